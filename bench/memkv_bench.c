@@ -0,0 +1,423 @@
+/*
+memkv_bench: YCSB风格的可复现基准测试
+
+  memkv_bench [-w A,B,C,D,E,F] [-d zipfian|uniform|latest] [-m raw,miaobyte]
+              [-r records] [-n ops] [-k keysizes] [-v valuesizes] [-p poolsize] [-s seed]
+              [-H prefault_threads]
+
+每个 workload x keymode x keysize x valuesize 组合输出一行JSON，包含吞吐、p50/p99/p999延迟(ns)
+以及key区、value区平均每个key占用的字节数，便于脚本比对回归。
+
+workload（同YCSB core workloads）：
+  A 50%读 50%更新      B 95%读 5%更新     C 100%读
+  D 95%读最新 5%插入   E 95%短前缀扫描 5%插入   F 50%读 50%读-改-写
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <memkv/memkv.h>
+#include <memkv/miaobyte.h>
+
+#define KEY_MAX 256
+
+typedef enum
+{
+    KM_RAW = 0,
+    KM_MIAOBYTE
+} keymode_t;
+
+typedef enum
+{
+    DIST_ZIPFIAN = 0,
+    DIST_UNIFORM,
+    DIST_LATEST
+} dist_t;
+
+typedef struct
+{
+    char name;
+    double read, update, insert, scan, rmw;
+    dist_t dist; // 该workload默认的分布
+} workload_t;
+
+static const workload_t workloads[] = {
+    {'A', 0.50, 0.50, 0.00, 0.00, 0.00, DIST_ZIPFIAN},
+    {'B', 0.95, 0.05, 0.00, 0.00, 0.00, DIST_ZIPFIAN},
+    {'C', 1.00, 0.00, 0.00, 0.00, 0.00, DIST_ZIPFIAN},
+    {'D', 0.95, 0.00, 0.05, 0.00, 0.00, DIST_LATEST},
+    {'E', 0.00, 0.00, 0.05, 0.95, 0.00, DIST_ZIPFIAN},
+    {'F', 0.50, 0.00, 0.00, 0.00, 0.50, DIST_ZIPFIAN},
+};
+
+typedef struct
+{
+    const char *workloads;
+    int dist; // -1表示使用workload默认
+    const char *keymodes;
+    uint64_t records;
+    uint64_t ops;
+    const char *keysizes;
+    const char *valuesizes;
+    size_t pool_size;
+    uint64_t seed;
+    int hugepage; // >0时用大页映射池、各区按大页对齐，并以该线程数预取
+} bench_opts_t;
+
+/* splitmix64，种子固定时结果可复现 */
+static uint64_t rng_state;
+static inline uint64_t rng_next(void)
+{
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+static inline double rng_double(void)
+{
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Gray等人的zipfian生成器，与YCSB一致，theta=0.99 */
+typedef struct
+{
+    uint64_t n;
+    double theta, alpha, zetan, eta;
+} zipf_t;
+
+static double zeta(uint64_t n, double theta)
+{
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++)
+        sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static void zipf_init(zipf_t *z, uint64_t n)
+{
+    z->n = n;
+    z->theta = 0.99;
+    z->alpha = 1.0 / (1.0 - z->theta);
+    z->zetan = zeta(n, z->theta);
+    double zeta2 = zeta(2, z->theta);
+    z->eta = (1 - pow(2.0 / n, 1 - z->theta)) / (1 - zeta2 / z->zetan);
+}
+
+static uint64_t zipf_next(const zipf_t *z)
+{
+    double u = rng_double();
+    double uz = u * z->zetan;
+    if (uz < 1.0)
+        return 0;
+    if (uz < 1.0 + pow(0.5, z->theta))
+        return 1;
+    uint64_t r = (uint64_t)(z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return r < z->n ? r : z->n - 1;
+}
+
+static inline uint64_t fnv64(uint64_t v)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++)
+    {
+        h ^= v & 0xff;
+        h *= 0x100000001B3ULL;
+        v >>= 8;
+    }
+    return h;
+}
+
+/* key为 "user" + 十进制序号，左侧补0到指定长度；raw和miaobyte两种模式下都是合法字符 */
+static size_t make_key(char *buf, uint64_t id, size_t keysize)
+{
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%llu", (unsigned long long)id);
+    size_t len = keysize > (size_t)n + 4 ? keysize : (size_t)n + 4;
+    if (len >= KEY_MAX)
+        len = KEY_MAX - 1;
+    memcpy(buf, "user", 4);
+    memset(buf + 4, '0', len - 4 - n);
+    memcpy(buf + len - n, num, n);
+    buf[len] = '\0';
+    return len;
+}
+
+typedef struct
+{
+    int (*set)(void *, const void *, size_t, const void *, size_t);
+    void *(*get)(void *, const void *, size_t);
+    void (*keys)(void *, const void *, size_t, void (*)(const void *, size_t));
+} kv_ops_t;
+
+static const kv_ops_t raw_ops = {memkv_set, memkv_get, memkv_keys};
+static const kv_ops_t miaobyte_ops = {miaobyte_set, miaobyte_get, miaobyte_keys};
+
+static uint64_t scan_count;
+static void scan_cb(const void *key_data, size_t key_len)
+{
+    (void)key_data;
+    (void)key_len;
+    scan_count++;
+}
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int run_one(const bench_opts_t *o, const workload_t *w, keymode_t km, size_t keysize, size_t valuesize)
+{
+    const kv_ops_t *ops = km == KM_RAW ? &raw_ops : &miaobyte_ops;
+    memkv_map_options_t mopts = {
+        .size = o->pool_size,
+        .hugepage = o->hugepage > 0,
+        .prefault_threads = (uint8_t)(o->hugepage > 0 ? o->hugepage : 0),
+    };
+    size_t pool_size = 0;
+    void *pool = memkv_map(NULL, &mopts, &pool_size);
+    if (!pool)
+    {
+        fprintf(stderr, "memkv_map failed\n");
+        return -1;
+    }
+    memkv_options_t iopts = {
+        .chartype = 256,
+        .keymem = 3,
+        .valueptrmem = 1,
+        .valuemem = 2,
+        .region_align = o->hugepage > 0 ? MEMKV_HUGEPAGE_SIZE : 0,
+    };
+    int r = km == KM_RAW ? memkv_init_ex(pool, pool_size, &iopts) : miaobyte_init_ex(pool, pool_size, &iopts);
+    if (r != MEMKV_SUCCESS)
+    {
+        fprintf(stderr, "init failed: %s\n", memkv_strerror(r));
+        memkv_unmap(pool, pool_size);
+        return -1;
+    }
+
+    rng_state = o->seed;
+    char key[KEY_MAX];
+    uint8_t *value = malloc(valuesize);
+    uint32_t *lat = malloc(sizeof(uint32_t) * o->ops);
+    if (!value || !lat)
+    {
+        free(value);
+        free(lat);
+        memkv_unmap(pool, pool_size);
+        return -1;
+    }
+    for (size_t i = 0; i < valuesize; i++)
+        value[i] = (uint8_t)('a' + i % 26);
+
+    /* 加载阶段 */
+    uint64_t loaded = 0;
+    for (; loaded < o->records; loaded++)
+    {
+        size_t len = make_key(key, loaded, keysize);
+        if (ops->set(pool, key, len, value, valuesize) != MEMKV_SUCCESS)
+            break;
+    }
+
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+
+    /* 运行阶段 */
+    dist_t dist = o->dist >= 0 ? (dist_t)o->dist : w->dist;
+    zipf_t zipf;
+    zipf_init(&zipf, loaded ? loaded : 1);
+    uint64_t inserted = loaded;
+    uint64_t errors = 0, misses = 0;
+    scan_count = 0;
+
+    uint64_t t_begin = now_ns();
+    for (uint64_t op = 0; op < o->ops; op++)
+    {
+        uint64_t id;
+        if (dist == DIST_UNIFORM)
+            id = rng_next() % (inserted ? inserted : 1);
+        else if (dist == DIST_LATEST)
+        {
+            uint64_t back = zipf_next(&zipf);
+            id = inserted > back ? inserted - 1 - back : 0;
+        }
+        else
+            id = fnv64(zipf_next(&zipf)) % (inserted ? inserted : 1);
+
+        double p = rng_double();
+        uint64_t t0 = now_ns();
+        if (p < w->read)
+        {
+            size_t len = make_key(key, id, keysize);
+            if (!ops->get(pool, key, len))
+                misses++;
+        }
+        else if (p < w->read + w->update)
+        {
+            size_t len = make_key(key, id, keysize);
+            if (ops->set(pool, key, len, value, valuesize) != MEMKV_SUCCESS)
+                errors++;
+        }
+        else if (p < w->read + w->update + w->insert)
+        {
+            size_t len = make_key(key, inserted, keysize);
+            if (ops->set(pool, key, len, value, valuesize) != MEMKV_SUCCESS)
+                errors++;
+            else
+                inserted++;
+        }
+        else if (p < w->read + w->update + w->insert + w->scan)
+        {
+            size_t len = make_key(key, id, keysize);
+            ops->keys(pool, key, len > 2 ? len - 2 : len, scan_cb);
+        }
+        else
+        {
+            size_t len = make_key(key, id, keysize);
+            uint8_t *v = ops->get(pool, key, len);
+            if (!v)
+                misses++;
+            else
+            {
+                v[0] ^= 1;
+                if (ops->set(pool, key, len, v, valuesize) != MEMKV_SUCCESS)
+                    errors++;
+            }
+        }
+        uint64_t dt = now_ns() - t0;
+        lat[op] = dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt;
+    }
+    uint64_t t_total = now_ns() - t_begin;
+
+    qsort(lat, o->ops, sizeof(uint32_t), cmp_u32);
+    uint32_t p50 = o->ops ? lat[o->ops * 50 / 100] : 0;
+    uint32_t p99 = o->ops ? lat[o->ops * 99 / 100] : 0;
+    uint32_t p999 = o->ops ? lat[o->ops * 999 / 1000] : 0;
+    static const char *dist_names[] = {"zipfian", "uniform", "latest"};
+
+    printf("{\"workload\":\"%c\",\"dist\":\"%s\",\"keymode\":\"%s\",\"key_size\":%zu,\"value_size\":%zu,"
+           "\"pool_size\":%zu,\"records\":%llu,\"ops\":%llu,\"seed\":%llu,"
+           "\"throughput_ops\":%.0f,\"p50_ns\":%u,\"p99_ns\":%u,\"p999_ns\":%u,"
+           "\"key_bytes_per_key\":%.1f,\"value_bytes_per_key\":%.1f,"
+           "\"misses\":%llu,\"errors\":%llu,\"scanned\":%llu}\n",
+           w->name, dist_names[dist], km == KM_RAW ? "raw" : "miaobyte", keysize, valuesize,
+           o->pool_size, (unsigned long long)loaded, (unsigned long long)o->ops, (unsigned long long)o->seed,
+           t_total ? o->ops * 1e9 / t_total : 0.0, p50, p99, p999,
+           loaded ? (double)st.nodes * st.node_size / loaded : 0.0,
+           loaded ? (double)st.value_alloc_bytes / loaded : 0.0,
+           (unsigned long long)misses, (unsigned long long)errors, (unsigned long long)scan_count);
+    fflush(stdout);
+
+    free(value);
+    free(lat);
+    memkv_unmap(pool, pool_size);
+    return 0;
+}
+
+static size_t parse_size(const char *s)
+{
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (*end == 'K' || *end == 'k')
+        v <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        v <<= 20;
+    else if (*end == 'G' || *end == 'g')
+        v <<= 30;
+    return (size_t)v;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -w <list>   workloads, e.g. A,B,C,D,E,F (default A,B,C)\n"
+            "  -d <dist>   zipfian|uniform|latest (default: per workload)\n"
+            "  -m <list>   key modes raw,miaobyte (default raw,miaobyte)\n"
+            "  -r <n>      records to load (default 100000)\n"
+            "  -n <n>      operations per run (default 1000000)\n"
+            "  -k <list>   key sizes in bytes (default 16)\n"
+            "  -v <list>   value sizes in bytes (default 64)\n"
+            "  -p <size>   pool size [K|M|G] (default 1G)\n"
+            "  -s <seed>   random seed (default 1)\n"
+            "  -H <n>      map the pool with huge pages, align regions and prefault with n threads\n"
+            "Each run prints one JSON line.\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    bench_opts_t o = {"A,B,C", -1, "raw,miaobyte", 100000, 1000000, "16", "64", (size_t)1 << 30, 1, 0};
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *a = argv[i], *v = argv[++i];
+        if (strcmp(a, "-w") == 0)
+            o.workloads = v;
+        else if (strcmp(a, "-d") == 0)
+            o.dist = strcmp(v, "uniform") == 0 ? DIST_UNIFORM : strcmp(v, "latest") == 0 ? DIST_LATEST : DIST_ZIPFIAN;
+        else if (strcmp(a, "-m") == 0)
+            o.keymodes = v;
+        else if (strcmp(a, "-r") == 0)
+            o.records = strtoull(v, NULL, 0);
+        else if (strcmp(a, "-n") == 0)
+            o.ops = strtoull(v, NULL, 0);
+        else if (strcmp(a, "-k") == 0)
+            o.keysizes = v;
+        else if (strcmp(a, "-v") == 0)
+            o.valuesizes = v;
+        else if (strcmp(a, "-p") == 0)
+            o.pool_size = parse_size(v);
+        else if (strcmp(a, "-s") == 0)
+            o.seed = strtoull(v, NULL, 0);
+        else if (strcmp(a, "-H") == 0)
+            o.hugepage = atoi(v);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int ret = 0;
+    for (const char *w = o.workloads; *w; w++)
+    {
+        const workload_t *wl = NULL;
+        for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+        {
+            if (workloads[i].name == *w)
+                wl = &workloads[i];
+        }
+        if (!wl)
+            continue;
+        for (int km = KM_RAW; km <= KM_MIAOBYTE; km++)
+        {
+            if (!strstr(o.keymodes, km == KM_RAW ? "raw" : "miaobyte"))
+                continue;
+            for (const char *ks = o.keysizes; ks && *ks; ks = strchr(ks, ',') ? strchr(ks, ',') + 1 : NULL)
+            {
+                for (const char *vs = o.valuesizes; vs && *vs; vs = strchr(vs, ',') ? strchr(vs, ',') + 1 : NULL)
+                {
+                    if (run_one(&o, wl, (keymode_t)km, strtoul(ks, NULL, 0), strtoul(vs, NULL, 0)) != 0)
+                        ret = 1;
+                }
+            }
+        }
+    }
+    return ret;
+}
@@ -42,6 +42,7 @@ box区：
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef enum {
     MEMKV_SUCCESS = 0,           // 操作成功
@@ -54,15 +55,329 @@ typedef enum {
     MEMKV_ERROR_KEY_EXISTS = -7,     // 键已存在（可选，用于set操作）
     MEMKV_ERROR_PREFIX_TOO_LONG = -8, // 前缀过长
     MEMKV_ERROR_CHAR_OUT_OF_RANGE = -9, // 字符索引超出范围
-    MEMKV_ERROR_UNKNOWN = -10         // 未知错误
+    MEMKV_ERROR_UNKNOWN = -10,        // 未知错误
+    MEMKV_ERROR_CAS_MISMATCH = -11,   // cas时当前值与期望值不一致
+    MEMKV_ERROR_FROZEN = -12,         // 池已冻结为只读格式，不支持该操作
+    MEMKV_ERROR_TIMEOUT = -13,        // watch等待超时
+    MEMKV_ERROR_VERSION = -14,        // 池的格式版本与本库不一致
+    MEMKV_ERROR_CORRUPT = -15,        // 一致性检查发现错误
+    MEMKV_ERROR_COMPRESSED = -16      // value压缩存储，没有零拷贝指针，需用memkv_read读取
 } memkv_error_t;
 
+typedef enum {
+    MEMKV_EVICT_NONE = 0, // 默认：池满时返回 MEMKV_ERROR_ALLOC_FAILED
+    MEMKV_EVICT_LFU = 1,  // cache模式：池满时采样若干key，淘汰访问计数最低的，然后重试分配
+    MEMKV_EVICT_TIER = 2, // 分层模式：池满时采样若干key，把访问计数最低的value搬到冷文件（memkv_tier_attach），get时再搬回
+} memkv_evict_policy_t;
+
+// 两阶段写入的预留句柄，由memkv_reserve填写
+typedef struct {
+    uint64_t box_offset; // 预留的box，commit或abort之后为-1
+    void *data;          // 可直接写入value的指针
+    size_t cap;          // 可写入的最大长度
+} memkv_reservation_t;
+
+// 写批次：暂存若干set/del，commit时一次发布，见 memkv_batch_commit；内容拷贝在进程内的缓冲区
+typedef struct {
+    void *pool;
+    uint8_t *buf;   // 依次为 操作(1字节)+key长度(4字节)+value长度(4字节)+key+value
+    size_t len;
+    size_t cap;
+    uint32_t ops;
+} memkv_batch_t;
+
+// memkv_init_ex 的参数
+typedef struct {
+    uint16_t chartype;   // 字符类别数量
+    uint8_t keymem;      // key区、valueptr区、value区的比例
+    uint8_t valueptrmem;
+    uint8_t valuemem;
+    uint64_t filter_keys; // 预计的key数量，>0时在池中开辟计数布隆过滤器，get未命中时只需访问一个cache line
+    uint64_t region_align; // key/valueptr/value区起始偏移的对齐（2的幂，如MEMKV_HUGEPAGE_SIZE），0表示64字节
+    uint64_t dedup_values; // 预计的不同value数量，>0时开启value去重：set写入相同内容的value共享一个引用计数的box
+    uint32_t dedup_min;    // 参与去重的最小value长度，0表示16字节
+    uint32_t compress_min;  // >0时set把不短于该长度的value压缩存储，读取用memkv_read
+    uint32_t compress_dict; // 池内共享压缩字典区的字节数，0表示不使用字典，见memkv_set_dict
+} memkv_options_t;
+
+#define MEMKV_HUGEPAGE_SIZE (2ULL << 20)
+
+// memkv_scan 的回调：worker为工作线程序号；key_data只在回调期间有效，value_data指向池内，压缩的value为NULL（value_len为原长）
+typedef void (*memkv_scan_func_t)(void *arg, int worker, const void *key_data, size_t key_len, void *value_data, size_t value_len);
+
+// memkv_scan 的参数
+typedef struct {
+    int threads;      // 工作线程数，0表示在线CPU数
+    bool ordered;     // true时所有回调都在调用线程上按字典序发生（worker恒为0），子树结果先缓冲再按序输出
+    size_t min_tasks; // 按层拆分前缀树直到子树任务数不少于该值，0表示threads*8
+} memkv_scan_options_t;
+
+// memkv_range 的回调，返回false时提前结束；压缩的value与memkv_scan一样给出NULL和原长
+typedef bool (*memkv_range_func_t)(void *arg, const void *key_data, size_t key_len, void *value_data, size_t value_len);
+
+// memkv_map 的参数
+typedef struct {
+    uint64_t size;            // 文件小于该值时扩展到该大小，0表示使用现有文件大小；path为NULL时是匿名映射的大小
+    bool hugepage;            // 文件位于hugetlbfs时本身即大页；否则对映射做MADV_HUGEPAGE（tmpfs需shmem_enabled=advise）
+    uint8_t prefault_threads; // 0不预取；1单线程预取；>1多线程并行预取，避免启动后的缺页风暴
+} memkv_map_options_t;
+
+#define MEMKV_FORMAT_VERSION 7 // 池和冻结镜像的格式版本，布局不兼容地变化时递增
+
+// memkv_open 的标志
+// PROT_READ映射：只能用memkv_lookup、memkv_keys、memkv_stats、memkv_hot_snapshot这些不写池的函数；
+// memkv_get（cache模式更新访问计数）、memkv_watch（在version上置等待者标记）等会写池，需要可写打开
+#define MEMKV_OPEN_RDONLY   0x1
+#define MEMKV_OPEN_HUGEPAGE 0x2 // 同 memkv_map_options_t.hugepage
+#define MEMKV_OPEN_PREFAULT 0x4 // 映射时预取整个池
+
+// memkv_open 打开的池，区域基址在打开时算好；只有memkv_lookup用这些缓存的基址，
+// 把kv->pool传给memkv_get/memkv_find/memkv_read等时它们仍按池头里的偏移逐次计算
+typedef struct {
+    void *pool;             // 映射基址，可直接传给memkv_*函数
+    size_t pool_len;
+    int flags;
+    bool frozen;            // 冻结的只读镜像
+    const uint8_t *keys;    // key区基址，冻结镜像为NULL
+    const uint8_t *values;  // value区基址
+} memkv_t;
+
+// memkv_check 的参数
+typedef struct {
+    int threads;  // 检查线程数，0表示在线CPU数
+    bool repair;  // 丢弃坏的子树和value不合法的key，按实际结果重写计数器；期间必须独占池
+} memkv_check_options_t;
+
+// memkv_check 的结果
+typedef struct {
+    uint64_t nodes;              // 可达的节点数
+    uint64_t keys;               // 可达的key数（repair后为保留下来的）
+    uint64_t value_boxes;        // key引用的池内box数，共享box算一个
+    uint64_t dedup_boxes;        // 去重索引中的表项数
+    uint64_t bad_links;          // 指向越界、未分配或空闲页的子节点指针
+    uint64_t shared_links;       // 指向已被引用过的节点（多个父节点或成环）
+    uint64_t bad_values;         // box头部或范围不合法、指向空闲box、冷记录越界
+    uint64_t overlapping_boxes;  // 与其他box重叠，或未登记却被多个key引用的box
+    uint64_t dedup_mismatches;   // 去重表项的引用数与实际引用的key数不符
+    uint64_t counter_mismatches; // meta里的统计计数与重新统计的不符
+    uint64_t errors;             // 以上问题之和
+    uint64_t dropped_subtrees;   // repair丢弃的子树
+    uint64_t dropped_keys;       // repair去掉的key
+} memkv_check_report_t;
+
+// 池的统计信息，来自写路径维护的计数器，开销很小，可以频繁采集
+typedef struct {
+    uint64_t keys;               // 存活的key数量
+    uint64_t nodes;              // 前缀树节点数量（只有一种可变节点格式），含根
+    uint64_t node_size;          // 每个节点的字节数
+    uint64_t node_capacity;      // key区可容纳的节点数（按区大小估算）
+    uint64_t nodes_free;         // 估算的空闲节点数
+    double avg_depth;            // key的平均深度
+
+    uint64_t value_region_size;  // value区大小
+    uint64_t value_boxes;        // 已分配的box数量
+    uint64_t value_alloc_bytes;  // box占用的字节
+    uint64_t value_used_bytes;   // value实际长度之和
+    uint64_t value_largest_free; // 能分配的最大连续空间（2的幂下界），writer每几百次分配释放探测一次，可能略为滞后
+    double value_internal_frag;  // 内部碎片率 1-used/alloc
+    double value_external_frag;  // 外部碎片率 1-largest_free/free
+
+    uint64_t evictions;          // 累计淘汰的key数量
+    uint64_t filter_bytes;       // 过滤器大小
+    uint64_t dedup_boxes;        // 去重后被共享的box数量
+    uint64_t dedup_saved_bytes;  // 共享box省下的value区字节
+    uint64_t compressed_values;  // 压缩存储的value数量
+    uint64_t compressed_raw_bytes; // 压缩value的原长之和
+    uint64_t compressed_bytes;   // 压缩value存储的字节之和
+    double compress_ratio;       // compressed_raw_bytes/compressed_bytes，没有压缩value时为0
+    uint64_t cold_values;        // 在冷文件中的value数量
+    uint64_t cold_bytes;         // 冷value的长度之和
+    uint64_t tier_demotions;     // 累计搬到冷文件的次数
+    uint64_t tier_promotions;    // 累计搬回池内的次数
+} memkv_stats_t;
+
+// 小value按大小级别从slab分配，每个级别的占用情况；size含8字节value头部
+#define MEMKV_SLAB_CLASSES 27
+typedef struct {
+    uint32_t size;            // 块大小
+    uint32_t chunks_per_slab; // 每个slab的块数
+    uint64_t slabs;           // 该级别的slab数
+    uint64_t chunks;          // 已分出的块数，含writer缓存中未用的
+    uint64_t values;          // 被value占用的块数
+    uint64_t value_bytes;     // 这些value的长度之和，与values*size的差即内部碎片
+} memkv_slab_stats_t;
+
+// 热路径埋点，编译memkv时开启MEMKV_PROBE才会有数据；统计区在池内，可被其他进程读取
+typedef enum {
+    MEMKV_OP_GET = 0,
+    MEMKV_OP_MALLOC,
+    MEMKV_OP_DEL,
+    MEMKV_OP_KEYS,
+    MEMKV_OP_MAX
+} memkv_op_t;
+
+#define MEMKV_PROBE_BUCKETS 96
+typedef struct {
+    uint64_t count;
+    uint64_t errors;     // get/del未找到，malloc分配失败
+    uint64_t depth_sum;  // 实际下降到的前缀树层数之和（被过滤器挡掉的为0）
+    uint64_t ticks_sum;
+    uint64_t hist[MEMKV_PROBE_BUCKETS]; // 对数线性延迟直方图，单位为ticks
+} memkv_probe_op_t;
+
+typedef struct {
+    uint32_t enabled;     // 有数据写入过
+    uint32_t unit_is_tsc; // 1: ticks为rdtsc周期，0: ticks为纳秒
+    memkv_probe_op_t ops[MEMKV_OP_MAX];
+} memkv_probe_t;
+
+// 热点采样：每sample_rate次get/malloc抽一次，key和它的各级前缀计入池内的count-min sketch和top-K表，
+// 其他进程（miaobyte top）可直接读取快照。count为衰减后的采样次数，乘sample_rate约为访问次数
+#define MEMKV_HOT_KEY_MAX 48     // 表中保留的key前缀长度，更长的key只记录这么多字节
+#define MEMKV_HOT_TOPK 16        // 热点key表的大小
+#define MEMKV_HOT_DEPTHS 16      // 统计热点前缀的最大深度
+#define MEMKV_HOT_PREFIX_TOPK 4  // 每个深度的热点前缀表大小
+typedef struct {
+    uint64_t count;
+    uint32_t len;                  // key（前缀）的完整长度，大于MEMKV_HOT_KEY_MAX时key被截断
+    uint8_t key[MEMKV_HOT_KEY_MAX];
+} memkv_hot_entry_t;
+
+typedef struct {
+    uint32_t sample_rate; // 0表示未开启
+    uint64_t samples;     // 累计采样次数，不衰减
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t depth_samples[MEMKV_HOT_DEPTHS + 1]; // 按key长度分布，最后一格收纳更长的key
+    uint32_t nkeys;
+    memkv_hot_entry_t keys[MEMKV_HOT_TOPK]; // 按count降序
+    uint32_t nprefixes[MEMKV_HOT_DEPTHS];
+    memkv_hot_entry_t prefixes[MEMKV_HOT_DEPTHS][MEMKV_HOT_PREFIX_TOPK]; // prefixes[d]为长度d+1的前缀，按count降序
+} memkv_hot_t;
+
+int memkv_init_ex(void *pool_data, size_t pool_len, const memkv_options_t *opts);
+// 映射池文件，基址按大页对齐，可选大页与预取；失败返回NULL
+void *memkv_map(const char *path, const memkv_map_options_t *opts, size_t *pool_len);
+void memkv_unmap(void *pool_data, size_t pool_len);
+// 映射已初始化的池文件（或冻结镜像）并校验魔数、格式版本和大小；版本不符返回MEMKV_ERROR_VERSION。
+// 只读打开只有open+fstat+mmap和几次比较，适合大量短命的reader进程
+int memkv_open(memkv_t *kv, const char *path, int flags);
+// 释放本线程的writer槽位和冷文件映射，解除映射
+void memkv_close(memkv_t *kv);
+// 纯读的查找，只用打开时缓存的基址，不更新访问计数，也不把冷value搬回池内（直接指向冷文件的映射），
+// 可在只读映射上使用；压缩的value返回NULL并在*value_len给出原长，内容用memkv_read读取，key不存在时*value_len为0
+const void *memkv_lookup(const memkv_t *kv, const void *key_data, size_t key_len, size_t *value_len);
+// 写入模型：多个线程、多个共享mmap的进程可以同时set/malloc/realloc/del/commit/incr，新节点用CAS挂上前缀树，
+// 同一个key的写在池内的key锁下串行；reader不受限制。cache模式（淘汰会回收节点）、batch_commit、tier_demote、
+// check和set_dict独占写入，与其他writer互斥。malloc/realloc返回后写value不在锁内，同一个key的并发写由调用方协调。
+// 每个writer线程有自己的分配缓存，见memkv_writer_detach
+// 把当前线程在该池上的分配缓存还给全局分配器并释放writer槽位；线程退出前或unmap前调用。
+// 不调用也不会泄漏：线程退出后其他writer会回收它的槽位
+void memkv_writer_detach(void *pool_data);
 int memkv_init(void *pool_data, size_t pool_len, uint16_t chartype, uint8_t keymem, uint8_t valueptrmem, uint8_t valuemem);
 int memkv_set(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
 void* memkv_malloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len);
+// 改变key对应value的长度并保留原有数据，能原地伸缩时不重新分配；key不存在时等同于memkv_malloc
+void* memkv_realloc(void *pool_data, const void *key_data, size_t key_len, size_t value_len);
+// 两阶段写入：reserve预留value空间并返回可写指针，此时key还不可见；
+// 写完后commit把value原子地发布到key上（value_len<=cap），或者abort放弃
+void* memkv_reserve(void *pool_data, size_t value_len, memkv_reservation_t *res);
+int memkv_commit(void *pool_data, const void *key_data, size_t key_len, memkv_reservation_t *res, size_t value_len);
+void memkv_abort(void *pool_data, memkv_reservation_t *res);
+// 写批次：set/del只暂存，commit先为所有set分配好box、建好节点，再在一次写序列号内发布全部操作；
+// 任何一步分配失败都不发布，返回错误并保留批次，可重试。成功后批次清空，可继续使用；不用时batch_free
+// 批内同一key的多次操作按暂存顺序生效；value不参与去重，按池的compress_min压缩
+void memkv_batch_init(memkv_batch_t *batch, void *pool_data);
+int memkv_batch_set(memkv_batch_t *batch, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
+int memkv_batch_del(memkv_batch_t *batch, const void *key_data, size_t key_len);
+int memkv_batch_commit(memkv_batch_t *batch);
+void memkv_batch_free(memkv_batch_t *batch);
+// 跨多个key的一致读：read_begin返回写序列号（等到没有批次在发布），读完后read_retry为true说明期间有批次提交，需要重读；
+// 批次的value写在新box里再换上，单个key的get本身总是看到完整的旧value或新value（memkv_set原地覆盖时不保证）
+// 发布批次的进程中途退出时，read_begin在确认它已退出后返回，读到的是已换上的部分，下一个批次提交时恢复
+uint64_t memkv_read_begin(void *pool_data);
+bool memkv_read_retry(void *pool_data, uint64_t seq);
+// 开启去重的池中get返回的value可能被多个key共享，只能读；修改请通过memkv_malloc/memkv_realloc（写时复制）
+// 压缩存储的value没有零拷贝指针，get返回NULL，用memkv_read读取；要和key不存在区分开时用memkv_find
 void* memkv_get(void *pool_data, const void *key_data, size_t key_len);
+// 与memkv_get相同，但返回状态：找到时*value为value指针、*value_len为长度，返回MEMKV_SUCCESS；
+// key不存在返回MEMKV_ERROR_KEY_NOT_FOUND；value压缩存储时*value为NULL、*value_len为原长，返回MEMKV_ERROR_COMPRESSED；
+// 冷value搬回池内失败返回MEMKV_ERROR_ALLOC_FAILED。输出参数都可为NULL
+int memkv_find(void *pool_data, const void *key_data, size_t key_len, void **value, size_t *value_len);
+// 把value拷贝（压缩的先解压）到buf，*value_len为原长；buf为NULL时只查询长度，buf_cap不够时返回MEMKV_ERROR_INVALID_ARG
+int memkv_read(void *pool_data, const void *key_data, size_t key_len, void *buf, size_t buf_cap, size_t *value_len);
+// 不论池的compress_min都尝试压缩这个value，压缩省不下1/8时按原样存储
+int memkv_set_compressed(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
+// 设置池内共享的压缩字典（不超过compress_dict字节），只能在没有压缩value时设置或替换
+int memkv_set_dict(void *pool_data, const void *dict, size_t dict_len);
+// 从样本value训练字典写入dict，返回字典长度
+size_t memkv_dict_train(const void *const *samples, const size_t *sample_lens, size_t nsamples, void *dict, size_t dict_cap);
 int memkv_del(void *pool_data, const void *key_data, size_t key_len);
 void memkv_keys(void *pool_data, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len));
+// 多线程遍历prefix下的所有key和value：在扇出足够的前几层拆分子树，由work-stealing线程池扫描，
+// 空闲线程出现时正在扫描的线程继续把子树拆给它；opts可为NULL
+int memkv_scan(void *pool_data, const void *prefix_data, size_t prefix_len, const memkv_scan_options_t *opts, memkv_scan_func_t func, void *arg);
+
+// 按字典序的邻居查找：lower_bound为第一个>=key的key，successor为第一个>key的key，predecessor为最后一个<key的key。
+// 找到时把key写入key_buf（容量key_cap，放不下返回MEMKV_ERROR_INVALID_ARG）、长度写入*found_len、value指针写入*value，
+// 输出参数都可为NULL；没有这样的key时返回MEMKV_ERROR_KEY_NOT_FOUND。key_len为0表示空key（lower_bound得到最小的key）
+int memkv_lower_bound(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+int memkv_successor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+int memkv_predecessor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+// 按字典序回调[start, end)内的key，start为NULL表示从最小的key开始，end为NULL表示不设上界；
+// 回调返回false时提前结束。返回回调的次数，出错时返回负的错误码
+int memkv_range(void *pool_data, const void *start_data, size_t start_len, const void *end_data, size_t end_len, memkv_range_func_t func, void *arg);
+
+// 把池冻结为紧凑的只读LOUDS前缀树写入dst：dst为NULL时只在*frozen_len返回所需大小，冻结期间源池不能有writer。
+// 冻结后的镜像可直接mmap，memkv_get/memkv_keys/memkv_stats按魔数识别，写操作、scan和range返回MEMKV_ERROR_FROZEN
+int memkv_freeze(void *pool_data, void *dst, size_t dst_len, size_t *frozen_len);
+
+// 分层存储：给池挂一个冷value文件（不存在时按size创建），路径记在池里，其他进程首次访问冷value时自动映射。
+// 冷value对get透明：命中时在key锁下搬回池内；搬回时池满会淘汰，和cache模式的写一样独占写入
+int memkv_tier_attach(void *pool_data, const char *path, size_t size);
+// 解除本进程对冷文件的映射，unmap池之前调用
+void memkv_tier_detach(void *pool_data);
+// 把衰减后访问计数<=max_freq的value搬到冷文件，最多搬max_bytes字节（0表示不限）；返回搬动的个数或负的错误码
+int memkv_tier_demote(void *pool_data, uint8_t max_freq, uint64_t max_bytes);
+
+// watch：*version与key（prefix=true时为整个前缀子树）当前的变更计数不同时立即返回，否则阻塞到有writer
+// 发布或删除它为止（futex，跨进程，不耗CPU）；返回时*version更新为最新计数。timeout_ms<0为不限时，
+// 超时返回MEMKV_ERROR_TIMEOUT，*version不变。首次可传timeout_ms=0取得当前计数。
+// key不存在时不为它建节点，而是等在最近的已有前缀上，同一前缀下其他key的写也会唤醒，醒来后需重新检查key。
+// set/commit/del/incr在数据就绪后通知；memkv_malloc/realloc不通知，调用方写完value后调用memkv_notify
+int memkv_watch(void *pool_data, const void *key_data, size_t key_len, bool prefix, uint32_t *version, int timeout_ms);
+// 唤醒key及其前缀上的watch者；key不存在时只通知前缀watch，返回MEMKV_ERROR_KEY_NOT_FOUND
+int memkv_notify(void *pool_data, const void *key_data, size_t key_len);
+
+// 一致性检查：多线程按子树检查节点指针、value box和统计计数，期间独占写入，并发的writer等检查结束。
+// 无错误返回MEMKV_SUCCESS；有错误且未repair返回MEMKV_ERROR_CORRUPT，repair后返回MEMKV_SUCCESS，细节在report中
+int memkv_check(void *pool_data, const memkv_check_options_t *opts, memkv_check_report_t *report);
+
+// 原子数值操作，value为8字节int64，原地修改，可跨进程共享mmap使用
+// incr在key不存在时按0创建；fetch_add/cas在key不存在时返回MEMKV_ERROR_KEY_NOT_FOUND
+int memkv_incr(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value);
+int memkv_fetch_add(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *old_value);
+int memkv_cas(void *pool_data, const void *key_data, size_t key_len, int64_t expected, int64_t desired, int64_t *actual);
+
+int memkv_stats(void *pool_data, memkv_stats_t *stats);
+// 填充至多max个级别，返回填充的级别数（冻结镜像为0）或错误码
+int memkv_slab_stats(void *pool_data, memkv_slab_stats_t *classes, int max);
+
+// 返回池内的埋点统计区；memkv_probe_flush把当前线程尚未合并的计数写入共享区（线程退出时自动合并）
+const memkv_probe_t *memkv_probe(void *pool_data);
+void memkv_probe_flush(void);
+int memkv_probe_bucket(uint64_t ticks);
+uint64_t memkv_probe_bucket_floor(int bucket);
+
+// 热点采样：sample_rate为N表示平均每N次get/malloc采样一次，0关闭；开关是池内的一个字段，对所有进程生效
+int memkv_hot_enable(void *pool_data, uint32_t sample_rate);
+// 清空sketch和top-K表，不改变采样率
+int memkv_hot_reset(void *pool_data);
+// 取一份一致的快照，只读，可在只读映射上使用
+int memkv_hot_snapshot(const void *pool_data, memkv_hot_t *out);
+
+// 设置淘汰策略，samples=0 时使用默认采样数
+int memkv_set_evict(void *pool_data, memkv_evict_policy_t policy, uint8_t samples);
 
 // 返回错误码对应的字符串描述
 const char* memkv_strerror(memkv_error_t err);
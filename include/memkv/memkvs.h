@@ -0,0 +1,51 @@
+#ifndef MEMKVS_H
+#define MEMKVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <memkv/memkv.h>
+
+/*
+memkvs: 把key按哈希分散到N个独立的memkv池（分片）上
+
+每个分片有自己的meta、key区和分配器，写不同分片的writer之间没有任何竞争；
+点操作按key的哈希路由到一个分片，keys(prefix)对各分片的有序结果做k路归并，输出仍按字典序。
+路由只取决于分片数和分片顺序，重新打开时两者必须与写入时一致。
+*/
+
+#define MEMKVS_MAX_SHARDS 256
+
+typedef struct {
+    uint32_t nshards;
+    void *pools[MEMKVS_MAX_SHARDS];
+    size_t pool_lens[MEMKVS_MAX_SHARDS];
+    bool mapped; // 分片由memkvs_open映射，memkvs_close时解除映射
+} memkvs_t;
+
+// memkvs_open 的参数
+typedef struct {
+    memkv_options_t init;    // 分片文件尚未初始化时使用的参数
+    memkv_map_options_t map; // 每个分片的映射参数，size为单个分片的大小
+    int numa_nodes;          // >0时把第i个分片的内存绑定到NUMA节点 i % numa_nodes
+} memkvs_options_t;
+
+// 按path_fmt（含一个%u，取分片序号）打开或创建nshards个分片文件
+int memkvs_open(memkvs_t *kvs, const char *path_fmt, uint32_t nshards, const memkvs_options_t *opts);
+// 使用调用方已映射好的nshards块内存作为分片，init非NULL时初始化尚未初始化的分片
+int memkvs_attach(memkvs_t *kvs, void *const *pools, const size_t *pool_lens, uint32_t nshards, const memkv_options_t *init);
+void memkvs_close(memkvs_t *kvs);
+
+// key所在的分片序号
+uint32_t memkvs_shard(const memkvs_t *kvs, const void *key_data, size_t key_len);
+
+int memkvs_set(memkvs_t *kvs, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
+void* memkvs_malloc(memkvs_t *kvs, const void *key_data, size_t key_len, size_t value_len);
+void* memkvs_get(memkvs_t *kvs, const void *key_data, size_t key_len);
+int memkvs_del(memkvs_t *kvs, const void *key_data, size_t key_len);
+int memkvs_incr(memkvs_t *kvs, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value);
+// 所有分片中以prefix开头的key，按字典序回调
+int memkvs_keys(memkvs_t *kvs, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len));
+
+#endif // MEMKVS_H
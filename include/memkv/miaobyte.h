@@ -7,11 +7,29 @@
 #include <memkv/memkv.h>
 
 int miaobyte_init(void *pool_data,const size_t pool_len,uint8_t keymem,uint8_t valueptrmem,uint8_t valuemem);
+int miaobyte_init_ex(void *pool_data,const size_t pool_len,memkv_options_t *opts); // opts->chartype 会被设为48
 void* miaobyte_malloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len);
+void* miaobyte_realloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len);
 int miaobyte_set(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
+int miaobyte_commit(void *pool_data, const void *key_data, size_t key_len, memkv_reservation_t *res, size_t value_len);
 void* miaobyte_get(void *pool_data, const void *key_data, size_t key_len);
+int miaobyte_find(void *pool_data, const void *key_data, size_t key_len, void **value, size_t *value_len);
+int miaobyte_read(void *pool_data, const void *key_data, size_t key_len, void *buf, size_t buf_cap, size_t *value_len);
 int miaobyte_del(void *pool_data, const void *key_data, size_t key_len);
+int miaobyte_batch_set(memkv_batch_t *batch, const void *key_data, size_t key_len, const void *value_data, size_t value_len);
+int miaobyte_batch_del(memkv_batch_t *batch, const void *key_data, size_t key_len);
+int miaobyte_watch(void *pool_data, const void *key_data, size_t key_len, bool prefix, uint32_t *version, int timeout_ms);
+int miaobyte_notify(void *pool_data, const void *key_data, size_t key_len);
+int miaobyte_incr(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value);
+int miaobyte_fetch_add(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *old_value);
+int miaobyte_cas(void *pool_data, const void *key_data, size_t key_len, int64_t expected, int64_t desired, int64_t *actual);
 void miaobyte_keys(void *pool_data, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len));
+int miaobyte_scan(void *pool_data, const void *prefix_data, size_t prefix_len, const memkv_scan_options_t *opts, memkv_scan_func_t func, void *arg); // 回调收到的是编码后的key
+// 有序查找与范围遍历，顺序按编码后的字节（a-z < 0-9 < 空格和符号），输出的key是编码后的字节
+int miaobyte_lower_bound(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+int miaobyte_successor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+int miaobyte_predecessor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value);
+int miaobyte_range(void *pool_data, const void *start_data, size_t start_len, const void *end_data, size_t end_len, memkv_range_func_t func, void *arg);
 
 int miaobyte_encode(const char *str, uint8_t *bytes, size_t len) ;
 int miaobyte_decode(const uint8_t *bytes, char *str, size_t len) ;
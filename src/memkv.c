@@ -1,15 +1,23 @@
 #include <stddef.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
 
 #include <memkv/memkv.h>
 #include "memkv_common.h"
+#include "memkv_hash.h"
+#include "memkv_probe.h"
+#include "memkv_hot.h"
 #include "logutil.h"
 
 static size_t keynode_size(const memkv_meta_t *meta)
 {
-    return  sizeof(uint64_t)+ sizeof(int32_t)*meta->char_type;
+    size_t raw = offsetof(key_node_t, child_key_blocks) + sizeof(int32_t) * meta->char_type;
+    return (raw + KEYNODE_ALIGN - 1) & ~(size_t)(KEYNODE_ALIGN - 1);
 }
 static int keynode_init(const memkv_meta_t *meta,void *nodeptr)
 {
@@ -19,8 +27,7 @@ static int keynode_init(const memkv_meta_t *meta,void *nodeptr)
         return -1;
     }
     key_node_t *node = (key_node_t *)nodeptr;
-    node->has_key = false;
-    node->box_offset = 0;
+    memset(node, 0, offsetof(key_node_t, child_key_blocks));
     for (size_t i = 0; i < meta->char_type; i++)
     {
         node->child_key_blocks[i] = -1; // 初始化所有子节点=-1
@@ -28,6 +35,422 @@ static int keynode_init(const memkv_meta_t *meta,void *nodeptr)
     return 0;
 }
 
+static bool keynode_has_child(const memkv_meta_t *meta, const key_node_t *node)
+{
+    for (size_t i = 0; i < meta->char_type; i++)
+    {
+        if (node->child_key_blocks[i] >= 0)
+            return true;
+    }
+    return false;
+}
+
+// 分配一个节点槽位：优先放在near所在的页（父节点旁边），页满时新开一页；失败返回-1。
+// 多个writer可能同时在同一页里分配，槽位用CAS认领；新开的页发布之前只有自己看得到
+static int32_t keynode_alloc(memkv_meta_t *meta, void *key_start, int32_t near)
+{
+    uint32_t all = (1u << meta->node_page_slots) - 1;
+    if (near >= 0)
+    {
+        key_page_t *page = keypage_at(meta, key_start, near);
+        uint32_t used = __atomic_load_n(&page->used, __ATOMIC_RELAXED);
+        while (~used & all)
+        {
+            int slot = __builtin_ctz(~used & all);
+            if (__atomic_compare_exchange_n(&page->used, &used, used | 1u << slot, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+                return (near & ~KEYNODE_SLOT_MASK) | slot;
+        }
+    }
+    int64_t page_id = magazine_page_alloc(meta);
+    if (page_id < 0)
+        return -1;
+    if (page_id > (INT32_MAX >> KEYNODE_SLOT_BITS))
+    {
+        LOG("[ERROR] key page id %ld exceeds node id range", (long)page_id);
+        magazine_page_free(meta, page_id);
+        return -1;
+    }
+    key_page_t *page = key_start + blockdata_offset(&meta->keys_blocks, page_id);
+    page->used = 1;
+    return (int32_t)(page_id << KEYNODE_SLOT_BITS);
+}
+
+// 释放节点槽位，页内没有节点时把整页还给blockmalloc；
+// 共享闸门下只会释放没发布出去的新节点，它要么在父节点的页里（页不会空），要么独占一整页
+static void keynode_free(memkv_meta_t *meta, void *key_start, int32_t node_id)
+{
+    key_page_t *page = keypage_at(meta, key_start, node_id);
+    uint32_t bit = 1u << (node_id & KEYNODE_SLOT_MASK);
+    if (!(__atomic_fetch_and(&page->used, ~bit, __ATOMIC_ACQ_REL) & ~bit))
+        magazine_page_free(meta, node_id >> KEYNODE_SLOT_BITS);
+}
+
+
+static inline size_t value_cap_round(size_t len)
+{
+    return (len + VALUE_ALIGN - 1) & ~(size_t)(VALUE_ALIGN - 1);
+}
+
+// box所属的slab级别，大box为NULL
+static inline slab_class_t *value_slab_class(memkv_meta_t *meta, const value_head_t *head)
+{
+    size_t size = sizeof(value_head_t) + head->cap;
+    int c = slab_class(size);
+    return c >= 0 && slab_class_size(c) == size ? &meta->slab_classes[c] : NULL;
+}
+
+// 修改value长度，同时维护统计
+static inline void value_set_len(memkv_meta_t *meta, value_head_t *head, size_t len)
+{
+    STAT_ADD(meta->stats.value_used_bytes, len - head->len);
+    slab_class_t *cl = value_slab_class(meta, head);
+    if (cl)
+        STAT_ADD(cl->value_bytes, len - head->len);
+    head->len = (uint32_t)len;
+}
+
+static void value_box_free(memkv_meta_t *meta, uint64_t box_offset)
+{
+    value_head_t *head = value_head(meta, box_offset);
+    STAT_SUB(meta->stats.value_boxes, 1);
+    STAT_SUB(meta->stats.value_alloc_bytes, sizeof(value_head_t) + head->cap);
+    STAT_SUB(meta->stats.value_used_bytes, head->len);
+    slab_class_t *cl = value_slab_class(meta, head);
+    if (cl)
+    {
+        STAT_SUB(cl->values, 1);
+        STAT_SUB(cl->value_bytes, head->len);
+    }
+    magazine_box_free(meta, box_offset, sizeof(value_head_t) + head->cap);
+}
+
+// 释放一个box字对value的引用：私有box直接释放，共享box在最后一个引用消失时释放，冷value还给冷文件；
+// 调用方负责先把节点上的box换掉
+static void keynode_value_release(memkv_meta_t *meta, uint64_t box)
+{
+    bool last = true;
+    value_head_t *head = keynode_head(meta, box);
+    if (head && (box & BOX_COMPRESSED))
+    {
+        STAT_SUB(meta->stats.compressed_values, 1);
+        STAT_SUB(meta->stats.compressed_raw_bytes, value_raw_len(head));
+        STAT_SUB(meta->stats.compressed_bytes, head->len);
+    }
+    if (box & BOX_COLD)
+    {
+        STAT_SUB(meta->stats.cold_values, 1);
+        STAT_SUB(meta->stats.cold_bytes, head ? head->len : 0);
+        tier_free(meta, box_offset_of(box));
+        return;
+    }
+    if (box & BOX_SHARED)
+    {
+        magazine_lock(meta);
+        last = dedup_release(meta, box_offset_of(box));
+        magazine_unlock(meta);
+    }
+    if (last)
+        value_box_free(meta, box_offset_of(box));
+}
+
+// key出现或消失时维护统计
+static inline void keynode_key_stats(memkv_meta_t *meta, size_t key_len, bool had_key, bool has_key)
+{
+    if (had_key == has_key)
+        return;
+    if (has_key)
+    {
+        STAT_ADD(meta->stats.keys, 1);
+        STAT_ADD(meta->stats.key_depth_sum, key_len);
+    }
+    else
+    {
+        STAT_SUB(meta->stats.keys, 1);
+        STAT_SUB(meta->stats.key_depth_sum, key_len);
+    }
+}
+
+// key出现或消失时同步过滤器和统计
+static inline void keynode_key_update(memkv_meta_t *meta, const void *key_data, size_t key_len, bool had_key, bool has_key)
+{
+    if (had_key == has_key)
+        return;
+    keynode_key_stats(meta, key_len, had_key, has_key);
+    if (meta->filter_blocks && has_key)
+        filter_add(meta, memkv_hash(key_data, key_len));
+    else if (meta->filter_blocks)
+        filter_del(meta, memkv_hash(key_data, key_len));
+}
+
+/*
+cache模式（近似LFU）：
+1. 每个key节点头部有7bit的对数访问计数freq和8bit的访问时钟atime，get命中时按概率递增freq，越热递增概率越低；
+2. 淘汰时钟由累计淘汰次数推进，freq按上次访问以来流逝的时钟衰减，冷掉的热key最终也会被淘汰；
+3. 分配失败时，从根随机游走采样若干个key，淘汰其中衰减后freq最低的；
+4. 淘汰同时释放value的box，并自底向上回收不再有key和子节点的trie节点。
+*/
+#define EVICT_DEFAULT_SAMPLES 5
+#define EVICT_MAX_ROUNDS 64 // 单次分配最多淘汰的轮数，避免一个大value清空整个池
+#define EVICT_CLOCK_SHIFT 6 // 每淘汰64个key，时钟前进1
+#define LFU_INIT_FREQ 5     // 新key的初始计数，避免刚写入就被淘汰
+#define LFU_LOG_FACTOR 10
+#define TIER_SWEEP_FRACTION 16
+
+static __thread uint32_t evict_rng = 2463534242u;
+static inline uint32_t evict_rand(void)
+{
+    uint32_t x = evict_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    evict_rng = x;
+    return x;
+}
+
+static inline uint8_t evict_clock(const memkv_meta_t *meta)
+{
+    return (uint8_t)(meta->evict_count >> EVICT_CLOCK_SHIFT);
+}
+
+// 按流逝的时钟衰减后的freq
+static inline uint8_t keynode_freq(const key_node_t *node, uint8_t now)
+{
+    uint8_t elapsed = (uint8_t)(now - node->atime);
+    return node->freq > elapsed ? node->freq - elapsed : 0;
+}
+
+static inline void keynode_touch(const memkv_meta_t *meta, key_node_t *node)
+{
+    uint8_t now = evict_clock(meta);
+    uint8_t freq = keynode_freq(node, now);
+    if (freq < 127)
+    {
+        uint32_t base = freq > LFU_INIT_FREQ ? freq - LFU_INIT_FREQ : 0;
+        // 以 1/(base*LFU_LOG_FACTOR+1) 的概率递增
+        if ((evict_rand() & 0xffff) * (base * LFU_LOG_FACTOR + 1) < 0x10000)
+            freq++;
+    }
+    // 只在计数或时钟变化时才写节点
+    if (freq != node->freq || now != node->atime)
+    {
+        node->freq = freq;
+        node->atime = now;
+    }
+}
+
+// 从根到某个节点的路径，blocks[0]为根，chars[i]为blocks[i]到blocks[i+1]的字符
+typedef struct
+{
+    int32_t blocks[KEY_BUFFER_MAX];
+    uint8_t chars[KEY_BUFFER_MAX];
+    size_t depth;
+} keypath_t;
+
+// 从path末端开始，自底向上回收没有key也没有子节点的节点（根、pinned和被watch的节点除外）
+static void keypath_prune(memkv_meta_t *meta, void *key_start, const key_node_t *pinned, const keypath_t *path)
+{
+    for (size_t d = path->depth; d > 0; d--)
+    {
+        key_node_t *node = keynode_at(meta, key_start, path->blocks[d]);
+        if (node == pinned || node->has_key || (node->flags & (KEYNODE_WATCHED | KEYNODE_STAGED)) || keynode_has_child(meta, node))
+            break;
+        key_node_t *parent = keynode_at(meta, key_start, path->blocks[d - 1]);
+        parent->child_key_blocks[path->chars[d - 1]] = -1;
+        keynode_free(meta, key_start, path->blocks[d]);
+        STAT_SUB(meta->stats.nodes, 1);
+    }
+}
+
+// 随机游走采样：返回有key的节点，或者一个可回收的空叶子节点；NULL表示本次采样落空
+static key_node_t *evict_sample(memkv_meta_t *meta, void *key_start, const key_node_t *pinned, keypath_t *path)
+{
+    key_node_t *node = keynode_at(meta, key_start, 0);
+    path->blocks[0] = 0;
+    path->depth = 0;
+    while (path->depth + 1 < KEY_BUFFER_MAX)
+    {
+        size_t nchild = 0;
+        for (size_t i = 0; i < meta->char_type; i++)
+        {
+            if (node->child_key_blocks[i] >= 0)
+                nchild++;
+        }
+        if (node->has_key && node != pinned && !(node->flags & KEYNODE_STAGED) && (nchild == 0 || evict_rand() % (nchild + 1) == 0))
+            return node;
+        if (nchild == 0)
+            return (node->has_key || node == pinned || (node->flags & (KEYNODE_WATCHED | KEYNODE_STAGED)) || path->depth == 0) ? NULL : node;
+
+        size_t k = evict_rand() % nchild;
+        for (size_t i = 0; i < meta->char_type; i++)
+        {
+            int32_t childi = node->child_key_blocks[i];
+            if (childi >= 0 && k-- == 0)
+            {
+                path->chars[path->depth] = (uint8_t)i;
+                path->blocks[++path->depth] = childi;
+                node = keynode_at(meta, key_start, childi);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+把节点的value搬到冷文件：先写好冷记录，再把偏移和BOX_COLD一起换上，最后释放池内的box。
+共享box有多个引用，不搬；压缩的value原样搬，标志保留
+*/
+static bool keynode_demote(memkv_meta_t *meta, key_node_t *node)
+{
+    uint64_t old = node->box;
+    if (!node->has_key || (old & (BOX_COLD | BOX_SHARED)) || (node->flags & KEYNODE_STAGED))
+        return false;
+    value_head_t *head = value_head(meta, box_offset_of(old));
+    uint64_t offset = tier_alloc(meta, head->len);
+    if (offset == (uint64_t)-1)
+        return false;
+    value_head_t *cold = tier_head(meta, offset);
+    memcpy(value_data(cold), value_data(head), head->len);
+    cold->len = head->len;
+    __atomic_store_n(&node->box, offset | BOX_COLD | (old & BOX_COMPRESSED), __ATOMIC_RELEASE);
+    STAT_ADD(meta->stats.cold_values, 1);
+    STAT_ADD(meta->stats.cold_bytes, cold->len);
+    STAT_ADD(meta->stats.tier_demotions, 1);
+    value_box_free(meta, box_offset_of(old));
+    return true;
+}
+
+/*
+深度优先扫描整棵树，把衰减后freq<=max_freq的value搬到冷文件，搬够max_bytes（0为不限）为止；
+返回搬动的个数或负的错误码。池满时随机采样找不到池内的value（热value集中在少数分支）也用它批量腾空间
+*/
+static int tier_sweep(memkv_meta_t *meta, const key_node_t *pinned, uint8_t max_freq, uint64_t max_bytes)
+{
+    void *key_start = (void *)meta + meta->key_offset;
+    size_t cap = 1024, n = 0;
+    int32_t *stack = malloc(cap * sizeof(int32_t));
+    if (!stack)
+        return MEMKV_ERROR_OUTOFMEMORY;
+    stack[n++] = 0;
+    uint8_t now = evict_clock(meta);
+    uint64_t moved_bytes = 0;
+    int moved = 0;
+    while (n && (!max_bytes || moved_bytes < max_bytes))
+    {
+        key_node_t *node = keynode_at(meta, key_start, stack[--n]);
+        if (node != pinned && node->has_key && !(node->box & (BOX_COLD | BOX_SHARED)) && !(node->flags & KEYNODE_STAGED) && keynode_freq(node, now) <= max_freq)
+        {
+            size_t len = value_head(meta, box_offset_of(node->box))->len;
+            if (keynode_demote(meta, node))
+            {
+                moved++;
+                moved_bytes += len;
+            }
+        }
+        for (size_t c = 0; c < meta->char_type; c++)
+        {
+            if (node->child_key_blocks[c] < 0)
+                continue;
+            if (n == cap)
+            {
+                int32_t *grown = realloc(stack, 2 * cap * sizeof(int32_t));
+                if (!grown)
+                {
+                    free(stack);
+                    return MEMKV_ERROR_OUTOFMEMORY;
+                }
+                stack = grown;
+                cap *= 2;
+            }
+            stack[n++] = node->child_key_blocks[c];
+        }
+    }
+    free(stack);
+    LOG("[INFO] demoted %d values, %lu bytes", moved, (unsigned long)moved_bytes);
+    return moved;
+}
+
+// 淘汰一个冷key（或回收一段空分支），返回是否释放了空间；pinned为当前正在写入的节点，它和写批次暂存中的节点不会被淘汰或回收
+static bool memkv_evict(memkv_meta_t *meta, void *pool_data, const key_node_t *pinned)
+{
+    // 淘汰会回收节点、改别的key，只在独占写入闸门时进行
+    if (meta->evict_policy == MEMKV_EVICT_NONE || !trie_exclusive(meta))
+        return false;
+
+    void *key_start = pool_data + meta->key_offset;
+    keypath_t paths[2];
+    int best = -1;
+    key_node_t *victim = NULL;
+    uint8_t victim_freq = 0;
+    bool freed = false;
+    uint8_t samples = meta->evict_samples ? meta->evict_samples : EVICT_DEFAULT_SAMPLES;
+    uint8_t now = evict_clock(meta);
+
+    // 游走偏向稀疏分支，同一个节点可能被反复采到：落空的采样不计数，最多尝试4倍；
+    // 至少要有两个不同的候选，只采到一个时再多试几轮，免得稀疏分支上的热key因为运气差被单独淘汰
+    uint8_t found = 0;
+    bool distinct = false;
+    for (int attempt = 0; ((found < samples && attempt < 4 * samples) || !distinct) && attempt < 16 * samples; attempt++)
+    {
+        int slot = (best == 0) ? 1 : 0;
+        key_node_t *node = evict_sample(meta, key_start, pinned, &paths[slot]);
+        if (!node)
+            continue;
+        if (!node->has_key)
+        {
+            keypath_prune(meta, key_start, pinned, &paths[slot]);
+            freed = true;
+            continue;
+        }
+        // 分层模式只看还在池内、能搬走的value
+        if (meta->evict_policy == MEMKV_EVICT_TIER && (node->box & (BOX_COLD | BOX_SHARED)))
+            continue;
+        found++;
+        if (node == victim)
+            continue;
+        distinct = distinct || victim;
+        uint8_t freq = keynode_freq(node, now);
+        if (!victim || freq < victim_freq)
+        {
+            victim = node;
+            victim_freq = freq;
+            best = slot;
+        }
+    }
+    if (victim && meta->evict_policy == MEMKV_EVICT_TIER)
+    {
+        LOG("[INFO] demote key at depth %zu, freq %u", paths[best].depth, (unsigned)victim_freq);
+        if (keynode_demote(meta, victim))
+        {
+            meta->evict_count++;
+            freed = true;
+        }
+    }
+    else if (meta->evict_policy == MEMKV_EVICT_TIER)
+    {
+        // 一次腾出value区的1/TIER_SWEEP_FRACTION，先搬写入后没再读过的
+        uint64_t target = meta->stats.value_region_size / TIER_SWEEP_FRACTION;
+        int moved = tier_sweep(meta, pinned, LFU_INIT_FREQ, target);
+        if (moved == 0)
+            moved = tier_sweep(meta, pinned, UINT8_MAX, target);
+        freed = freed || moved > 0;
+    }
+    else if (victim)
+    {
+        LOG("[INFO] evict key at depth %zu, freq %u", paths[best].depth, (unsigned)victim_freq);
+        uint64_t box = victim->box;
+        victim->has_key = false;
+        victim->box = 0;
+        keynode_value_release(meta, box);
+        keynode_key_update(meta, paths[best].chars, paths[best].depth, true, false);
+        watch_notify(meta, victim, paths[best].chars, paths[best].depth);
+        keypath_prune(meta, key_start, pinned, &paths[best]);
+        meta->evict_count++;
+        freed = true;
+    }
+    return freed;
+}
+
 static size_t align_to_power_of_16_times_8(size_t size) {
     if (size < 8) return 0;
     size_t base = size / 8;
@@ -41,9 +464,21 @@ static size_t align_to_power_of_16_times_8(size_t size) {
 }
 
 int memkv_init(void *pool_data,const size_t pool_len,  const uint16_t chartype,uint8_t keymem,uint8_t valueptrmem,uint8_t valuemem)
+{
+    memkv_options_t opts = {
+        .chartype = chartype,
+        .keymem = keymem,
+        .valueptrmem = valueptrmem,
+        .valuemem = valuemem,
+        .filter_keys = 0,
+    };
+    return memkv_init_ex(pool_data, pool_len, &opts);
+}
+
+int memkv_init_ex(void *pool_data, const size_t pool_len, const memkv_options_t *opts)
 {
     //memkv meta区
-    if (!pool_data||pool_len<=0)
+    if (!pool_data||pool_len<=0||!opts)
     {
         LOG("[ERROR] pool is NULL");
         return MEMKV_ERROR_INVALID_ARG;
@@ -54,29 +489,125 @@ int memkv_init(void *pool_data,const size_t pool_len,  const uint16_t chartype,u
         return MEMKV_ERROR_OUTOFMEMORY;
     }
     memkv_meta_t *meta = (memkv_meta_t *)pool_data;
-    if (memcmp(meta->magic, MEMKV_MAGIC, sizeof(meta->magic)) == 0)
+    if (memcmp(meta->magic, MEMKV_MAGIC, sizeof(meta->magic)) == 0 || pool_is_frozen(pool_data))
     {
         LOG("[INFO] memkv already initialized");
         return MEMKV_ERROR_ALREADY_INIT; // 已经初始化
     }
     memcpy(meta->magic, MEMKV_MAGIC, sizeof(meta->magic));
     meta->pool_size = pool_len;
-    meta->char_type = chartype;
+    meta->version = MEMKV_FORMAT_VERSION;
+    meta->char_type = opts->chartype;
+    meta->evict_policy = MEMKV_EVICT_NONE;
+    meta->evict_samples = EVICT_DEFAULT_SAMPLES;
+    meta->evict_count = 0;
+    meta->tier_path[0] = 0;
+    meta->watch_prefixes = 0;
+    meta->batch_seq = 0;
 
     LOG("[INFO] meta size: %zu", sizeof(memkv_meta_t));
 
-    //分割剩余的pool，为key,valueptr,value三块
-    size_t total_available = pool_len - sizeof(memkv_meta_t);
+    //过滤器区，紧跟在meta之后，按cache line对齐
+    uint64_t filter_offset = (sizeof(memkv_meta_t) + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(uint64_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+    size_t filtersize = opts->filter_keys ? filter_size(opts->filter_keys) : 0;
+    if (filter_offset + filtersize >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small for filter of %zu bytes", pool_len, filtersize);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    filter_init(meta, filter_offset, filtersize);
+
+    //埋点统计区
+    meta->probe_offset = filter_offset + filtersize;
+    size_t probesize = (sizeof(memkv_probe_t) + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(size_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+    if (meta->probe_offset + probesize >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small", pool_len);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    memset(pool_data + meta->probe_offset, 0, probesize);
+
+    //热点采样区
+    uint64_t hot_offset = meta->probe_offset + probesize;
+    if (hot_offset + hot_area_size() >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small", pool_len);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    hot_init(meta, hot_offset);
+
+    //writer分配缓存槽位区
+    uint64_t writers_offset = hot_offset + hot_area_size();
+    if (writers_offset + magazine_area_size() >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small", pool_len);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    magazine_init(meta, writers_offset);
+
+    //value去重索引区
+    uint64_t dedup_offset = writers_offset + magazine_area_size();
+    size_t dedupsize = dedup_area_size(opts->dedup_values);
+    if (dedup_offset + dedupsize >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small for dedup index of %zu bytes", pool_len, dedupsize);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    dedup_init(meta, dedup_offset, dedupsize, opts->dedup_min);
+
+    //压缩字典区
+    uint64_t dict_offset = dedup_offset + dedupsize;
+    size_t dictsize = compress_area_size(opts->compress_dict);
+    if (dict_offset + dictsize >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small for a %u byte compression dictionary", pool_len, opts->compress_dict);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    compress_init(meta, dict_offset, opts->compress_dict, opts->compress_min);
+
+    //slab描述符区，按value区可能的最大值估算
+    uint64_t slab_offset = dict_offset + dictsize;
+    size_t total_proportion = opts->keymem + opts->valueptrmem + opts->valuemem;
+    if (!total_proportion || slab_offset >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small", pool_len);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    size_t slabsize = slab_area_size((pool_len - slab_offset) / total_proportion * opts->valuemem + opts->valuemem);
+    if (slab_offset + slabsize >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small for slab descriptors of %zu bytes", pool_len, slabsize);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+
+    //分割剩余的pool，为key,valueptr,value三块；各区起始偏移按region_align对齐，配合大页映射时不跨页
+    uint64_t align = opts->region_align ? opts->region_align : KEYNODE_ALIGN;
+    if (align & (align - 1))
+    {
+        LOG("[ERROR] region_align %lu is not a power of two", (unsigned long)align);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    uint64_t key_offset = (slab_offset + slabsize + align - 1) & ~(align - 1);
+    if (key_offset >= pool_len)
+    {
+        LOG("[ERROR] pool size %lu is too small for region_align %lu", pool_len, (unsigned long)align);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    size_t total_available = pool_len - key_offset;
 
     // 根据比例计算各部分大小（未对齐）
-    size_t total_proportion = keymem + valueptrmem + valuemem;
-    size_t keys_size_raw = (total_available * keymem) / total_proportion;
-    size_t valueptr_size_raw = (total_available * valueptrmem) / total_proportion;
-    size_t value_size_raw = (total_available * valuemem) / total_proportion;
-
-    // 8字节对齐（向下取整）
-    size_t keys_size = (keys_size_raw / 8) * 8;
-    size_t valueptr_size = (valueptr_size_raw / 8) * 8;
+    size_t keys_size_raw = (total_available * opts->keymem) / total_proportion;
+    size_t valueptr_size_raw = (total_available * opts->valueptrmem) / total_proportion;
+    size_t value_size_raw = (total_available * opts->valuemem) / total_proportion;
+
+    // 按region_align对齐（向下取整）
+    size_t keys_size = (keys_size_raw / align) * align;
+    size_t valueptr_size = (valueptr_size_raw / align) * align;
+    if (!keys_size || !valueptr_size)
+    {
+        LOG("[ERROR] pool size %lu is too small for region_align %lu", pool_len, (unsigned long)align);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
     size_t value_size = align_to_power_of_16_times_8(value_size_raw);
 
     // 调整最后一个部分以使用剩余空间（确保总和 <= total_available）
@@ -87,27 +618,41 @@ int memkv_init(void *pool_data,const size_t pool_len,  const uint16_t chartype,u
         value_size = align_to_power_of_16_times_8(value_size);
     }
 
-    LOG("[INFO] keys_size: %zu, valueptr_size: %zu, value_size: %zu", keys_size, valueptr_size, value_size);
-    meta->key_offset = sizeof(memkv_meta_t);
+    // boxmalloc要求的取整丢掉的尾部交给slab分配器
+    size_t value_tail_end = (total_available - keys_size - valueptr_size) & ~(size_t)(VALUE_ALIGN - 1);
+    size_t slab_cover = (slabsize / sizeof(slab_desc_t) - 2) * SLAB_SIZE;
+    if (value_tail_end > slab_cover)
+        value_tail_end = slab_cover;
+
+    LOG("[INFO] keys_size: %zu, valueptr_size: %zu, value_size: %zu, slab tail: %zu", keys_size, valueptr_size, value_size, value_tail_end - value_size);
+    meta->key_offset = key_offset;
     meta->valueptr_offset = meta->key_offset + keys_size;
     meta->value_offset = meta->valueptr_offset + valueptr_size;
 
-    //key 区
-    size_t keynodesize = keynode_size(meta);
-    blocks_init(&(meta->keys_blocks), keys_size, keynodesize);
+    //key 区，按页分配，每页为64字节页头加若干个64字节对齐的节点
+    meta->node_size = (uint32_t)keynode_size(meta);
+    size_t slots = (KEYPAGE_SIZE - KEYPAGE_HEAD) / meta->node_size;
+    if (slots < 1)
+        slots = 1;
+    if (slots > KEYNODE_SLOT_MASK + 1)
+        slots = KEYNODE_SLOT_MASK + 1;
+    meta->node_page_slots = (uint8_t)slots;
+    blocks_init(&(meta->keys_blocks), keys_size, KEYPAGE_HEAD + slots * meta->node_size);
     void *keys_start = pool_data + meta->key_offset;
-    int64_t root_block_id = blocks_alloc(&meta->keys_blocks, keys_start); // 分配根节点
-    if (root_block_id < 0) {
+    int32_t root_id = keynode_alloc(meta, keys_start, -1); // 分配根节点
+    if (root_id != 0) {
         LOG("[ERROR] failed to allocate root node");
         return MEMKV_ERROR_OUTOFMEMORY;
     }
-    void *root_key = keys_start + blockdata_offset(&meta->keys_blocks, root_block_id);
-    if (!root_key)
+    void *root_key = keynode_at(meta, keys_start, root_id);
+    if ((uintptr_t)root_key % KEYNODE_ALIGN)
     {
-        LOG("[ERROR] failed to allocate root node");
-        return -1;
+        LOG("[WARN] key pages are not cache line aligned, nodes may straddle lines");
     }
     keynode_init(meta, root_key); // 初始化根节点
+    memset(&meta->stats, 0, sizeof(meta->stats));
+    meta->stats.nodes = 1;
+    meta->stats.value_region_size = value_tail_end;
 
     //valueptr和values区
     void *boxptr_start = pool_data + meta->valueptr_offset;
@@ -117,102 +662,849 @@ int memkv_init(void *pool_data,const size_t pool_len,  const uint16_t chartype,u
         LOG("[ERROR] box_init failed");
         return -1;
     }
+    slab_init(meta, slab_offset, value_size, value_tail_end);
+    magazine_probe_largest(meta);
     LOG("[INFO] memkv root node initialized");
     return MEMKV_SUCCESS;
 }
-void* memkv_malloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len){
-        if (!pool_data  || !key_data || key_len < 0)
+// 沿着前缀树查找key对应的节点，路径上缺少的节点会被创建；调用方在写入闸门内。
+// 新节点初始化好之后才用CAS挂到父节点上，读者和其他writer看到的子节点总是完整的
+static key_node_t *keynode_insert(memkv_meta_t *meta, const void *key_data, size_t key_len)
+{
+    void *pool_data = meta;
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot insert key");
         return NULL;
-
-    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
-
+    }
     void* key_start = pool_data + meta->key_offset;
-    key_node_t *root_node = key_start + blockdata_offset(&meta->keys_blocks, 0);
-    key_node_t *cur_node = root_node;
+    key_node_t *cur_node = keynode_at(meta, key_start, 0);
+    int32_t cur_id = 0;
+    key_node_t *base = NULL; // 路径上最深的前缀watch节点，新节点的变更计数从它接着走，见memkv_watch
 
     for (size_t i = 0; i < key_len; i++)
     {
+        if (cur_node->flags & KEYNODE_WATCH_PREFIX)
+            base = cur_node;
         // 当前字符的索引
         uint8_t char_index = *(uint8_t *)(key_data + i);
         if (char_index >= meta->char_type) {
             LOG("[ERROR] character index out of range in set: %u (depth %zu)", char_index, i);
             return NULL;
         }
-        int32_t childi = cur_node->child_key_blocks[char_index];
+        int32_t childi = __atomic_load_n(&cur_node->child_key_blocks[char_index], __ATOMIC_ACQUIRE);
         if (childi < 0)
         {
-            // 如果没有子节点，分配一个新的节点
-            int64_t new_block_id = blocks_alloc(&meta->keys_blocks, key_start);
-            if (new_block_id<0)
+            // 如果没有子节点，在父节点旁边分配一个新的节点
+            int32_t new_id = keynode_alloc(meta, key_start, cur_id);
+            for (int round = 0; new_id < 0 && round < EVICT_MAX_ROUNDS && memkv_evict(meta, pool_data, cur_node); round++)
+                new_id = keynode_alloc(meta, key_start, cur_id);
+            if (new_id<0)
             {
                 LOG("[ERROR] failed to allocate new block for char %c at depth %zu", char_index, i);
                 return NULL;
             }
-            cur_node->child_key_blocks[char_index] = (int32_t)new_block_id;
-            key_node_t *new_node = key_start + blockdata_offset(&meta->keys_blocks,new_block_id);
+            key_node_t *new_node = keynode_at(meta, key_start, new_id);
             keynode_init(meta, new_node);
-            cur_node = new_node;
+            if (base)
+                new_node->version = watch_base(base);
+            // 别的writer抢先挂上了同一个子节点：释放自己的，沿它的走
+            if (__atomic_compare_exchange_n(&cur_node->child_key_blocks[char_index], &childi, new_id, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            {
+                STAT_ADD(meta->stats.nodes, 1);
+                childi = new_id;
+            }
+            else
+                keynode_free(meta, key_start, new_id);
         }
+        cur_node = keynode_at(meta, key_start, childi); // 跳转到子节点
+        cur_id = childi;
+    }
+    return cur_node;
+}
+
+// 分配一个容量至少为cap的value box，cache模式下失败时淘汰后重试
+static uint64_t value_box_alloc(memkv_meta_t *meta, const key_node_t *pinned, size_t cap)
+{
+    void *pool_data = meta;
+    if (cap > UINT32_MAX - sizeof(value_head_t))
+    {
+        LOG("[ERROR] value of size %zu is too large", cap);
+        return (uint64_t)-1;
+    }
+    // 小box按大小级别取自writer缓存，size会被向上取整到级别大小，多出的部分计入容量
+    size_t size = sizeof(value_head_t) + cap;
+    uint64_t offset = magazine_box_alloc(meta, &size);
+    for (int round = 0; offset == (uint64_t)-1 && round < EVICT_MAX_ROUNDS && memkv_evict(meta, pool_data, pinned); round++)
+    {
+        size = sizeof(value_head_t) + cap;
+        offset = magazine_box_alloc(meta, &size);
+    }
+    if (offset == (uint64_t)-1)
+    {
+        LOG("[ERROR] box_alloc failed for value of size %zu", cap);
+        return offset;
+    }
+    value_head_t *head = value_head(meta, offset);
+    head->len = 0;
+    head->cap = (uint32_t)(size - sizeof(value_head_t));
+    STAT_ADD(meta->stats.value_boxes, 1);
+    STAT_ADD(meta->stats.value_alloc_bytes, size);
+    slab_class_t *cl = value_slab_class(meta, head);
+    if (cl)
+        STAT_ADD(cl->values, 1);
+    return offset;
+}
+
+// 把冷value搬回池内，返回池内的value头部；冷文件不可用或池满时返回NULL
+static value_head_t *keynode_promote(memkv_meta_t *meta, key_node_t *node)
+{
+    uint64_t old = node->box;
+    value_head_t *cold = tier_head(meta, box_offset_of(old));
+    if (!cold)
+    {
+        LOG("[ERROR] tier file is not available, cannot read cold value");
+        return NULL;
+    }
+    uint64_t offset = value_box_alloc(meta, node, value_cap_round(cold->len));
+    if (offset == (uint64_t)-1)
+        return NULL;
+    value_head_t *head = value_head(meta, offset);
+    value_set_len(meta, head, cold->len);
+    memcpy(value_data(head), value_data(cold), cold->len);
+    STAT_SUB(meta->stats.cold_values, 1);
+    STAT_SUB(meta->stats.cold_bytes, cold->len);
+    STAT_ADD(meta->stats.tier_promotions, 1);
+    // 偏移和去掉BOX_COLD的标志一起换上，读者不会拿池内偏移去读冷文件
+    __atomic_store_n(&node->box, offset | (old & BOX_COMPRESSED), __ATOMIC_RELEASE);
+    tier_free(meta, box_offset_of(old));
+    return head;
+}
+
+/*
+把box字指向的value拷贝到dst，最多cap字节，压缩的先解压；返回value原长，解压失败返回-1
+*/
+static size_t keynode_value_copy(memkv_meta_t *meta, uint64_t box, void *dst, size_t cap)
+{
+    size_t len;
+    void *data = value_view(meta, box, &len);
+    if (data)
+    {
+        memcpy(dst, data, len < cap ? len : cap);
+        return len;
+    }
+    value_head_t *head = keynode_head(meta, box);
+    if (cap >= len)
+        return value_decompress(meta, head, dst) ? len : (size_t)-1;
+    void *tmp = malloc(len);
+    if (!tmp || !value_decompress(meta, head, tmp))
+    {
+        free(tmp);
+        return (size_t)-1;
+    }
+    memcpy(dst, tmp, cap);
+    free(tmp);
+    return len;
+}
+
+/*
+给节点设置一个长度为value_len的value：
+1. 旧box放得下时原地复用，不经过分配器，数据也不会换cache line；
+2. preserve=false(malloc/set)时，新value不到旧容量一半则换一个小box，避免浪费；
+3. preserve=true(realloc)时，缩小总是原地完成，放不下时按1.5倍增长并拷贝旧数据。
+*/
+static void *keynode_value_resize(memkv_meta_t *meta, key_node_t *node, size_t value_len, bool preserve)
+{
+    uint8_t now = evict_clock(meta);
+    uint8_t freq = LFU_INIT_FREQ;
+    value_head_t *old_head = NULL;
+    if (node->has_key && (node->box & BOX_COLD) && !keynode_promote(meta, node))
+        return NULL;
+    uint64_t old = node->box;
+    if (node->has_key)
+    {
+        old_head = value_head(meta, box_offset_of(old));
+        freq = keynode_freq(node, now);
+        // 共享box不能原地修改，下面按写时复制换成私有box；压缩的value先解压到新box
+        if (!(old & (BOX_SHARED | BOX_COMPRESSED)) && value_len <= old_head->cap && (preserve || value_cap_round(value_len) * 2 > old_head->cap))
+        {
+            LOG("[INFO] reuse value box in place, len %u -> %zu", old_head->len, value_len);
+            value_set_len(meta, old_head, value_len);
+            node->freq = freq;
+            node->atime = now;
+            return value_data(old_head);
+        }
+        if (!preserve)
+        {
+            LOG("[INFO] key already exists, deleting value");
+            node->has_key = false;
+            keynode_value_release(meta, old); // 释放旧的对象
+            old_head = NULL;
+        }
+    }
+
+    size_t cap = value_cap_round(value_len);
+    if (old_head && cap < (size_t)old_head->cap + old_head->cap / 2)
+        cap = value_cap_round((size_t)old_head->cap + old_head->cap / 2);
+    uint64_t newobj_offset = value_box_alloc(meta, node, cap); // 分配新的对象
+    if (newobj_offset == (uint64_t)-1 && cap > value_cap_round(value_len))
+        newobj_offset = value_box_alloc(meta, node, value_cap_round(value_len));
+    if (newobj_offset == (uint64_t)-1)
+        return NULL;
+
+    value_head_t *head = value_head(meta, newobj_offset);
+    value_set_len(meta, head, value_len);
+    if (old_head)
+    {
+        if (keynode_value_copy(meta, old, value_data(head), value_len) == (size_t)-1)
+        {
+            value_box_free(meta, newobj_offset);
+            return NULL;
+        }
+    }
+    __atomic_store_n(&node->box, newobj_offset, __ATOMIC_RELEASE); // 更新实际的对象偏移，存储形式一起清掉
+    node->freq = freq;
+    node->atime = now;
+    node->has_key = true;
+    if (old_head)
+        keynode_value_release(meta, old);
+    return value_data(head);
+}
+
+// 写操作进入前缀树写入闸门：cache模式下分配失败随时可能淘汰别的key、回收节点，只能独占
+static inline void writer_enter(memkv_meta_t *meta)
+{
+    trie_enter(meta, meta->evict_policy != MEMKV_EVICT_NONE);
+}
+
+// malloc的主体，不发watch通知：set写完数据后再通知；*nodep非空时返回时仍持有它的key锁，由调用方放开
+static void *keynode_malloc(memkv_meta_t *meta, const void *key_data, size_t key_len, size_t value_len, key_node_t **nodep)
+{
+    PROBE_BEGIN();
+    void *result = NULL;
+    key_node_t *cur_node = keynode_insert(meta, key_data, key_len);
+    if (cur_node)
+    {
+        key_lock(meta, cur_node);
+        bool had_key = cur_node->has_key;
+        result = keynode_value_resize(meta, cur_node, value_len, false);
+        keynode_key_update(meta, key_data, key_len, had_key, cur_node->has_key);
+    }
+    PROBE_END(meta, MEMKV_OP_MALLOC, cur_node ? key_len : 0, result == NULL); // 插入时整条路径都走到底
+    *nodep = cur_node;
+    return result;
+}
+
+void* memkv_malloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len){
+        if (!pool_data  || !key_data || key_len < 0)
+        return NULL;
+
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot malloc");
+        return NULL;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    hot_sample(meta, key_data, key_len, true);
+    writer_enter(meta);
+    key_node_t *node;
+    void *result = keynode_malloc(meta, key_data, key_len, value_len, &node);
+    if (node)
+        key_unlock(meta, node);
+    trie_leave(meta);
+    return result;
+}
+
+void* memkv_realloc(void *pool_data, const void *key_data, size_t key_len, size_t value_len)
+{
+    if (!pool_data || !key_data)
+    {
+        LOG("[ERROR] invalid arguments to memkv_realloc");
+        return NULL;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot realloc");
+        return NULL;
+    }
+
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    writer_enter(meta);
+    key_node_t *cur_node = keynode_insert(meta, key_data, key_len);
+    if (!cur_node)
+    {
+        trie_leave(meta);
+        return NULL;
+    }
+    key_lock(meta, cur_node);
+    bool had_key = cur_node->has_key;
+    void *result = keynode_value_resize(meta, cur_node, value_len, true);
+    keynode_key_update(meta, key_data, key_len, had_key, cur_node->has_key);
+    key_unlock(meta, cur_node);
+    trie_leave(meta);
+    return result;
+}
+
+/*
+两阶段写入：reserve只分配一个不挂在任何key上的box，调用方直接往池里写value，
+commit时才下降前缀树，用release写把box发布到key上，读者要么看到旧value，要么看到写完的新value；
+abort释放box，失败的生产者不会留下写了一半的value。
+*/
+static inline void keynode_publish(key_node_t *node, uint64_t box, uint8_t freq, uint8_t atime)
+{
+    node->freq = freq;
+    node->atime = atime;
+    // 先发布box再置has_key：新key的读者看到has_key时box已写完；覆盖时读者看到旧box或新box，偏移和存储形式总是配套的
+    __atomic_store_n(&node->box, box, __ATOMIC_RELEASE);
+    __atomic_store_n(&node->has_key, 1, __ATOMIC_RELEASE);
+}
+
+void* memkv_reserve(void *pool_data, size_t value_len, memkv_reservation_t *res)
+{
+    if (!pool_data || !res)
+    {
+        LOG("[ERROR] invalid arguments to memkv_reserve");
+        return NULL;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    res->box_offset = (uint64_t)-1;
+    res->data = NULL;
+    res->cap = 0;
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot reserve");
+        return NULL;
+    }
+
+    size_t cap = value_cap_round(value_len);
+    writer_enter(meta);
+    uint64_t offset = value_box_alloc(meta, NULL, cap);
+    trie_leave(meta);
+    if (offset == (uint64_t)-1)
+        return NULL;
+    res->box_offset = offset;
+    res->data = value_data(value_head(meta, offset));
+    res->cap = value_head(meta, offset)->cap;
+    return res->data;
+}
+
+int memkv_commit(void *pool_data, const void *key_data, size_t key_len, memkv_reservation_t *res, size_t value_len)
+{
+    if (!pool_data || !key_data || !res || res->box_offset == (uint64_t)-1 || value_len > res->cap)
+    {
+        LOG("[ERROR] invalid arguments to memkv_commit");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    writer_enter(meta);
+    key_node_t *node = keynode_insert(meta, key_data, key_len);
+    if (!node)
+    {
+        trie_leave(meta);
+        LOG("[ERROR] failed to insert key in commit, reservation is kept");
+        return MEMKV_ERROR_ALLOC_FAILED;
+    }
+    key_lock(meta, node);
+
+    value_head_t *head = value_head(meta, res->box_offset);
+    value_set_len(meta, head, value_len);
+
+    uint8_t now = evict_clock(meta);
+    bool had_key = node->has_key;
+    uint64_t old = node->box;
+    uint8_t freq = had_key ? keynode_freq(node, now) : LFU_INIT_FREQ;
+    keynode_publish(node, res->box_offset, freq, now);
+    if (had_key)
+        keynode_value_release(meta, old);
+    else
+        keynode_key_update(meta, key_data, key_len, false, true);
+    key_unlock(meta, node);
+    watch_notify(meta, node, key_data, key_len);
+    trie_leave(meta);
+
+    res->box_offset = (uint64_t)-1;
+    res->data = NULL;
+    LOG("[INFO] reservation committed, len %zu", value_len);
+    return MEMKV_SUCCESS;
+}
+
+void memkv_abort(void *pool_data, memkv_reservation_t *res)
+{
+    if (!pool_data || !res || res->box_offset == (uint64_t)-1)
+        return;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    value_box_free(meta, res->box_offset);
+    res->box_offset = (uint64_t)-1;
+    res->data = NULL;
+    LOG("[INFO] reservation aborted");
+}
+
+/*
+写批次：
+1. set/del只拷贝到进程内的缓冲区；
+2. commit的准备阶段为每个set建好节点、分配box并写入value，del找到节点，涉及的节点打KEYNODE_STAGED，
+   准备阶段触发的淘汰不会淘汰、搬走或回收它们；任何一步失败时释放已分配的box，什么都不发布；
+   value总是写进新box，不原地覆盖，并发的单key get看到的是完整的旧value或新value；
+   del的key在池中不存在时，找批内更早暂存的set建好的节点，同一key的操作按暂存顺序生效；
+3. 发布阶段持有batch_lock（批次之间互斥）把batch_seq加成奇数，依次换上新的box、清掉被删除key的has_key和box，
+   新出现的key同时加进过滤器，再把batch_seq加1变回偶数。用read_begin/read_retry包住的多key读要么看到整个批次，
+   要么一个都看不到；发布中途进程退出时，下一个拿到batch_lock的进程把batch_seq推回偶数，已换上的部分保留；
+4. 旧value的释放、统计、被删key的过滤器计数、watch通知放在发布之后，不占用写序列号。
+*/
+static key_node_t *keynode_find(memkv_meta_t *meta, const void *key_data, size_t key_len, size_t *depth, int *err);
+
+#define BATCH_SET 1
+#define BATCH_DEL 2
+#define BATCH_HEAD 9 // 操作1字节 + key长度4字节 + value长度4字节
+#define BATCH_WAIT_SPINS (1 << 20) // 读者等待发布的自旋次数，超过后去检查写者是否还活着
+
+// 拿到批次锁，返回当前的偶数batch_seq；上一个持有者发布到一半退出时batch_seq停在奇数，
+// 已换上的节点无法撤回，推回偶数让读者继续
+static uint32_t batch_lock(memkv_meta_t *meta)
+{
+    pool_lock(&meta->batch_lock, "batch");
+    uint32_t seq = __atomic_load_n(&meta->batch_seq, __ATOMIC_RELAXED);
+    if (seq & 1)
+    {
+        LOG("[WARN] batch writer died while publishing, batch_seq %u recovered", seq);
+        __atomic_store_n(&meta->batch_seq, ++seq, __ATOMIC_RELEASE);
+    }
+    return seq;
+}
+
+typedef struct {
+    const uint8_t *key;
+    uint32_t key_len;
+    uint8_t op;
+    bool had_key;        // 发布时节点原来有没有key
+    uint64_t flags;      // 新value的存储形式，BOX_COMPRESSED
+    key_node_t *node;    // del的key不存在时为NULL
+    uint64_t box_offset; // set的新box
+    uint64_t old;        // 发布时节点原来的box字
+} batch_item_t;
+
+void memkv_batch_init(memkv_batch_t *batch, void *pool_data)
+{
+    if (!batch)
+        return;
+    memset(batch, 0, sizeof(*batch));
+    batch->pool = pool_data;
+}
+
+void memkv_batch_free(memkv_batch_t *batch)
+{
+    if (!batch)
+        return;
+    free(batch->buf);
+    memkv_batch_init(batch, batch->pool);
+}
+
+static int batch_append(memkv_batch_t *batch, uint8_t op, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+{
+    if (!batch || !batch->pool || !key_data || !key_len || (value_len && !value_data) || key_len > UINT32_MAX || value_len > UINT32_MAX)
+    {
+        LOG("[ERROR] invalid arguments to memkv_batch");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    size_t need = batch->len + BATCH_HEAD + key_len + value_len;
+    if (need > batch->cap)
+    {
+        size_t cap = batch->cap ? batch->cap : 256;
+        while (cap < need)
+            cap *= 2;
+        uint8_t *buf = realloc(batch->buf, cap);
+        if (!buf)
+            return MEMKV_ERROR_OUTOFMEMORY;
+        batch->buf = buf;
+        batch->cap = cap;
+    }
+    uint8_t *p = batch->buf + batch->len;
+    uint32_t klen = (uint32_t)key_len, vlen = (uint32_t)value_len;
+    p[0] = op;
+    memcpy(p + 1, &klen, sizeof(klen));
+    memcpy(p + 5, &vlen, sizeof(vlen));
+    memcpy(p + BATCH_HEAD, key_data, key_len);
+    if (value_len)
+        memcpy(p + BATCH_HEAD + key_len, value_data, value_len);
+    batch->len = need;
+    batch->ops++;
+    return MEMKV_SUCCESS;
+}
+
+int memkv_batch_set(memkv_batch_t *batch, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+{
+    return batch_append(batch, BATCH_SET, key_data, key_len, value_data, value_len);
+}
+
+int memkv_batch_del(memkv_batch_t *batch, const void *key_data, size_t key_len)
+{
+    return batch_append(batch, BATCH_DEL, key_data, key_len, NULL, 0);
+}
+
+// 准备一个set：建节点、分配box、写入value（按需压缩）
+static int batch_stage_set(memkv_meta_t *meta, batch_item_t *it, const void *value, size_t value_len)
+{
+    key_node_t *node = keynode_insert(meta, it->key, it->key_len);
+    if (!node)
+        return MEMKV_ERROR_ALLOC_FAILED;
+    it->node = node;
+    __atomic_fetch_or(&node->flags, KEYNODE_STAGED, __ATOMIC_RELAXED);
+    void *packed = NULL;
+    size_t packed_len = 0;
+    if (meta->compress_min && value_len >= meta->compress_min)
+        packed = value_compress(meta, value, value_len, &packed_len);
+    if (packed)
+    {
+        value = packed;
+        value_len = packed_len;
+        it->flags = BOX_COMPRESSED;
+    }
+    it->box_offset = value_box_alloc(meta, it->node, value_cap_round(value_len));
+    if (it->box_offset == (uint64_t)-1)
+    {
+        free(packed);
+        return MEMKV_ERROR_ALLOC_FAILED;
+    }
+    value_head_t *head = value_head(meta, it->box_offset);
+    value_set_len(meta, head, value_len);
+    memcpy(value_data(head), value, value_len);
+    free(packed);
+    return MEMKV_SUCCESS;
+}
+
+static void batch_publish(batch_item_t *it, uint8_t now)
+{
+    key_node_t *node = it->node;
+    it->had_key = node->has_key;
+    it->old = node->box;
+    if (it->op == BATCH_DEL)
+    {
+        // 批内之后的set会在本节点上重新发布，box必须在这里清掉，不能留到发布之后
+        __atomic_store_n(&node->has_key, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&node->box, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    uint8_t freq = node->has_key ? keynode_freq(node, now) : LFU_INIT_FREQ;
+    keynode_publish(node, it->box_offset | it->flags, freq, now);
+}
+
+int memkv_batch_commit(memkv_batch_t *batch)
+{
+    if (!batch || !batch->pool)
+    {
+        LOG("[ERROR] invalid arguments to memkv_batch_commit");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(batch->pool))
+        return MEMKV_ERROR_FROZEN;
+    if (!batch->ops)
+        return MEMKV_SUCCESS;
+    memkv_meta_t *meta = (memkv_meta_t *)batch->pool;
+    batch_item_t *items = calloc(batch->ops, sizeof(batch_item_t));
+    if (!items)
+        return MEMKV_ERROR_OUTOFMEMORY;
+    // 批内的key不加key锁，整个提交独占写入闸门
+    trie_enter(meta, true);
+
+    // 准备阶段
+    int r = MEMKV_SUCCESS;
+    uint32_t staged = 0;
+    for (size_t pos = 0; staged < batch->ops; staged++)
+    {
+        batch_item_t *it = &items[staged];
+        const uint8_t *p = batch->buf + pos;
+        uint32_t value_len;
+        it->op = p[0];
+        memcpy(&it->key_len, p + 1, sizeof(it->key_len));
+        memcpy(&value_len, p + 5, sizeof(value_len));
+        it->key = p + BATCH_HEAD;
+        it->box_offset = (uint64_t)-1;
+        pos += BATCH_HEAD + it->key_len + value_len;
+        if (it->op == BATCH_SET)
+            r = batch_stage_set(meta, it, it->key + it->key_len, value_len);
         else
         {
-            cur_node = key_start + blockdata_offset(&meta->keys_blocks, childi); // 跳转到子节点
+            it->node = keynode_find(meta, it->key, it->key_len, NULL, &r);
+            if (r == MEMKV_ERROR_KEY_NOT_FOUND)
+            {
+                r = MEMKV_SUCCESS; // 删除不存在的key不算失败，发布时跳过
+                // 池中还没有的key可能由批内更早的set暂存，删的是那个节点
+                for (uint32_t j = staged; j-- > 0;)
+                {
+                    if (items[j].op == BATCH_SET && items[j].key_len == it->key_len && memcmp(items[j].key, it->key, it->key_len) == 0)
+                    {
+                        it->node = items[j].node;
+                        break;
+                    }
+                }
+            }
+            if (it->node)
+                __atomic_fetch_or(&it->node->flags, KEYNODE_STAGED, __ATOMIC_RELAXED);
+        }
+        if (r != MEMKV_SUCCESS)
+            break;
+    }
+    if (r != MEMKV_SUCCESS)
+    {
+        LOG("[ERROR] batch op %u failed: %s, nothing published", staged, memkv_strerror(r));
+        for (uint32_t i = 0; i <= staged && i < batch->ops; i++)
+        {
+            if (items[i].box_offset != (uint64_t)-1)
+                value_box_free(meta, items[i].box_offset);
+            if (items[i].node)
+                __atomic_fetch_and(&items[i].node->flags, (uint8_t)~KEYNODE_STAGED, __ATOMIC_RELAXED);
+        }
+        trie_leave(meta);
+        free(items);
+        return r;
+    }
+
+    // 发布阶段：batch_seq为奇数期间换上所有操作的结果；过滤器先于读者看到批次完成，批内新key不会被它挡掉
+    uint32_t seq = batch_lock(meta);
+    __atomic_store_n(&meta->batch_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    uint8_t now = evict_clock(meta);
+    for (uint32_t i = 0; i < batch->ops; i++)
+    {
+        batch_item_t *it = &items[i];
+        if (!it->node)
+            continue;
+        batch_publish(it, now);
+        if (meta->filter_blocks && it->op == BATCH_SET && !it->had_key)
+            filter_add(meta, memkv_hash(it->key, it->key_len));
+    }
+    __atomic_store_n(&meta->batch_seq, seq + 2, __ATOMIC_RELEASE);
+    pool_unlock(&meta->batch_lock);
+
+    // 发布之后：释放旧value，维护统计和过滤器，通知watch
+    for (uint32_t i = 0; i < batch->ops; i++)
+    {
+        batch_item_t *it = &items[i];
+        if (!it->node)
+            continue;
+        __atomic_fetch_and(&it->node->flags, (uint8_t)~KEYNODE_STAGED, __ATOMIC_RELAXED);
+        if (it->had_key)
+            keynode_value_release(meta, it->old);
+        if (it->op == BATCH_SET && (it->flags & BOX_COMPRESSED))
+        {
+            value_head_t *head = value_head(meta, it->box_offset);
+            STAT_ADD(meta->stats.compressed_values, 1);
+            STAT_ADD(meta->stats.compressed_raw_bytes, value_raw_len(head));
+            STAT_ADD(meta->stats.compressed_bytes, head->len);
+        }
+        keynode_key_stats(meta, it->key_len, it->had_key, it->op == BATCH_SET);
+        if (meta->filter_blocks && it->op == BATCH_DEL && it->had_key)
+            filter_del(meta, memkv_hash(it->key, it->key_len));
+        watch_notify(meta, it->node, it->key, it->key_len);
+    }
+    trie_leave(meta);
+    LOG("[INFO] batch of %u ops committed", batch->ops);
+    free(items);
+    batch->len = 0;
+    batch->ops = 0;
+    return MEMKV_SUCCESS;
+}
+
+uint64_t memkv_read_begin(void *pool_data)
+{
+    if (!pool_data || pool_is_frozen(pool_data))
+        return 0;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    uint32_t seq;
+    for (unsigned spins = 1; (seq = __atomic_load_n(&meta->batch_seq, __ATOMIC_ACQUIRE)) & 1; spins++)
+    {
+        // 等得太久时检查写者：已经退出的话批次停在这里不会再变，按奇数序列号读下去，
+        // 下一个批次接管batch_lock时会改变序列号，read_retry照常生效；只读映射上也不用写池
+        uint32_t owner;
+        if (spins % BATCH_WAIT_SPINS == 0 && (owner = __atomic_load_n(&meta->batch_lock, __ATOMIC_RELAXED)) &&
+            kill((pid_t)owner, 0) != 0 && errno == ESRCH && __atomic_load_n(&meta->batch_seq, __ATOMIC_ACQUIRE) == seq)
+        {
+            LOG("[WARN] batch writer %u died while publishing, reading the partial batch", owner);
+            return seq;
+        }
+        if (spins % 1024 == 0)
+            sched_yield();
+    }
+    return seq;
+}
+
+bool memkv_read_retry(void *pool_data, uint64_t seq)
+{
+    if (!pool_data || pool_is_frozen(pool_data))
+        return false;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&meta->batch_seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+整体写入一个新box再发布，set的去重和压缩路径使用，flags为存储形式（BOX_COMPRESSED）：
+开启去重时相同内容的value引用去重索引中已有的共享box；没有时写入新box再登记，
+登记失败（索引满）时作为私有box。旧value在新value发布之后才释放引用。调用方在写入闸门内。
+*/
+static int memkv_set_box(memkv_meta_t *meta, const void *key_data, size_t key_len, const void *value, size_t value_len, uint64_t flags)
+{
+    key_node_t *node = keynode_insert(meta, key_data, key_len);
+    if (!node)
+        return MEMKV_ERROR_ALLOC_FAILED;
+    key_lock(meta, node);
+    bool dedup = meta->dedup_slots && value_len >= meta->dedup_min;
+    if (dedup && node->has_key && (node->box & (BOX_SHARED | BOX_COMPRESSED | BOX_COLD)) == (BOX_SHARED | flags))
+    {
+        value_head_t *cur = value_head(meta, box_offset_of(node->box));
+        if (cur->len == value_len && memcmp(value_data(cur), value, value_len) == 0)
+        {
+            key_unlock(meta, node);
+            return MEMKV_SUCCESS;
         }
     }
 
-    // 设置当前节点的hasobj_offset为value
-    
-    void *valueptr_start = pool_data + meta->valueptr_offset;
-    void *value_start = pool_data + meta->value_offset;
-    if (cur_node->has_key)
+    uint64_t hash = dedup ? memkv_hash(value, value_len) : 0;
+    uint64_t offset = (uint64_t)-1;
+    if (dedup)
     {
-        LOG("[INFO] key already exists, deleting value");
-        box_free(valueptr_start, cur_node->box_offset); // 释放旧的对象
+        magazine_lock(meta);
+        offset = dedup_acquire(meta, hash, value, value_len);
+        magazine_unlock(meta);
     }
-    uint64_t newobj_offset= box_alloc(valueptr_start, value_len); // 分配新的对象
-    if (newobj_offset == (uint64_t)-1)
+    bool shared = dedup;
+    if (offset == (uint64_t)-1)
     {
-        LOG("[ERROR] box_alloc failed for value of size %zu", value_len);
-        return NULL;
+        offset = value_box_alloc(meta, node, value_cap_round(value_len));
+        if (offset == (uint64_t)-1)
+        {
+            key_unlock(meta, node);
+            return MEMKV_ERROR_ALLOC_FAILED;
+        }
+        value_head_t *head = value_head(meta, offset);
+        value_set_len(meta, head, value_len);
+        memcpy(value_data(head), value, value_len);
+        uint64_t interned = (uint64_t)-1;
+        if (dedup)
+        {
+            magazine_lock(meta);
+            interned = dedup_intern(meta, hash, offset);
+            magazine_unlock(meta);
+        }
+        if (interned == (uint64_t)-1)
+            shared = false;
+        else if (interned != offset)
+        {
+            value_box_free(meta, offset);
+            offset = interned;
+        }
     }
-    cur_node->box_offset = newobj_offset; // 更新实际的对象偏移
-    cur_node->has_key = true;
 
-    uint64_t value_offset = cur_node->box_offset;
-    
-    void* result= value_start + value_offset;
-    return result;
+    uint8_t now = evict_clock(meta);
+    bool had_key = node->has_key;
+    uint64_t old = node->box;
+    uint8_t freq = had_key ? keynode_freq(node, now) : LFU_INIT_FREQ;
+    if (flags & BOX_COMPRESSED)
+    {
+        STAT_ADD(meta->stats.compressed_values, 1);
+        STAT_ADD(meta->stats.compressed_raw_bytes, value_raw_len(value_head(meta, offset)));
+        STAT_ADD(meta->stats.compressed_bytes, value_len);
+    }
+    keynode_publish(node, offset | (shared ? BOX_SHARED : 0) | flags, freq, now);
+    if (had_key)
+        keynode_value_release(meta, old);
+    else
+        keynode_key_update(meta, key_data, key_len, false, true);
+    key_unlock(meta, node);
+    watch_notify(meta, node, key_data, key_len);
+    LOG("[INFO] key set with %s%s value", shared ? "shared" : "private", (flags & BOX_COMPRESSED) ? " compressed" : "");
+    return MEMKV_SUCCESS;
 }
 
-int memkv_set(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+static int memkv_set_plain(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
 {
-    void* objptr= memkv_malloc( pool_data,  key_data, key_len, value_len);
+    if (!pool_data || !key_data)
+        return MEMKV_ERROR_INVALID_ARG;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    writer_enter(meta);
+    if (meta->dedup_slots && value_len >= meta->dedup_min)
+    {
+        int r = memkv_set_box(meta, key_data, key_len, value_data, value_len, 0);
+        trie_leave(meta);
+        return r;
+    }
+    key_node_t *node;
+    void* objptr= keynode_malloc(meta, key_data, key_len, value_len, &node);
     if (!objptr)
     {
+        if (node)
+            key_unlock(meta, node);
+        trie_leave(meta);
         LOG("[ERROR] memkv_malloc failed in set");
         return MEMKV_ERROR_ALLOC_FAILED;
     }
-    memcpy(objptr, value_data, value_len); // 复制新值
+    memcpy(objptr, value_data, value_len); // 复制新值，写完才放开key锁
+    key_unlock(meta, node);
+    watch_notify(meta, node, key_data, key_len);
+    trie_leave(meta);
 
-    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
     void *value_start = pool_data + meta->value_offset;
     uint64_t value_offset = objptr-value_start;
     LOG("[INFO] key set successfully,objoffset %lu", value_offset);
     return MEMKV_SUCCESS;
 }
+
+int memkv_set_compressed(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+{
+    if (!pool_data || !key_data || (value_len && !value_data))
+    {
+        LOG("[ERROR] invalid arguments to memkv_set_compressed");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot set");
+        return MEMKV_ERROR_FROZEN;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    size_t packed_len = 0;
+    void *packed = value_compress(meta, value_data, value_len, &packed_len);
+    if (!packed)
+        return memkv_set_plain(pool_data, key_data, key_len, value_data, value_len);
+    writer_enter(meta);
+    int r = memkv_set_box(meta, key_data, key_len, packed, packed_len, BOX_COMPRESSED);
+    trie_leave(meta);
+    free(packed);
+    return r;
+}
+
+int memkv_set(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+{
+    if (pool_data && pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is frozen, cannot set");
+        return MEMKV_ERROR_FROZEN;
+    }
+    if (pool_data && key_data)
+        hot_sample(pool_data, key_data, key_len, true);
+    if (pool_data && ((memkv_meta_t *)pool_data)->compress_min && value_len >= ((memkv_meta_t *)pool_data)->compress_min)
+        return memkv_set_compressed(pool_data, key_data, key_len, value_data, value_len);
+    return memkv_set_plain(pool_data, key_data, key_len, value_data, value_len);
+}
  
  
-void* memkv_get(void *pool_data, const void *key_data, size_t key_len)
+// 沿着前缀树查找key对应的节点，找不到时返回NULL并通过err给出原因；depth非空时给出下降到的层数
+static key_node_t *keynode_find(memkv_meta_t *meta, const void *key_data, size_t key_len, size_t *depth, int *err)
 {
-    if (!pool_data || !key_data || key_len <= 0)
+    if (depth)
+        *depth = 0;
+    // 先查过滤器，大部分未命中在这里只需访问一个cache line
+    if (meta->filter_blocks && !filter_maybe(meta, memkv_hash(key_data, key_len)))
     {
-        LOG("[ERROR] invalid arguments to memkv_get");
+        LOG("[INFO] key not found by filter");
+        *err = MEMKV_ERROR_KEY_NOT_FOUND;
         return NULL;
     }
 
-    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
-    void* key_start = pool_data + meta->key_offset;
-    key_node_t *root_node = key_start + blockdata_offset(&meta->keys_blocks, 0);
-    key_node_t *cur_node = root_node;
+    void* key_start = (void *)meta + meta->key_offset;
+    key_node_t *cur_node = keynode_at(meta, key_start, 0);
 
     // 沿着前缀树遍历
     for (size_t i = 0; i < key_len; i++)
@@ -220,35 +1512,222 @@ void* memkv_get(void *pool_data, const void *key_data, size_t key_len)
         uint8_t char_index = ((uint8_t*)key_data)[i];
         if (char_index >= meta->char_type) {
             LOG("[ERROR] character index out of range in get: %u (depth %zu)", char_index, i);
+            *err = MEMKV_ERROR_CHAR_OUT_OF_RANGE;
             return NULL;
         }
-        int32_t childi = cur_node->child_key_blocks[char_index];
+        int32_t childi = __atomic_load_n(&cur_node->child_key_blocks[char_index], __ATOMIC_ACQUIRE);
         if (childi < 0)
         {
             // 未找到子节点，表示键不存在
             LOG("[INFO] key not found at character %zu", i);
+            *err = MEMKV_ERROR_KEY_NOT_FOUND;
             return NULL;
         }
         // 跳转到子节点
-        cur_node = key_start + blockdata_offset(&meta->keys_blocks, childi);
+        cur_node = keynode_at(meta, key_start, childi);
+        if (depth)
+            *depth = i + 1;
     }
 
     // 到达最后一个节点，检查是否有值
     if (!cur_node->has_key)
     {
         LOG("[INFO] key path found but no key set");
+        *err = MEMKV_ERROR_KEY_NOT_FOUND;
         return NULL;
     }
+    *err = MEMKV_SUCCESS;
+    return cur_node;
+}
 
-    // 获取value的指针和值
-    void *value_start = pool_data + meta->value_offset;
-    uint64_t value_offset = cur_node->box_offset;
-    
-    // 构造返回值
-    void* result= value_start + value_offset;
+// 读路径上把冷value搬回池内：进入写入闸门后重新下降，拿key锁确认还是冷的再搬，失败时返回NULL
+static key_node_t *keynode_warm(memkv_meta_t *meta, const void *key_data, size_t key_len, int *err)
+{
+    writer_enter(meta);
+    key_node_t *node = keynode_find(meta, key_data, key_len, NULL, err);
+    if (node)
+    {
+        key_lock(meta, node);
+        if ((node->box & BOX_COLD) && !keynode_promote(meta, node))
+            *err = MEMKV_ERROR_ALLOC_FAILED;
+        key_unlock(meta, node);
+    }
+    trie_leave(meta);
+    return *err == MEMKV_SUCCESS ? node : NULL;
+}
+
+int memkv_find(void *pool_data, const void *key_data, size_t key_len, void **value, size_t *value_len)
+{
+    if (value)
+        *value = NULL;
+    if (!pool_data || !key_data || key_len <= 0)
+    {
+        LOG("[ERROR] invalid arguments to memkv_find");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+
+    if (pool_is_frozen(pool_data))
+    {
+        void *v = frozen_get(pool_data, key_data, key_len);
+        if (!v)
+            return MEMKV_ERROR_KEY_NOT_FOUND;
+        if (value)
+            *value = v;
+        if (value_len)
+            *value_len = ((value_head_t *)v - 1)->len;
+        return MEMKV_SUCCESS;
+    }
+
+    PROBE_BEGIN();
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    hot_sample(meta, key_data, key_len, false);
+    int err;
+    size_t depth;
+    key_node_t *cur_node = keynode_find(meta, key_data, key_len, &depth, &err);
+    if (!cur_node)
+    {
+        PROBE_END(meta, MEMKV_OP_GET, depth, 1);
+        return err;
+    }
+
+    if (meta->evict_policy != MEMKV_EVICT_NONE)
+        keynode_touch(meta, cur_node);
+
+    // 冷value先搬回池内
+    if ((keynode_box(cur_node) & BOX_COLD) && !(cur_node = keynode_warm(meta, key_data, key_len, &err)))
+    {
+        PROBE_END(meta, MEMKV_OP_GET, depth, 1);
+        return err;
+    }
+
+    // 获取value的指针，压缩的只给出原长；偏移和存储形式取自同一个box字
+    uint64_t box = keynode_box(cur_node);
+    size_t len;
+    void *result = value_view(meta, box, &len);
+    if (value_len)
+        *value_len = len;
+    PROBE_END(meta, MEMKV_OP_GET, depth, 0);
+    if (box & BOX_COMPRESSED)
+    {
+        LOG("[WARN] value is compressed, read it with memkv_read");
+        return MEMKV_ERROR_COMPRESSED;
+    }
     LOG("[INFO] key found");
-    return result;
+    if (value)
+        *value = result;
+    return MEMKV_SUCCESS;
+}
+
+void* memkv_get(void *pool_data, const void *key_data, size_t key_len)
+{
+    void *value;
+    memkv_find(pool_data, key_data, key_len, &value, NULL);
+    return value;
+}
+
+/*
+只读查找：不touch、不搬冷value、不写埋点，池里没有任何写入，只读映射上也能用；
+下降时用memkv_open缓存的key区和value区基址
+*/
+const void *memkv_lookup(const memkv_t *kv, const void *key_data, size_t key_len, size_t *value_len)
+{
+    if (value_len)
+        *value_len = 0;
+    if (!kv || !kv->pool || (key_len && !key_data))
+        return NULL;
+    if (kv->frozen)
+    {
+        void *v = frozen_get(kv->pool, key_data, key_len);
+        if (v && value_len)
+            *value_len = ((value_head_t *)v - 1)->len;
+        return v;
+    }
+
+    memkv_meta_t *meta = (memkv_meta_t *)kv->pool;
+    if (meta->filter_blocks && !filter_maybe(meta, memkv_hash(key_data, key_len)))
+        return NULL;
+    void *key_start = (void *)kv->keys;
+    key_node_t *node = keynode_at(meta, key_start, 0);
+    for (size_t i = 0; i < key_len; i++)
+    {
+        uint8_t c = ((const uint8_t *)key_data)[i];
+        int32_t child = c < meta->char_type ? __atomic_load_n(&node->child_key_blocks[c], __ATOMIC_ACQUIRE) : -1;
+        if (child < 0)
+            return NULL;
+        node = keynode_at(meta, key_start, child);
+    }
+    if (!__atomic_load_n(&node->has_key, __ATOMIC_ACQUIRE))
+        return NULL;
+    uint64_t box = keynode_box(node);
+    size_t len;
+    void *v;
+    if (box & (BOX_COLD | BOX_COMPRESSED))
+    {
+        v = value_view(meta, box, &len);
+    }
+    else
+    {
+        value_head_t *head = (value_head_t *)(kv->values + box);
+        len = head->len;
+        v = value_data(head);
+    }
+    if (value_len)
+        *value_len = len;
+    return v;
+}
+int memkv_read(void *pool_data, const void *key_data, size_t key_len, void *buf, size_t buf_cap, size_t *value_len)
+{
+    if (!pool_data || !key_data || key_len <= 0 || !value_len)
+    {
+        LOG("[ERROR] invalid arguments to memkv_read");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        // 冻结时已解压
+        void *v = frozen_get(pool_data, key_data, key_len);
+        if (!v)
+            return MEMKV_ERROR_KEY_NOT_FOUND;
+        *value_len = ((value_head_t *)v - 1)->len;
+        if (buf && buf_cap < *value_len)
+            return MEMKV_ERROR_INVALID_ARG;
+        if (buf)
+            memcpy(buf, v, *value_len);
+        return MEMKV_SUCCESS;
+    }
+
+    PROBE_BEGIN();
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    hot_sample(meta, key_data, key_len, false);
+    int err;
+    size_t depth;
+    key_node_t *cur_node = keynode_find(meta, key_data, key_len, &depth, &err);
+    if (!cur_node)
+    {
+        PROBE_END(meta, MEMKV_OP_GET, depth, 1);
+        return err;
+    }
+    if (meta->evict_policy != MEMKV_EVICT_NONE)
+        keynode_touch(meta, cur_node);
+    if ((keynode_box(cur_node) & BOX_COLD) && !(cur_node = keynode_warm(meta, key_data, key_len, &err)))
+    {
+        PROBE_END(meta, MEMKV_OP_GET, depth, 1);
+        return err;
+    }
+
+    uint64_t box = keynode_box(cur_node);
+    value_view(meta, box, value_len);
+    if (buf && buf_cap < *value_len)
+    {
+        LOG("[ERROR] value buffer too small: need %zu, have %zu", *value_len, buf_cap);
+        err = MEMKV_ERROR_INVALID_ARG;
+    }
+    else if (buf && keynode_value_copy(meta, box, buf, buf_cap) == (size_t)-1)
+        err = MEMKV_ERROR_INVALID_ARG;
+    PROBE_END(meta, MEMKV_OP_GET, depth, 0);
+    return err;
 }
+
 int memkv_del(void* pool_data, const void* key_data, size_t key_len)
 {
     if (!pool_data || !key_data || key_len <= 0)
@@ -256,50 +1735,274 @@ int memkv_del(void* pool_data, const void* key_data, size_t key_len)
         LOG("[ERROR] invalid arguments to memkv_del");
         return MEMKV_ERROR_INVALID_ARG;
     }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
 
+    PROBE_BEGIN();
     memkv_meta_t *meta = (memkv_meta_t *)pool_data;
-    void* key_start = pool_data + meta->key_offset;
-    key_node_t *root_node = key_start + blockdata_offset(&meta->keys_blocks, 0);
-    key_node_t *cur_node = root_node;
+    int err;
+    size_t depth;
+    writer_enter(meta);
+    key_node_t *cur_node = keynode_find(meta, key_data, key_len, &depth, &err);
+    if (cur_node)
+    {
+        // 别的writer可能抢先删掉了，拿到key锁后再确认一次
+        key_lock(meta, cur_node);
+        if (!cur_node->has_key)
+        {
+            key_unlock(meta, cur_node);
+            cur_node = NULL;
+            err = MEMKV_ERROR_KEY_NOT_FOUND;
+        }
+    }
+    if (!cur_node)
+    {
+        trie_leave(meta);
+        LOG("[INFO] nothing to delete");
+        PROBE_END(meta, MEMKV_OP_DEL, depth, 1);
+        return err;
+    }
 
-    // 沿着前缀树遍历
-    for (size_t i = 0; i < key_len; i++)
+    // 将节点标记为没有值，再释放与键关联的值
+    uint64_t box = cur_node->box;
+    __atomic_store_n(&cur_node->has_key, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&cur_node->box, 0, __ATOMIC_RELEASE);
+    keynode_value_release(meta, box);
+    keynode_key_update(meta, key_data, key_len, true, false);
+    key_unlock(meta, cur_node);
+    watch_notify(meta, cur_node, key_data, key_len);
+    trie_leave(meta);
+    
+    LOG("[INFO] key and associated value deleted successfully");
+    PROBE_END(meta, MEMKV_OP_DEL, depth, 0);
+    return MEMKV_SUCCESS;
+}
+
+/*
+原子数值操作：value必须是8字节的int64（即 -i64），只下降一次前缀树，
+直接在池中用原子指令修改，多个进程共享同一个mmap时也是安全的。
+冷value搬回池内、共享value写时复制都要换box，在写入闸门内重新下降、拿key锁重新检查后进行：
+两个进程同时对同一个计数器操作时只换一次，不会丢掉对方的修改或重复释放旧box。
+*/
+static int64_t *keynode_i64(memkv_meta_t *meta, key_node_t *node, uint64_t box, int *err)
+{
+    int64_t *valptr = NULL;
+    if (!__atomic_load_n(&node->has_key, __ATOMIC_ACQUIRE))
+        *err = MEMKV_ERROR_KEY_NOT_FOUND;
+    else if ((box & BOX_COLD) && !keynode_promote(meta, node))
+        *err = MEMKV_ERROR_ALLOC_FAILED;
+    else
     {
-        uint8_t char_index = ((uint8_t*)key_data)[i];
-        if (char_index >= meta->char_type) {
-            LOG("[ERROR] character index out of range in get: %u (depth %zu)", char_index, i);
-            return MEMKV_ERROR_CHAR_OUT_OF_RANGE;
+        box = keynode_box(node);
+        value_head_t *head = value_head(meta, box_offset_of(box));
+        if ((box & BOX_COMPRESSED) || head->len != sizeof(int64_t))
+        {
+            LOG("[ERROR] value length %u is not an int64", head->len);
+            *err = MEMKV_ERROR_INVALID_ARG;
         }
-        int32_t childi = cur_node->child_key_blocks[char_index];
-        if (childi < 0)
+        else if (box & BOX_SHARED)
         {
-            // 未找到子节点，表示键不存在
-            LOG("[INFO] key not found at character %zu, nothing to delete", i);
-            return MEMKV_ERROR_KEY_NOT_FOUND;
+            // 写时复制，原子操作只作用于这个key
+            valptr = keynode_value_resize(meta, node, sizeof(int64_t), true);
+            *err = valptr ? MEMKV_SUCCESS : MEMKV_ERROR_ALLOC_FAILED;
         }
-        // 跳转到子节点
-        cur_node = key_start + blockdata_offset(&meta->keys_blocks, childi);
+        else
+            valptr = value_data(head);
     }
+    return valptr;
+}
 
-    // 到达最后一个节点，检查是否有值
-    if (!cur_node->has_key)
+static int64_t *memkv_i64_find(void *pool_data, const void *key_data, size_t key_len, key_node_t **nodep, int *err)
+{
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    if (pool_is_frozen(pool_data))
+    {
+        *err = MEMKV_ERROR_FROZEN;
+        return NULL;
+    }
+    key_node_t *node = keynode_find(meta, key_data, key_len, NULL, err);
+    if (!node)
+        return NULL;
+    if (meta->evict_policy != MEMKV_EVICT_NONE)
+        keynode_touch(meta, node);
+    uint64_t box = keynode_box(node);
+    if (!(box & (BOX_COLD | BOX_SHARED)))
+    {
+        *nodep = node;
+        return keynode_i64(meta, node, box, err);
+    }
+    writer_enter(meta);
+    int64_t *valptr = NULL;
+    node = keynode_find(meta, key_data, key_len, NULL, err);
+    if (node)
     {
-        LOG("[INFO] key found but has no value, nothing to delete");
-        return MEMKV_ERROR_KEY_NOT_FOUND;
+        key_lock(meta, node);
+        valptr = keynode_i64(meta, node, keynode_box(node), err);
+        key_unlock(meta, node);
     }
+    trie_leave(meta);
+    *nodep = node;
+    return valptr;
+}
 
-    // 释放与键关联的值
-    void *valueptr_start = pool_data + meta->valueptr_offset;
-    box_free(valueptr_start, cur_node->box_offset);
-    
-    // 将节点标记为没有值
-    cur_node->has_key = false;
-    cur_node->box_offset = 0;
-    
-    LOG("[INFO] key and associated value deleted successfully");
+static int i64_fetch_add(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *old_value)
+{
+    if (!pool_data || !key_data)
+    {
+        LOG("[ERROR] invalid arguments to memkv_fetch_add");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    int err;
+    key_node_t *node;
+    int64_t *valptr = memkv_i64_find(pool_data, key_data, key_len, &node, &err);
+    if (!valptr)
+        return err;
+    int64_t old = __atomic_fetch_add(valptr, delta, __ATOMIC_SEQ_CST);
+    watch_notify(pool_data, node, key_data, key_len);
+    if (old_value)
+        *old_value = old;
     return MEMKV_SUCCESS;
 }
-#define KEY_BUFFER_MAX 1024
+
+int memkv_fetch_add(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *old_value)
+{
+    return i64_fetch_add(pool_data, key_data, key_len, delta, old_value);
+}
+
+int memkv_incr(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value)
+{
+    int64_t old;
+    int r = i64_fetch_add(pool_data, key_data, key_len, delta, &old);
+    if (r == MEMKV_ERROR_KEY_NOT_FOUND)
+    {
+        // key不存在时按0创建：建好节点后在key锁下再查一次，别的writer抢先创建了就直接加上去；
+        // 新value先在box里写好delta再发布，其他进程不会看到未初始化的计数
+        memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+        writer_enter(meta);
+        key_node_t *node = keynode_insert(meta, key_data, key_len);
+        r = MEMKV_ERROR_ALLOC_FAILED;
+        if (node)
+        {
+            key_lock(meta, node);
+            if (node->has_key)
+            {
+                int64_t *valptr = keynode_i64(meta, node, keynode_box(node), &r);
+                if (valptr)
+                    old = __atomic_fetch_add(valptr, delta, __ATOMIC_SEQ_CST);
+            }
+            else
+            {
+                uint64_t offset = value_box_alloc(meta, node, value_cap_round(sizeof(int64_t)));
+                if (offset != (uint64_t)-1)
+                {
+                    value_head_t *head = value_head(meta, offset);
+                    value_set_len(meta, head, sizeof(int64_t));
+                    memcpy(value_data(head), &delta, sizeof(int64_t));
+                    keynode_publish(node, offset, LFU_INIT_FREQ, evict_clock(meta));
+                    keynode_key_update(meta, key_data, key_len, false, true);
+                    old = 0;
+                    r = MEMKV_SUCCESS;
+                }
+            }
+            key_unlock(meta, node);
+            if (r == MEMKV_SUCCESS)
+                watch_notify(meta, node, key_data, key_len);
+        }
+        trie_leave(meta);
+    }
+    if (r == MEMKV_SUCCESS && new_value)
+        *new_value = old + delta;
+    return r;
+}
+
+int memkv_cas(void *pool_data, const void *key_data, size_t key_len, int64_t expected, int64_t desired, int64_t *actual)
+{
+    if (!pool_data || !key_data)
+    {
+        LOG("[ERROR] invalid arguments to memkv_cas");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    int err;
+    key_node_t *node;
+    int64_t *valptr = memkv_i64_find(pool_data, key_data, key_len, &node, &err);
+    if (!valptr)
+        return err;
+    bool ok = __atomic_compare_exchange_n(valptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    if (ok)
+        watch_notify(pool_data, node, key_data, key_len);
+    if (actual)
+        *actual = expected; // 失败时为当前值，成功时等于传入的expected
+    return ok ? MEMKV_SUCCESS : MEMKV_ERROR_CAS_MISMATCH;
+}
+
+/*
+watch：不为不存在的key建节点（否则随便watch一些key就会留下永不回收的节点），
+而是等在路径上最深的已有节点上，并给它打KEYNODE_WATCH_PREFIX：之后创建这个key的写沿路径通知时会唤醒它。
+这样等到的是整个前缀的变化，可能是同一前缀下别的key，调用方醒来后重新检查即可。
+调用方手里的计数可能来自某个祖先，所以新建的节点、第一次被前缀watch的节点都从路径上最深的前缀watch节点的计数接着走，
+不会恰好等于调用方手里的旧值而漏掉变化。被watch的节点打KEYNODE_WATCHED不被回收，数量不超过池里出现过的节点
+*/
+int memkv_watch(void *pool_data, const void *key_data, size_t key_len, bool prefix, uint32_t *version, int timeout_ms)
+{
+    if (!pool_data || (key_len && !key_data) || !version)
+    {
+        LOG("[ERROR] invalid arguments to memkv_watch");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    void *key_start = pool_data + meta->key_offset;
+    key_node_t *node = keynode_at(meta, key_start, 0);
+    key_node_t *base = NULL;
+    size_t depth = 0;
+    for (; depth < key_len; depth++)
+    {
+        uint8_t c = ((const uint8_t *)key_data)[depth];
+        if (c >= meta->char_type)
+        {
+            LOG("[ERROR] character index out of range in watch: %u (depth %zu)", c, depth);
+            return MEMKV_ERROR_CHAR_OUT_OF_RANGE;
+        }
+        int32_t child = __atomic_load_n(&node->child_key_blocks[c], __ATOMIC_ACQUIRE);
+        if (child < 0)
+            break;
+        if (node->flags & KEYNODE_WATCH_PREFIX)
+            base = node;
+        node = keynode_at(meta, key_start, child);
+    }
+    uint8_t want = KEYNODE_WATCHED | (prefix || depth < key_len ? KEYNODE_WATCH_PREFIX : 0);
+    if ((node->flags & want) != want)
+    {
+        uint8_t old = __atomic_fetch_or(&node->flags, want, __ATOMIC_SEQ_CST);
+        if ((want & ~old) & KEYNODE_WATCH_PREFIX)
+        {
+            __atomic_fetch_add(&meta->watch_prefixes, 1, __ATOMIC_SEQ_CST);
+            // 之前子树里的写没有记到这个节点上，先打标志再对齐祖先的计数，之后的写两边都会加
+            if (base)
+                watch_rebase(&node->version, watch_base(base));
+        }
+    }
+    return watch_wait(&node->version, version, timeout_ms);
+}
+
+// 通知key的watch者：memkv_malloc/realloc只分配，调用方写完value后调用
+int memkv_notify(void *pool_data, const void *key_data, size_t key_len)
+{
+    if (!pool_data || (key_len && !key_data))
+    {
+        LOG("[ERROR] invalid arguments to memkv_notify");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    int err;
+    key_node_t *node = keynode_find(meta, key_data, key_len, NULL, &err);
+    watch_notify(meta, node, key_data, key_len);
+    return node ? MEMKV_SUCCESS : err;
+}
+
 static void memkv_traverse_dfs(memkv_meta_t *meta, key_node_t *node, char *key_buffer, size_t depth, void (*func)(const void* key_data, size_t key_len))
 {
     if (!node)
@@ -318,7 +2021,7 @@ static void memkv_traverse_dfs(memkv_meta_t *meta, key_node_t *node, char *key_b
         if (child_id >= 0)
         {
             void *key_start = (uint8_t *)meta + meta->key_offset;
-            key_node_t *child_node = key_start + blockdata_offset(&meta->keys_blocks, child_id);
+            key_node_t *child_node = keynode_at(meta, key_start, child_id);
             
             if (depth + 1 >= KEY_BUFFER_MAX) {
                 LOG("[ERROR] would overflow key buffer at depth %zu, skipping child %zu", depth+1, i);
@@ -331,17 +2034,11 @@ static void memkv_traverse_dfs(memkv_meta_t *meta, key_node_t *node, char *key_b
     }
 }
 
-void memkv_keys(void* pool_data, const void* prefix_data,size_t prefix_len, void (*func)(const void* key_data, size_t key_len))
+static void memkv_keys_walk(void* pool_data, const void* prefix_data,size_t prefix_len, void (*func)(const void* key_data, size_t key_len))
 {
-    if (!pool_data || !func)
-    {
-        LOG("[ERROR] invalid arguments to memkv_keys");
-        return;
-    }
-
     memkv_meta_t *meta = (memkv_meta_t *)pool_data;
     void *key_start = pool_data + meta->key_offset;
-    key_node_t *root_node =  key_start + blockdata_offset(&meta->keys_blocks, 0);
+    key_node_t *root_node = keynode_at(meta, key_start, 0);
     if (!root_node)
     {
         LOG("[ERROR] root node is NULL");
@@ -382,7 +2079,7 @@ void memkv_keys(void* pool_data, const void* prefix_data,size_t prefix_len, void
                 LOG("[INFO] prefix not found");
                 return; // 前缀不存在
             }
-            cur_node =key_start + blockdata_offset(&meta->keys_blocks, child_id);
+            cur_node = keynode_at(meta, key_start, child_id);
         }
 
         // 从前缀节点开始递归遍历
@@ -395,6 +2092,107 @@ void memkv_keys(void* pool_data, const void* prefix_data,size_t prefix_len, void
     }
 }
 
+int memkv_stats(void *pool_data, memkv_stats_t *stats)
+{
+    if (!pool_data || !stats)
+    {
+        LOG("[ERROR] invalid arguments to memkv_stats");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (pool_is_frozen(pool_data))
+    {
+        frozen_stats(pool_data, stats);
+        return MEMKV_SUCCESS;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    stats->keys = meta->stats.keys;
+    stats->nodes = meta->stats.nodes;
+    stats->node_size = keynode_size(meta);
+    stats->node_capacity = (meta->valueptr_offset - meta->key_offset) / (KEYPAGE_HEAD + meta->node_page_slots * stats->node_size) * meta->node_page_slots;
+    stats->nodes_free = stats->node_capacity > stats->nodes ? stats->node_capacity - stats->nodes : 0;
+    stats->avg_depth = meta->stats.keys ? (double)meta->stats.key_depth_sum / meta->stats.keys : 0.0;
+
+    stats->value_region_size = meta->stats.value_region_size;
+    stats->value_boxes = meta->stats.value_boxes;
+    stats->value_alloc_bytes = meta->stats.value_alloc_bytes;
+    stats->value_used_bytes = meta->stats.value_used_bytes;
+    stats->value_largest_free = meta->stats.value_largest_free;
+    stats->value_internal_frag = stats->value_alloc_bytes ? 1.0 - (double)stats->value_used_bytes / stats->value_alloc_bytes : 0.0;
+    uint64_t free_bytes = stats->value_region_size - stats->value_alloc_bytes;
+    stats->value_external_frag = free_bytes ? 1.0 - (double)stats->value_largest_free / free_bytes : 0.0;
+    if (stats->value_external_frag < 0)
+        stats->value_external_frag = 0;
+
+    stats->evictions = meta->evict_count;
+    stats->filter_bytes = meta->filter_blocks * MEMKV_FILTER_BLOCK_SIZE;
+    stats->dedup_boxes = meta->stats.dedup_boxes;
+    stats->dedup_saved_bytes = meta->stats.dedup_saved_bytes;
+    stats->compressed_values = meta->stats.compressed_values;
+    stats->compressed_raw_bytes = meta->stats.compressed_raw_bytes;
+    stats->compressed_bytes = meta->stats.compressed_bytes;
+    stats->compress_ratio = stats->compressed_bytes ? (double)stats->compressed_raw_bytes / stats->compressed_bytes : 0;
+    stats->cold_values = meta->stats.cold_values;
+    stats->cold_bytes = meta->stats.cold_bytes;
+    stats->tier_demotions = meta->stats.tier_demotions;
+    stats->tier_promotions = meta->stats.tier_promotions;
+    return MEMKV_SUCCESS;
+}
+
+int memkv_tier_demote(void *pool_data, uint8_t max_freq, uint64_t max_bytes)
+{
+    if (!pool_data)
+    {
+        LOG("[ERROR] invalid arguments to memkv_tier_demote");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    if (!meta->tier_path[0])
+    {
+        LOG("[ERROR] no tier file attached");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    // 下沉一次搬很多key，不加key锁，独占写入闸门
+    trie_enter(meta, true);
+    int moved = tier_sweep(meta, NULL, max_freq, max_bytes);
+    trie_leave(meta);
+    return moved;
+}
+
+int memkv_set_evict(void *pool_data, memkv_evict_policy_t policy, uint8_t samples)
+{
+    if (!pool_data || policy < MEMKV_EVICT_NONE || policy > MEMKV_EVICT_TIER)
+    {
+        LOG("[ERROR] invalid arguments to memkv_set_evict");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    meta->evict_policy = (uint8_t)policy;
+    meta->evict_samples = samples ? samples : EVICT_DEFAULT_SAMPLES;
+    return MEMKV_SUCCESS;
+}
+
+void memkv_keys(void* pool_data, const void* prefix_data,size_t prefix_len, void (*func)(const void* key_data, size_t key_len))
+{
+    if (!pool_data || !func)
+    {
+        LOG("[ERROR] invalid arguments to memkv_keys");
+        return;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        frozen_keys(pool_data, prefix_data, prefix_len, func);
+        return;
+    }
+    PROBE_BEGIN();
+    memkv_keys_walk(pool_data, prefix_data, prefix_len, func);
+    PROBE_END((memkv_meta_t *)pool_data, MEMKV_OP_KEYS, prefix_len, 0);
+}
+
 const char* memkv_strerror(memkv_error_t err)
 {
     switch (err) {
@@ -418,6 +2216,18 @@ const char* memkv_strerror(memkv_error_t err)
             return "Prefix is too long";
         case MEMKV_ERROR_CHAR_OUT_OF_RANGE:
             return "Character index out of range";
+        case MEMKV_ERROR_CAS_MISMATCH:
+            return "Compare-and-swap value mismatch";
+        case MEMKV_ERROR_FROZEN:
+            return "Pool is frozen (read-only)";
+        case MEMKV_ERROR_TIMEOUT:
+            return "Timed out";
+        case MEMKV_ERROR_VERSION:
+            return "Pool format version mismatch";
+        case MEMKV_ERROR_CORRUPT:
+            return "Pool is inconsistent";
+        case MEMKV_ERROR_COMPRESSED:
+            return "Value is compressed, use memkv_read";
         case MEMKV_ERROR_UNKNOWN:
         default:
             return "Unknown error";
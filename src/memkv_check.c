@@ -0,0 +1,590 @@
+/*
+一致性检查：memkv_check
+
+1) 从根按层展开若干层得到足够多的子树任务，多个线程各自深度优先检查子树；
+   节点id先校验页号、槽位和页内的槽位位图，再在全局的访问位图上原子置位，
+   置位失败说明节点被第二次引用（共享或成环）；
+2) 每个key校验value：池内box的头部和范围、slab块的边界和级别、不在writer缓存的空闲box里，冷记录在冷文件的已分配范围内；
+   所有box的区间汇总排序后检查重叠，只有去重索引里登记的共享box可以被多个key引用，且引用数要一致；
+3) 重新统计key数、深度和、节点数、压缩和冷value等计数，与meta里写路径维护的计数比较；
+4) repair时把坏的子节点指针置-1（丢弃整个子树）、去掉value不合法或与别的box重叠的key，
+   去重引用数和计数器按实际结果重写；被丢弃的box和节点不释放，宁可泄漏也不二次释放。
+检查期间独占前缀树写入闸门，并发的writer等检查结束再继续；已退出的writer留下的半截写会被报成错误。
+blockmalloc/boxmalloc的内部空闲链表不在memkv的可见范围内，分配器一侧只能核对memkv自己的计数和缓存。
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define CHECK_MAX_THREADS 256
+#define CHECK_SPLIT_LEVELS 6
+#define CHECK_TASKS_PER_THREAD 16
+
+typedef struct
+{
+    int32_t id;
+    uint32_t depth;
+} check_item_t;
+
+typedef struct
+{
+    uint64_t offset;
+    uint64_t end;
+    key_node_t *node;
+    uint32_t depth;
+} check_box_t;
+
+typedef struct
+{
+    check_item_t *items;
+    size_t n;
+    size_t cap;
+} check_items_t;
+
+// 每个线程的统计，最后合并
+typedef struct
+{
+    memkv_check_report_t r;
+    uint64_t depth_sum;
+    uint64_t compressed_values;
+    uint64_t compressed_raw_bytes;
+    uint64_t compressed_bytes;
+    uint64_t cold_values;
+    uint64_t cold_bytes;
+    check_box_t *boxes;
+    size_t nboxes;
+    size_t box_cap;
+    check_items_t stack;
+    bool oom;
+} check_acc_t;
+
+typedef struct
+{
+    memkv_meta_t *meta;
+    void *key_start;
+    uint64_t key_region;
+    uint64_t page_bytes;
+    uint64_t max_pages;
+    uint64_t *visited; // 按节点id的访问位图
+    uint64_t *free_pages; // writer缓存中的空闲页，已排序
+    size_t nfree_pages;
+    uint64_t *free_boxes; // writer缓存中的空闲box，已排序
+    size_t nfree_boxes;
+    bool repair;
+    check_item_t *tasks;
+    size_t ntasks;
+    size_t next;
+    check_acc_t *accs;
+} check_ctx_t;
+
+typedef struct
+{
+    check_ctx_t *ctx;
+    int worker;
+} check_worker_t;
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int cmp_box(const void *a, const void *b)
+{
+    const check_box_t *x = a, *y = b;
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+static bool sorted_has(const uint64_t *arr, size_t n, uint64_t v)
+{
+    return n && bsearch(&v, arr, n, sizeof(uint64_t), cmp_u64);
+}
+
+static bool items_push(check_items_t *s, int32_t id, uint32_t depth)
+{
+    if (s->n == s->cap)
+    {
+        size_t cap = s->cap ? s->cap * 2 : 256;
+        check_item_t *items = realloc(s->items, cap * sizeof(*items));
+        if (!items)
+            return false;
+        s->items = items;
+        s->cap = cap;
+    }
+    s->items[s->n++] = (check_item_t){id, depth};
+    return true;
+}
+
+static bool acc_add_box(check_acc_t *acc, uint64_t offset, uint64_t end, key_node_t *node, uint32_t depth)
+{
+    if (acc->nboxes == acc->box_cap)
+    {
+        size_t cap = acc->box_cap ? acc->box_cap * 2 : 1024;
+        check_box_t *boxes = realloc(acc->boxes, cap * sizeof(*boxes));
+        if (!boxes)
+            return false;
+        acc->boxes = boxes;
+        acc->box_cap = cap;
+    }
+    acc->boxes[acc->nboxes++] = (check_box_t){offset, end, node, depth};
+    return true;
+}
+
+// 节点id指向key区内一个已分配的槽位，且不是writer缓存中的空闲页
+static bool check_node_id(const check_ctx_t *ctx, int32_t id)
+{
+    uint64_t page = (uint64_t)id >> KEYNODE_SLOT_BITS;
+    if (id < 0 || page >= ctx->max_pages || (id & KEYNODE_SLOT_MASK) >= ctx->meta->node_page_slots)
+        return false;
+    if (blockdata_offset(&ctx->meta->keys_blocks, page) + ctx->page_bytes > ctx->key_region)
+        return false;
+    if (sorted_has(ctx->free_pages, ctx->nfree_pages, page))
+        return false;
+    return keypage_at(ctx->meta, ctx->key_start, id)->used & (1u << (id & KEYNODE_SLOT_MASK));
+}
+
+static bool check_claim(check_ctx_t *ctx, int32_t id)
+{
+    uint64_t bit = 1ULL << (id & 63);
+    return !(__atomic_fetch_or(&ctx->visited[id >> 6], bit, __ATOMIC_RELAXED) & bit);
+}
+
+// 去掉节点上的key，不释放value
+static void check_drop_key(check_acc_t *acc, key_node_t *node, uint32_t depth)
+{
+    node->has_key = 0;
+    node->box = 0;
+    acc->r.keys--;
+    acc->depth_sum -= depth;
+    acc->r.dropped_keys++;
+}
+
+// 校验节点的value，合法时记下box区间和统计
+static bool check_value(check_ctx_t *ctx, check_acc_t *acc, key_node_t *node, uint32_t depth)
+{
+    memkv_meta_t *meta = ctx->meta;
+    uint64_t box = node->box, off = box_offset_of(box);
+    if (box & ~(BOX_OFFSET_MASK | BOX_SHARED | BOX_COMPRESSED | BOX_COLD))
+        return false;
+    if (box & BOX_COLD)
+    {
+        if (box & BOX_SHARED || !tier_valid(meta, off))
+            return false;
+        value_head_t *head = tier_head(meta, off);
+        acc->cold_values++;
+        acc->cold_bytes += head->len;
+        if (box & BOX_COMPRESSED)
+        {
+            acc->compressed_values++;
+            acc->compressed_raw_bytes += value_raw_len(head);
+            acc->compressed_bytes += head->len;
+        }
+        return true;
+    }
+    uint64_t region = meta->stats.value_region_size;
+    if (off % sizeof(uint64_t) || off + sizeof(value_head_t) > region)
+        return false;
+    value_head_t *head = value_head(meta, off);
+    uint64_t end = off + sizeof(value_head_t) + head->cap;
+    if (head->len > head->cap || end > region || sorted_has(ctx->free_boxes, ctx->nfree_boxes, off))
+        return false;
+    // 小box在slab内时必须落在同级别块的边界上
+    if (end - off <= SLAB_MAX && !slab_chunk_valid(meta, off, end - off))
+        return false;
+    if ((box & BOX_COMPRESSED) && head->len < VALUE_COMPRESS_HEAD)
+        return false;
+    if (!acc_add_box(acc, off, end, node, depth))
+        acc->oom = true;
+    if (box & BOX_COMPRESSED)
+    {
+        acc->compressed_values++;
+        acc->compressed_raw_bytes += value_raw_len(head);
+        acc->compressed_bytes += head->len;
+    }
+    return true;
+}
+
+// 检查一个已认领的节点，合法的子节点压入out
+static void check_node(check_ctx_t *ctx, check_acc_t *acc, check_item_t item, check_items_t *out)
+{
+    key_node_t *node = keynode_at(ctx->meta, ctx->key_start, item.id);
+    acc->r.nodes++;
+    if (node->has_key)
+    {
+        acc->r.keys++;
+        acc->depth_sum += item.depth;
+        if (!check_value(ctx, acc, node, item.depth))
+        {
+            acc->r.bad_values++;
+            if (ctx->repair)
+                check_drop_key(acc, node, item.depth);
+        }
+    }
+    for (size_t c = 0; c < ctx->meta->char_type; c++)
+    {
+        int32_t child = node->child_key_blocks[c];
+        if (child < 0)
+            continue;
+        bool valid = check_node_id(ctx, child);
+        if (valid && check_claim(ctx, child))
+        {
+            if (!items_push(out, child, item.depth + 1))
+                acc->oom = true;
+            continue;
+        }
+        if (valid)
+            acc->r.shared_links++;
+        else
+            acc->r.bad_links++;
+        if (ctx->repair)
+        {
+            node->child_key_blocks[c] = -1;
+            acc->r.dropped_subtrees++;
+        }
+    }
+}
+
+static void *check_worker(void *arg)
+{
+    check_worker_t *w = arg;
+    check_ctx_t *ctx = w->ctx;
+    check_acc_t *acc = &ctx->accs[w->worker];
+    for (;;)
+    {
+        size_t t = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED);
+        if (t >= ctx->ntasks)
+            break;
+        acc->stack.n = 0;
+        if (!items_push(&acc->stack, ctx->tasks[t].id, ctx->tasks[t].depth))
+        {
+            acc->oom = true;
+            break;
+        }
+        while (acc->stack.n)
+        {
+            check_item_t item = acc->stack.items[--acc->stack.n];
+            check_node(ctx, acc, item, &acc->stack);
+        }
+    }
+    return NULL;
+}
+
+// writer缓存中的空闲页和box
+static bool check_collect_free(check_ctx_t *ctx)
+{
+    memkv_meta_t *meta = ctx->meta;
+    writer_slot_t *slots = (writer_slot_t *)((uint8_t *)meta + meta->writers_offset);
+    size_t np = 0, nb = 0;
+    for (int s = 0; s < MEMKV_WRITER_SLOTS; s++)
+    {
+        np += slots[s].npages < MAG_PAGES ? slots[s].npages : MAG_PAGES;
+        for (int c = 0; c < MAG_CLASSES; c++)
+            nb += slots[s].nboxes[c] < MAG_BOXES ? slots[s].nboxes[c] : MAG_BOXES;
+    }
+    ctx->free_pages = malloc((np + 1) * sizeof(uint64_t));
+    ctx->free_boxes = malloc((nb + 1) * sizeof(uint64_t));
+    if (!ctx->free_pages || !ctx->free_boxes)
+        return false;
+    for (int s = 0; s < MEMKV_WRITER_SLOTS; s++)
+    {
+        for (uint32_t i = 0; i < slots[s].npages && i < MAG_PAGES; i++)
+            ctx->free_pages[ctx->nfree_pages++] = (uint64_t)slots[s].pages[i];
+        for (int c = 0; c < MAG_CLASSES; c++)
+        {
+            for (uint32_t i = 0; i < slots[s].nboxes[c] && i < MAG_BOXES; i++)
+                ctx->free_boxes[ctx->nfree_boxes++] = slots[s].boxes[c][i];
+        }
+    }
+    qsort(ctx->free_pages, ctx->nfree_pages, sizeof(uint64_t), cmp_u64);
+    qsort(ctx->free_boxes, ctx->nfree_boxes, sizeof(uint64_t), cmp_u64);
+    return true;
+}
+
+static dedup_entry_t *check_dedup_entry(dedup_entry_t **sorted, size_t n, uint64_t offset)
+{
+    size_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (sorted[mid]->box_offset < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < n && sorted[lo]->box_offset == offset ? sorted[lo] : NULL;
+}
+
+static int cmp_entry(const void *a, const void *b)
+{
+    uint64_t x = (*(dedup_entry_t *const *)a)->box_offset, y = (*(dedup_entry_t *const *)b)->box_offset;
+    return x < y ? -1 : x > y;
+}
+
+/*
+box区间排序后检查重叠：同一偏移上的一组引用只有全部带BOX_SHARED且在去重索引里登记时合法，
+组内引用数要等于表项的refs；表项没有任何key引用也算不一致（泄漏的共享box）
+*/
+static bool check_boxes(check_ctx_t *ctx, check_acc_t *all, uint64_t *saved_bytes)
+{
+    memkv_meta_t *meta = ctx->meta;
+    dedup_entry_t *table = (dedup_entry_t *)((uint8_t *)meta + meta->dedup_offset);
+    size_t nentries = 0;
+    dedup_entry_t **entries = malloc((meta->dedup_slots + 1) * sizeof(*entries));
+    uint32_t *counted = calloc(meta->dedup_slots + 1, sizeof(uint32_t));
+    if (!entries || !counted)
+    {
+        free(entries);
+        free(counted);
+        return false;
+    }
+    for (uint64_t i = 0; i < meta->dedup_slots; i++)
+    {
+        if (table[i].refs)
+            entries[nentries++] = &table[i];
+    }
+    qsort(entries, nentries, sizeof(*entries), cmp_entry);
+    if (all->nboxes)
+        qsort(all->boxes, all->nboxes, sizeof(check_box_t), cmp_box);
+
+    uint64_t prev_end = 0;
+    for (size_t i = 0; i < all->nboxes;)
+    {
+        size_t j = i;
+        while (j < all->nboxes && all->boxes[j].offset == all->boxes[i].offset)
+            j++;
+        check_box_t *b = &all->boxes[i];
+        dedup_entry_t *e = (b->node->box & BOX_SHARED) ? check_dedup_entry(entries, nentries, b->offset) : NULL;
+        bool all_shared = true;
+        for (size_t k = i; k < j; k++)
+            all_shared = all_shared && (all->boxes[k].node->box & BOX_SHARED);
+        size_t keep = j - i;
+        if (b->offset < prev_end)
+        {
+            // 与前一个box重叠，整组都不可信
+            all->r.overlapping_boxes += j - i;
+            keep = 0;
+        }
+        else if (!(all_shared && e))
+        {
+            // 未登记的共享或私有box被多个key引用：留第一个作为私有box
+            if (j - i > 1 || (b->node->box & BOX_SHARED))
+                all->r.overlapping_boxes += j - i > 1 ? j - i - 1 : 1;
+            keep = 1;
+            if (ctx->repair)
+                b->node->box &= ~BOX_SHARED;
+        }
+        else
+        {
+            counted[e - table] = (uint32_t)(j - i);
+        }
+        if (ctx->repair)
+        {
+            for (size_t k = i + keep; k < j; k++)
+            {
+                check_box_t *d = &all->boxes[k];
+                if (d->node->box & BOX_COMPRESSED)
+                {
+                    value_head_t *head = value_head(meta, d->offset);
+                    all->compressed_values--;
+                    all->compressed_raw_bytes -= value_raw_len(head);
+                    all->compressed_bytes -= head->len;
+                }
+                check_drop_key(all, d->node, d->depth);
+            }
+        }
+        if (keep && all->boxes[i].end > prev_end)
+            prev_end = all->boxes[i].end;
+        i = j;
+    }
+
+    *saved_bytes = 0;
+    for (size_t k = 0; k < nentries; k++)
+    {
+        dedup_entry_t *e = entries[k];
+        uint32_t refs = counted[e - table];
+        if (refs != e->refs)
+        {
+            all->r.dedup_mismatches++;
+            // 没有key引用的表项保留，box作为泄漏留在表里，不影响查找链
+            if (ctx->repair && refs)
+                e->refs = refs;
+        }
+        if (e->refs > 1)
+            *saved_bytes += (uint64_t)(e->refs - 1) * (sizeof(value_head_t) + value_head(meta, e->box_offset)->cap);
+    }
+    all->r.dedup_boxes = nentries;
+    free(entries);
+    free(counted);
+    return true;
+}
+
+static void check_counter(memkv_check_report_t *r, const char *name, uint64_t *field, uint64_t actual, bool repair)
+{
+    (void)name; // 只在日志里用
+    if (*field == actual)
+        return;
+    LOG("[WARN] counter %s is %lu, recounted %lu", name, (unsigned long)*field, (unsigned long)actual);
+    r->counter_mismatches++;
+    if (repair)
+        *field = actual;
+}
+
+int memkv_check(void *pool_data, const memkv_check_options_t *opts, memkv_check_report_t *report)
+{
+    if (!pool_data || !report)
+    {
+        LOG("[ERROR] invalid arguments to memkv_check");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    memset(report, 0, sizeof(*report));
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_check_options_t defaults = {0};
+    if (!opts)
+        opts = &defaults;
+    int threads = opts->threads > 0 ? opts->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > CHECK_MAX_THREADS)
+        threads = CHECK_MAX_THREADS;
+
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    check_ctx_t ctx = {
+        .meta = meta,
+        .key_start = (uint8_t *)meta + meta->key_offset,
+        .key_region = meta->valueptr_offset - meta->key_offset,
+        .page_bytes = KEYPAGE_HEAD + (uint64_t)meta->node_page_slots * meta->node_size,
+        .repair = opts->repair,
+    };
+    ctx.max_pages = ctx.key_region / ctx.page_bytes + 1;
+    if (ctx.max_pages > ((uint64_t)INT32_MAX >> KEYNODE_SLOT_BITS) + 1)
+        ctx.max_pages = ((uint64_t)INT32_MAX >> KEYNODE_SLOT_BITS) + 1;
+    size_t words = ((ctx.max_pages << KEYNODE_SLOT_BITS) + 63) / 64;
+    ctx.visited = calloc(words, sizeof(uint64_t));
+    ctx.accs = calloc(threads + 1, sizeof(check_acc_t));
+    check_items_t frontier = {0}, next = {0};
+    int r = MEMKV_ERROR_OUTOFMEMORY;
+    trie_enter(meta, true);
+    if (!ctx.visited || !ctx.accs || !check_collect_free(&ctx) || !items_push(&frontier, 0, 0))
+        goto done;
+
+    // 调用线程展开上面几层，叶子任务交给worker；accs[threads]是调用线程的统计
+    check_acc_t *main_acc = &ctx.accs[threads];
+    check_claim(&ctx, 0);
+    for (int level = 0; level < CHECK_SPLIT_LEVELS && frontier.n && frontier.n < (size_t)threads * CHECK_TASKS_PER_THREAD; level++)
+    {
+        next.n = 0;
+        for (size_t i = 0; i < frontier.n; i++)
+            check_node(&ctx, main_acc, frontier.items[i], &next);
+        check_items_t t = frontier;
+        frontier = next;
+        next = t;
+    }
+    ctx.tasks = frontier.items;
+    ctx.ntasks = frontier.n;
+
+    pthread_t tids[CHECK_MAX_THREADS];
+    check_worker_t workers[CHECK_MAX_THREADS];
+    int started = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i] = (check_worker_t){&ctx, i};
+        if (i == 0 || pthread_create(&tids[i], NULL, check_worker, &workers[i]) != 0)
+        {
+            tids[i] = 0;
+            if (i != 0)
+                continue;
+        }
+        started++;
+    }
+    check_worker(&workers[0]);
+    for (int i = 1; i < threads; i++)
+    {
+        if (tids[i])
+            pthread_join(tids[i], NULL);
+    }
+    LOG("[INFO] checked %zu subtrees with %d threads", ctx.ntasks, started);
+
+    // 合并到main_acc
+    bool oom = main_acc->oom;
+    for (int i = 0; i < threads; i++)
+    {
+        check_acc_t *a = &ctx.accs[i];
+        oom = oom || a->oom;
+        main_acc->r.nodes += a->r.nodes;
+        main_acc->r.keys += a->r.keys;
+        main_acc->r.bad_links += a->r.bad_links;
+        main_acc->r.shared_links += a->r.shared_links;
+        main_acc->r.bad_values += a->r.bad_values;
+        main_acc->r.dropped_subtrees += a->r.dropped_subtrees;
+        main_acc->r.dropped_keys += a->r.dropped_keys;
+        main_acc->depth_sum += a->depth_sum;
+        main_acc->compressed_values += a->compressed_values;
+        main_acc->compressed_raw_bytes += a->compressed_raw_bytes;
+        main_acc->compressed_bytes += a->compressed_bytes;
+        main_acc->cold_values += a->cold_values;
+        main_acc->cold_bytes += a->cold_bytes;
+        for (size_t k = 0; k < a->nboxes && !oom; k++)
+            oom = !acc_add_box(main_acc, a->boxes[k].offset, a->boxes[k].end, a->boxes[k].node, a->boxes[k].depth);
+    }
+    uint64_t saved_bytes = 0;
+    if (oom || !check_boxes(&ctx, main_acc, &saved_bytes))
+        goto done;
+
+    memkv_check_report_t *rep = &main_acc->r;
+    bool repair = opts->repair;
+    check_counter(rep, "keys", &meta->stats.keys, rep->keys, repair);
+    check_counter(rep, "key_depth_sum", &meta->stats.key_depth_sum, main_acc->depth_sum, repair);
+    check_counter(rep, "nodes", &meta->stats.nodes, rep->nodes, repair);
+    check_counter(rep, "compressed_values", &meta->stats.compressed_values, main_acc->compressed_values, repair);
+    check_counter(rep, "compressed_raw_bytes", &meta->stats.compressed_raw_bytes, main_acc->compressed_raw_bytes, repair);
+    check_counter(rep, "compressed_bytes", &meta->stats.compressed_bytes, main_acc->compressed_bytes, repair);
+    check_counter(rep, "cold_values", &meta->stats.cold_values, main_acc->cold_values, repair);
+    check_counter(rep, "cold_bytes", &meta->stats.cold_bytes, main_acc->cold_bytes, repair);
+    check_counter(rep, "dedup_boxes", &meta->stats.dedup_boxes, rep->dedup_boxes, repair);
+    check_counter(rep, "dedup_saved_bytes", &meta->stats.dedup_saved_bytes, saved_bytes, repair);
+    // 预留未提交的box也计入value_boxes，只能要求不少于被key引用的box数
+    uint64_t private_boxes = 0;
+    for (size_t i = 0; i < main_acc->nboxes; i++)
+        private_boxes += i == 0 || main_acc->boxes[i].offset != main_acc->boxes[i - 1].offset;
+    rep->value_boxes = private_boxes;
+    if (meta->stats.value_boxes < private_boxes)
+    {
+        LOG("[WARN] counter value_boxes is %lu, but keys reference %lu boxes", (unsigned long)meta->stats.value_boxes, (unsigned long)private_boxes);
+        rep->counter_mismatches++;
+    }
+
+    rep->errors = rep->bad_links + rep->shared_links + rep->bad_values + rep->overlapping_boxes + rep->dedup_mismatches + rep->counter_mismatches;
+    *report = *rep;
+    LOG("[INFO] check: %lu nodes, %lu keys, %lu problems%s", (unsigned long)rep->nodes, (unsigned long)rep->keys, (unsigned long)rep->errors, repair ? " (repaired)" : "");
+    r = rep->errors && !repair ? MEMKV_ERROR_CORRUPT : MEMKV_SUCCESS;
+
+done:
+    trie_leave(meta);
+    if (r == MEMKV_ERROR_OUTOFMEMORY)
+    {
+        LOG("[ERROR] out of memory while checking the pool");
+    }
+    if (ctx.accs)
+    {
+        for (int i = 0; i <= threads; i++)
+        {
+            free(ctx.accs[i].boxes);
+            free(ctx.accs[i].stack.items);
+        }
+    }
+    free(ctx.accs);
+    free(ctx.visited);
+    free(ctx.free_pages);
+    free(ctx.free_boxes);
+    free(frontier.items);
+    free(next.items);
+    return r;
+}
@@ -3,10 +3,34 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include <boxmalloc/boxmalloc.h>
 #include <blockmalloc/blockmalloc.h>
+#include <memkv/memkv.h>
 
+#define VALUE_ALIGN 8 // value按8字节对齐，原子操作依赖它
+
+// 池内统计计数器的增减，多个writer可能同时修改同一个计数器
+#define STAT_ADD(field, n) __atomic_fetch_add(&(field), (n), __ATOMIC_RELAXED)
+#define STAT_SUB(field, n) __atomic_fetch_sub(&(field), (n), __ATOMIC_RELAXED)
+
+/*
+小value的slab分配器：SLAB_CLASSES个级别（含value头部）16~64按8字节递增，之后每个2的幂区间再分4级，
+最大SLAB_MAX，相邻级别相差不超过25%；每个slab是SLAB_SIZE字节，只切一个级别的块。
+*/
+#define SLAB_SIZE 16384
+#define SLAB_CLASSES 27
+#define SLAB_MAX 2048
+typedef struct{
+    uint32_t partial;         // 有空闲块的slab链表，描述符序号+1，0为空
+    uint32_t chunks_per_slab;
+    uint64_t slabs;           // 该级别的slab数
+    uint64_t chunks;          // 已从slab分出的块数，含writer缓存中的
+    uint64_t values;          // 其中被value占用的块数
+    uint64_t value_bytes;     // 这些value的长度之和
+}  slab_class_t;
 
 typedef struct
 {   
@@ -14,20 +38,340 @@ typedef struct
     uint8_t magic[6]; // "memkv"
     uint16_t char_type; // 字符类别数量，不超过256，因为unicode可以用更多的byte(uint8_t)表示
     uint64_t pool_size; // 内存池大小
+    uint32_t version;   // 格式版本 MEMKV_FORMAT_VERSION，memkv_open校验
     // 三块区域的偏移
     uint64_t key_offset;
     uint64_t valueptr_offset;
     uint64_t value_offset;
 
-    // key区
+    // cache模式，见 memkv_evict_policy_t
+    uint8_t evict_policy;
+    uint8_t evict_samples; // 每次淘汰采样的key数量
+    uint64_t evict_count;  // 累计淘汰次数，右移后作为淘汰时钟
+
+    // 过滤器区，filter_blocks=0表示未开启
+    uint64_t filter_offset;
+    uint64_t filter_blocks;
+
+    // 埋点统计区 memkv_probe_t
+    uint64_t probe_offset;
+
+    // 热点采样区 hot_area_t，见 memkv_hot.c
+    uint64_t hot_offset;
+
+    // 统计计数器，写路径上顺手维护（多个writer并发时用STAT_ADD/STAT_SUB原子加减），memkv_stats直接读取
+    struct {
+        uint64_t keys;              // 存活的key数量
+        uint64_t key_depth_sum;     // 所有key的深度(长度)之和
+        uint64_t nodes;             // 已分配的前缀树节点数量，含根
+        uint64_t value_region_size; // value区大小
+        uint64_t value_boxes;       // 已分配的box数量，含预留未提交的
+        uint64_t value_alloc_bytes; // box占用的字节，含头部和容量余量
+        uint64_t value_used_bytes;  // value实际长度之和
+        uint64_t dedup_boxes;       // 去重索引中的共享box数量
+        uint64_t dedup_saved_bytes; // 共享box被多引用省下的字节
+        uint64_t compressed_values;    // 压缩存储的value数量
+        uint64_t compressed_raw_bytes; // 这些value的原长之和
+        uint64_t compressed_bytes;     // 这些value压缩后的长度之和
+        uint64_t cold_values;     // 在冷文件中的value数量
+        uint64_t cold_bytes;      // 这些value的长度之和
+        uint64_t tier_demotions;  // 累计搬到冷文件的次数
+        uint64_t tier_promotions; // 累计搬回池内的次数
+        uint64_t value_largest_free; // 最近一次探测到的最大可分配box，持有分配器锁的writer定期刷新
+        uint64_t largest_free_age;   // 上次探测以来的全局分配和释放次数
+    } stats;
+
+    // 全局分配器锁（持有者pid）和writer分配缓存槽位区，见 memkv_magazine.c
+    uint32_t alloc_lock;
+    uint32_t batch_seq; // 写批次的序列号，奇数表示有批次正在发布，见 memkv_batch_commit
+    uint32_t trie_lock;   // 前缀树写入闸门的独占持有者pid，见 trie_enter
+    uint32_t batch_lock;  // 发布写批次的进程pid，持有期间batch_seq为奇数；持有者中途退出时由下一个批次接管
+    uint64_t writers_offset;
+
+    // key区：blockmalloc按页分配，页内再按槽位分配节点，见 key_page_t
+    uint32_t node_size;      // 节点字节数，64字节的整数倍
+    uint8_t node_page_slots; // 每页的节点槽位数
     blocks_meta_t keys_blocks;
+
+    // value去重索引区，dedup_slots=0表示未开启，见 memkv_dedup.c
+    uint64_t dedup_offset;
+    uint64_t dedup_slots;
+    uint32_t dedup_min; // 参与去重的最小value长度
+
+    // value压缩，compress_min=0表示set不自动压缩；共享字典区见 memkv_compress.c
+    uint32_t compress_min;
+    uint32_t dict_len;
+    uint32_t dict_cap;
+    uint64_t dict_offset;
+
+    // 冷value文件路径，空表示未开启分层，见 memkv_tier.c
+    char tier_path[256];
+
+    // 带KEYNODE_WATCH_PREFIX的节点数，0时写者不用再走一遍路径
+    uint32_t watch_prefixes;
+
+    // 小value的slab分配器，见 memkv_slab.c
+    uint64_t slab_offset;    // slab描述符表，每SLAB_SIZE字节的value区一项
+    uint64_t slab_granules;  // 描述符表项数
+    uint64_t slab_tail;      // boxmalloc管理范围之外的value区尾部 [slab_tail, slab_tail_end)，只切slab
+    uint64_t slab_tail_end;
+    uint64_t slab_tail_next; // 尾部从未切过slab的起点
+    uint32_t slab_tail_free; // 尾部空闲slab链表，描述符序号+1，0为空
+    uint32_t slab_reserved;
+    slab_class_t slab_classes[SLAB_CLASSES];
 }  memkv_meta_t;
 
+// 节点头部16字节，字段自然对齐，读取时不需要位域掩码；整个节点按64字节对齐，不跨cache line起始
 typedef struct{
-    bool has_key:1;
-    uint64_t box_offset:63;//如果has_key=1,表示该节点存储了一个key,box_offset表示key对应的对象偏移
+    uint64_t box;//如果has_key=1,表示该节点存储了一个key；低56位是value box的偏移，高8位是存储形式BOX_SHARED等，偏移和存储形式同一次原子写发布
+    uint8_t has_key;
+    uint8_t freq;//cache模式下的对数访问计数(LFU)，0~127
+    uint8_t atime;//cache模式下最近一次访问时的淘汰时钟(低8位)，freq按流逝的时钟衰减；和box同在节点头部，读路径不会多一次cache miss
+    uint8_t flags;//KEYNODE_WATCHED等，多个进程都会改，只用原子操作置位和清除
+    uint32_t version;//watch用的变更计数，写者每次发布加2，bit0表示有进程在futex等待，见 memkv_watch.c
     int32_t child_key_blocks[2];//实际不为2，而是=char_type。
-}  __attribute__((packed))  key_node_t;
+}  key_node_t;
+
+/*
+key区的页：一个blockmalloc块，64字节页头之后是node_page_slots个节点。
+节点id = 页号<<KEYNODE_SLOT_BITS | 页内槽位，分配子节点时优先使用父节点所在页的空槽，
+同一棵子树的节点聚在同一页内，下降时相邻几层落在同一组cache line/TLB页上。
+*/
+#define KEYNODE_ALIGN 64
+#define KEYPAGE_SIZE 4096
+#define KEYPAGE_HEAD 64
+#define KEYNODE_SLOT_BITS 4
+#define KEYNODE_SLOT_MASK ((1 << KEYNODE_SLOT_BITS) - 1)
+#define BOX_FLAG_SHIFT 56
+#define BOX_OFFSET_MASK ((UINT64_C(1) << BOX_FLAG_SHIFT) - 1)
+#define BOX_SHARED (UINT64_C(0x01) << BOX_FLAG_SHIFT) // value是去重索引中的共享box，不能原地修改
+#define BOX_COMPRESSED (UINT64_C(0x02) << BOX_FLAG_SHIFT) // value是压缩后的字节，读取要解压
+#define BOX_COLD (UINT64_C(0x04) << BOX_FLAG_SHIFT) // value在冷文件中，偏移是冷文件内的偏移
+#define KEYNODE_WATCHED 0x08 // 被watch过（key本身或不存在的key最近的已有前缀），即使没有key和子节点也不回收，等待者睡在它的version上
+#define KEYNODE_WATCH_PREFIX 0x10 // 前缀watch，子树里的写也给它的version加2
+#define KEYNODE_STAGED 0x20 // 被未提交的写批次引用，提交或放弃之前不回收
+#define KEY_BUFFER_MAX 1024 // 遍历时key缓冲区的长度上限
+typedef struct{
+    uint32_t used; // 已分配槽位的位图
+}  key_page_t;
+
+// value box的头部，紧挨在value数据之前；box_offset指向头部
+typedef struct{
+    uint32_t len; // value长度
+    uint32_t cap; // box中可用于value的容量，len<=cap时可以原地覆盖
+}  value_head_t;
+
+static inline key_page_t *keypage_at(memkv_meta_t *meta, void *key_start, int32_t node_id)
+{
+    return key_start + blockdata_offset(&meta->keys_blocks, node_id >> KEYNODE_SLOT_BITS);
+}
+static inline key_node_t *keynode_at(memkv_meta_t *meta, void *key_start, int32_t node_id)
+{
+    return (void *)keypage_at(meta, key_start, node_id) + KEYPAGE_HEAD + (size_t)(node_id & KEYNODE_SLOT_MASK) * meta->node_size;
+}
+static inline value_head_t *value_head(memkv_meta_t *meta, uint64_t box_offset)
+{
+    return (void *)meta + meta->value_offset + box_offset;
+}
+static inline void *value_data(value_head_t *head)
+{
+    return head + 1;
+}
+
+// 压缩value的原长，在box内容开头
+static inline size_t value_raw_len(value_head_t *head)
+{
+    uint32_t raw;
+    memcpy(&raw, value_data(head), sizeof(raw));
+    return raw;
+}
+
+// 冷value文件 memkv_tier.c，映射是进程本地的
+value_head_t *tier_head(const memkv_meta_t *meta, uint64_t offset);
+uint64_t tier_alloc(memkv_meta_t *meta, size_t len);
+void tier_free(memkv_meta_t *meta, uint64_t offset);
+bool tier_valid(const memkv_meta_t *meta, uint64_t offset); // 冷记录在冷文件已分配的范围内，memkv_check用
+
+// 节点box字的偏移部分
+static inline uint64_t box_offset_of(uint64_t box)
+{
+    return box & BOX_OFFSET_MASK;
+}
+
+// 读者一次取出偏移和存储形式，之后只用这个快照
+static inline uint64_t keynode_box(const key_node_t *node)
+{
+    return __atomic_load_n(&node->box, __ATOMIC_ACQUIRE);
+}
+
+// 节点value的头部，冷value在冷文件中，冷文件无法映射时为NULL
+static inline value_head_t *keynode_head(memkv_meta_t *meta, uint64_t box)
+{
+    return (box & BOX_COLD) ? tier_head(meta, box_offset_of(box)) : value_head(meta, box_offset_of(box));
+}
+
+// 读路径上value的零拷贝视图：压缩的value没有可直接使用的指针，给出NULL和原长，内容用memkv_read读取；
+// 冷value指向冷文件的映射，不搬回池内
+static inline void *value_view(memkv_meta_t *meta, uint64_t box, size_t *len)
+{
+    value_head_t *head = keynode_head(meta, box);
+    if (!head)
+    {
+        *len = 0;
+        return NULL;
+    }
+    if (box & BOX_COMPRESSED)
+    {
+        *len = value_raw_len(head);
+        return NULL;
+    }
+    *len = head->len;
+    return value_data(head);
+}
+
+// 大小为size（含头部）的box所在的slab级别，超过SLAB_MAX时为-1
+static inline int slab_class(size_t size)
+{
+    if (size <= 16)
+        return 0;
+    if (size <= 64)
+        return (int)((size + 7) / 8) - 2;
+    if (size > SLAB_MAX)
+        return -1;
+    int n = 63 - __builtin_clzll(size - 1);
+    return 7 + (n - 6) * 4 + (int)((size - 1 - ((size_t)1 << n)) >> (n - 2));
+}
+static inline size_t slab_class_size(int c)
+{
+    if (c < 7)
+        return 16 + 8 * (size_t)c;
+    int g = (c - 7) / 4, k = (c - 7) % 4;
+    return ((size_t)64 << g) + (size_t)(k + 1) * ((size_t)16 << g);
+}
+// slab分配器 memkv_slab.c，调用方持有magazine_lock
+typedef struct{
+    uint16_t base;      // slab起点相对本项SLAB_SIZE格子起点的偏移+1，0表示这一格没有slab起点
+    uint8_t cls;
+    uint8_t flags;      // SLAB_TAIL等
+    uint16_t used;      // 已分出的块数
+    uint16_t free_head; // 空闲块链表，块序号，SLAB_NONE为空；空闲块开头2字节存下一块的序号
+    uint16_t bump;      // 从未分出过的块起点
+    uint16_t reserved;
+    uint32_t next;      // partial或尾部空闲链表，描述符序号+1
+    uint32_t prev;
+}  slab_desc_t;
+size_t slab_area_size(uint64_t value_bytes);
+void slab_init(memkv_meta_t *meta, uint64_t offset, uint64_t box_size, uint64_t tail_end);
+uint64_t slab_alloc(memkv_meta_t *meta, int c);
+bool slab_free(memkv_meta_t *meta, uint64_t offset); // offset不在slab内时返回false，由调用方还给boxmalloc
+bool slab_chunk_valid(const memkv_meta_t *meta, uint64_t offset, size_t size); // memkv_check用
+
+// writer分配缓存 memkv_magazine.c
+#define MEMKV_WRITER_SLOTS 16
+#define MAG_PAGES 16     // 每个writer缓存的空闲key页数
+#define MAG_BOXES 16     // 每个大小级别缓存的box数
+#define MAG_CLASSES SLAB_CLASSES // 与slab级别一致
+typedef struct{
+    uint32_t owner;    // 占用槽位的线程tid，0表示空闲
+    uint32_t pid;      // 所属进程
+    uint32_t active;   // 以共享方式进入了前缀树写入闸门，见 trie_enter
+    uint32_t npages;
+    uint32_t nboxes[MAG_CLASSES];
+    int64_t pages[MAG_PAGES];
+    uint64_t boxes[MAG_CLASSES][MAG_BOXES];
+}  __attribute__((aligned(64))) writer_slot_t;
+size_t magazine_area_size(void);
+void magazine_init(memkv_meta_t *meta, uint64_t offset);
+void pool_lock(uint32_t *word, const char *name);
+void pool_unlock(uint32_t *word);
+void magazine_lock(memkv_meta_t *meta);
+void magazine_unlock(memkv_meta_t *meta);
+uint32_t magazine_self_pid(void); // 本进程pid，缓存在线程局部变量里
+void magazine_probe_largest(memkv_meta_t *meta);
+int magazine_reclaim(memkv_meta_t *meta);
+int64_t magazine_page_alloc(memkv_meta_t *meta);
+void magazine_page_free(memkv_meta_t *meta, int64_t page_id);
+uint64_t magazine_box_alloc(memkv_meta_t *meta, size_t *size);
+void magazine_box_free(memkv_meta_t *meta, uint64_t offset, size_t size);
+
+// 前缀树写入闸门和key锁 memkv_magazine.c
+#define KEY_LOCK_STRIPES 64 // key锁按节点地址分条，每条独占一个cache line
+void trie_enter(memkv_meta_t *meta, bool exclusive);
+void trie_leave(memkv_meta_t *meta);
+bool trie_exclusive(const memkv_meta_t *meta); // 当前线程独占着闸门
+void key_lock(memkv_meta_t *meta, const key_node_t *node);
+void key_unlock(memkv_meta_t *meta, const key_node_t *node);
+
+// value去重索引 memkv_dedup.c
+#define DEDUP_DEFAULT_MIN 16
+typedef struct{
+    uint64_t hash;       // value内容的哈希
+    uint64_t box_offset; // 共享的box
+    uint32_t refs;       // 引用该box的key数量，0表示空槽
+    uint32_t reserved;
+}  dedup_entry_t;
+size_t dedup_area_size(uint64_t expected_values);
+void dedup_init(memkv_meta_t *meta, uint64_t offset, size_t size, uint32_t min_len);
+uint64_t dedup_acquire(memkv_meta_t *meta, uint64_t hash, const void *data, size_t len);
+uint64_t dedup_intern(memkv_meta_t *meta, uint64_t hash, uint64_t box_offset);
+bool dedup_release(memkv_meta_t *meta, uint64_t box_offset);
+
+// value压缩 memkv_compress.c
+#define VALUE_COMPRESS_HEAD 4 // 压缩后的box内容以uint32原长开头
+size_t compress_area_size(uint32_t dict_cap);
+void compress_init(memkv_meta_t *meta, uint64_t offset, uint32_t dict_cap, uint32_t min_len);
+void *value_compress(const memkv_meta_t *meta, const void *src, size_t len, size_t *out_len); // 返回malloc的缓冲区，不值得压缩时返回NULL
+bool value_decompress(const memkv_meta_t *meta, value_head_t *head, void *dst);
+
+// watch/notify memkv_watch.c
+void watch_notify(memkv_meta_t *meta, key_node_t *node, const void *key_data, size_t key_len); // 发布或删除之后调用
+int watch_wait(uint32_t *version, uint32_t *seen, int timeout_ms);
+uint32_t watch_base(key_node_t *node); // 节点当前的变更计数（去掉等待者标记）
+void watch_rebase(uint32_t *version, uint32_t base); // 把变更计数改成base，有等待者时唤醒
+
+// 过滤器 memkv_filter.c
+#define MEMKV_FILTER_BLOCK_SIZE 64
+size_t filter_size(uint64_t expected_keys);
+void filter_init(memkv_meta_t *meta, uint64_t filter_offset, size_t size);
+bool filter_maybe(const memkv_meta_t *meta, uint64_t hash);
+void filter_add(memkv_meta_t *meta, uint64_t hash);
+void filter_del(memkv_meta_t *meta, uint64_t hash);
+
+// 冻结的只读池 memkv_freeze.c
+/*
+LOUDS前缀树：节点按BFS编号（根为0），louds位向量里每个节点依次写 度数个1 + 一个0；
+节点v的子节点是BFS编号连续的一段，labels[]给出每个节点的入边字符，同一父节点下升序。
+has_key位向量标记有key的节点，第rank1(v)个key的value在values区的values_index[rank]处。
+pool_size和version与memkv_meta_t同偏移，只读取魔数、大小和版本的工具对两种格式通用。
+*/
+#define MEMKV_FROZEN_MAGIC "memkvF"
+#define FROZEN_SELECT_SAMPLE 64 // 每64个0采样一次位置
+#define FROZEN_RANK_BLOCK 512   // has_key每512位一个累计计数
+typedef struct
+{
+    uint8_t magic[6]; // "memkvF"
+    uint16_t char_type;
+    uint64_t pool_size;
+    uint32_t version;
+    uint64_t nodes;
+    uint64_t keys;
+    uint64_t key_depth_sum;
+    uint64_t louds_offset; // uint64_t[]，2*nodes-1位
+    uint64_t select_offset; // uint64_t[]，第i*FROZEN_SELECT_SAMPLE个0的位置
+    uint64_t labels_offset; // uint8_t[nodes]
+    uint64_t haskey_offset; // uint64_t[]，nodes位
+    uint64_t rank_offset;   // uint32_t[]，每FROZEN_RANK_BLOCK位之前的1的个数
+    uint64_t values_index_offset; // uint64_t[keys]，value头部相对values_offset的偏移
+    uint64_t values_offset; // 依次排列的 value_head_t + 数据，按8字节对齐
+    uint64_t values_size;
+} memkv_frozen_t;
 
+static inline bool pool_is_frozen(const void *pool_data)
+{
+    return memcmp(pool_data, MEMKV_FROZEN_MAGIC, 6) == 0;
+}
+void *frozen_get(const memkv_frozen_t *fz, const void *key_data, size_t key_len);
+void frozen_keys(const memkv_frozen_t *fz, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len));
+void frozen_stats(const memkv_frozen_t *fz, memkv_stats_t *stats);
 
 #endif // MEMKV_COMMON_H
\ No newline at end of file
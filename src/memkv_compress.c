@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "memkv_hash.h"
+#include "logutil.h"
+
+/*
+value压缩：
+1. 编码是LZ4风格的字节流，序列为 token(高4位字面量长度，低4位匹配长度-4) + 字面量 + 2字节偏移，
+   长度>=15时后跟若干255和余数；最后一个序列只有字面量。没有熵编码，解压只有拷贝，每字节几个周期；
+2. 池内可选一个共享字典，压缩和解压时把字典当作数据之前的窗口，偏移可以指回字典，
+   短小的JSON文档也能引用字典里的字段名和常见片段；
+3. 压缩后的box内容为 [uint32原长][字节流]，节点的box字带BOX_COMPRESSED标志。
+*/
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 13
+#define DICT_SEGMENT 32 // 训练字典时的片段长度
+#define DICT_GRAM 8     // 给片段打分用的k-gram长度
+#define DICT_COUNT_BITS 16
+
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// 字典和数据拼成的虚拟窗口上的字节
+static inline uint8_t lz_at(const uint8_t *dict, size_t dict_len, const uint8_t *src, size_t v)
+{
+    return v < dict_len ? dict[v] : src[v - dict_len];
+}
+
+static bool lz_put_len(uint8_t **op, const uint8_t *end, size_t len)
+{
+    for (; len >= 255; len -= 255)
+    {
+        if (*op >= end)
+            return false;
+        *(*op)++ = 255;
+    }
+    if (*op >= end)
+        return false;
+    *(*op)++ = (uint8_t)len;
+    return true;
+}
+
+// 输出一个序列，match_len=0表示最后一个只有字面量的序列
+static bool lz_put_sequence(uint8_t **op, const uint8_t *end, const uint8_t *lit, size_t lit_len, size_t offset, size_t match_len)
+{
+    size_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+    if (*op >= end)
+        return false;
+    *(*op)++ = (uint8_t)(((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15));
+    if (lit_len >= 15 && !lz_put_len(op, end, lit_len - 15))
+        return false;
+    if ((size_t)(end - *op) < lit_len)
+        return false;
+    memcpy(*op, lit, lit_len);
+    *op += lit_len;
+    if (!match_len)
+        return true;
+    if (end - *op < 2)
+        return false;
+    *(*op)++ = (uint8_t)offset;
+    *(*op)++ = (uint8_t)(offset >> 8);
+    return ml < 15 || lz_put_len(op, end, ml - 15);
+}
+
+// 压缩到dst，放不下时返回0
+static size_t lz_compress(const uint8_t *dict, size_t dict_len, const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    uint32_t *table = calloc(1u << LZ_HASH_BITS, sizeof(uint32_t)); // 虚拟位置+1，0为空
+    if (!table)
+        return 0;
+    // 字典只保留最后64K，偏移够得着
+    size_t dict_from = dict_len > LZ_MAX_OFFSET ? dict_len - LZ_MAX_OFFSET : 0;
+    for (size_t v = dict_from; v + LZ_MIN_MATCH <= dict_len; v++)
+        table[lz_hash(lz_read32(dict + v))] = (uint32_t)v + 1;
+
+    uint8_t *op = dst;
+    const uint8_t *end = dst + cap;
+    size_t anchor = 0, i = 0;
+    while (i + LZ_MIN_MATCH <= len)
+    {
+        uint32_t seq = lz_read32(src + i);
+        uint32_t h = lz_hash(seq);
+        size_t cur = dict_len + i;
+        size_t cand = table[h];
+        table[h] = (uint32_t)cur + 1;
+        if (cand && cur - (cand - 1) <= LZ_MAX_OFFSET)
+        {
+            size_t c = cand - 1;
+            size_t m = 0;
+            while (i + m < len && lz_at(dict, dict_len, src, c + m) == src[i + m])
+                m++;
+            if (m >= LZ_MIN_MATCH)
+            {
+                if (!lz_put_sequence(&op, end, src + anchor, i - anchor, cur - c, m))
+                {
+                    free(table);
+                    return 0;
+                }
+                i += m;
+                anchor = i;
+                if (i >= 2 && i + 2 <= len)
+                    table[lz_hash(lz_read32(src + i - 2))] = (uint32_t)(dict_len + i - 2) + 1;
+                continue;
+            }
+        }
+        // 不可压缩的区域步长逐渐加大
+        i += 1 + ((i - anchor) >> 6);
+    }
+    free(table);
+    if (!lz_put_sequence(&op, end, src + anchor, len - anchor, 0, 0))
+        return 0;
+    return (size_t)(op - dst);
+}
+
+static bool lz_get_len(const uint8_t **ip, const uint8_t *end, size_t *len)
+{
+    uint8_t b;
+    do
+    {
+        if (*ip >= end)
+            return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+// 解压出恰好raw_len字节，输入损坏时返回false
+static bool lz_decompress(const uint8_t *dict, size_t dict_len, const uint8_t *src, size_t len, uint8_t *dst, size_t raw_len)
+{
+    const uint8_t *ip = src, *iend = src + len;
+    size_t op = 0;
+    for (;;)
+    {
+        if (ip >= iend)
+            return false;
+        uint8_t token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !lz_get_len(&ip, iend, &lit))
+            return false;
+        if ((size_t)(iend - ip) < lit || raw_len - op < lit)
+            return false;
+        memcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend)
+            return op == raw_len;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t m = token & 15;
+        if (m == 15 && !lz_get_len(&ip, iend, &m))
+            return false;
+        m += LZ_MIN_MATCH;
+        if (!offset || offset > op + dict_len || raw_len - op < m)
+            return false;
+        // 偏移越过输出开头时先从字典尾部拷贝，重叠的匹配逐字节复制
+        size_t k = 0;
+        for (; offset > op + k && k < m; k++)
+            dst[op + k] = dict[dict_len - (offset - op - k)];
+        for (; k < m; k++)
+            dst[op + k] = dst[op + k - offset];
+        op += m;
+    }
+}
+
+static inline const uint8_t *dict_data(const memkv_meta_t *meta)
+{
+    return (const uint8_t *)meta + meta->dict_offset;
+}
+
+size_t compress_area_size(uint32_t dict_cap)
+{
+    return ((size_t)dict_cap + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(size_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+}
+
+void compress_init(memkv_meta_t *meta, uint64_t offset, uint32_t dict_cap, uint32_t min_len)
+{
+    meta->dict_offset = offset;
+    meta->dict_cap = dict_cap;
+    meta->dict_len = 0;
+    meta->compress_min = min_len;
+}
+
+void *value_compress(const memkv_meta_t *meta, const void *src, size_t len, size_t *out_len)
+{
+    if (len > UINT32_MAX)
+        return NULL;
+    // 至少省下1/8才值得压缩，否则读路径白白多一次解压
+    size_t cap = len - len / 8;
+    if (cap <= VALUE_COMPRESS_HEAD)
+        return NULL;
+    uint8_t *buf = malloc(cap);
+    if (!buf)
+        return NULL;
+    uint32_t raw = (uint32_t)len;
+    memcpy(buf, &raw, sizeof(raw));
+    size_t n = lz_compress(dict_data(meta), meta->dict_len, src, len, buf + VALUE_COMPRESS_HEAD, cap - VALUE_COMPRESS_HEAD);
+    if (!n)
+    {
+        free(buf);
+        return NULL;
+    }
+    *out_len = VALUE_COMPRESS_HEAD + n;
+    return buf;
+}
+
+bool value_decompress(const memkv_meta_t *meta, value_head_t *head, void *dst)
+{
+    const uint8_t *stream = (const uint8_t *)value_data(head) + VALUE_COMPRESS_HEAD;
+    if (!lz_decompress(dict_data(meta), meta->dict_len, stream, head->len - VALUE_COMPRESS_HEAD, dst, value_raw_len(head)))
+    {
+        LOG("[ERROR] corrupt compressed value");
+        return false;
+    }
+    return true;
+}
+
+int memkv_set_dict(void *pool_data, const void *dict, size_t dict_len)
+{
+    if (!pool_data || (dict_len && !dict))
+    {
+        LOG("[ERROR] invalid arguments to memkv_set_dict");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    if (dict_len > meta->dict_cap)
+    {
+        LOG("[ERROR] dictionary of %zu bytes exceeds the reserved %u bytes", dict_len, meta->dict_cap);
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    // 已有的压缩value依赖旧字典解压；独占写入闸门，没有正在用旧字典压缩的writer
+    trie_enter(meta, true);
+    if (meta->stats.compressed_values)
+    {
+        trie_leave(meta);
+        LOG("[ERROR] cannot replace dictionary while %lu compressed values exist", (unsigned long)meta->stats.compressed_values);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    memcpy((uint8_t *)meta + meta->dict_offset, dict, dict_len);
+    meta->dict_len = (uint32_t)dict_len;
+    trie_leave(meta);
+    LOG("[INFO] compression dictionary set: %zu bytes", dict_len);
+    return MEMKV_SUCCESS;
+}
+
+/*
+训练字典：统计所有样本中每个8字节k-gram的出现次数，样本按32字节切成片段，
+片段得分为其k-gram计数之和；按得分从高到低挑选，已选片段的k-gram计数清零，
+重复的片段不会被再选。得分最高的放在字典末尾，离数据最近，偏移最短。
+*/
+typedef struct
+{
+    uint64_t score;
+    uint32_t sample;
+    uint32_t pos;
+} dict_segment_t;
+
+static int segment_cmp(const void *a, const void *b)
+{
+    const dict_segment_t *x = a, *y = b;
+    return x->score < y->score ? 1 : x->score > y->score ? -1 : 0;
+}
+
+static uint64_t segment_score(const uint32_t *counts, const uint8_t *p)
+{
+    uint64_t s = 0;
+    for (size_t i = 0; i + DICT_GRAM <= DICT_SEGMENT; i++)
+    {
+        uint32_t c = counts[memkv_hash(p + i, DICT_GRAM) >> (64 - DICT_COUNT_BITS)];
+        s += c > 1 ? c : 0; // 只出现一次的k-gram对其他value没有用
+    }
+    return s;
+}
+
+size_t memkv_dict_train(const void *const *samples, const size_t *sample_lens, size_t nsamples, void *dict, size_t dict_cap)
+{
+    if (!samples || !sample_lens || !dict || !dict_cap)
+        return 0;
+    uint32_t *counts = calloc(1u << DICT_COUNT_BITS, sizeof(uint32_t));
+    size_t nseg = 0;
+    for (size_t s = 0; s < nsamples; s++)
+        nseg += sample_lens[s] / DICT_SEGMENT;
+    dict_segment_t *segs = malloc((nseg ? nseg : 1) * sizeof(dict_segment_t));
+    if (!counts || !segs)
+    {
+        free(counts);
+        free(segs);
+        return 0;
+    }
+    for (size_t s = 0; s < nsamples; s++)
+    {
+        const uint8_t *p = samples[s];
+        for (size_t i = 0; i + DICT_GRAM <= sample_lens[s]; i++)
+            counts[memkv_hash(p + i, DICT_GRAM) >> (64 - DICT_COUNT_BITS)]++;
+    }
+    size_t k = 0;
+    for (size_t s = 0; s < nsamples; s++)
+    {
+        for (size_t pos = 0; pos + DICT_SEGMENT <= sample_lens[s]; pos += DICT_SEGMENT)
+        {
+            segs[k].score = segment_score(counts, (const uint8_t *)samples[s] + pos);
+            segs[k].sample = (uint32_t)s;
+            segs[k].pos = (uint32_t)pos;
+            k++;
+        }
+    }
+    qsort(segs, nseg, sizeof(dict_segment_t), segment_cmp);
+
+    uint8_t *out = dict;
+    size_t filled = 0;
+    for (size_t i = 0; i < nseg && filled + DICT_SEGMENT <= dict_cap; i++)
+    {
+        const uint8_t *p = (const uint8_t *)samples[segs[i].sample] + segs[i].pos;
+        // 得分因已选片段而大幅下降的说明内容重复
+        uint64_t now = segment_score(counts, p);
+        if (!now || now * 2 < segs[i].score)
+            continue;
+        filled += DICT_SEGMENT;
+        memcpy(out + dict_cap - filled, p, DICT_SEGMENT);
+        for (size_t j = 0; j + DICT_GRAM <= DICT_SEGMENT; j++)
+            counts[memkv_hash(p + j, DICT_GRAM) >> (64 - DICT_COUNT_BITS)] = 0;
+    }
+    memmove(out, out + dict_cap - filled, filled);
+    free(counts);
+    free(segs);
+    LOG("[INFO] trained dictionary of %zu bytes from %zu samples", filled, nsamples);
+    return filled;
+}
@@ -0,0 +1,139 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "memkv_common.h"
+#include "memkv_hash.h"
+#include "logutil.h"
+
+/*
+value去重索引：
+1. 池内的开放寻址哈希表，每项记录一个共享box的内容哈希、偏移和引用数，refs=0为空槽；
+2. set时先按内容查表，相同的value直接引用已有box；引用该box的节点的box字带BOX_SHARED标志；
+3. 共享box的内容不可修改：malloc/realloc/原子操作遇到共享box时先拷贝出私有box（写时复制）；
+4. 引用数归零时删除表项（后移删除，不留墓碑），由调用方释放box。
+调用方持有magazine_lock。
+*/
+#define DEDUP_MAX_LOAD_NUM 3 // 装载因子上限3/4
+#define DEDUP_MAX_LOAD_DEN 4
+
+static inline dedup_entry_t *dedup_table(const memkv_meta_t *meta)
+{
+    return (dedup_entry_t *)((uint8_t *)meta + meta->dedup_offset);
+}
+
+static inline uint64_t dedup_home(const memkv_meta_t *meta, uint64_t hash)
+{
+    return (uint64_t)(((unsigned __int128)hash * meta->dedup_slots) >> 64);
+}
+
+static inline uint64_t box_bytes(const value_head_t *head)
+{
+    return sizeof(value_head_t) + head->cap;
+}
+
+size_t dedup_area_size(uint64_t expected_values)
+{
+    if (!expected_values)
+        return 0;
+    uint64_t slots = expected_values * DEDUP_MAX_LOAD_DEN / DEDUP_MAX_LOAD_NUM + 1;
+    return (slots * sizeof(dedup_entry_t) + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(size_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+}
+
+void dedup_init(memkv_meta_t *meta, uint64_t offset, size_t size, uint32_t min_len)
+{
+    meta->dedup_offset = offset;
+    meta->dedup_slots = size / sizeof(dedup_entry_t);
+    meta->dedup_min = min_len ? min_len : DEDUP_DEFAULT_MIN;
+    if (meta->dedup_slots)
+        memset(dedup_table(meta), 0, meta->dedup_slots * sizeof(dedup_entry_t));
+    LOG("[INFO] dedup slots: %lu", (unsigned long)meta->dedup_slots);
+}
+
+// 找内容相同的共享box，找到时引用数加1并返回其偏移，否则返回-1
+uint64_t dedup_acquire(memkv_meta_t *meta, uint64_t hash, const void *data, size_t len)
+{
+    dedup_entry_t *table = dedup_table(meta);
+    for (uint64_t i = dedup_home(meta, hash);; i = (i + 1) % meta->dedup_slots)
+    {
+        dedup_entry_t *e = &table[i];
+        if (!e->refs)
+            return (uint64_t)-1;
+        if (e->hash != hash)
+            continue;
+        value_head_t *head = value_head(meta, e->box_offset);
+        if (head->len == len && memcmp(value_data(head), data, len) == 0)
+        {
+            e->refs++;
+            meta->stats.dedup_saved_bytes += box_bytes(head);
+            return e->box_offset;
+        }
+    }
+}
+
+/*
+登记一个新写好的box：已有相同内容时（并发的writer抢先登记）引用那个box并返回其偏移，
+调用方释放自己的box；否则登记box_offset；表满时返回-1，box保持私有
+*/
+uint64_t dedup_intern(memkv_meta_t *meta, uint64_t hash, uint64_t box_offset)
+{
+    value_head_t *head = value_head(meta, box_offset);
+    uint64_t existing = dedup_acquire(meta, hash, value_data(head), head->len);
+    if (existing != (uint64_t)-1)
+        return existing;
+    if ((meta->stats.dedup_boxes + 1) * DEDUP_MAX_LOAD_DEN > meta->dedup_slots * DEDUP_MAX_LOAD_NUM)
+    {
+        LOG("[WARN] dedup index is full, value stays private");
+        return (uint64_t)-1;
+    }
+    dedup_entry_t *table = dedup_table(meta);
+    uint64_t i = dedup_home(meta, hash);
+    while (table[i].refs)
+        i = (i + 1) % meta->dedup_slots;
+    table[i].hash = hash;
+    table[i].box_offset = box_offset;
+    table[i].refs = 1;
+    meta->stats.dedup_boxes++;
+    return box_offset;
+}
+
+// 释放一个引用，返回true表示这是最后一个引用，表项已删除，调用方应释放box
+bool dedup_release(memkv_meta_t *meta, uint64_t box_offset)
+{
+    value_head_t *head = value_head(meta, box_offset);
+    uint64_t hash = memkv_hash(value_data(head), head->len);
+    dedup_entry_t *table = dedup_table(meta);
+    uint64_t n = meta->dedup_slots;
+    uint64_t i = dedup_home(meta, hash);
+    for (; table[i].refs; i = (i + 1) % n)
+    {
+        if (table[i].box_offset == box_offset)
+            break;
+    }
+    if (!table[i].refs)
+    {
+        LOG("[ERROR] shared box %lu is missing from the dedup index, leaking it", (unsigned long)box_offset);
+        return false;
+    }
+    if (--table[i].refs)
+    {
+        meta->stats.dedup_saved_bytes -= box_bytes(head);
+        return false;
+    }
+
+    // 后移删除：把探测链上可以前移的项搬到空位，保持查找不中断
+    for (uint64_t j = (i + 1) % n; table[j].refs; j = (j + 1) % n)
+    {
+        uint64_t home = dedup_home(meta, table[j].hash);
+        bool keep = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (!keep)
+        {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].refs = 0;
+    meta->stats.dedup_boxes--;
+    return true;
+}
@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "memkv_common.h"
+#include "logutil.h"
+
+/*
+分块计数布隆过滤器：
+1. 每个块正好是一个64字节的cache line，里面有128个4bit计数器；
+2. key的哈希高32位选块，低28位在块内选FILTER_HASHES个计数器，一次查询只碰一个cache line；
+3. 计数器支持删除；加到15后饱和，不再增减，宁可多一点误判也不会漏判；
+4. 多个writer会同时增减同一个字节里的两个计数器，按字节CAS修改。
+*/
+#define FILTER_HASHES 4
+#define FILTER_COUNTER_MAX 15
+
+static inline uint8_t *filter_block(const memkv_meta_t *meta, uint64_t hash)
+{
+    uint64_t block = ((hash >> 32) * meta->filter_blocks) >> 32;
+    return (uint8_t *)meta + meta->filter_offset + block * MEMKV_FILTER_BLOCK_SIZE;
+}
+
+static inline unsigned filter_slot(uint64_t hash, int i)
+{
+    return (unsigned)(hash >> (7 * i)) & 0x7f;
+}
+
+static inline uint8_t filter_get(const uint8_t *block, unsigned slot)
+{
+    return (__atomic_load_n(&block[slot >> 1], __ATOMIC_RELAXED) >> ((slot & 1) * 4)) & 0xf;
+}
+
+// 计数器加减1，0和饱和值不动
+static void filter_step(uint8_t *block, unsigned slot, int delta)
+{
+    unsigned shift = (slot & 1) * 4;
+    uint8_t *byte = &block[slot >> 1];
+    uint8_t cur = __atomic_load_n(byte, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        uint8_t v = (cur >> shift) & 0xf;
+        if (v == FILTER_COUNTER_MAX || (delta < 0 && v == 0))
+            return;
+        uint8_t next = (uint8_t)((cur & ~(0xf << shift)) | ((v + delta) << shift));
+        if (__atomic_compare_exchange_n(byte, &cur, next, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+size_t filter_size(uint64_t expected_keys)
+{
+    // 每个key约8个计数器(4字节)，4个哈希下误判率约3%
+    uint64_t blocks = (expected_keys * 8 + 127) / 128;
+    return blocks * MEMKV_FILTER_BLOCK_SIZE;
+}
+
+void filter_init(memkv_meta_t *meta, uint64_t filter_offset, size_t size)
+{
+    meta->filter_offset = filter_offset;
+    meta->filter_blocks = size / MEMKV_FILTER_BLOCK_SIZE;
+    if (meta->filter_blocks)
+        memset((uint8_t *)meta + filter_offset, 0, meta->filter_blocks * MEMKV_FILTER_BLOCK_SIZE);
+    LOG("[INFO] filter blocks: %lu", (unsigned long)meta->filter_blocks);
+}
+
+bool filter_maybe(const memkv_meta_t *meta, uint64_t hash)
+{
+    if (!meta->filter_blocks)
+        return true;
+    const uint8_t *block = filter_block(meta, hash);
+    for (int i = 0; i < FILTER_HASHES; i++)
+    {
+        if (filter_get(block, filter_slot(hash, i)) == 0)
+            return false;
+    }
+    return true;
+}
+
+void filter_add(memkv_meta_t *meta, uint64_t hash)
+{
+    if (!meta->filter_blocks)
+        return;
+    uint8_t *block = filter_block(meta, hash);
+    for (int i = 0; i < FILTER_HASHES; i++)
+        filter_step(block, filter_slot(hash, i), 1);
+}
+
+void filter_del(memkv_meta_t *meta, uint64_t hash)
+{
+    if (!meta->filter_blocks)
+        return;
+    uint8_t *block = filter_block(meta, hash);
+    for (int i = 0; i < FILTER_HASHES; i++)
+        filter_step(block, filter_slot(hash, i), -1);
+}
@@ -0,0 +1,376 @@
+/*
+冻结：把可变池转换为紧凑的只读LOUDS前缀树（格式见memkv_common.h的memkv_frozen_t）
+
+可变节点每个都带char_type个int32子节点槽，冻结后每个节点只占约2位LOUDS + 1字节字符 + 1位has_key，
+value按key的BFS顺序紧密排列。冻结后的池可以直接mmap，memkv_get/memkv_keys/memkv_stats按魔数识别；
+写操作返回MEMKV_ERROR_FROZEN。
+
+查询：节点v的子节点块在louds中从第v-1个0之后开始、到第v个0结束，
+块前面的1的个数就是v之前所有节点的度数之和，于是第一个子节点的编号 = 1 + (块起点 - v)，
+只需要select0；has_key的rank给出value的序号。
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define FROZEN_ALIGN 64
+
+static inline const void *frozen_at(const memkv_frozen_t *fz, uint64_t offset)
+{
+    return (const uint8_t *)fz + offset;
+}
+
+static inline uint64_t align_up(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) & ~(a - 1);
+}
+
+// 第j个0（从0开始）在louds中的位置
+static uint64_t frozen_select0(const memkv_frozen_t *fz, uint64_t j)
+{
+    const uint64_t *bits = frozen_at(fz, fz->louds_offset);
+    const uint64_t *samples = frozen_at(fz, fz->select_offset);
+    uint64_t pos = samples[j / FROZEN_SELECT_SAMPLE];
+    uint64_t r = j % FROZEN_SELECT_SAMPLE;
+    if (!r)
+        return pos;
+    pos++;
+    uint64_t w = pos >> 6;
+    uint64_t x = ~bits[w] & (~0ULL << (pos & 63));
+    for (;;)
+    {
+        uint64_t z = (uint64_t)__builtin_popcountll(x);
+        if (r <= z)
+        {
+            while (--r)
+                x &= x - 1;
+            return (w << 6) + (uint64_t)__builtin_ctzll(x);
+        }
+        r -= z;
+        x = ~bits[++w];
+    }
+}
+
+// 节点v的子节点编号区间[*first, *first + 返回值)
+static uint64_t frozen_children(const memkv_frozen_t *fz, uint64_t v, uint64_t *first)
+{
+    uint64_t start = v ? frozen_select0(fz, v - 1) + 1 : 0;
+    uint64_t end = frozen_select0(fz, v);
+    *first = 1 + start - v;
+    return end - start;
+}
+
+// 子节点按字符升序，二分查找；不存在返回0（根不会是任何节点的子节点）
+static uint64_t frozen_child(const memkv_frozen_t *fz, uint64_t v, uint8_t c)
+{
+    const uint8_t *labels = frozen_at(fz, fz->labels_offset);
+    uint64_t first;
+    uint64_t n = frozen_children(fz, v, &first);
+    uint64_t end = first + n;
+    uint64_t lo = first, hi = end;
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (labels[mid] < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < end && labels[lo] == c ? lo : 0;
+}
+
+static inline bool frozen_has_key(const memkv_frozen_t *fz, uint64_t v)
+{
+    const uint64_t *bits = frozen_at(fz, fz->haskey_offset);
+    return bits[v >> 6] >> (v & 63) & 1;
+}
+
+// v之前有key的节点数，即v的value序号
+static uint64_t frozen_rank(const memkv_frozen_t *fz, uint64_t v)
+{
+    const uint64_t *bits = frozen_at(fz, fz->haskey_offset);
+    const uint32_t *ranks = frozen_at(fz, fz->rank_offset);
+    uint64_t r = ranks[v / FROZEN_RANK_BLOCK];
+    for (uint64_t w = v / FROZEN_RANK_BLOCK * (FROZEN_RANK_BLOCK / 64); w < v >> 6; w++)
+        r += (uint64_t)__builtin_popcountll(bits[w]);
+    if (v & 63)
+        r += (uint64_t)__builtin_popcountll(bits[v >> 6] & ((1ULL << (v & 63)) - 1));
+    return r;
+}
+
+static inline value_head_t *frozen_value(const memkv_frozen_t *fz, uint64_t v)
+{
+    const uint64_t *index = frozen_at(fz, fz->values_index_offset);
+    return (value_head_t *)frozen_at(fz, fz->values_offset + index[frozen_rank(fz, v)]);
+}
+
+void *frozen_get(const memkv_frozen_t *fz, const void *key_data, size_t key_len)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < key_len; i++)
+    {
+        uint8_t c = ((const uint8_t *)key_data)[i];
+        if (c >= fz->char_type)
+        {
+            LOG("[ERROR] character index out of range in get: %u (depth %zu)", c, i);
+            return NULL;
+        }
+        v = frozen_child(fz, v, c);
+        if (!v)
+            return NULL;
+    }
+    if (!frozen_has_key(fz, v))
+        return NULL;
+    return value_data(frozen_value(fz, v));
+}
+
+static void frozen_dfs(const memkv_frozen_t *fz, uint64_t v, uint8_t *key_buffer, size_t depth, void (*func)(const void *key_data, size_t key_len))
+{
+    if (frozen_has_key(fz, v))
+        func(key_buffer, depth);
+    const uint8_t *labels = frozen_at(fz, fz->labels_offset);
+    uint64_t first;
+    uint64_t n = frozen_children(fz, v, &first);
+    for (uint64_t i = first; i < first + n; i++)
+    {
+        if (depth + 1 >= KEY_BUFFER_MAX)
+        {
+            LOG("[ERROR] would overflow key buffer at depth %zu, skipping child %u", depth + 1, labels[i]);
+            continue;
+        }
+        key_buffer[depth] = labels[i];
+        frozen_dfs(fz, i, key_buffer, depth + 1, func);
+    }
+}
+
+void frozen_keys(const memkv_frozen_t *fz, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len))
+{
+    uint8_t key_buffer[KEY_BUFFER_MAX];
+    if (prefix_len >= sizeof(key_buffer))
+    {
+        LOG("[ERROR] prefix is too long");
+        return;
+    }
+    uint64_t v = 0;
+    for (size_t i = 0; i < prefix_len; i++)
+    {
+        uint8_t c = ((const uint8_t *)prefix_data)[i];
+        if (c >= fz->char_type)
+        {
+            LOG("[ERROR] character index out of range: %u", c);
+            return;
+        }
+        v = frozen_child(fz, v, c);
+        if (!v)
+            return;
+        key_buffer[i] = c;
+    }
+    frozen_dfs(fz, v, key_buffer, prefix_len, func);
+}
+
+void frozen_stats(const memkv_frozen_t *fz, memkv_stats_t *stats)
+{
+    stats->keys = fz->keys;
+    stats->nodes = fz->nodes;
+    stats->avg_depth = fz->keys ? (double)fz->key_depth_sum / fz->keys : 0.0;
+    stats->value_region_size = fz->values_size;
+    stats->value_boxes = fz->keys;
+    stats->value_alloc_bytes = fz->values_size;
+    const uint64_t *index = frozen_at(fz, fz->values_index_offset);
+    for (uint64_t k = 0; k < fz->keys; k++)
+        stats->value_used_bytes += ((const value_head_t *)frozen_at(fz, fz->values_offset + index[k]))->len;
+    stats->value_internal_frag = stats->value_alloc_bytes ? 1.0 - (double)stats->value_used_bytes / stats->value_alloc_bytes : 0.0;
+}
+
+/*
+第一遍按BFS收集节点（同时记录入边字符和深度），计算各区大小；
+第二遍按BFS顺序写louds、has_key和value。BFS队列本身就是节点编号顺序。
+*/
+typedef struct
+{
+    int32_t *ids;
+    uint8_t *labels;
+    uint16_t *depths;
+    uint64_t n;
+    uint64_t cap;
+} freeze_queue_t;
+
+static bool queue_push(freeze_queue_t *q, int32_t id, uint8_t label, uint16_t depth)
+{
+    if (q->n == q->cap)
+    {
+        uint64_t cap = q->cap ? q->cap * 2 : 1024;
+        int32_t *ids = realloc(q->ids, cap * sizeof(*ids));
+        if (ids)
+            q->ids = ids;
+        uint8_t *labels = realloc(q->labels, cap);
+        if (labels)
+            q->labels = labels;
+        uint16_t *depths = realloc(q->depths, cap * sizeof(*depths));
+        if (depths)
+            q->depths = depths;
+        if (!ids || !labels || !depths)
+            return false;
+        q->cap = cap;
+    }
+    q->ids[q->n] = id;
+    q->labels[q->n] = label;
+    q->depths[q->n] = depth;
+    q->n++;
+    return true;
+}
+
+int memkv_freeze(void *pool_data, void *dst, size_t dst_len, size_t *frozen_len)
+{
+    if (!pool_data || !frozen_len)
+    {
+        LOG("[ERROR] invalid arguments to memkv_freeze");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] pool is already frozen");
+        return MEMKV_ERROR_FROZEN;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    void *key_start = pool_data + meta->key_offset;
+
+    freeze_queue_t q = {0};
+    int r = MEMKV_SUCCESS;
+    uint64_t keys = 0, depth_sum = 0, values_size = 0;
+    if (!queue_push(&q, 0, 0, 0))
+    {
+        r = MEMKV_ERROR_OUTOFMEMORY;
+        goto done;
+    }
+    for (uint64_t i = 0; i < q.n; i++)
+    {
+        key_node_t *node = keynode_at(meta, key_start, q.ids[i]);
+        if (node->has_key)
+        {
+            keys++;
+            depth_sum += q.depths[i];
+            size_t value_len;
+            value_view(meta, node->box, &value_len);
+            values_size += align_up(sizeof(value_head_t) + value_len, 8);
+        }
+        for (size_t c = 0; c < meta->char_type; c++)
+        {
+            int32_t child = node->child_key_blocks[c];
+            if (child < 0)
+                continue;
+            if (q.depths[i] + 1 >= KEY_BUFFER_MAX)
+            {
+                LOG("[ERROR] key deeper than %d, skipping child %zu", KEY_BUFFER_MAX, c);
+                continue;
+            }
+            if (!queue_push(&q, child, (uint8_t)c, q.depths[i] + 1))
+            {
+                r = MEMKV_ERROR_OUTOFMEMORY;
+                goto done;
+            }
+        }
+    }
+
+    uint64_t n = q.n;
+    uint64_t louds_bits = 2 * n - 1;
+    memkv_frozen_t h = {0};
+    h.char_type = meta->char_type;
+    h.version = MEMKV_FORMAT_VERSION;
+    h.nodes = n;
+    h.keys = keys;
+    h.key_depth_sum = depth_sum;
+    uint64_t off = align_up(sizeof(h), FROZEN_ALIGN);
+    h.louds_offset = off;
+    off = align_up(off + (louds_bits + 63) / 64 * 8, FROZEN_ALIGN);
+    h.select_offset = off;
+    off = align_up(off + ((n + FROZEN_SELECT_SAMPLE - 1) / FROZEN_SELECT_SAMPLE) * 8, FROZEN_ALIGN);
+    h.labels_offset = off;
+    off = align_up(off + n, FROZEN_ALIGN);
+    h.haskey_offset = off;
+    off = align_up(off + (n + 63) / 64 * 8, FROZEN_ALIGN);
+    h.rank_offset = off;
+    off = align_up(off + (n + FROZEN_RANK_BLOCK - 1) / FROZEN_RANK_BLOCK * 4, FROZEN_ALIGN);
+    h.values_index_offset = off;
+    off = align_up(off + keys * 8, FROZEN_ALIGN);
+    h.values_offset = off;
+    h.values_size = values_size;
+    h.pool_size = off + values_size;
+
+    *frozen_len = h.pool_size;
+    if (!dst)
+        goto done;
+    if (dst_len < h.pool_size)
+    {
+        LOG("[ERROR] frozen image needs %lu bytes, buffer has %zu", (unsigned long)h.pool_size, dst_len);
+        r = MEMKV_ERROR_OUTOFMEMORY;
+        goto done;
+    }
+
+    memset(dst, 0, h.values_offset);
+    uint8_t *base = dst;
+    uint64_t *louds = (uint64_t *)(base + h.louds_offset);
+    uint64_t *samples = (uint64_t *)(base + h.select_offset);
+    uint8_t *labels = base + h.labels_offset;
+    uint64_t *haskey = (uint64_t *)(base + h.haskey_offset);
+    uint32_t *ranks = (uint32_t *)(base + h.rank_offset);
+    uint64_t *index = (uint64_t *)(base + h.values_index_offset);
+    uint8_t *values = base + h.values_offset;
+
+    uint64_t pos = 0, zeros = 0, k = 0, voff = 0;
+    for (uint64_t v = 0; v < n; v++)
+    {
+        key_node_t *node = keynode_at(meta, key_start, q.ids[v]);
+        labels[v] = q.labels[v];
+        if (v % FROZEN_RANK_BLOCK == 0)
+            ranks[v / FROZEN_RANK_BLOCK] = (uint32_t)k;
+        if (node->has_key)
+        {
+            haskey[v >> 6] |= 1ULL << (v & 63);
+            // 冻结镜像里没有节点标志，压缩的value解压后存放
+            value_head_t *head = (value_head_t *)(values + voff);
+            size_t value_len;
+            void *src = value_view(meta, node->box, &value_len);
+            head->len = (uint32_t)value_len;
+            head->cap = (uint32_t)value_len;
+            if (src)
+                memcpy(value_data(head), src, value_len);
+            else if (!value_decompress(meta, keynode_head(meta, node->box), value_data(head)))
+            {
+                r = MEMKV_ERROR_INVALID_ARG;
+                goto done;
+            }
+            index[k++] = voff;
+            voff += align_up(sizeof(value_head_t) + value_len, 8);
+        }
+        // 子节点在BFS队列中依次排列，louds里写度数个1
+        for (size_t c = 0; c < meta->char_type; c++)
+        {
+            if (node->child_key_blocks[c] >= 0 && q.depths[v] + 1 < KEY_BUFFER_MAX)
+            {
+                louds[pos >> 6] |= 1ULL << (pos & 63);
+                pos++;
+            }
+        }
+        if (zeros % FROZEN_SELECT_SAMPLE == 0)
+            samples[zeros / FROZEN_SELECT_SAMPLE] = pos;
+        zeros++;
+        pos++;
+    }
+    // 魔数最后写：写到一半的镜像不会被识别为冻结池
+    memcpy(dst, &h, sizeof(h));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(dst, MEMKV_FROZEN_MAGIC, sizeof(h.magic));
+    LOG("[INFO] frozen %lu nodes, %lu keys into %lu bytes", (unsigned long)n, (unsigned long)keys, (unsigned long)h.pool_size);
+
+done:
+    free(q.ids);
+    free(q.labels);
+    free(q.depths);
+    return r;
+}
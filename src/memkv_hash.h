@@ -0,0 +1,31 @@
+#ifndef MEMKV_HASH_H
+#define MEMKV_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// key的64位哈希，每次吃8字节，最后做一次混合，足够过滤器和分片使用
+static inline uint64_t memkv_hash(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (len * 0xff51afd7ed558ccdULL);
+    while (len >= 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+        p += 8;
+        len -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, len);
+    h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 29;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 32;
+    return h;
+}
+
+#endif // MEMKV_HASH_H
@@ -0,0 +1,283 @@
+/*
+热点key和热点前缀的采样统计：
+1. 每个线程按[1, 2*rate)内的随机间隔倒数，平均每rate次get/malloc采样一次，不采样的操作只有一次递减；
+2. 采样的key和它长度1..MEMKV_HOT_DEPTHS的各级前缀（即前缀树上经过的节点）用原子加计入同一个count-min sketch，
+   key和前缀的哈希用不同的种子区分，估计值取各行的最小值；
+3. top-K表按估计值更新：已在表中的刷新计数，不在表中且大于表中最小值时替换它。表很小，线性扫描比堆更省事，
+   由一把trylock保护，抢不到锁的采样只计入sketch，写者之间不会互相等待；
+4. 每HOT_DECAY_SAMPLES次采样把sketch和表中的计数减半，热点随负载变化而更替；
+5. 读者不加锁，按seq重试取一份一致的快照，只读映射上也能读取（miaobyte top）。
+*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "memkv_hash.h"
+#include "memkv_hot.h"
+#include "logutil.h"
+
+#define HOT_DECAY_SAMPLES (1u << 14)
+#define HOT_PREFIX_SEED 0x5bd1e9955bd1e995ULL
+#define HOT_LOCK_CHECK 1024 // 抢锁失败这么多次检查一次持有者是否还活着
+#define HOT_SNAPSHOT_TRIES 1000
+
+static __thread uint32_t hot_countdown;
+static __thread uint32_t hot_rng;
+static __thread uint32_t hot_lock_fails;
+
+static inline hot_area_t *hot_area(const memkv_meta_t *meta)
+{
+    return (hot_area_t *)((uint8_t *)meta + meta->hot_offset);
+}
+
+size_t hot_area_size(void)
+{
+    return (sizeof(hot_area_t) + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(size_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+}
+
+void hot_init(memkv_meta_t *meta, uint64_t offset)
+{
+    meta->hot_offset = offset;
+    memset((uint8_t *)meta + offset, 0, hot_area_size());
+}
+
+static inline uint32_t hot_next_rand(void)
+{
+    // xorshift32，种子取线程本地变量的地址
+    if (!hot_rng)
+        hot_rng = (uint32_t)(uintptr_t)&hot_rng | 1;
+    hot_rng ^= hot_rng << 13;
+    hot_rng ^= hot_rng >> 17;
+    hot_rng ^= hot_rng << 5;
+    return hot_rng;
+}
+
+// 计入sketch并返回估计值
+static uint32_t sketch_add(hot_area_t *h, uint64_t hash)
+{
+    uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+    uint32_t est = UINT32_MAX;
+    for (uint32_t r = 0; r < HOT_SKETCH_ROWS; r++)
+    {
+        uint32_t v = __atomic_add_fetch(&h->sketch[r][(h1 + r * h2) % HOT_SKETCH_COLS], 1, __ATOMIC_RELAXED);
+        if (v < est)
+            est = v;
+    }
+    return est;
+}
+
+static void topk_update(hot_slot_t *slots, int n, uint64_t hash, const void *key_data, size_t len, uint64_t est)
+{
+    size_t keep = len < MEMKV_HOT_KEY_MAX ? len : MEMKV_HOT_KEY_MAX;
+    hot_slot_t *min = &slots[0];
+    for (int i = 0; i < n; i++)
+    {
+        hot_slot_t *s = &slots[i];
+        if (s->count && s->hash == hash && s->len == len && memcmp(s->key, key_data, keep) == 0)
+        {
+            if (est > s->count)
+                s->count = est;
+            return;
+        }
+        if (s->count < min->count)
+            min = s;
+    }
+    if (est <= min->count)
+        return;
+    min->count = est;
+    min->hash = hash;
+    min->len = (uint32_t)len;
+    memcpy(min->key, key_data, keep);
+}
+
+static void hot_decay(hot_area_t *h)
+{
+    for (int r = 0; r < HOT_SKETCH_ROWS; r++)
+        for (int c = 0; c < HOT_SKETCH_COLS; c++)
+            __atomic_store_n(&h->sketch[r][c], __atomic_load_n(&h->sketch[r][c], __ATOMIC_RELAXED) / 2, __ATOMIC_RELAXED);
+    for (int i = 0; i < MEMKV_HOT_TOPK; i++)
+        h->keys[i].count /= 2;
+    for (int d = 0; d < MEMKV_HOT_DEPTHS; d++)
+        for (int i = 0; i < MEMKV_HOT_PREFIX_TOPK; i++)
+            h->prefixes[d][i].count /= 2;
+}
+
+// top-K表的锁，锁字为持有者pid；wait=false时抢不到立即返回，持有者进程已退出时接管
+static bool hot_lock(hot_area_t *h, bool wait)
+{
+    uint32_t me = magazine_self_pid();
+    for (;;)
+    {
+        uint32_t cur = 0;
+        if (__atomic_compare_exchange_n(&h->lock, &cur, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+        if (++hot_lock_fails % HOT_LOCK_CHECK == 0 && kill((pid_t)cur, 0) != 0 && errno == ESRCH &&
+            __atomic_compare_exchange_n(&h->lock, &cur, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            LOG("[WARN] hot sampler lock holder %u is gone, lock taken over", cur);
+            break;
+        }
+        if (!wait)
+            return false;
+        sched_yield();
+    }
+    // 上一个持有者可能死在更新中途，先把seq恢复成偶数
+    uint32_t seq = __atomic_load_n(&h->seq, __ATOMIC_RELAXED);
+    if (seq & 1)
+        __atomic_store_n(&h->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->seq, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return true;
+}
+
+static void hot_unlock(hot_area_t *h)
+{
+    __atomic_fetch_add(&h->seq, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&h->lock, 0, __ATOMIC_RELEASE);
+}
+
+void hot_tick(memkv_meta_t *meta, uint32_t rate, const void *key_data, size_t key_len, bool write)
+{
+    if (hot_countdown > 1)
+    {
+        hot_countdown--;
+        return;
+    }
+    hot_countdown = rate > 1 ? 1 + hot_next_rand() % (2 * rate - 1) : 1;
+
+    hot_area_t *h = hot_area(meta);
+    uint64_t n = __atomic_add_fetch(&h->samples, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(write ? &h->writes : &h->reads, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->depth_samples[key_len < MEMKV_HOT_DEPTHS ? key_len : MEMKV_HOT_DEPTHS], 1, __ATOMIC_RELAXED);
+
+    // sketch不加锁，先算好各级前缀的估计值
+    uint64_t key_hash = memkv_hash(key_data, key_len);
+    uint32_t key_est = sketch_add(h, key_hash);
+    int depths = key_len < MEMKV_HOT_DEPTHS ? (int)key_len : MEMKV_HOT_DEPTHS;
+    uint64_t prefix_hash[MEMKV_HOT_DEPTHS];
+    uint32_t prefix_est[MEMKV_HOT_DEPTHS];
+    for (int d = 0; d < depths; d++)
+    {
+        prefix_hash[d] = memkv_hash(key_data, (size_t)d + 1) ^ HOT_PREFIX_SEED;
+        prefix_est[d] = sketch_add(h, prefix_hash[d]);
+    }
+
+    if (!hot_lock(h, false))
+        return;
+    topk_update(h->keys, MEMKV_HOT_TOPK, key_hash, key_data, key_len, key_est);
+    for (int d = 0; d < depths; d++)
+        topk_update(h->prefixes[d], MEMKV_HOT_PREFIX_TOPK, prefix_hash[d], key_data, (size_t)d + 1, prefix_est[d]);
+    if (n - h->decayed_at >= HOT_DECAY_SAMPLES)
+    {
+        hot_decay(h);
+        h->decayed_at = n;
+    }
+    hot_unlock(h);
+}
+
+int memkv_hot_enable(void *pool_data, uint32_t sample_rate)
+{
+    if (!pool_data)
+        return MEMKV_ERROR_POOL_NULL;
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    __atomic_store_n(&hot_area(pool_data)->rate, sample_rate, __ATOMIC_RELAXED);
+    return MEMKV_SUCCESS;
+}
+
+int memkv_hot_reset(void *pool_data)
+{
+    if (!pool_data)
+        return MEMKV_ERROR_POOL_NULL;
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    hot_area_t *h = hot_area(pool_data);
+    hot_lock(h, true);
+    memset(h->keys, 0, sizeof(h->keys));
+    memset(h->prefixes, 0, sizeof(h->prefixes));
+    for (int r = 0; r < HOT_SKETCH_ROWS; r++)
+        for (int c = 0; c < HOT_SKETCH_COLS; c++)
+            __atomic_store_n(&h->sketch[r][c], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->samples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->reads, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->writes, 0, __ATOMIC_RELAXED);
+    for (int d = 0; d <= MEMKV_HOT_DEPTHS; d++)
+        __atomic_store_n(&h->depth_samples[d], 0, __ATOMIC_RELAXED);
+    h->decayed_at = 0;
+    hot_unlock(h);
+    return MEMKV_SUCCESS;
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+    uint64_t x = ((const memkv_hot_entry_t *)a)->count, y = ((const memkv_hot_entry_t *)b)->count;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// 非空的表项拷到out并按count降序排列，返回个数
+static uint32_t slots_export(const hot_slot_t *slots, int n, memkv_hot_entry_t *out)
+{
+    uint32_t m = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!slots[i].count)
+            continue;
+        out[m].count = slots[i].count;
+        out[m].len = slots[i].len;
+        memcpy(out[m].key, slots[i].key, MEMKV_HOT_KEY_MAX);
+        m++;
+    }
+    if (m > 1)
+        qsort(out, m, sizeof(*out), entry_cmp);
+    return m;
+}
+
+int memkv_hot_snapshot(const void *pool_data, memkv_hot_t *out)
+{
+    if (!pool_data || !out)
+    {
+        LOG("[ERROR] invalid arguments to memkv_hot_snapshot");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    const hot_area_t *h = hot_area(pool_data);
+    hot_slot_t keys[MEMKV_HOT_TOPK];
+    hot_slot_t prefixes[MEMKV_HOT_DEPTHS][MEMKV_HOT_PREFIX_TOPK];
+    int tries = 0;
+    for (;; tries++)
+    {
+        if (tries == HOT_SNAPSHOT_TRIES)
+            return MEMKV_ERROR_TIMEOUT;
+        uint32_t seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+        {
+            sched_yield();
+            continue;
+        }
+        memcpy(keys, h->keys, sizeof(keys));
+        memcpy(prefixes, h->prefixes, sizeof(prefixes));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) == seq)
+            break;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->sample_rate = __atomic_load_n(&h->rate, __ATOMIC_RELAXED);
+    out->samples = __atomic_load_n(&h->samples, __ATOMIC_RELAXED);
+    out->reads = __atomic_load_n(&h->reads, __ATOMIC_RELAXED);
+    out->writes = __atomic_load_n(&h->writes, __ATOMIC_RELAXED);
+    for (int d = 0; d <= MEMKV_HOT_DEPTHS; d++)
+        out->depth_samples[d] = __atomic_load_n(&h->depth_samples[d], __ATOMIC_RELAXED);
+    out->nkeys = slots_export(keys, MEMKV_HOT_TOPK, out->keys);
+    for (int d = 0; d < MEMKV_HOT_DEPTHS; d++)
+        out->nprefixes[d] = slots_export(prefixes[d], MEMKV_HOT_PREFIX_TOPK, out->prefixes[d]);
+    return MEMKV_SUCCESS;
+}
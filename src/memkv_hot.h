@@ -0,0 +1,50 @@
+#ifndef MEMKV_HOT_H
+#define MEMKV_HOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+
+/*
+热点采样区，紧跟在埋点统计区之后，见 memkv_hot.c。
+rate独占一条cache line，未开启时热路径只读这一个字段；开启后每个线程按随机间隔倒数，平均每rate次操作采样一次。
+*/
+#define HOT_SKETCH_ROWS 4
+#define HOT_SKETCH_COLS 1024
+
+typedef struct {
+    uint64_t count;
+    uint64_t hash;
+    uint32_t len;
+    uint8_t key[MEMKV_HOT_KEY_MAX];
+} hot_slot_t;
+
+typedef struct {
+    uint32_t rate;       // 采样间隔，0为关闭
+    uint8_t pad0[60];
+    uint32_t lock;       // top-K表的锁，持有者pid；采样时抢不到就只计入sketch
+    uint32_t seq;        // top-K表的写序列号，奇数表示正在更新，快照按它重试
+    uint64_t samples;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t decayed_at; // 上次衰减时的samples
+    uint64_t depth_samples[MEMKV_HOT_DEPTHS + 1];
+    hot_slot_t keys[MEMKV_HOT_TOPK];
+    hot_slot_t prefixes[MEMKV_HOT_DEPTHS][MEMKV_HOT_PREFIX_TOPK];
+    uint32_t sketch[HOT_SKETCH_ROWS][HOT_SKETCH_COLS];
+} hot_area_t;
+
+size_t hot_area_size(void);
+void hot_init(memkv_meta_t *meta, uint64_t offset);
+void hot_tick(memkv_meta_t *meta, uint32_t rate, const void *key_data, size_t key_len, bool write);
+
+static inline void hot_sample(memkv_meta_t *meta, const void *key_data, size_t key_len, bool write)
+{
+    uint32_t rate = __atomic_load_n(&((hot_area_t *)((uint8_t *)meta + meta->hot_offset))->rate, __ATOMIC_RELAXED);
+    if (__builtin_expect(rate != 0, 0))
+        hot_tick(meta, rate, key_data, key_len, write);
+}
+
+#endif // MEMKV_HOT_H
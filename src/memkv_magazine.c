@@ -0,0 +1,561 @@
+/*
+分配缓存(magazine)：挡在blockmalloc/boxmalloc前面的per-writer缓存
+
+key页和value box的全局分配器都在池内的一份结构上，多个writer同时写入时它们是串行点。
+每个writer线程在池内占用一个writer槽位，槽位里缓存若干空闲key页和常用大小的box：
+  1) 分配时先从自己的槽位取，空了才拿全局锁批量补充一半；
+  2) 释放时先放回自己的槽位，满了才拿全局锁批量归还一半；
+  3) 槽位和缓存内容都在共享内存里，writer线程/进程崩溃后，其他writer发现其tid已不存在时，
+     把槽位中缓存的页和box还给全局分配器，不会泄漏。
+box按slab级别缓存，MAG_CLASSES个级别覆盖16~SLAB_MAX字节（含value头部），全局一侧由slab分配器切块，
+更大的box直接走boxmalloc。
+
+多个writer并发写入前缀树：
+  1) 新节点建好后用CAS把父节点的子指针从-1换成它，输了的一方释放自己的节点，沿赢家的节点继续；
+     页内槽位位图、统计计数和过滤器计数器都用原子操作修改；
+  2) 同一个key的value替换、删除、数值操作在该key的key锁下进行，key锁按节点地址分成KEY_LOCK_STRIPES条；
+  3) 只会往树上加节点的写以共享方式进入写入闸门：在自己的槽位上置active，再确认没有独占者；
+     会回收节点或一次改很多key的操作（cache模式的淘汰、写批次、冷value下沉、一致性检查）独占闸门，
+     拿到trie_lock后等所有槽位的active清零。cache模式下分配失败随时可能淘汰，这时writer直接独占闸门；
+  4) 闸门和key锁的锁字都是持有者pid，持有者退出后由下一个等待者接管；已退出writer槽位上的active不再等待。
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define MAG_TLS_POOLS 4 // 每个线程同时缓存槽位的池数量
+#define LOCK_SPIN_YIELD 1024
+#define LOCK_SPIN_CHECK (1 << 16)
+#define LARGEST_FREE_PERIOD 256 // 全局分配器每变化这么多次，重新探测一次最大可分配box
+
+static __thread struct
+{
+    memkv_meta_t *meta;
+    int slot;
+} tls_slots[MAG_TLS_POOLS];
+
+// tid和pid缓存在线程局部变量里，每次分配释放不再各做一次系统调用；fork出的子进程里清掉重取
+static __thread uint32_t tls_tid, tls_pid;
+static pthread_once_t tls_atfork_once = PTHREAD_ONCE_INIT;
+
+static void tls_ids_reset(void)
+{
+    tls_tid = 0;
+    tls_pid = 0;
+}
+
+static void tls_atfork_register(void)
+{
+    pthread_atfork(NULL, NULL, tls_ids_reset);
+}
+
+static void tls_ids_load(void)
+{
+    pthread_once(&tls_atfork_once, tls_atfork_register);
+    tls_tid = (uint32_t)syscall(SYS_gettid);
+    tls_pid = (uint32_t)getpid();
+}
+
+static inline uint32_t self_tid(void)
+{
+    if (__builtin_expect(!tls_tid, 0))
+        tls_ids_load();
+    return tls_tid;
+}
+
+static inline uint32_t self_pid(void)
+{
+    if (__builtin_expect(!tls_pid, 0))
+        tls_ids_load();
+    return tls_pid;
+}
+
+uint32_t magazine_self_pid(void)
+{
+    return self_pid();
+}
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline writer_slot_t *slot_at(memkv_meta_t *meta, int i)
+{
+    return (writer_slot_t *)((void *)meta + meta->writers_offset) + i;
+}
+
+// 探测当前能分配的最大box（2的幂下界），做 O(log n) 次分配和释放，结果记在统计里；调用方持有全局锁
+static void probe_largest_free(memkv_meta_t *meta)
+{
+    void *valueptr_start = (void *)meta + meta->valueptr_offset;
+    uint64_t free_bytes = meta->stats.value_region_size - meta->stats.value_alloc_bytes;
+    uint64_t size = 1;
+    while (size <= free_bytes / 2)
+        size <<= 1;
+    for (; size >= VALUE_ALIGN; size >>= 1)
+    {
+        uint64_t offset = box_alloc(valueptr_start, size);
+        if (offset != (uint64_t)-1)
+        {
+            box_free(valueptr_start, offset);
+            break;
+        }
+    }
+    meta->stats.value_largest_free = size >= VALUE_ALIGN ? size : 0;
+    meta->stats.largest_free_age = 0;
+}
+
+// 全局分配器每变化LARGEST_FREE_PERIOD次重新探测一次，memkv_stats只读结果，不加锁也不写池
+static inline void largest_free_tick(memkv_meta_t *meta)
+{
+    if (++meta->stats.largest_free_age >= LARGEST_FREE_PERIOD)
+        probe_largest_free(meta);
+}
+
+void magazine_probe_largest(memkv_meta_t *meta)
+{
+    magazine_lock(meta);
+    probe_largest_free(meta);
+    magazine_unlock(meta);
+}
+
+// 小box先从slab分配，slab申请不到时直接找boxmalloc；调用方持有全局锁
+static uint64_t global_box_alloc(memkv_meta_t *meta, int c, size_t size)
+{
+    uint64_t offset = c >= 0 ? slab_alloc(meta, c) : (uint64_t)-1;
+    if (offset == (uint64_t)-1)
+        offset = box_alloc((void *)meta + meta->valueptr_offset, size);
+    largest_free_tick(meta);
+    return offset;
+}
+
+static void global_box_free(memkv_meta_t *meta, uint64_t offset)
+{
+    if (!slab_free(meta, offset))
+        box_free((void *)meta + meta->valueptr_offset, offset);
+    largest_free_tick(meta);
+}
+
+// key锁跟在writer槽位之后，每条一个cache line
+typedef struct{
+    uint32_t holder;
+}  __attribute__((aligned(64))) key_lock_t;
+
+size_t magazine_area_size(void)
+{
+    return sizeof(writer_slot_t) * MEMKV_WRITER_SLOTS + sizeof(key_lock_t) * KEY_LOCK_STRIPES;
+}
+
+void magazine_init(memkv_meta_t *meta, uint64_t offset)
+{
+    meta->alloc_lock = 0;
+    meta->trie_lock = 0;
+    meta->batch_lock = 0;
+    meta->writers_offset = offset;
+    memset((void *)meta + offset, 0, magazine_area_size());
+}
+
+// 池内的跨进程锁，锁字为持有者pid；持有者进程已退出时接管
+void pool_lock(uint32_t *word, const char *name)
+{
+    (void)name; // 只在日志里用
+    uint32_t me = self_pid();
+    for (uint32_t spins = 1;; spins++)
+    {
+        uint32_t cur = 0;
+        if (__atomic_compare_exchange_n(word, &cur, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+        if (spins % LOCK_SPIN_CHECK == 0 && kill((pid_t)cur, 0) != 0 && errno == ESRCH &&
+            __atomic_compare_exchange_n(word, &cur, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            LOG("[WARN] %s lock holder %u is gone, lock taken over", name, cur);
+            return;
+        }
+        if (spins % LOCK_SPIN_YIELD == 0)
+            sched_yield();
+        else
+            cpu_relax();
+    }
+}
+
+void pool_unlock(uint32_t *word)
+{
+    __atomic_store_n(word, 0, __ATOMIC_RELEASE);
+}
+
+// 全局分配器锁
+void magazine_lock(memkv_meta_t *meta)
+{
+    pool_lock(&meta->alloc_lock, "allocator");
+}
+
+void magazine_unlock(memkv_meta_t *meta)
+{
+    pool_unlock(&meta->alloc_lock);
+}
+
+// 把槽位中的缓存全部还给全局分配器，调用方持有全局锁
+static void slot_drain(memkv_meta_t *meta, writer_slot_t *slot)
+{
+    void *key_start = (void *)meta + meta->key_offset;
+    while (slot->npages)
+    {
+        slot->npages--;
+        blocks_free(&meta->keys_blocks, key_start, slot->pages[slot->npages]);
+    }
+    for (int c = 0; c < MAG_CLASSES; c++)
+    {
+        while (slot->nboxes[c])
+        {
+            slot->nboxes[c]--;
+            global_box_free(meta, slot->boxes[c][slot->nboxes[c]]);
+        }
+    }
+}
+
+static bool slot_owner_dead(const writer_slot_t *slot, uint32_t owner)
+{
+    uint32_t pid = __atomic_load_n(&slot->pid, __ATOMIC_ACQUIRE);
+    return pid && syscall(SYS_tgkill, (pid_t)pid, (pid_t)owner, 0) != 0 && errno == ESRCH;
+}
+
+int magazine_reclaim(memkv_meta_t *meta)
+{
+    uint32_t me = self_tid();
+    int reclaimed = 0;
+    for (int i = 0; i < MEMKV_WRITER_SLOTS; i++)
+    {
+        writer_slot_t *slot = slot_at(meta, i);
+        uint32_t owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+        if (!owner || owner == me || !slot_owner_dead(slot, owner))
+            continue;
+        // 先抢到槽位再回收，避免两个writer重复归还同一批缓存
+        if (!__atomic_compare_exchange_n(&slot->owner, &owner, me, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            continue;
+        magazine_lock(meta);
+        slot_drain(meta, slot);
+        magazine_unlock(meta);
+        __atomic_store_n(&slot->active, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->pid, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->owner, 0, __ATOMIC_RELEASE);
+        reclaimed++;
+        LOG("[INFO] reclaimed allocation cache of exited writer %u", owner);
+    }
+    return reclaimed;
+}
+
+static writer_slot_t *slot_try_acquire(memkv_meta_t *meta, uint32_t me, int *index)
+{
+    for (int i = 0; i < MEMKV_WRITER_SLOTS; i++)
+    {
+        writer_slot_t *slot = slot_at(meta, i);
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&slot->owner, &expected, me, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&slot->pid, self_pid(), __ATOMIC_RELEASE);
+            *index = i;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+// 当前线程在该池上的槽位；槽位用完时返回NULL，调用方直接走全局分配器
+static writer_slot_t *slot_self(memkv_meta_t *meta)
+{
+    uint32_t me = self_tid();
+    uint32_t pid = self_pid();
+    int free_tls = -1;
+    for (int i = 0; i < MAG_TLS_POOLS; i++)
+    {
+        if (tls_slots[i].meta == meta)
+        {
+            writer_slot_t *slot = slot_at(meta, tls_slots[i].slot);
+            // fork出的子进程或重新映射的池：槽位已不属于自己
+            if (slot->owner == me && slot->pid == pid)
+                return slot;
+            tls_slots[i].meta = NULL;
+        }
+        if (!tls_slots[i].meta && free_tls < 0)
+            free_tls = i;
+    }
+    if (free_tls < 0)
+        return NULL;
+
+    int index;
+    writer_slot_t *slot = slot_try_acquire(meta, me, &index);
+    if (!slot && magazine_reclaim(meta))
+        slot = slot_try_acquire(meta, me, &index);
+    if (!slot)
+        return NULL;
+    tls_slots[free_tls].meta = meta;
+    tls_slots[free_tls].slot = index;
+    return slot;
+}
+
+// 全局分配失败时，先把自己的缓存和已退出writer的缓存还回去，再试一次
+static void magazine_release_cached(memkv_meta_t *meta, writer_slot_t *slot)
+{
+    if (slot)
+    {
+        magazine_lock(meta);
+        slot_drain(meta, slot);
+        magazine_unlock(meta);
+    }
+    magazine_reclaim(meta);
+}
+
+int64_t magazine_page_alloc(memkv_meta_t *meta)
+{
+    void *key_start = (void *)meta + meta->key_offset;
+    writer_slot_t *slot = slot_self(meta);
+    if (slot && slot->npages)
+        return slot->pages[--slot->npages];
+
+    int64_t page_id;
+    magazine_lock(meta);
+    page_id = blocks_alloc(&meta->keys_blocks, key_start);
+    // 批量补充一半，后续分配不再拿锁
+    while (slot && page_id >= 0 && slot->npages < MAG_PAGES / 2)
+    {
+        int64_t extra = blocks_alloc(&meta->keys_blocks, key_start);
+        if (extra < 0)
+            break;
+        slot->pages[slot->npages] = extra;
+        slot->npages++;
+    }
+    magazine_unlock(meta);
+    if (page_id < 0)
+    {
+        magazine_release_cached(meta, slot);
+        magazine_lock(meta);
+        page_id = blocks_alloc(&meta->keys_blocks, key_start);
+        magazine_unlock(meta);
+    }
+    return page_id;
+}
+
+void magazine_page_free(memkv_meta_t *meta, int64_t page_id)
+{
+    void *key_start = (void *)meta + meta->key_offset;
+    writer_slot_t *slot = slot_self(meta);
+    if (slot && slot->npages < MAG_PAGES)
+    {
+        slot->pages[slot->npages] = page_id;
+        slot->npages++;
+        return;
+    }
+    magazine_lock(meta);
+    while (slot && slot->npages > MAG_PAGES / 2)
+    {
+        slot->npages--;
+        blocks_free(&meta->keys_blocks, key_start, slot->pages[slot->npages]);
+    }
+    blocks_free(&meta->keys_blocks, key_start, page_id);
+    magazine_unlock(meta);
+}
+
+uint64_t magazine_box_alloc(memkv_meta_t *meta, size_t *size)
+{
+    int c = slab_class(*size);
+    writer_slot_t *slot = c >= 0 ? slot_self(meta) : NULL;
+    if (c >= 0)
+        *size = slab_class_size(c);
+    if (slot && slot->nboxes[c])
+        return slot->boxes[c][--slot->nboxes[c]];
+
+    magazine_lock(meta);
+    uint64_t offset = global_box_alloc(meta, c, *size);
+    while (slot && offset != (uint64_t)-1 && slot->nboxes[c] < MAG_BOXES / 2)
+    {
+        uint64_t extra = global_box_alloc(meta, c, *size);
+        if (extra == (uint64_t)-1)
+            break;
+        slot->boxes[c][slot->nboxes[c]] = extra;
+        slot->nboxes[c]++;
+    }
+    magazine_unlock(meta);
+    if (offset == (uint64_t)-1)
+    {
+        magazine_release_cached(meta, slot);
+        magazine_lock(meta);
+        offset = global_box_alloc(meta, c, *size);
+        magazine_unlock(meta);
+    }
+    return offset;
+}
+
+void magazine_box_free(memkv_meta_t *meta, uint64_t offset, size_t size)
+{
+    int c = slab_class(size);
+    // 只缓存恰好是某个级别大小的box
+    if (c >= 0 && size != slab_class_size(c))
+        c = -1;
+    writer_slot_t *slot = c >= 0 ? slot_self(meta) : NULL;
+    if (slot && slot->nboxes[c] < MAG_BOXES)
+    {
+        slot->boxes[c][slot->nboxes[c]] = offset;
+        slot->nboxes[c]++;
+        return;
+    }
+    magazine_lock(meta);
+    while (slot && slot->nboxes[c] > MAG_BOXES / 2)
+    {
+        slot->nboxes[c]--;
+        global_box_free(meta, slot->boxes[c][slot->nboxes[c]]);
+    }
+    global_box_free(meta, offset);
+    magazine_unlock(meta);
+}
+
+void memkv_writer_detach(void *pool_data)
+{
+    if (!pool_data)
+        return;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    uint32_t me = self_tid();
+    for (int i = 0; i < MAG_TLS_POOLS; i++)
+    {
+        if (tls_slots[i].meta != meta)
+            continue;
+        writer_slot_t *slot = slot_at(meta, tls_slots[i].slot);
+        tls_slots[i].meta = NULL;
+        if (slot->owner != me)
+            continue;
+        magazine_lock(meta);
+        slot_drain(meta, slot);
+        magazine_unlock(meta);
+        __atomic_store_n(&slot->pid, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// 当前线程进入了闸门的池，嵌套调用（memkv_set里再调memkv_set_compressed等）只计深度
+static __thread struct
+{
+    memkv_meta_t *meta;
+    uint32_t depth;
+    writer_slot_t *slot; // 共享方式时为自己的槽位，独占时为NULL
+} tls_gates[MAG_TLS_POOLS];
+
+static int gate_find(const memkv_meta_t *meta)
+{
+    for (int i = 0; i < MAG_TLS_POOLS; i++)
+    {
+        if (tls_gates[i].depth && tls_gates[i].meta == meta)
+            return i;
+    }
+    return -1;
+}
+
+// 拿到trie_lock后等共享writer全部离开；已退出的writer留下的active不算
+static void gate_drain(memkv_meta_t *meta)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < MEMKV_WRITER_SLOTS; i++)
+    {
+        writer_slot_t *slot = slot_at(meta, i);
+        for (uint32_t spins = 1; __atomic_load_n(&slot->active, __ATOMIC_SEQ_CST); spins++)
+        {
+            uint32_t owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+            if (spins % LOCK_SPIN_CHECK == 0 && owner && slot_owner_dead(slot, owner))
+            {
+                LOG("[WARN] writer %u exited inside the trie gate, not waiting for it", owner);
+                break;
+            }
+            if (spins % LOCK_SPIN_YIELD == 0)
+                sched_yield();
+            else
+                cpu_relax();
+        }
+    }
+}
+
+void trie_enter(memkv_meta_t *meta, bool exclusive)
+{
+    int g = gate_find(meta);
+    if (g >= 0)
+    {
+        tls_gates[g].depth++;
+        return;
+    }
+    for (g = 0; g < MAG_TLS_POOLS && tls_gates[g].depth; g++)
+        ;
+    writer_slot_t *slot = exclusive || g == MAG_TLS_POOLS ? NULL : slot_self(meta);
+    while (slot)
+    {
+        // Dekker式握手：先亮出自己再看独占者，独占者先拿锁再看各槽位，双方至少有一方看到对方
+        __atomic_store_n(&slot->active, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&meta->trie_lock, __ATOMIC_SEQ_CST))
+            break;
+        __atomic_store_n(&slot->active, 0, __ATOMIC_RELEASE);
+        // 等独占者结束；它已退出时由这里接管再放开
+        pool_lock(&meta->trie_lock, "trie");
+        pool_unlock(&meta->trie_lock);
+    }
+    if (!slot)
+    {
+        pool_lock(&meta->trie_lock, "trie");
+        gate_drain(meta);
+    }
+    if (g == MAG_TLS_POOLS)
+    {
+        LOG("[WARN] too many pools in the trie gate on one thread, nested calls are not tracked");
+        return;
+    }
+    tls_gates[g].meta = meta;
+    tls_gates[g].depth = 1;
+    tls_gates[g].slot = slot;
+}
+
+void trie_leave(memkv_meta_t *meta)
+{
+    int g = gate_find(meta);
+    if (g < 0)
+    {
+        pool_unlock(&meta->trie_lock);
+        return;
+    }
+    if (--tls_gates[g].depth)
+        return;
+    if (tls_gates[g].slot)
+        __atomic_store_n(&tls_gates[g].slot->active, 0, __ATOMIC_RELEASE);
+    else
+        pool_unlock(&meta->trie_lock);
+}
+
+bool trie_exclusive(const memkv_meta_t *meta)
+{
+    int g = gate_find(meta);
+    return g >= 0 && !tls_gates[g].slot;
+}
+
+static inline uint32_t *key_lock_word(memkv_meta_t *meta, const key_node_t *node)
+{
+    key_lock_t *locks = (key_lock_t *)((void *)meta + meta->writers_offset + sizeof(writer_slot_t) * MEMKV_WRITER_SLOTS);
+    uint64_t x = (uint64_t)((uintptr_t)node - (uintptr_t)meta) / KEYNODE_ALIGN * UINT64_C(0x9e3779b97f4a7c15);
+    return &locks[(x >> 32) % KEY_LOCK_STRIPES].holder;
+}
+
+void key_lock(memkv_meta_t *meta, const key_node_t *node)
+{
+    pool_lock(key_lock_word(meta, node), "key");
+}
+
+void key_unlock(memkv_meta_t *meta, const key_node_t *node)
+{
+    pool_unlock(key_lock_word(meta, node));
+}
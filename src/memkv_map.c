@@ -0,0 +1,355 @@
+/*
+池文件映射：基址按大页对齐，可选大页与预取
+
+32GB级别的池用4KB页时，前缀树上的随机跳转会频繁TLB miss；
+启动后首次访问每一页又会触发缺页。这里提供：
+  1) 文件位于hugetlbfs时直接得到大页映射，否则对映射做MADV_HUGEPAGE（透明大页）
+  2) 映射基址按大页对齐，配合memkv_options_t.region_align让各区不跨大页起始
+  3) 预取：单线程时用MAP_POPULATE或MADV_POPULATE_WRITE，多线程时按区间并行触碰每一页
+memkv_open在此之上校验池头部（魔数、格式版本、大小），可以PROT_READ只读映射，
+并把区域基址缓存在memkv_t里
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+#include "memkv/memkv.h"
+#include "memkv_common.h"
+#include "memkv_probe.h"
+#include "logutil.h"
+
+#ifndef HUGETLBFS_MAGIC
+#define HUGETLBFS_MAGIC 0x958458f6
+#endif
+
+#define PREFAULT_MAX_THREADS 64
+
+typedef struct
+{
+    uint8_t *start;
+    size_t len;
+    size_t step;
+} prefault_job_t;
+
+static size_t page_size(void)
+{
+    long ps = sysconf(_SC_PAGESIZE);
+    return ps > 0 ? (size_t)ps : 4096;
+}
+
+/* 文件在hugetlbfs上时返回其大页大小，否则返回0 */
+static size_t hugetlb_page_size(int fd)
+{
+    struct statfs sfs;
+    if (fd < 0 || fstatfs(fd, &sfs) != 0)
+        return 0;
+    return (unsigned long)sfs.f_type == HUGETLBFS_MAGIC ? (size_t)sfs.f_bsize : 0;
+}
+
+/* 先预留len+align的地址空间，在对齐处MAP_FIXED映射，再释放两端多余部分 */
+static void *map_aligned(size_t len, size_t align, int prot, int flags, int fd)
+{
+    if (align <= page_size())
+        return mmap(NULL, len, prot, flags, fd, 0);
+
+    size_t span = len + align;
+    void *raw = mmap(NULL, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED)
+        return MAP_FAILED;
+    uintptr_t start = ((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1);
+    void *p = mmap((void *)start, len, prot, flags | MAP_FIXED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        munmap(raw, span);
+        return MAP_FAILED;
+    }
+    if (start > (uintptr_t)raw)
+        munmap(raw, start - (uintptr_t)raw);
+    uintptr_t end = (start + len + page_size() - 1) & ~(uintptr_t)(page_size() - 1);
+    uintptr_t raw_end = (uintptr_t)raw + span;
+    if (raw_end > end)
+        munmap((void *)end, raw_end - end);
+    return p;
+}
+
+static void *prefault_worker(void *arg)
+{
+    prefault_job_t *job = arg;
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(job->start, job->len, MADV_POPULATE_WRITE) == 0)
+        return NULL;
+#endif
+    // 内核不支持MADV_POPULATE_WRITE时，逐页原子加0：触发写缺页但不改变内容，其他进程并发写也安全
+    for (size_t off = 0; off < job->len; off += job->step)
+        __atomic_fetch_add(job->start + off, 0, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+/* 把[pool, pool+len)按step对齐切成threads段并行预取 */
+static void prefault(void *pool, size_t len, size_t step, unsigned threads)
+{
+    if (threads > PREFAULT_MAX_THREADS)
+        threads = PREFAULT_MAX_THREADS;
+    size_t pages = (len + step - 1) / step;
+    if (threads > pages)
+        threads = pages ? (unsigned)pages : 1;
+    size_t chunk = (pages + threads - 1) / threads * step;
+
+    prefault_job_t jobs[PREFAULT_MAX_THREADS];
+    pthread_t tids[PREFAULT_MAX_THREADS];
+    unsigned started = 0;
+    for (unsigned i = 0; i < threads; i++)
+    {
+        size_t off = (size_t)i * chunk;
+        if (off >= len)
+            break;
+        jobs[i].start = (uint8_t *)pool + off;
+        jobs[i].len = len - off < chunk ? len - off : chunk;
+        jobs[i].step = step;
+        if (i == 0 || pthread_create(&tids[i], NULL, prefault_worker, &jobs[i]) != 0)
+        {
+            if (i != 0)
+            {
+                LOG("[WARN] prefault thread %u failed to start, running inline", i);
+            }
+            prefault_worker(&jobs[i]);
+            tids[i] = 0;
+        }
+        started = i + 1;
+    }
+    for (unsigned i = 1; i < started; i++)
+    {
+        if (tids[i])
+            pthread_join(tids[i], NULL);
+    }
+}
+
+void *memkv_map(const char *path, const memkv_map_options_t *opts, size_t *pool_len)
+{
+    memkv_map_options_t defaults = {0};
+    if (!opts)
+        opts = &defaults;
+    if (!pool_len)
+    {
+        LOG("[ERROR] pool_len is NULL");
+        return NULL;
+    }
+
+    int fd = -1;
+    size_t len = opts->size;
+    int flags = MAP_SHARED;
+    if (path)
+    {
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            LOG("[ERROR] open %s failed: %s", path, strerror(errno));
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            LOG("[ERROR] fstat %s failed: %s", path, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        if (len > (size_t)st.st_size)
+        {
+            if (ftruncate(fd, (off_t)len) != 0)
+            {
+                LOG("[ERROR] ftruncate %s to %zu failed: %s", path, len, strerror(errno));
+                close(fd);
+                return NULL;
+            }
+        }
+        else if (len == 0)
+        {
+            len = (size_t)st.st_size;
+        }
+    }
+    else
+    {
+        flags |= MAP_ANONYMOUS;
+    }
+    if (len == 0)
+    {
+        LOG("[ERROR] pool size is 0");
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    size_t hugetlb = hugetlb_page_size(fd);
+    size_t align = hugetlb ? hugetlb : opts->hugepage ? MEMKV_HUGEPAGE_SIZE : page_size();
+    // 需要先madvise再预取，否则MAP_POPULATE填进来的是小页
+    bool populate = opts->prefault_threads == 1 && !(opts->hugepage && !hugetlb);
+    if (populate)
+        flags |= MAP_POPULATE;
+
+    void *pool = map_aligned(len, align, PROT_READ | PROT_WRITE, flags, fd);
+    if (fd >= 0)
+        close(fd);
+    if (pool == MAP_FAILED)
+    {
+        LOG("[ERROR] mmap %zu bytes failed: %s", len, strerror(errno));
+        return NULL;
+    }
+
+    if (opts->hugepage && !hugetlb)
+    {
+#ifdef MADV_HUGEPAGE
+        if (madvise(pool, len, MADV_HUGEPAGE) != 0)
+        {
+            LOG("[WARN] MADV_HUGEPAGE failed: %s", strerror(errno));
+        }
+#else
+        LOG("[WARN] MADV_HUGEPAGE is not supported");
+#endif
+    }
+    if (opts->prefault_threads && !populate)
+        prefault(pool, len, hugetlb ? hugetlb : page_size(), opts->prefault_threads);
+
+    LOG("[INFO] mapped %zu bytes at %p, page %zu%s", len, pool, align, hugetlb ? " (hugetlbfs)" : "");
+    *pool_len = len;
+    return pool;
+}
+
+void memkv_unmap(void *pool_data, size_t pool_len)
+{
+    if (!pool_data)
+        return;
+    probe_detach(pool_data);
+    munmap(pool_data, pool_len);
+}
+
+/* 校验映射的头部：冻结镜像和可写池的version、pool_size同偏移 */
+static int pool_validate(const void *pool, size_t len, const char *path)
+{
+    (void)path; // 只在日志里用
+    if (pool_is_frozen(pool))
+    {
+        const memkv_frozen_t *fz = pool;
+        if (fz->version != MEMKV_FORMAT_VERSION)
+        {
+            LOG("[ERROR] %s has format version %u, expected %u", path, fz->version, MEMKV_FORMAT_VERSION);
+            return MEMKV_ERROR_VERSION;
+        }
+        if (fz->pool_size > len || fz->values_offset + fz->values_size > len)
+        {
+            LOG("[ERROR] frozen image %s is truncated: %lu > %zu", path, (unsigned long)fz->pool_size, len);
+            return MEMKV_ERROR_INVALID_ARG;
+        }
+        return MEMKV_SUCCESS;
+    }
+    const memkv_meta_t *meta = pool;
+    if (len < sizeof(memkv_meta_t) || memcmp(meta->magic, MEMKV_MAGIC, sizeof(meta->magic)) != 0)
+    {
+        LOG("[ERROR] %s is not a memkv pool", path);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (meta->version != MEMKV_FORMAT_VERSION)
+    {
+        LOG("[ERROR] %s has format version %u, expected %u", path, meta->version, MEMKV_FORMAT_VERSION);
+        return MEMKV_ERROR_VERSION;
+    }
+    if (meta->pool_size > len || meta->key_offset >= meta->valueptr_offset || meta->valueptr_offset >= meta->value_offset || meta->value_offset >= meta->pool_size)
+    {
+        LOG("[ERROR] pool %s has an inconsistent layout for %zu mapped bytes", path, len);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    return MEMKV_SUCCESS;
+}
+
+int memkv_open(memkv_t *kv, const char *path, int flags)
+{
+    if (!kv || !path)
+    {
+        LOG("[ERROR] invalid arguments to memkv_open");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    memset(kv, 0, sizeof(*kv));
+    bool rdonly = flags & MEMKV_OPEN_RDONLY;
+    int fd = open(path, rdonly ? O_RDONLY : O_RDWR);
+    if (fd < 0)
+    {
+        LOG("[ERROR] open %s failed: %s", path, strerror(errno));
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(memkv_frozen_t))
+    {
+        LOG("[ERROR] %s is too small to be a memkv pool", path);
+        close(fd);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    size_t len = (size_t)st.st_size;
+    size_t hugetlb = hugetlb_page_size(fd);
+    bool hugepage = flags & MEMKV_OPEN_HUGEPAGE;
+    size_t align = hugetlb ? hugetlb : hugepage ? MEMKV_HUGEPAGE_SIZE : page_size();
+    int mflags = MAP_SHARED;
+    bool populate = (flags & MEMKV_OPEN_PREFAULT) && !(hugepage && !hugetlb);
+    if (populate)
+        mflags |= MAP_POPULATE;
+    void *pool = map_aligned(len, align, rdonly ? PROT_READ : PROT_READ | PROT_WRITE, mflags, fd);
+    close(fd);
+    if (pool == MAP_FAILED)
+    {
+        LOG("[ERROR] mmap %s failed: %s", path, strerror(errno));
+        return MEMKV_ERROR_OUTOFMEMORY;
+    }
+    int r = pool_validate(pool, len, path);
+    if (r != MEMKV_SUCCESS)
+    {
+        munmap(pool, len);
+        return r;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugepage && !hugetlb && madvise(pool, len, MADV_HUGEPAGE) != 0)
+    {
+        LOG("[WARN] MADV_HUGEPAGE failed: %s", strerror(errno));
+    }
+#endif
+    if ((flags & MEMKV_OPEN_PREFAULT) && !populate)
+    {
+        // 只读映射不能写触碰，交给内核预读
+        if (rdonly)
+            madvise(pool, len, MADV_WILLNEED);
+        else
+            prefault(pool, len, page_size(), 1);
+    }
+
+    kv->pool = pool;
+    kv->pool_len = len;
+    kv->flags = flags;
+    kv->frozen = pool_is_frozen(pool);
+    if (kv->frozen)
+    {
+        kv->values = (const uint8_t *)pool + ((const memkv_frozen_t *)pool)->values_offset;
+    }
+    else
+    {
+        const memkv_meta_t *meta = pool;
+        kv->keys = (const uint8_t *)pool + meta->key_offset;
+        kv->values = (const uint8_t *)pool + meta->value_offset;
+    }
+    return MEMKV_SUCCESS;
+}
+
+void memkv_close(memkv_t *kv)
+{
+    if (!kv || !kv->pool)
+        return;
+    if (!(kv->flags & MEMKV_OPEN_RDONLY) && !kv->frozen)
+        memkv_writer_detach(kv->pool);
+    memkv_tier_detach(kv->pool);
+    probe_detach(kv->pool);
+    munmap(kv->pool, kv->pool_len);
+    memset(kv, 0, sizeof(*kv));
+}
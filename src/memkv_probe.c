@@ -0,0 +1,144 @@
+#include <stddef.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "memkv_probe.h"
+#include "logutil.h"
+
+/*
+对数线性直方图：小于16的值每个值一个桶，之后每个2的幂分成4个桶，
+相对误差不超过25%，最后一个桶收纳所有更大的值。
+*/
+int memkv_probe_bucket(uint64_t ticks)
+{
+    if (ticks < 16)
+        return (int)ticks;
+    int msb = 63 - __builtin_clzll(ticks);
+    int b = 16 + (msb - 4) * 4 + (int)((ticks >> (msb - 2)) & 3);
+    return b < MEMKV_PROBE_BUCKETS ? b : MEMKV_PROBE_BUCKETS - 1;
+}
+
+uint64_t memkv_probe_bucket_floor(int bucket)
+{
+    if (bucket < 16)
+        return (uint64_t)bucket;
+    int msb = (bucket - 16) / 4 + 4;
+    uint64_t sub = (uint64_t)((bucket - 16) % 4);
+    return (1ULL << msb) | (sub << (msb - 2));
+}
+
+const memkv_probe_t *memkv_probe(void *pool_data)
+{
+    if (!pool_data)
+        return NULL;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    return (const memkv_probe_t *)((uint8_t *)meta + meta->probe_offset);
+}
+
+#ifdef MEMKV_ENABLE_PROBE
+
+#define PROBE_FLUSH_OPS 64
+
+// 线程本地的累加器，只对应最近使用的一个池
+static __thread struct
+{
+    memkv_meta_t *meta;
+    uint32_t pending;
+    memkv_probe_op_t ops[MEMKV_OP_MAX];
+} probe_local;
+
+static void probe_flush_local(void)
+{
+    memkv_meta_t *meta = probe_local.meta;
+    if (!meta || !probe_local.pending)
+        return;
+    memkv_probe_t *area = (memkv_probe_t *)((uint8_t *)meta + meta->probe_offset);
+    for (int op = 0; op < MEMKV_OP_MAX; op++)
+    {
+        memkv_probe_op_t *src = &probe_local.ops[op];
+        if (!src->count)
+            continue;
+        memkv_probe_op_t *dst = &area->ops[op];
+        __atomic_fetch_add(&dst->count, src->count, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dst->errors, src->errors, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dst->depth_sum, src->depth_sum, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&dst->ticks_sum, src->ticks_sum, __ATOMIC_RELAXED);
+        for (int b = 0; b < MEMKV_PROBE_BUCKETS; b++)
+        {
+            if (src->hist[b])
+                __atomic_fetch_add(&dst->hist[b], src->hist[b], __ATOMIC_RELAXED);
+        }
+    }
+    area->unit_is_tsc = PROBE_UNIT_TSC;
+    area->enabled = 1;
+    memset(probe_local.ops, 0, sizeof(probe_local.ops));
+    probe_local.pending = 0;
+}
+
+// 线程退出时把不足PROBE_FLUSH_OPS次的剩余计数合并进去，否则会丢掉最多63次操作
+static pthread_key_t probe_key;
+static pthread_once_t probe_key_once = PTHREAD_ONCE_INIT;
+
+static void probe_thread_exit(void *arg)
+{
+    (void)arg;
+    probe_flush_local();
+}
+
+static void probe_key_init(void)
+{
+    if (pthread_key_create(&probe_key, probe_thread_exit) != 0)
+        LOG("[WARN] pthread_key_create failed, probe samples of exiting threads may be lost");
+}
+
+void probe_record(memkv_meta_t *meta, memkv_op_t op, uint64_t ticks, uint64_t depth, int failed)
+{
+    if (probe_local.meta != meta)
+    {
+        if (!probe_local.meta)
+        {
+            // 本线程第一次记录：登记退出时的flush，值非空析构函数才会被调用
+            pthread_once(&probe_key_once, probe_key_init);
+            pthread_setspecific(probe_key, &probe_local);
+        }
+        probe_flush_local();
+        probe_local.meta = meta;
+    }
+    memkv_probe_op_t *o = &probe_local.ops[op];
+    o->count++;
+    o->errors += failed ? 1 : 0;
+    o->depth_sum += depth;
+    o->ticks_sum += ticks;
+    o->hist[memkv_probe_bucket(ticks)]++;
+    if (++probe_local.pending >= PROBE_FLUSH_OPS)
+        probe_flush_local();
+}
+
+void memkv_probe_flush(void)
+{
+    probe_flush_local();
+}
+
+void probe_detach(memkv_meta_t *meta)
+{
+    if (probe_local.meta != meta)
+        return;
+    probe_flush_local();
+    probe_local.meta = NULL;
+}
+
+#else
+
+void memkv_probe_flush(void)
+{
+}
+
+void probe_detach(memkv_meta_t *meta)
+{
+    (void)meta;
+}
+
+#endif // MEMKV_ENABLE_PROBE
@@ -0,0 +1,49 @@
+#ifndef MEMKV_PROBE_H
+#define MEMKV_PROBE_H
+
+#include <stdint.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+
+/*
+热路径埋点：编译时定义 MEMKV_ENABLE_PROBE 才生效（cmake -DMEMKV_PROBE=ON），否则宏为空，没有任何开销。
+开启后每次操作读两次时间戳，计数和延迟直方图先累加在线程本地，
+每 PROBE_FLUSH_OPS 次操作以及线程退出时用原子加合并到池内的共享统计区，外部进程（miaobyte probe）可以直接读取。
+*/
+// 池解除映射前调用：本线程尚未合并的计数先写进去，之后不再指向这个池
+void probe_detach(memkv_meta_t *meta);
+
+#ifdef MEMKV_ENABLE_PROBE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t probe_now(void)
+{
+    return __rdtsc();
+}
+#define PROBE_UNIT_TSC 1
+#else
+#include <time.h>
+static inline uint64_t probe_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#define PROBE_UNIT_TSC 0
+#endif
+
+void probe_record(memkv_meta_t *meta, memkv_op_t op, uint64_t ticks, uint64_t depth, int failed);
+
+#define PROBE_BEGIN() uint64_t probe_t0_ = probe_now()
+#define PROBE_END(meta, op, depth, failed) probe_record((meta), (op), probe_now() - probe_t0_, (depth), (failed))
+
+#else
+
+#define PROBE_BEGIN()
+#define PROBE_END(meta, op, depth, failed)
+
+#endif // MEMKV_ENABLE_PROBE
+
+#endif // MEMKV_PROBE_H
@@ -0,0 +1,269 @@
+/*
+有序导航：lower_bound / successor / predecessor / range
+
+前缀树的深度优先顺序（节点自身的key在前，子节点按字节值升序）就是key的字典序，
+这里用显式的路径游标在树上前进/后退，不做整棵子树的枚举：
+定位一次是O(key长度 + 沿途的兄弟查找)，range之后每输出一个key只多走它与上一个key的分叉部分，
+遇到第一个>=end的key就结束。
+与memkv_keys一样不与writer互斥，并发修改时只保证不会读到未发布的value。
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+// 从根到当前节点的路径，nodes[0]为根，key[i]为nodes[i]到nodes[i+1]的字符
+typedef struct
+{
+    memkv_meta_t *meta;
+    void *key_start;
+    int32_t nodes[KEY_BUFFER_MAX];
+    uint8_t key[KEY_BUFFER_MAX];
+    size_t depth;
+} range_cursor_t;
+
+static inline key_node_t *cursor_node(const range_cursor_t *cur)
+{
+    return keynode_at(cur->meta, cur->key_start, cur->nodes[cur->depth]);
+}
+
+/*
+按字典序前进到下一个key：self为true时当前节点自身的key也算，from为当前节点下一个要看的子节点；
+当前子树找完后回到父节点继续看后面的兄弟
+*/
+static bool cursor_next(range_cursor_t *cur, bool self, size_t from)
+{
+    size_t char_type = cur->meta->char_type;
+    for (;;)
+    {
+        key_node_t *node = cursor_node(cur);
+        if (self && node->has_key)
+            return true;
+        size_t c = from;
+        while (c < char_type && node->child_key_blocks[c] < 0)
+            c++;
+        if (c < char_type && cur->depth + 1 < KEY_BUFFER_MAX)
+        {
+            cur->key[cur->depth] = (uint8_t)c;
+            cur->nodes[++cur->depth] = node->child_key_blocks[c];
+            self = true;
+            from = 0;
+            continue;
+        }
+        if (cur->depth == 0)
+            return false;
+        cur->depth--;
+        from = (size_t)cur->key[cur->depth] + 1;
+        self = false;
+    }
+}
+
+/*
+按字典序后退到上一个key：先看当前节点中字符小于below的子树（从大到小，每棵子树取最后一个key），
+再看节点自身，最后回到父节点
+*/
+static bool cursor_prev(range_cursor_t *cur, size_t below)
+{
+    size_t char_type = cur->meta->char_type;
+    for (;;)
+    {
+        key_node_t *node = cursor_node(cur);
+        size_t c = below;
+        while (c > 0 && node->child_key_blocks[c - 1] < 0)
+            c--;
+        if (c > 0 && cur->depth + 1 < KEY_BUFFER_MAX)
+        {
+            cur->key[cur->depth] = (uint8_t)(c - 1);
+            cur->nodes[++cur->depth] = node->child_key_blocks[c - 1];
+            below = char_type;
+            continue;
+        }
+        if (node->has_key)
+            return true;
+        if (cur->depth == 0)
+            return false;
+        cur->depth--;
+        below = cur->key[cur->depth];
+    }
+}
+
+/*
+沿key下降到能走到的最深处；完整匹配返回true，否则*stop为第一个走不下去的字符
+（超出char_type的字符比所有子节点都大，按char_type处理）
+*/
+static bool cursor_descend(range_cursor_t *cur, const uint8_t *key, size_t key_len, size_t *stop)
+{
+    cur->nodes[0] = 0;
+    cur->depth = 0;
+    for (size_t i = 0; i < key_len; i++)
+    {
+        size_t c = key[i] < cur->meta->char_type ? key[i] : cur->meta->char_type;
+        int32_t child = c < cur->meta->char_type ? cursor_node(cur)->child_key_blocks[c] : -1;
+        if (child < 0)
+        {
+            *stop = c;
+            return false;
+        }
+        cur->key[cur->depth] = (uint8_t)c;
+        cur->nodes[++cur->depth] = child;
+    }
+    return true;
+}
+
+// 第一个>=key（strict时>key）的key
+static bool cursor_seek_ge(range_cursor_t *cur, const void *key_data, size_t key_len, bool strict)
+{
+    size_t stop;
+    if (cursor_descend(cur, key_data, key_len, &stop))
+        return cursor_next(cur, !strict, 0);
+    return cursor_next(cur, false, stop + 1);
+}
+
+// 最后一个<key的key
+static bool cursor_seek_lt(range_cursor_t *cur, const void *key_data, size_t key_len)
+{
+    size_t stop;
+    if (cursor_descend(cur, key_data, key_len, &stop))
+    {
+        // key自身和它的子树都不小于key
+        if (cur->depth == 0)
+            return false;
+        cur->depth--;
+        return cursor_prev(cur, cur->key[cur->depth]);
+    }
+    return cursor_prev(cur, stop);
+}
+
+static int cursor_init(range_cursor_t *cur, void *pool_data, const void *key_data, size_t key_len)
+{
+    if (!pool_data || (key_len && !key_data))
+    {
+        LOG("[ERROR] invalid arguments to ordered lookup");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (key_len >= KEY_BUFFER_MAX)
+    {
+        LOG("[ERROR] key too long for ordered lookup: %zu", key_len);
+        return MEMKV_ERROR_PREFIX_TOO_LONG;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] ordered and parallel traversal are not supported on frozen pools");
+        return MEMKV_ERROR_FROZEN;
+    }
+    cur->meta = (memkv_meta_t *)pool_data;
+    cur->key_start = pool_data + cur->meta->key_offset;
+    return MEMKV_SUCCESS;
+}
+
+// 把游标处的key写给调用方；key_buf放不下时*found_len仍给出需要的长度
+static int cursor_output(range_cursor_t *cur, void *key_buf, size_t key_cap, size_t *found_len, void **value)
+{
+    if (found_len)
+        *found_len = cur->depth;
+    if (value)
+    {
+        size_t value_len;
+        *value = value_view(cur->meta, keynode_box(cursor_node(cur)), &value_len);
+    }
+    if (key_buf && cur->depth > key_cap)
+    {
+        LOG("[ERROR] key buffer too small: need %zu, have %zu", cur->depth, key_cap);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (key_buf)
+        memcpy(key_buf, cur->key, cur->depth);
+    return MEMKV_SUCCESS;
+}
+
+typedef enum
+{
+    SEEK_GE,
+    SEEK_GT,
+    SEEK_LT
+} seek_mode_t;
+
+static int memkv_seek(void *pool_data, const void *key_data, size_t key_len, seek_mode_t mode, void *key_buf, size_t key_cap, size_t *found_len, void **value)
+{
+    range_cursor_t *cur = malloc(sizeof(*cur));
+    if (!cur)
+        return MEMKV_ERROR_OUTOFMEMORY;
+    int r = cursor_init(cur, pool_data, key_data, key_len);
+    if (r == MEMKV_SUCCESS)
+    {
+        bool found = mode == SEEK_LT ? cursor_seek_lt(cur, key_data, key_len)
+                                     : cursor_seek_ge(cur, key_data, key_len, mode == SEEK_GT);
+        r = found ? cursor_output(cur, key_buf, key_cap, found_len, value) : MEMKV_ERROR_KEY_NOT_FOUND;
+    }
+    free(cur);
+    return r;
+}
+
+int memkv_lower_bound(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value)
+{
+    return memkv_seek(pool_data, key_data, key_len, SEEK_GE, key_buf, key_cap, found_len, value);
+}
+
+int memkv_successor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value)
+{
+    return memkv_seek(pool_data, key_data, key_len, SEEK_GT, key_buf, key_cap, found_len, value);
+}
+
+int memkv_predecessor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value)
+{
+    return memkv_seek(pool_data, key_data, key_len, SEEK_LT, key_buf, key_cap, found_len, value);
+}
+
+// 字典序比较，短的前缀在前
+static int key_compare(const uint8_t *a, size_t alen, const uint8_t *b, size_t blen)
+{
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c)
+        return c;
+    return alen < blen ? -1 : alen > blen;
+}
+
+int memkv_range(void *pool_data, const void *start_data, size_t start_len, const void *end_data, size_t end_len, memkv_range_func_t func, void *arg)
+{
+    if (!func)
+    {
+        LOG("[ERROR] invalid arguments to memkv_range");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    range_cursor_t *cur = malloc(sizeof(*cur));
+    if (!cur)
+        return MEMKV_ERROR_OUTOFMEMORY;
+    int r = cursor_init(cur, pool_data, start_data, start_len);
+    if (r != MEMKV_SUCCESS)
+    {
+        free(cur);
+        return r;
+    }
+    if (!start_len)
+        start_data = "";
+    if (end_data && key_compare(start_data, start_len, end_data, end_len) >= 0)
+    {
+        free(cur);
+        return 0;
+    }
+
+    int count = 0;
+    bool more = cursor_seek_ge(cur, start_data, start_len, false);
+    while (more)
+    {
+        if (end_data && key_compare(cur->key, cur->depth, end_data, end_len) >= 0)
+            break;
+        size_t value_len;
+        void *value = value_view(cur->meta, keynode_box(cursor_node(cur)), &value_len);
+        count++;
+        if (!func(arg, cur->key, cur->depth, value, value_len))
+            break;
+        more = cursor_next(cur, false, 0);
+    }
+    free(cur);
+    return count;
+}
@@ -0,0 +1,492 @@
+/*
+并行遍历：memkv_scan
+
+1) 先下降到prefix对应的节点，再按层展开：每个有子节点的节点拆成
+   [只输出自身key的任务, 子树0, 子树1, ...]，顺序与深度优先一致，直到任务数够多或展开了SCAN_SPLIT_LEVELS层；
+2) 无序模式：任务轮流分给各worker的双端队列，worker从自己队尾取、从别人队头偷，
+   有worker空闲时，正在扫描的worker把剩余的子节点拆成新任务压入自己的队列，大子树也能被分摊；
+3) 有序模式：worker按序领取任务，把结果缓冲在任务里，调用线程按任务顺序回放，输出保持字典序。
+遍历期间只读前缀树，和memkv_keys一样不与writer互斥。
+*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define SCAN_SPLIT_LEVELS 8
+#define SCAN_MAX_THREADS 256
+
+typedef struct scan_task
+{
+    int32_t node_id;
+    bool self_only; // 只输出节点自身的key：拆分时父节点的key单独成一个任务，保持字典序
+    int done;       // 有序模式：结果已写入out
+    size_t depth;
+    // 有序模式的结果缓冲，记录为 [uint16 key_len][key][uint64 box]
+    uint8_t *out;
+    size_t out_len;
+    size_t out_cap;
+    bool out_failed;
+    uint8_t key[];
+} scan_task_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    scan_task_t **items;
+    size_t head; // 偷取端
+    size_t tail; // 所有者端
+    size_t cap;
+} scan_deque_t;
+
+typedef struct
+{
+    memkv_meta_t *meta;
+    void *key_start;
+    memkv_scan_func_t func;
+    void *arg;
+    bool ordered;
+    int threads;
+    scan_deque_t *deques;
+    size_t pending; // 无序模式：尚未完成的任务数
+    int idle;       // 无序模式：空闲worker数，>0时扫描中的worker拆分子树
+    scan_task_t **tasks;
+    size_t ntasks;
+    size_t next;    // 有序模式：下一个待领取的任务
+} scan_ctx_t;
+
+typedef struct
+{
+    scan_ctx_t *ctx;
+    int worker;
+} scan_worker_t;
+
+static size_t keynode_child_count(const memkv_meta_t *meta, const key_node_t *node)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < meta->char_type; i++)
+        n += node->child_key_blocks[i] >= 0;
+    return n;
+}
+
+static scan_task_t *scan_task_new(int32_t node_id, const uint8_t *key, size_t depth, bool self_only)
+{
+    scan_task_t *t = malloc(sizeof(scan_task_t) + depth);
+    if (!t)
+        return NULL;
+    memset(t, 0, sizeof(*t));
+    t->node_id = node_id;
+    t->self_only = self_only;
+    t->depth = depth;
+    if (depth)
+        memcpy(t->key, key, depth);
+    return t;
+}
+
+static void scan_task_free(scan_task_t *t)
+{
+    free(t->out);
+    free(t);
+}
+
+static bool deque_push(scan_deque_t *d, scan_task_t *t)
+{
+    pthread_mutex_lock(&d->lock);
+    if (d->head == d->tail)
+        d->head = d->tail = 0;
+    if (d->tail == d->cap)
+    {
+        size_t cap = d->cap ? d->cap * 2 : 64;
+        scan_task_t **items = realloc(d->items, cap * sizeof(*items));
+        if (!items)
+        {
+            pthread_mutex_unlock(&d->lock);
+            return false;
+        }
+        d->items = items;
+        d->cap = cap;
+    }
+    d->items[d->tail++] = t;
+    pthread_mutex_unlock(&d->lock);
+    return true;
+}
+
+static scan_task_t *deque_take(scan_deque_t *d, bool steal)
+{
+    scan_task_t *t = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail)
+        t = steal ? d->items[d->head++] : d->items[--d->tail];
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+static void scan_emit(scan_ctx_t *ctx, int worker, scan_task_t *task, key_node_t *node, const uint8_t *key, size_t depth)
+{
+    // box字里带着存储形式，回放时才知道value在冷文件里还是压缩过
+    uint64_t box = keynode_box(node);
+    if (!ctx->ordered)
+    {
+        size_t value_len;
+        void *value = value_view(ctx->meta, box, &value_len);
+        ctx->func(ctx->arg, worker, key, depth, value, value_len);
+        return;
+    }
+    if (task->out_failed)
+        return;
+    size_t need = sizeof(uint16_t) + depth + sizeof(box);
+    if (task->out_len + need > task->out_cap)
+    {
+        size_t cap = task->out_cap ? task->out_cap * 2 : 4096;
+        while (cap < task->out_len + need)
+            cap *= 2;
+        uint8_t *out = realloc(task->out, cap);
+        if (!out)
+        {
+            task->out_failed = true;
+            return;
+        }
+        task->out = out;
+        task->out_cap = cap;
+    }
+    uint16_t len = (uint16_t)depth;
+    uint8_t *p = task->out + task->out_len;
+    memcpy(p, &len, sizeof(len));
+    memcpy(p + sizeof(len), key, depth);
+    memcpy(p + sizeof(len) + depth, &box, sizeof(box));
+    task->out_len += need;
+}
+
+static void scan_dfs(scan_ctx_t *ctx, int worker, scan_task_t *task, key_node_t *node, uint8_t *key, size_t depth)
+{
+    if (node->has_key)
+        scan_emit(ctx, worker, task, node, key, depth);
+    for (size_t i = 0; i < ctx->meta->char_type; i++)
+    {
+        int32_t child = node->child_key_blocks[i];
+        if (child < 0)
+            continue;
+        if (depth + 1 >= KEY_BUFFER_MAX)
+        {
+            LOG("[ERROR] would overflow key buffer at depth %zu, skipping child %zu", depth + 1, i);
+            continue;
+        }
+        key[depth] = (uint8_t)i;
+        // 有worker空闲时把子树拆出去，它会从队头偷走
+        if (!ctx->ordered && __atomic_load_n(&ctx->idle, __ATOMIC_RELAXED) > 0)
+        {
+            scan_task_t *t = scan_task_new(child, key, depth + 1, false);
+            if (t)
+            {
+                __atomic_add_fetch(&ctx->pending, 1, __ATOMIC_RELAXED);
+                if (deque_push(&ctx->deques[worker], t))
+                    continue;
+                __atomic_sub_fetch(&ctx->pending, 1, __ATOMIC_RELAXED);
+                free(t);
+            }
+        }
+        scan_dfs(ctx, worker, task, keynode_at(ctx->meta, ctx->key_start, child), key, depth + 1);
+    }
+}
+
+static void scan_run_task(scan_ctx_t *ctx, int worker, scan_task_t *t)
+{
+    uint8_t key[KEY_BUFFER_MAX];
+    memcpy(key, t->key, t->depth);
+    key_node_t *node = keynode_at(ctx->meta, ctx->key_start, t->node_id);
+    if (t->self_only)
+    {
+        if (node->has_key)
+            scan_emit(ctx, worker, t, node, key, t->depth);
+        return;
+    }
+    scan_dfs(ctx, worker, t, node, key, t->depth);
+}
+
+static scan_task_t *scan_next_unordered(scan_ctx_t *ctx, int worker)
+{
+    scan_task_t *t = deque_take(&ctx->deques[worker], false);
+    for (int i = 1; !t && i < ctx->threads; i++)
+        t = deque_take(&ctx->deques[(worker + i) % ctx->threads], true);
+    return t;
+}
+
+static void *scan_worker(void *p)
+{
+    scan_worker_t *w = p;
+    scan_ctx_t *ctx = w->ctx;
+    if (ctx->ordered)
+    {
+        for (;;)
+        {
+            size_t i = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED);
+            if (i >= ctx->ntasks)
+                break;
+            scan_run_task(ctx, w->worker, ctx->tasks[i]);
+            __atomic_store_n(&ctx->tasks[i]->done, 1, __ATOMIC_RELEASE);
+        }
+        return NULL;
+    }
+
+    bool idle = false;
+    for (;;)
+    {
+        scan_task_t *t = scan_next_unordered(ctx, w->worker);
+        if (!t)
+        {
+            if (__atomic_load_n(&ctx->pending, __ATOMIC_ACQUIRE) == 0)
+                break;
+            if (!idle)
+            {
+                __atomic_add_fetch(&ctx->idle, 1, __ATOMIC_RELAXED);
+                idle = true;
+            }
+            sched_yield();
+            continue;
+        }
+        if (idle)
+        {
+            __atomic_sub_fetch(&ctx->idle, 1, __ATOMIC_RELAXED);
+            idle = false;
+        }
+        scan_run_task(ctx, w->worker, t);
+        scan_task_free(t);
+        __atomic_sub_fetch(&ctx->pending, 1, __ATOMIC_RELEASE);
+    }
+    if (idle)
+        __atomic_sub_fetch(&ctx->idle, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// 按层展开任务列表，直到任务数不少于min_tasks。拆分只影响并行度：内存不够时停在当前层，
+// 拆到一半的节点退回成一个完整任务，任务列表始终覆盖整棵子树
+static void scan_split(scan_ctx_t *ctx, size_t min_tasks)
+{
+    for (int level = 0; level < SCAN_SPLIT_LEVELS && ctx->ntasks < min_tasks; level++)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < ctx->ntasks; i++)
+        {
+            scan_task_t *t = ctx->tasks[i];
+            key_node_t *node = keynode_at(ctx->meta, ctx->key_start, t->node_id);
+            n += t->self_only ? 1 : 1 + keynode_child_count(ctx->meta, node);
+        }
+        if (n == ctx->ntasks)
+            break;
+        scan_task_t **tasks = calloc(n, sizeof(*tasks));
+        if (!tasks)
+        {
+            LOG("[WARN] out of memory splitting scan tasks, keeping %zu tasks", ctx->ntasks);
+            return;
+        }
+        size_t k = 0;
+        bool ok = true;
+        for (size_t i = 0; i < ctx->ntasks; i++)
+        {
+            scan_task_t *t = ctx->tasks[i];
+            key_node_t *node = keynode_at(ctx->meta, ctx->key_start, t->node_id);
+            if (t->self_only || !keynode_child_count(ctx->meta, node) || t->depth + 1 >= KEY_BUFFER_MAX || !ok)
+            {
+                tasks[k++] = t;
+                continue;
+            }
+            uint8_t key[KEY_BUFFER_MAX];
+            memcpy(key, t->key, t->depth);
+            // 节点自身的key排在子树前面，保证有序模式的字典序
+            size_t first = k;
+            bool has_key = node->has_key;
+            if (has_key)
+                tasks[k++] = t;
+            for (size_t c = 0; c < ctx->meta->char_type; c++)
+            {
+                int32_t child = node->child_key_blocks[c];
+                if (child < 0)
+                    continue;
+                key[t->depth] = (uint8_t)c;
+                scan_task_t *sub = scan_task_new(child, key, t->depth + 1, false);
+                if (!sub)
+                {
+                    ok = false;
+                    break;
+                }
+                tasks[k++] = sub;
+            }
+            if (!ok)
+            {
+                // 放弃这个节点已拆出的子任务，整棵子树仍由t负责
+                while (k > first + has_key)
+                    scan_task_free(tasks[--k]);
+                tasks[first] = t;
+                k = first + 1;
+            }
+            else if (has_key)
+            {
+                t->self_only = true;
+            }
+            else
+            {
+                free(t);
+            }
+        }
+        free(ctx->tasks);
+        ctx->tasks = tasks;
+        ctx->ntasks = k;
+        if (!ok)
+        {
+            LOG("[WARN] out of memory splitting scan tasks, keeping %zu tasks", ctx->ntasks);
+            return;
+        }
+    }
+}
+
+// 有序模式：按任务顺序回放缓冲的结果
+static int scan_replay(scan_ctx_t *ctx)
+{
+    for (size_t i = 0; i < ctx->ntasks; i++)
+    {
+        scan_task_t *t = ctx->tasks[i];
+        while (!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE))
+            sched_yield();
+        if (t->out_failed)
+        {
+            LOG("[ERROR] out of memory buffering ordered scan results");
+            return MEMKV_ERROR_OUTOFMEMORY;
+        }
+        for (size_t off = 0; off < t->out_len;)
+        {
+            uint16_t len;
+            uint64_t box;
+            memcpy(&len, t->out + off, sizeof(len));
+            const uint8_t *key = t->out + off + sizeof(len);
+            memcpy(&box, key + len, sizeof(box));
+            size_t value_len;
+            void *value = value_view(ctx->meta, box, &value_len);
+            ctx->func(ctx->arg, 0, key, len, value, value_len);
+            off += sizeof(len) + len + sizeof(box);
+        }
+        free(t->out);
+        t->out = NULL;
+    }
+    return MEMKV_SUCCESS;
+}
+
+int memkv_scan(void *pool_data, const void *prefix_data, size_t prefix_len, const memkv_scan_options_t *opts, memkv_scan_func_t func, void *arg)
+{
+    if (!pool_data || !func || (prefix_len && !prefix_data))
+    {
+        LOG("[ERROR] invalid arguments to memkv_scan");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (prefix_len >= KEY_BUFFER_MAX)
+    {
+        LOG("[ERROR] prefix too long: %zu", prefix_len);
+        return MEMKV_ERROR_PREFIX_TOO_LONG;
+    }
+    if (pool_is_frozen(pool_data))
+    {
+        LOG("[ERROR] ordered and parallel traversal are not supported on frozen pools");
+        return MEMKV_ERROR_FROZEN;
+    }
+    memkv_scan_options_t defaults = {0};
+    if (!opts)
+        opts = &defaults;
+
+    scan_ctx_t ctx = {0};
+    ctx.meta = (memkv_meta_t *)pool_data;
+    ctx.key_start = pool_data + ctx.meta->key_offset;
+    ctx.func = func;
+    ctx.arg = arg;
+    ctx.ordered = opts->ordered;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    ctx.threads = opts->threads > 0 ? opts->threads : (ncpu > 0 ? (int)ncpu : 1);
+    if (ctx.threads > SCAN_MAX_THREADS)
+        ctx.threads = SCAN_MAX_THREADS;
+
+    // 下降到前缀节点
+    int32_t node_id = 0;
+    for (size_t i = 0; i < prefix_len; i++)
+    {
+        uint8_t c = ((const uint8_t *)prefix_data)[i];
+        if (c >= ctx.meta->char_type)
+        {
+            LOG("[ERROR] character index out of range in scan: %u (depth %zu)", c, i);
+            return MEMKV_ERROR_CHAR_OUT_OF_RANGE;
+        }
+        node_id = keynode_at(ctx.meta, ctx.key_start, node_id)->child_key_blocks[c];
+        if (node_id < 0)
+            return MEMKV_SUCCESS;
+    }
+
+    int r = MEMKV_SUCCESS;
+    ctx.tasks = calloc(1, sizeof(*ctx.tasks));
+    ctx.deques = calloc((size_t)ctx.threads, sizeof(scan_deque_t));
+    if (ctx.tasks)
+        ctx.tasks[0] = scan_task_new(node_id, prefix_data, prefix_len, false);
+    if (!ctx.tasks || !ctx.deques || !ctx.tasks[0])
+    {
+        r = MEMKV_ERROR_OUTOFMEMORY;
+        goto done;
+    }
+    ctx.ntasks = 1;
+    scan_split(&ctx, opts->min_tasks ? opts->min_tasks : (size_t)ctx.threads * 8);
+    LOG("[INFO] scan split into %zu tasks for %d threads", ctx.ntasks, ctx.threads);
+
+    for (int i = 0; i < ctx.threads; i++)
+        pthread_mutex_init(&ctx.deques[i].lock, NULL);
+    if (!ctx.ordered)
+    {
+        for (size_t i = 0; i < ctx.ntasks; i++)
+            deque_push(&ctx.deques[i % ctx.threads], ctx.tasks[i]);
+        ctx.pending = ctx.ntasks;
+        ctx.ntasks = 0; // 任务归队列所有，由worker释放
+    }
+
+    // 无序模式下调用线程就是worker 0；有序模式下调用线程负责按序回放
+    scan_worker_t workers[SCAN_MAX_THREADS];
+    pthread_t tids[SCAN_MAX_THREADS];
+    int first = ctx.ordered ? 0 : 1;
+    int started = 0;
+    for (int i = 0; i < ctx.threads; i++)
+        workers[i] = (scan_worker_t){&ctx, i};
+    for (int i = first; i < ctx.threads; i++)
+    {
+        if (pthread_create(&tids[i], NULL, scan_worker, &workers[i]) != 0)
+            break;
+        started = i + 1;
+    }
+    if (ctx.ordered)
+    {
+        if (!started)
+            scan_worker(&workers[0]);
+        r = scan_replay(&ctx);
+        // 回放失败时让worker尽快收尾
+        __atomic_store_n(&ctx.next, ctx.ntasks, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        scan_worker(&workers[0]);
+    }
+    for (int i = first; i < started; i++)
+        pthread_join(tids[i], NULL);
+    for (int i = 0; i < ctx.threads; i++)
+        pthread_mutex_destroy(&ctx.deques[i].lock);
+
+done:
+    for (size_t i = 0; ctx.tasks && i < ctx.ntasks; i++)
+    {
+        if (ctx.tasks[i])
+            scan_task_free(ctx.tasks[i]);
+    }
+    free(ctx.tasks);
+    for (int i = 0; ctx.deques && i < ctx.threads; i++)
+        free(ctx.deques[i].items);
+    free(ctx.deques);
+    return r;
+}
@@ -0,0 +1,243 @@
+/*
+小value的slab分配器：挡在boxmalloc前面，按细分的大小级别分配不超过SLAB_MAX的box
+1. boxmalloc的级别按2的幂增长，略大于级别边界的value要浪费将近一半；slab级别相邻只差12.5%~25%，
+   每个slab是一块SLAB_SIZE字节的box，整块切成同一级别的块，块之间没有头部；
+2. value区每SLAB_SIZE字节对应一个描述符，slab登记在其起点所在格子的描述符上。slab互不重叠且不短于一格，
+   每格至多一个slab起点，块所在的slab只可能登记在本格或前一格，释放时按偏移O(1)找到；
+3. memkv_init按boxmalloc的要求把value区向下取整，取整丢掉的尾部由这里直接切成slab，不再浪费；
+4. 每个级别把有空闲块的slab串成双链表，分配取链表头的slab；slab的块全部释放后还给boxmalloc或尾部空闲链表，
+   但每个级别留一个空slab，避免在边界上反复申请释放；
+5. 不在任何slab内的小box（slab申请失败时直接从boxmalloc分配的）释放时返回false，由调用方交给box_free。
+调用方持有magazine_lock。
+*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define SLAB_NONE 0xffff
+#define SLAB_TAIL 0x01 // slab切自value区尾部，释放后回到尾部空闲链表
+
+static inline slab_desc_t *slab_descs(const memkv_meta_t *meta)
+{
+    return (slab_desc_t *)((uint8_t *)meta + meta->slab_offset);
+}
+
+static inline uint64_t slab_base(uint64_t g, const slab_desc_t *d)
+{
+    return g * SLAB_SIZE + d->base - 1;
+}
+
+// 包含offset的slab的描述符序号，不在slab内时返回-1
+static int64_t slab_find(const memkv_meta_t *meta, uint64_t offset)
+{
+    uint64_t g = offset / SLAB_SIZE;
+    const slab_desc_t *descs = slab_descs(meta);
+    for (int i = 0; i < 2 && g < meta->slab_granules; i++, g--)
+    {
+        const slab_desc_t *d = &descs[g];
+        if (d->base && slab_base(g, d) <= offset && offset < slab_base(g, d) + SLAB_SIZE)
+            return (int64_t)g;
+        if (!g)
+            break;
+    }
+    return -1;
+}
+
+size_t slab_area_size(uint64_t value_bytes)
+{
+    uint64_t granules = value_bytes / SLAB_SIZE + 2;
+    return (granules * sizeof(slab_desc_t) + MEMKV_FILTER_BLOCK_SIZE - 1) & ~(size_t)(MEMKV_FILTER_BLOCK_SIZE - 1);
+}
+
+void slab_init(memkv_meta_t *meta, uint64_t offset, uint64_t box_size, uint64_t tail_end)
+{
+    meta->slab_offset = offset;
+    meta->slab_granules = tail_end / SLAB_SIZE + 2;
+    meta->slab_tail = box_size;
+    meta->slab_tail_end = tail_end;
+    meta->slab_tail_next = box_size;
+    meta->slab_tail_free = 0;
+    meta->slab_reserved = 0;
+    memset(slab_descs(meta), 0, meta->slab_granules * sizeof(slab_desc_t));
+    for (int c = 0; c < SLAB_CLASSES; c++)
+    {
+        meta->slab_classes[c] = (slab_class_t){0};
+        meta->slab_classes[c].chunks_per_slab = (uint32_t)(SLAB_SIZE / slab_class_size(c));
+    }
+    LOG("[INFO] slab granules: %lu, tail: %lu bytes", (unsigned long)meta->slab_granules, (unsigned long)(tail_end - box_size));
+}
+
+static void partial_push(memkv_meta_t *meta, slab_class_t *cl, uint64_t g)
+{
+    slab_desc_t *descs = slab_descs(meta);
+    descs[g].prev = 0;
+    descs[g].next = cl->partial;
+    if (cl->partial)
+        descs[cl->partial - 1].prev = (uint32_t)g + 1;
+    cl->partial = (uint32_t)g + 1;
+}
+
+static void partial_remove(memkv_meta_t *meta, slab_class_t *cl, uint64_t g)
+{
+    slab_desc_t *descs = slab_descs(meta);
+    slab_desc_t *d = &descs[g];
+    if (d->prev)
+        descs[d->prev - 1].next = d->next;
+    else
+        cl->partial = d->next;
+    if (d->next)
+        descs[d->next - 1].prev = d->prev;
+    d->next = d->prev = 0;
+}
+
+// 申请一块新的slab，先用尾部，再找boxmalloc
+static int64_t slab_new(memkv_meta_t *meta, int c)
+{
+    slab_desc_t *descs = slab_descs(meta);
+    uint64_t base;
+    uint8_t flags = 0;
+    if (meta->slab_tail_free)
+    {
+        uint64_t g = meta->slab_tail_free - 1;
+        base = slab_base(g, &descs[g]);
+        meta->slab_tail_free = descs[g].next;
+        flags = SLAB_TAIL;
+    }
+    else if (meta->slab_tail_next + SLAB_SIZE <= meta->slab_tail_end)
+    {
+        base = meta->slab_tail_next;
+        meta->slab_tail_next += SLAB_SIZE;
+        flags = SLAB_TAIL;
+    }
+    else
+    {
+        base = box_alloc((void *)meta + meta->valueptr_offset, SLAB_SIZE);
+        if (base == (uint64_t)-1)
+            return -1;
+    }
+    uint64_t g = base / SLAB_SIZE;
+    slab_desc_t *d = &descs[g];
+    *d = (slab_desc_t){
+        .base = (uint16_t)(base - g * SLAB_SIZE + 1),
+        .cls = (uint8_t)c,
+        .flags = flags,
+        .free_head = SLAB_NONE,
+    };
+    meta->slab_classes[c].slabs++;
+    return (int64_t)g;
+}
+
+// 全空的slab还回去
+static void slab_release(memkv_meta_t *meta, uint64_t g)
+{
+    slab_desc_t *d = &slab_descs(meta)[g];
+    meta->slab_classes[d->cls].slabs--;
+    if (d->flags & SLAB_TAIL)
+    {
+        // 描述符保留base，挂到尾部空闲链表上
+        d->cls = 0;
+        d->used = 0;
+        d->bump = 0;
+        d->free_head = SLAB_NONE;
+        d->next = meta->slab_tail_free;
+        meta->slab_tail_free = (uint32_t)g + 1;
+        return;
+    }
+    uint64_t base = slab_base(g, d);
+    *d = (slab_desc_t){0};
+    box_free((void *)meta + meta->valueptr_offset, base);
+}
+
+uint64_t slab_alloc(memkv_meta_t *meta, int c)
+{
+    slab_class_t *cl = &meta->slab_classes[c];
+    int64_t g = cl->partial ? (int64_t)cl->partial - 1 : -1;
+    if (g < 0)
+    {
+        g = slab_new(meta, c);
+        if (g < 0)
+            return (uint64_t)-1;
+        partial_push(meta, cl, (uint64_t)g);
+    }
+    slab_desc_t *d = &slab_descs(meta)[g];
+    uint64_t base = slab_base((uint64_t)g, d);
+    size_t size = slab_class_size(c);
+    uint16_t idx;
+    if (d->free_head != SLAB_NONE)
+    {
+        idx = d->free_head;
+        memcpy(&d->free_head, (uint8_t *)meta + meta->value_offset + base + (size_t)idx * size, sizeof(uint16_t));
+    }
+    else
+        idx = d->bump++;
+    if (++d->used == cl->chunks_per_slab)
+        partial_remove(meta, cl, (uint64_t)g);
+    cl->chunks++;
+    return base + (size_t)idx * size;
+}
+
+bool slab_free(memkv_meta_t *meta, uint64_t offset)
+{
+    int64_t g = slab_find(meta, offset);
+    if (g < 0)
+        return false;
+    slab_desc_t *d = &slab_descs(meta)[g];
+    slab_class_t *cl = &meta->slab_classes[d->cls];
+    size_t size = slab_class_size(d->cls);
+    uint16_t idx = (uint16_t)((offset - slab_base((uint64_t)g, d)) / size);
+    memcpy((uint8_t *)meta + meta->value_offset + offset, &d->free_head, sizeof(uint16_t));
+    d->free_head = idx;
+    if (d->used-- == cl->chunks_per_slab)
+        partial_push(meta, cl, (uint64_t)g);
+    cl->chunks--;
+    // 每个级别留一个空slab
+    if (!d->used && !(cl->partial == (uint64_t)g + 1 && !d->next))
+    {
+        partial_remove(meta, cl, (uint64_t)g);
+        slab_release(meta, (uint64_t)g);
+    }
+    return true;
+}
+
+bool slab_chunk_valid(const memkv_meta_t *meta, uint64_t offset, size_t size)
+{
+    int64_t g = slab_find(meta, offset);
+    if (g < 0)
+        return offset < meta->slab_tail; // 尾部只有slab
+    const slab_desc_t *d = &slab_descs(meta)[g];
+    if (d->cls >= SLAB_CLASSES || slab_class_size(d->cls) != size)
+        return false;
+    uint64_t rel = offset - slab_base((uint64_t)g, d);
+    return rel % size == 0 && rel / size < d->bump;
+}
+
+int memkv_slab_stats(void *pool_data, memkv_slab_stats_t *classes, int max)
+{
+    if (!pool_data || (!classes && max > 0) || max < 0)
+    {
+        LOG("[ERROR] invalid arguments to memkv_slab_stats");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return 0;
+    const memkv_meta_t *meta = pool_data;
+    int n = max < SLAB_CLASSES ? max : SLAB_CLASSES;
+    for (int c = 0; c < n; c++)
+    {
+        const slab_class_t *cl = &meta->slab_classes[c];
+        classes[c] = (memkv_slab_stats_t){
+            .size = (uint32_t)slab_class_size(c),
+            .chunks_per_slab = cl->chunks_per_slab,
+            .slabs = cl->slabs,
+            .chunks = cl->chunks,
+            .values = cl->values,
+            .value_bytes = cl->value_bytes,
+        };
+    }
+    return n;
+}
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+/*
+冷value文件：
+1. 池之外的一个普通文件（可以在磁盘上），头部之后是按2的幂大小级别分配的value记录，
+   记录格式与池内box相同（value_head_t + 数据），空闲记录按级别串成单链表，头部是共享的，分配释放持有magazine_lock；
+2. attach时把文件的绝对路径记在池的meta里，映射是进程本地的：每个进程第一次碰到冷value时按路径打开并映射，
+   登记在进程内的 池基址->映射 表中；只有attach会创建文件，读路径上打开不到就当冷文件不可用，
+   没有写权限时只读映射，只能读冷value，不能分配和释放冷记录；
+3. 节点的box字带BOX_COLD时偏移是冷文件内的偏移。get命中冷value时搬回池内，
+   池满时（MEMKV_EVICT_TIER）或memkv_tier_demote把衰减后访问计数最低的value搬到冷文件。
+*/
+#define TIER_MAGIC "memkvC"
+#define TIER_DATA_OFFSET 4096
+#define TIER_CLASSES 40
+#define TIER_MIN_SHIFT 4 // 最小记录16字节
+#define TIER_MAX_POOLS 64
+
+typedef struct
+{
+    uint8_t magic[6];
+    uint64_t size;
+    uint64_t bump;                 // 从未分配过的区域起点
+    uint64_t heads[TIER_CLASSES];  // 每个级别的空闲记录链表，-1为空
+} tier_file_t;
+
+typedef struct
+{
+    const void *pool;
+    tier_file_t *base;
+    size_t len;
+    bool writable;
+} tier_map_t;
+
+static tier_map_t tier_maps[TIER_MAX_POOLS];
+static pthread_mutex_t tier_maps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline int tier_class(size_t size)
+{
+    int c = 0;
+    while (((size_t)1 << (c + TIER_MIN_SHIFT)) < size)
+        c++;
+    return c;
+}
+
+/*
+映射冷文件：create=true（attach）时不存在就创建，新文件按size建立并初始化头部；
+否则只打开已有的文件，没有写权限时退回只读映射，*writable给出结果
+*/
+static tier_file_t *tier_map_file(const char *path, size_t size, bool create, size_t *len, bool *writable)
+{
+    int fd = open(path, create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    *writable = fd >= 0;
+    if (fd < 0 && !create && (errno == EACCES || errno == EROFS || errno == EPERM))
+        fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG("[ERROR] open tier file %s failed: %s", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        LOG("[ERROR] stat tier file %s failed: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    bool fresh = create && st.st_size == 0;
+    if (fresh)
+    {
+        if (size <= TIER_DATA_OFFSET || ftruncate(fd, (off_t)size) != 0)
+        {
+            LOG("[ERROR] cannot size tier file %s to %zu bytes", path, size);
+            close(fd);
+            return NULL;
+        }
+        st.st_size = (off_t)size;
+    }
+    if ((size_t)st.st_size <= TIER_DATA_OFFSET)
+    {
+        LOG("[ERROR] %s is too small for a memkv tier file", path);
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, *writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        LOG("[ERROR] mmap tier file %s failed: %s", path, strerror(errno));
+        return NULL;
+    }
+    tier_file_t *tf = base;
+    if (fresh)
+    {
+        tf->size = (uint64_t)st.st_size;
+        tf->bump = TIER_DATA_OFFSET;
+        memset(tf->heads, 0xff, sizeof(tf->heads));
+        memcpy(tf->magic, TIER_MAGIC, sizeof(tf->magic));
+    }
+    else if (memcmp(tf->magic, TIER_MAGIC, sizeof(tf->magic)) != 0)
+    {
+        LOG("[ERROR] %s is not a memkv tier file", path);
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    *len = (size_t)st.st_size;
+    return tf;
+}
+
+static tier_map_t *tier_lookup(const void *pool)
+{
+    for (int i = 0; i < TIER_MAX_POOLS; i++)
+    {
+        if (tier_maps[i].pool == pool)
+            return &tier_maps[i];
+    }
+    return NULL;
+}
+
+static tier_map_t *tier_register(const void *pool, tier_file_t *base, size_t len, bool writable)
+{
+    tier_map_t *m = tier_lookup(NULL);
+    if (!m)
+    {
+        LOG("[ERROR] more than %d tiered pools in one process", TIER_MAX_POOLS);
+        return NULL;
+    }
+    m->base = base;
+    m->len = len;
+    m->writable = writable;
+    m->pool = pool;
+    return m;
+}
+
+// 本进程中池对应的冷文件，首次使用时按meta里的路径映射；write=true时只返回可写的映射
+static tier_file_t *tier_file(const memkv_meta_t *meta, bool write)
+{
+    if (!meta->tier_path[0])
+        return NULL;
+    pthread_mutex_lock(&tier_maps_lock);
+    tier_map_t *m = tier_lookup(meta);
+    if (!m)
+    {
+        size_t len = 0;
+        bool writable;
+        tier_file_t *base = tier_map_file(meta->tier_path, 0, false, &len, &writable);
+        if (base && !(m = tier_register(meta, base, len, writable)))
+            munmap(base, len);
+    }
+    pthread_mutex_unlock(&tier_maps_lock);
+    if (m && write && !m->writable)
+    {
+        LOG("[ERROR] tier file %s is mapped read-only in this process", meta->tier_path);
+        return NULL;
+    }
+    return m ? m->base : NULL;
+}
+
+value_head_t *tier_head(const memkv_meta_t *meta, uint64_t offset)
+{
+    tier_file_t *tf = tier_file(meta, false);
+    return tf ? (value_head_t *)((uint8_t *)tf + offset) : NULL;
+}
+
+uint64_t tier_alloc(memkv_meta_t *meta, size_t len)
+{
+    tier_file_t *tf = tier_file(meta, true);
+    if (!tf)
+        return (uint64_t)-1;
+    int c = tier_class(sizeof(value_head_t) + len);
+    if (c >= TIER_CLASSES)
+        return (uint64_t)-1;
+    size_t size = (size_t)1 << (c + TIER_MIN_SHIFT);
+    uint64_t offset = (uint64_t)-1;
+    magazine_lock(meta);
+    if (tf->heads[c] != (uint64_t)-1)
+    {
+        offset = tf->heads[c];
+        memcpy(&tf->heads[c], (uint8_t *)tf + offset, sizeof(uint64_t));
+    }
+    else if (tf->bump + size <= tf->size)
+    {
+        offset = tf->bump;
+        tf->bump += size;
+    }
+    magazine_unlock(meta);
+    if (offset == (uint64_t)-1)
+    {
+        LOG("[WARN] tier file is full, cannot spill %zu bytes", len);
+        return offset;
+    }
+    value_head_t *head = (value_head_t *)((uint8_t *)tf + offset);
+    head->len = 0;
+    head->cap = (uint32_t)(size - sizeof(value_head_t));
+    return offset;
+}
+
+void tier_free(memkv_meta_t *meta, uint64_t offset)
+{
+    tier_file_t *tf = tier_file(meta, true);
+    if (!tf)
+    {
+        LOG("[ERROR] tier file unavailable, leaking cold record %lu", (unsigned long)offset);
+        return;
+    }
+    value_head_t *head = (value_head_t *)((uint8_t *)tf + offset);
+    int c = tier_class(sizeof(value_head_t) + head->cap);
+    magazine_lock(meta);
+    memcpy(head, &tf->heads[c], sizeof(uint64_t));
+    tf->heads[c] = offset;
+    magazine_unlock(meta);
+}
+
+bool tier_valid(const memkv_meta_t *meta, uint64_t offset)
+{
+    tier_file_t *tf = tier_file(meta, false);
+    if (!tf || offset < TIER_DATA_OFFSET || offset + sizeof(value_head_t) > tf->bump)
+        return false;
+    value_head_t *head = (value_head_t *)((uint8_t *)tf + offset);
+    return head->len <= head->cap && offset + sizeof(value_head_t) + head->cap <= tf->bump;
+}
+
+int memkv_tier_attach(void *pool_data, const char *path, size_t size)
+{
+    if (!pool_data || !path || !path[0])
+    {
+        LOG("[ERROR] invalid arguments to memkv_tier_attach");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    if (pool_is_frozen(pool_data))
+        return MEMKV_ERROR_FROZEN;
+    memkv_meta_t *meta = (memkv_meta_t *)pool_data;
+    // 路径记成绝对路径，别的工作目录下的进程也能找到同一个文件；文件还不存在时先按原样比较
+    char abs[PATH_MAX];
+    if (!realpath(path, abs))
+        snprintf(abs, sizeof(abs), "%s", path);
+    // 已有冷value时换文件会丢数据
+    if (meta->stats.cold_values && strcmp(meta->tier_path, abs) != 0)
+    {
+        LOG("[ERROR] pool already spills %lu values to %s", (unsigned long)meta->stats.cold_values, meta->tier_path);
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+
+    int r = MEMKV_SUCCESS;
+    pthread_mutex_lock(&tier_maps_lock);
+    tier_map_t *m = tier_lookup(meta);
+    if (m && m->writable && strcmp(meta->tier_path, abs) == 0)
+        goto done;
+    size_t len = 0;
+    bool writable;
+    tier_file_t *base = tier_map_file(path, size, true, &len, &writable);
+    if (!base)
+    {
+        r = MEMKV_ERROR_OUTOFMEMORY;
+        goto done;
+    }
+    if (!realpath(path, abs))
+    {
+        LOG("[ERROR] cannot resolve tier path %s: %s", path, strerror(errno));
+        abs[0] = '\0';
+    }
+    else if (strlen(abs) >= sizeof(meta->tier_path))
+    {
+        LOG("[ERROR] tier path too long: %s", abs);
+        abs[0] = '\0';
+    }
+    if (!abs[0])
+    {
+        munmap(base, len);
+        r = MEMKV_ERROR_INVALID_ARG;
+        goto done;
+    }
+    if (m)
+    {
+        munmap(m->base, m->len);
+        m->base = base;
+        m->len = len;
+        m->writable = writable;
+    }
+    else if (!tier_register(meta, base, len, writable))
+    {
+        munmap(base, len);
+        r = MEMKV_ERROR_OUTOFMEMORY;
+        goto done;
+    }
+    strcpy(meta->tier_path, abs);
+    LOG("[INFO] tier file %s attached, %zu bytes", abs, len);
+done:
+    pthread_mutex_unlock(&tier_maps_lock);
+    return r;
+}
+
+void memkv_tier_detach(void *pool_data)
+{
+    pthread_mutex_lock(&tier_maps_lock);
+    tier_map_t *m = pool_data ? tier_lookup(pool_data) : NULL;
+    if (m)
+    {
+        munmap(m->base, m->len);
+        memset(m, 0, sizeof(*m));
+    }
+    pthread_mutex_unlock(&tier_maps_lock);
+}
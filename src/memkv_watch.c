@@ -0,0 +1,118 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "memkv_common.h"
+#include "logutil.h"
+
+/*
+watch/notify：
+1. 每个节点头部有一个32位的version，写者发布新value（或删除）之后把它加2，bit0表示有等待者；
+2. 等待者置上bit0后在version上futex等待，写者加2时看到bit0才清掉它并FUTEX_WAKE，没有等待者时只多一次原子加；
+3. 池是多进程共享的mmap，futex不能用PRIVATE标志，内核按物理页定位等待队列；
+4. 前缀watch给节点打KEYNODE_WATCH_PREFIX，池里有这种节点时写者沿key的路径再走一遍，给路径上的前缀节点也加2；
+5. 不存在的key等在最近的已有前缀节点上，新建节点的计数从路径上最深的前缀节点接着走（watch_base），见memkv_watch。
+*/
+#define WATCH_WAITERS 1u
+#define WATCH_STEP 2u
+
+static inline long futex(uint32_t *addr, int op, uint32_t val, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+static void watch_bump(uint32_t *version)
+{
+    uint32_t old = __atomic_fetch_add(version, WATCH_STEP, __ATOMIC_SEQ_CST);
+    if (old & WATCH_WAITERS)
+    {
+        __atomic_fetch_and(version, ~WATCH_WAITERS, __ATOMIC_SEQ_CST);
+        futex(version, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+void watch_notify(memkv_meta_t *meta, key_node_t *node, const void *key_data, size_t key_len)
+{
+    if (node)
+        watch_bump(&node->version);
+    if (!__atomic_load_n(&meta->watch_prefixes, __ATOMIC_RELAXED))
+        return;
+    void *key_start = (void *)meta + meta->key_offset;
+    key_node_t *cur = keynode_at(meta, key_start, 0);
+    for (size_t i = 0;; i++)
+    {
+        if (cur != node && (cur->flags & KEYNODE_WATCH_PREFIX))
+            watch_bump(&cur->version);
+        if (i == key_len)
+            break;
+        uint8_t c = ((const uint8_t *)key_data)[i];
+        if (c >= meta->char_type || cur->child_key_blocks[c] < 0)
+            break;
+        cur = keynode_at(meta, key_start, cur->child_key_blocks[c]);
+    }
+}
+
+uint32_t watch_base(key_node_t *node)
+{
+    return __atomic_load_n(&node->version, __ATOMIC_ACQUIRE) & ~WATCH_WAITERS;
+}
+
+void watch_rebase(uint32_t *version, uint32_t base)
+{
+    uint32_t cur = __atomic_load_n(version, __ATOMIC_ACQUIRE);
+    while ((cur & ~WATCH_WAITERS) != base)
+    {
+        if (__atomic_compare_exchange_n(version, &cur, base, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            if (cur & WATCH_WAITERS)
+                futex(version, FUTEX_WAKE, INT_MAX, NULL);
+            break;
+        }
+    }
+}
+
+static int64_t watch_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int watch_wait(uint32_t *version, uint32_t *seen, int timeout_ms)
+{
+    int64_t deadline = timeout_ms >= 0 ? watch_now_ms() + timeout_ms : 0;
+    for (;;)
+    {
+        uint32_t cur = __atomic_load_n(version, __ATOMIC_ACQUIRE);
+        if ((cur & ~WATCH_WAITERS) != *seen)
+        {
+            *seen = cur & ~WATCH_WAITERS;
+            return MEMKV_SUCCESS;
+        }
+        struct timespec ts, *tsp = NULL;
+        if (timeout_ms >= 0)
+        {
+            int64_t left = deadline - watch_now_ms();
+            if (left <= 0)
+                return MEMKV_ERROR_TIMEOUT;
+            ts.tv_sec = left / 1000;
+            ts.tv_nsec = (left % 1000) * 1000000;
+            tsp = &ts;
+        }
+        // 置上等待者标记，失败说明version变了，重新检查
+        if (!(cur & WATCH_WAITERS) && !__atomic_compare_exchange_n(version, &cur, cur | WATCH_WAITERS, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            continue;
+        if (futex(version, FUTEX_WAIT, cur | WATCH_WAITERS, tsp) != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            LOG("[ERROR] futex wait failed: %s", strerror(errno));
+            return MEMKV_ERROR_UNKNOWN;
+        }
+    }
+}
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <memkv/memkv.h>
+#include <memkv/memkvs.h>
+#include "memkv_hash.h"
+#include "logutil.h"
+
+#define MPOL_DEFAULT 0
+#define MPOL_BIND 2
+#define NUMA_MASK_BITS 1024
+
+/*
+路由用哈希的低32位：过滤器用高32位选block，分片内的key若也按高位聚集，
+每个分片只会用到一部分过滤器block
+*/
+static inline uint32_t shard_of(uint32_t nshards, uint64_t hash)
+{
+    return (uint32_t)(((hash & 0xffffffffULL) * nshards) >> 32);
+}
+
+uint32_t memkvs_shard(const memkvs_t *kvs, const void *key_data, size_t key_len)
+{
+    return shard_of(kvs->nshards, memkv_hash(key_data, key_len));
+}
+
+static inline void *shard_pool(memkvs_t *kvs, const void *key_data, size_t key_len)
+{
+    if (!kvs || !kvs->nshards || !key_data)
+        return NULL;
+    return kvs->pools[memkvs_shard(kvs, key_data, key_len)];
+}
+
+int memkvs_attach(memkvs_t *kvs, void *const *pools, const size_t *pool_lens, uint32_t nshards, const memkv_options_t *init)
+{
+    if (!kvs || !pools || !pool_lens || nshards == 0 || nshards > MEMKVS_MAX_SHARDS)
+    {
+        LOG("[ERROR] invalid arguments to memkvs_attach");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    memset(kvs, 0, sizeof(*kvs));
+    for (uint32_t i = 0; i < nshards; i++)
+    {
+        if (init)
+        {
+            int r = memkv_init_ex(pools[i], pool_lens[i], init);
+            if (r != MEMKV_SUCCESS && r != MEMKV_ERROR_ALREADY_INIT)
+            {
+                LOG("[ERROR] init shard %u failed: %s", i, memkv_strerror(r));
+                return r;
+            }
+        }
+        kvs->pools[i] = pools[i];
+        kvs->pool_lens[i] = pool_lens[i];
+    }
+    kvs->nshards = nshards;
+    return MEMKV_SUCCESS;
+}
+
+// 把[addr, addr+len)的内存策略设为绑定到node；不支持NUMA的系统上只打印警告
+static void numa_bind(void *addr, size_t len, int node)
+{
+    unsigned long mask[NUMA_MASK_BITS / (8 * sizeof(unsigned long))] = {0};
+    if (node < 0 || node >= NUMA_MASK_BITS)
+        return;
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (!addr)
+    {
+        // 映射和预取前先设置当前线程的策略，预取线程继承它
+        if (syscall(SYS_set_mempolicy, MPOL_BIND, mask, NUMA_MASK_BITS) != 0)
+        {
+            LOG("[WARN] set_mempolicy to node %d failed: %s", node, strerror(errno));
+        }
+        return;
+    }
+    // 映射后再给区间设置策略，之后其他进程缺页时也分配在该节点上
+    if (syscall(SYS_mbind, addr, len, MPOL_BIND, mask, NUMA_MASK_BITS, 0) != 0)
+    {
+        LOG("[WARN] mbind shard to node %d failed: %s", node, strerror(errno));
+    }
+}
+
+int memkvs_open(memkvs_t *kvs, const char *path_fmt, uint32_t nshards, const memkvs_options_t *opts)
+{
+    if (!kvs || !path_fmt || !opts || nshards == 0 || nshards > MEMKVS_MAX_SHARDS)
+    {
+        LOG("[ERROR] invalid arguments to memkvs_open");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    void *pools[MEMKVS_MAX_SHARDS];
+    size_t lens[MEMKVS_MAX_SHARDS];
+    int r = MEMKV_SUCCESS;
+    uint32_t mapped = 0;
+    for (; mapped < nshards; mapped++)
+    {
+        char path[4096];
+        snprintf(path, sizeof(path), path_fmt, mapped);
+        int node = opts->numa_nodes > 0 ? (int)(mapped % (uint32_t)opts->numa_nodes) : -1;
+        if (node >= 0)
+            numa_bind(NULL, 0, node);
+        pools[mapped] = memkv_map(path, &opts->map, &lens[mapped]);
+        if (node >= 0)
+        {
+            syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+            if (pools[mapped])
+                numa_bind(pools[mapped], lens[mapped], node);
+        }
+        if (!pools[mapped])
+        {
+            LOG("[ERROR] map shard %s failed", path);
+            r = MEMKV_ERROR_OUTOFMEMORY;
+            break;
+        }
+    }
+    if (r == MEMKV_SUCCESS)
+        r = memkvs_attach(kvs, pools, lens, nshards, &opts->init);
+    if (r != MEMKV_SUCCESS)
+    {
+        for (uint32_t i = 0; i < mapped; i++)
+            memkv_unmap(pools[i], lens[i]);
+        return r;
+    }
+    kvs->mapped = true;
+    return MEMKV_SUCCESS;
+}
+
+void memkvs_close(memkvs_t *kvs)
+{
+    if (!kvs)
+        return;
+    for (uint32_t i = 0; i < kvs->nshards; i++)
+    {
+        memkv_writer_detach(kvs->pools[i]);
+        memkv_tier_detach(kvs->pools[i]);
+        if (kvs->mapped)
+            memkv_unmap(kvs->pools[i], kvs->pool_lens[i]);
+    }
+    memset(kvs, 0, sizeof(*kvs));
+}
+
+int memkvs_set(memkvs_t *kvs, const void *key_data, size_t key_len, const void *value_data, size_t value_len)
+{
+    void *pool = shard_pool(kvs, key_data, key_len);
+    return pool ? memkv_set(pool, key_data, key_len, value_data, value_len) : MEMKV_ERROR_INVALID_ARG;
+}
+
+void* memkvs_malloc(memkvs_t *kvs, const void *key_data, size_t key_len, size_t value_len)
+{
+    void *pool = shard_pool(kvs, key_data, key_len);
+    return pool ? memkv_malloc(pool, key_data, key_len, value_len) : NULL;
+}
+
+void* memkvs_get(memkvs_t *kvs, const void *key_data, size_t key_len)
+{
+    void *pool = shard_pool(kvs, key_data, key_len);
+    return pool ? memkv_get(pool, key_data, key_len) : NULL;
+}
+
+int memkvs_del(memkvs_t *kvs, const void *key_data, size_t key_len)
+{
+    void *pool = shard_pool(kvs, key_data, key_len);
+    return pool ? memkv_del(pool, key_data, key_len) : MEMKV_ERROR_INVALID_ARG;
+}
+
+int memkvs_incr(memkvs_t *kvs, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value)
+{
+    void *pool = shard_pool(kvs, key_data, key_len);
+    return pool ? memkv_incr(pool, key_data, key_len, delta, new_value) : MEMKV_ERROR_INVALID_ARG;
+}
+
+/*
+keys的k路归并：memkv_keys的回调没有用户参数，各分片的结果先经线程局部的收集器
+按 [uint16长度][key字节] 追加到各自的缓冲区（单个分片内已是字典序），再用小顶堆归并
+*/
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    size_t pos; // 归并时的读位置
+    bool failed;
+} keybuf_t;
+
+static __thread keybuf_t *collect_buf;
+
+static void collect_key(const void *key_data, size_t key_len)
+{
+    keybuf_t *b = collect_buf;
+    if (b->failed)
+        return;
+    if (b->len + sizeof(uint16_t) + key_len > b->cap)
+    {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + sizeof(uint16_t) + key_len)
+            cap *= 2;
+        uint8_t *data = realloc(b->data, cap);
+        if (!data)
+        {
+            b->failed = true;
+            return;
+        }
+        b->data = data;
+        b->cap = cap;
+    }
+    uint16_t l = (uint16_t)key_len;
+    memcpy(b->data + b->len, &l, sizeof(l));
+    memcpy(b->data + b->len + sizeof(l), key_data, key_len);
+    b->len += sizeof(l) + key_len;
+}
+
+static inline const uint8_t *keybuf_peek(const keybuf_t *b, size_t *key_len)
+{
+    uint16_t l;
+    memcpy(&l, b->data + b->pos, sizeof(l));
+    *key_len = l;
+    return b->data + b->pos + sizeof(l);
+}
+
+// 字典序，短的前缀在前，与前缀树的深度优先顺序一致
+static bool keybuf_less(const keybuf_t *a, const keybuf_t *b)
+{
+    size_t la, lb;
+    const uint8_t *ka = keybuf_peek(a, &la);
+    const uint8_t *kb = keybuf_peek(b, &lb);
+    int c = memcmp(ka, kb, la < lb ? la : lb);
+    return c < 0 || (c == 0 && la < lb);
+}
+
+static void heap_down(keybuf_t *bufs, uint32_t *heap, uint32_t n, uint32_t i)
+{
+    for (;;)
+    {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && keybuf_less(&bufs[heap[l]], &bufs[heap[m]]))
+            m = l;
+        if (r < n && keybuf_less(&bufs[heap[r]], &bufs[heap[m]]))
+            m = r;
+        if (m == i)
+            return;
+        uint32_t t = heap[i];
+        heap[i] = heap[m];
+        heap[m] = t;
+        i = m;
+    }
+}
+
+int memkvs_keys(memkvs_t *kvs, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len))
+{
+    if (!kvs || !kvs->nshards || !func)
+    {
+        LOG("[ERROR] invalid arguments to memkvs_keys");
+        return MEMKV_ERROR_INVALID_ARG;
+    }
+    keybuf_t *bufs = calloc(kvs->nshards, sizeof(keybuf_t));
+    if (!bufs)
+        return MEMKV_ERROR_OUTOFMEMORY;
+
+    int r = MEMKV_SUCCESS;
+    uint32_t heap[MEMKVS_MAX_SHARDS];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < kvs->nshards; i++)
+    {
+        collect_buf = &bufs[i];
+        memkv_keys(kvs->pools[i], prefix_data, prefix_len, collect_key);
+        if (bufs[i].failed)
+        {
+            LOG("[ERROR] out of memory collecting keys of shard %u", i);
+            r = MEMKV_ERROR_OUTOFMEMORY;
+            goto done;
+        }
+        if (bufs[i].len)
+            heap[n++] = i;
+    }
+    collect_buf = NULL;
+
+    for (uint32_t i = n / 2; i-- > 0;)
+        heap_down(bufs, heap, n, i);
+    while (n)
+    {
+        keybuf_t *b = &bufs[heap[0]];
+        size_t key_len;
+        const uint8_t *key = keybuf_peek(b, &key_len);
+        func(key, key_len);
+        b->pos += sizeof(uint16_t) + key_len;
+        if (b->pos >= b->len)
+            heap[0] = heap[--n];
+        heap_down(bufs, heap, n, 0);
+    }
+
+done:
+    collect_buf = NULL;
+    for (uint32_t i = 0; i < kvs->nshards; i++)
+        free(bufs[i].data);
+    free(bufs);
+    return r;
+}
@@ -67,6 +67,12 @@ int miaobyte_decode(const uint8_t *bytes, char *str, size_t len) {
 int miaobyte_init(void *pool_data,const size_t pool_len,uint8_t keymem,uint8_t valueptrmem,uint8_t valuemem){
     return memkv_init(pool_data,pool_len,48,keymem,valueptrmem,valuemem);
 }
+int miaobyte_init_ex(void *pool_data,const size_t pool_len,memkv_options_t *opts){
+    if (!opts)
+        return MEMKV_ERROR_INVALID_ARG;
+    opts->chartype = 48;
+    return memkv_init_ex(pool_data,pool_len,opts);
+}
 void* miaobyte_malloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len){
     uint8_t *encoded_key = malloc(key_len);
     if (!encoded_key)
@@ -80,6 +86,19 @@ void* miaobyte_malloc(void *pool_data, const void *key_data, size_t key_len,size
     free(encoded_key);
     return ret;
 }
+void* miaobyte_realloc(void *pool_data, const void *key_data, size_t key_len,size_t value_len){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key)
+        return NULL;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { 
+        free(encoded_key); 
+        return NULL;
+    }
+    void* ret = memkv_realloc(pool_data, encoded_key, key_len, value_len);
+    free(encoded_key);
+    return ret;
+}
 int miaobyte_set(void *pool_data, const void *key_data, size_t key_len, const void *value_data, size_t value_len){
     uint8_t *encoded_key = malloc(key_len);
     if (!encoded_key)
@@ -91,6 +110,16 @@ int miaobyte_set(void *pool_data, const void *key_data, size_t key_len, const vo
     return ret;
 }
 
+int miaobyte_commit(void *pool_data, const void *key_data, size_t key_len, memkv_reservation_t *res, size_t value_len){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_commit(pool_data, encoded_key, key_len, res, value_len);
+    free(encoded_key);
+    return ret;
+}
+
 void* miaobyte_get(void *pool_data, const void *key_data, size_t key_len){
     uint8_t *encoded_key = malloc(key_len);
     if (!encoded_key) return NULL;
@@ -103,6 +132,26 @@ void* miaobyte_get(void *pool_data, const void *key_data, size_t key_len){
     return ret;
 }
 
+int miaobyte_find(void *pool_data, const void *key_data, size_t key_len, void **value, size_t *value_len){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    r = memkv_find(pool_data, encoded_key, key_len, value, value_len);
+    free(encoded_key);
+    return r;
+}
+
+int miaobyte_read(void *pool_data, const void *key_data, size_t key_len, void *buf, size_t buf_cap, size_t *value_len){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    r = memkv_read(pool_data, encoded_key, key_len, buf, buf_cap, value_len);
+    free(encoded_key);
+    return r;
+}
+
 int miaobyte_del(void *pool_data, const void *key_data, size_t key_len){
     uint8_t *encoded_key = malloc(key_len);
     if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
@@ -113,6 +162,76 @@ int miaobyte_del(void *pool_data, const void *key_data, size_t key_len){
     return ret;
 }
 
+int miaobyte_batch_set(memkv_batch_t *batch, const void *key_data, size_t key_len, const void *value_data, size_t value_len){
+    uint8_t *encoded_key = malloc(key_len ? key_len : 1);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_batch_set(batch, encoded_key, key_len, value_data, value_len);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_batch_del(memkv_batch_t *batch, const void *key_data, size_t key_len){
+    uint8_t *encoded_key = malloc(key_len ? key_len : 1);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_batch_del(batch, encoded_key, key_len);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_watch(void *pool_data, const void *key_data, size_t key_len, bool prefix, uint32_t *version, int timeout_ms){
+    uint8_t *encoded_key = malloc(key_len ? key_len : 1);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_watch(pool_data, encoded_key, key_len, prefix, version, timeout_ms);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_notify(void *pool_data, const void *key_data, size_t key_len){
+    uint8_t *encoded_key = malloc(key_len ? key_len : 1);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_notify(pool_data, encoded_key, key_len);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_incr(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *new_value){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_incr(pool_data, encoded_key, key_len, delta, new_value);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_fetch_add(void *pool_data, const void *key_data, size_t key_len, int64_t delta, int64_t *old_value){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_fetch_add(pool_data, encoded_key, key_len, delta, old_value);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_cas(void *pool_data, const void *key_data, size_t key_len, int64_t expected, int64_t desired, int64_t *actual){
+    uint8_t *encoded_key = malloc(key_len);
+    if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+    int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+    if (r != 0) { free(encoded_key); return r; }
+    int ret = memkv_cas(pool_data, encoded_key, key_len, expected, desired, actual);
+    free(encoded_key);
+    return ret;
+}
+
 void miaobyte_keys(void *pool_data, const void *prefix_data, size_t prefix_len, void (*func)(const void *key_data, size_t key_len)){
     uint8_t *encoded_prefix = NULL;
     if (prefix_len > 0) {
@@ -123,4 +242,65 @@ void miaobyte_keys(void *pool_data, const void *prefix_data, size_t prefix_len,
     }
     memkv_keys(pool_data, encoded_prefix, prefix_len, func);
     free(encoded_prefix);
-}
\ No newline at end of file
+}
+
+int miaobyte_scan(void *pool_data, const void *prefix_data, size_t prefix_len, const memkv_scan_options_t *opts, memkv_scan_func_t func, void *arg){
+    uint8_t *encoded_prefix = NULL;
+    if (prefix_len > 0) {
+        encoded_prefix = malloc(prefix_len);
+        if (!encoded_prefix) return MEMKV_ERROR_OUTOFMEMORY;
+        int r = miaobyte_encode((const char*)prefix_data, encoded_prefix, prefix_len);
+        if (r != 0) { free(encoded_prefix); return r; }
+    }
+    int ret = memkv_scan(pool_data, encoded_prefix, prefix_len, opts, func, arg);
+    free(encoded_prefix);
+    return ret;
+}
+
+// 编码key后调用有序查找，得到的key仍是编码后的字节
+static int miaobyte_seek(int (*seek)(void *, const void *, size_t, void *, size_t, size_t *, void **), void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value){
+    uint8_t *encoded_key = NULL;
+    if (key_len > 0) {
+        encoded_key = malloc(key_len);
+        if (!encoded_key) return MEMKV_ERROR_OUTOFMEMORY;
+        int r = miaobyte_encode((const char*)key_data, encoded_key, key_len);
+        if (r != 0) { free(encoded_key); return r; }
+    }
+    int ret = seek(pool_data, encoded_key, key_len, key_buf, key_cap, found_len, value);
+    free(encoded_key);
+    return ret;
+}
+
+int miaobyte_lower_bound(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value){
+    return miaobyte_seek(memkv_lower_bound, pool_data, key_data, key_len, key_buf, key_cap, found_len, value);
+}
+
+int miaobyte_successor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value){
+    return miaobyte_seek(memkv_successor, pool_data, key_data, key_len, key_buf, key_cap, found_len, value);
+}
+
+int miaobyte_predecessor(void *pool_data, const void *key_data, size_t key_len, void *key_buf, size_t key_cap, size_t *found_len, void **value){
+    return miaobyte_seek(memkv_predecessor, pool_data, key_data, key_len, key_buf, key_cap, found_len, value);
+}
+
+int miaobyte_range(void *pool_data, const void *start_data, size_t start_len, const void *end_data, size_t end_len, memkv_range_func_t func, void *arg){
+    uint8_t *encoded_start = NULL, *encoded_end = NULL;
+    int ret = MEMKV_ERROR_OUTOFMEMORY;
+    if (start_data && start_len > 0) {
+        encoded_start = malloc(start_len);
+        if (!encoded_start) goto done;
+        ret = miaobyte_encode((const char*)start_data, encoded_start, start_len);
+        if (ret != 0) goto done;
+    }
+    if (end_data) {
+        encoded_end = malloc(end_len ? end_len : 1);
+        if (!encoded_end) { ret = MEMKV_ERROR_OUTOFMEMORY; goto done; }
+        ret = miaobyte_encode((const char*)end_data, encoded_end, end_len);
+        if (ret != 0) goto done;
+    }
+    ret = memkv_range(pool_data, encoded_start, start_data ? start_len : 0, encoded_end, end_len, func, arg);
+done:
+    free(encoded_start);
+    free(encoded_end);
+    return ret;
+}
@@ -7,7 +7,12 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
 #include <unistd.h>
+#include <time.h>
 
 #include <memkv/miaobyte.h>
 #include <memkv/memkv.h>
@@ -33,11 +38,44 @@ static void usage(const char *prog)
             "pool_path may be a tmpfs/shm file (e.g. /dev/shm/kvpool) or a regular file on disk.\n"
             "If the file does not exist, create it and set its size using: truncate -s <size> <pool_path>\n"
             "Commands:\n"
-            "  init <size>[K|M|G] [ratios]   create new pool file (ratios default 3:1:2)\n"
+            "  init <size>[K|M|G] [ratios] [filter_keys] [dedup_values] [compress_min]\n"
+            "                                 create new pool file (ratios default 3:1:2),\n"
+            "                                 filter_keys>0 sizes a negative-lookup filter,\n"
+            "                                 dedup_values>0 shares boxes of identical values,\n"
+            "                                 compress_min>0 compresses values of at least that size\n"
             "  set  <key> <value>   [type]    store value\n"
             "  get  <key>           [type]    fetch value\n"
             "  del  <key>                     delete key\n"
+            "  mset <key> <value> [<key> <value> ...]\n"
+            "                                 store several keys as one atomic batch\n"
+            "  incr <key> [delta]             atomically add delta (default 1) to an i64 value\n"
+            "  cas  <key> <expected> <new>    atomically replace an i64 value if it equals expected\n"
             "  keys [prefix]                  list keys (optionally under prefix)\n"
+            "  count [prefix] [threads]       count keys and value bytes with a parallel scan\n"
+            "  range <start|-> [end|-] [limit] list keys in [start, end) in key order\n"
+            "  seek <ge|gt|lt> <key>          print the first key >= / > key, or the last key < key\n"
+            "  evict <none|lfu|tier> [samples] set eviction policy (lfu = cache mode,\n"
+            "                                 tier = spill cold values to the tier file)\n"
+            "  tier <cold_path> <size>[K|M|G] [max_freq]\n"
+            "                                 attach a disk-backed file for cold values and move\n"
+            "                                 values with access count <= max_freq (default: all) there\n"
+            "  watch <key> [prefix] [timeout_ms]\n"
+            "                                 block until the key (or any key under it with 'prefix')\n"
+            "                                 changes, print the new value; repeats until timeout\n"
+            "  fsck [threads] [repair]        check trie links, value boxes and counters in parallel;\n"
+            "                                 'repair' drops broken subtrees and rewrites counters\n"
+            "                                 (no other writer may use the pool meanwhile)\n"
+            "  stats                          print key/node/value region statistics\n"
+            "  slabs                          print per size class slab occupancy of small values\n"
+            "  probe                          print hot-path latency histograms (MEMKV_PROBE builds)\n"
+            "  top [interval_ms] [rounds]     print the sampled hottest keys and prefixes per depth,\n"
+            "                                 refreshing every interval_ms when given\n"
+            "  top <on [N]|off|reset>         sample 1 in N (default 100) get/set ops, stop sampling,\n"
+            "                                 or clear the collected counts\n"
+            "  freeze <out_path>              write a compact read-only copy of the pool to a new file;\n"
+            "                                 get/keys/stats work on it directly\n"
+            "  serve [socket_path]            map the pool once and execute line commands from stdin,\n"
+            "                                 or from a unix socket when socket_path is given\n"
             "Type flags (choose one for set/get):\n"
             "  -i64 -i32 -u64 -u32 -u8 -s -b\n"
             "Notes:\n"
@@ -88,11 +126,76 @@ static val_type_t parse_type_flag(const char *arg)
     return VT_AUTO;
 }
 
-static void print_value(void *valptr, val_type_t t)
+/* 按类型将文本编码为存储字节；数值写入scratch，字符串直接引用valstr */
+typedef union
+{
+    int64_t i64;
+    int32_t i32;
+    uint64_t u64;
+    uint32_t u32;
+    uint8_t u8;
+} value_scratch_t;
+
+static const void *encode_value(const char *valstr, val_type_t t, value_scratch_t *scratch, size_t *len)
+{
+    switch (t)
+    {
+    case VT_I64:
+        scratch->i64 = strtoll(valstr, NULL, 0);
+        *len = sizeof(scratch->i64);
+        return &scratch->i64;
+    case VT_I32:
+        scratch->i32 = (int32_t)strtol(valstr, NULL, 0);
+        *len = sizeof(scratch->i32);
+        return &scratch->i32;
+    case VT_U64:
+        scratch->u64 = strtoull(valstr, NULL, 0);
+        *len = sizeof(scratch->u64);
+        return &scratch->u64;
+    case VT_U32:
+        scratch->u32 = (uint32_t)strtoul(valstr, NULL, 0);
+        *len = sizeof(scratch->u32);
+        return &scratch->u32;
+    case VT_U8:
+        scratch->u8 = (uint8_t)strtoul(valstr, NULL, 0);
+        *len = sizeof(scratch->u8);
+        return &scratch->u8;
+    case VT_BOOL:
+        scratch->u8 = (strcmp(valstr, "true") == 0 || strcmp(valstr, "1") == 0) ? 1 : 0;
+        *len = 1;
+        return &scratch->u8;
+    case VT_STRING:
+    case VT_AUTO:
+    default:
+        *len = strlen(valstr) + 1;
+        return valstr;
+    }
+}
+
+/* 取value：能零拷贝时直接返回池内指针，压缩的value解压到*owned，调用方free */
+static void *fetch_value(void *pool, const char *key, void **owned)
+{
+    *owned = NULL;
+    void *v = miaobyte_get(pool, key, strlen(key));
+    if (v)
+        return v;
+    size_t len = 0;
+    if (miaobyte_read(pool, key, strlen(key), NULL, 0, &len) != MEMKV_SUCCESS)
+        return NULL;
+    *owned = malloc(len ? len : 1);
+    if (*owned && miaobyte_read(pool, key, strlen(key), *owned, len, &len) != MEMKV_SUCCESS)
+    {
+        free(*owned);
+        *owned = NULL;
+    }
+    return *owned;
+}
+
+static void print_value(FILE *out, void *valptr, val_type_t t)
 {
     if (!valptr)
     {
-        printf("(null)\n");
+        fprintf(out, "(null)\n");
         return;
     }
     switch (t)
@@ -101,65 +204,674 @@ static void print_value(void *valptr, val_type_t t)
     {
         int64_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%lld\n", (long long)v);
+        fprintf(out, "%lld\n", (long long)v);
         break;
     }
     case VT_I32:
     {
         int32_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%d\n", v);
+        fprintf(out, "%d\n", v);
         break;
     }
     case VT_U64:
     {
         uint64_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%llu\n", (unsigned long long)v);
+        fprintf(out, "%llu\n", (unsigned long long)v);
         break;
     }
     case VT_U32:
     {
         uint32_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%u\n", v);
+        fprintf(out, "%u\n", v);
         break;
     }
     case VT_U8:
     {
         uint8_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%u\n", (unsigned)v);
+        fprintf(out, "%u\n", (unsigned)v);
         break;
     }
     case VT_BOOL:
     {
         uint8_t v;
         memcpy(&v, valptr, sizeof(v));
-        printf("%s\n", v ? "true" : "false");
+        fprintf(out, "%s\n", v ? "true" : "false");
         break;
     }
     case VT_STRING:
     case VT_AUTO:
     default:
-        printf("%s\n", (char *)valptr);
+        fprintf(out, "%s\n", (char *)valptr);
         break;
     }
 }
 
-/* decode + print each key */
+/* decode + print each key，输出目标由keys_out指定（serve模式下为批量响应缓冲） */
+static FILE *keys_out;
 static void keys_cb(const void *key_data, size_t key_len)
 {
+    FILE *out = keys_out ? keys_out : stdout;
     char buf[1024];
     if (key_len >= sizeof(buf))
         return;
     int r = miaobyte_decode((const uint8_t *)key_data, buf, key_len);
     if (r != 0)
     {
-        printf("<invalid-key>\n");
+        fprintf(out, "<invalid-key>\n");
+        return;
+    }
+    fprintf(out, "%s\n", buf);
+}
+
+/* range: "-"表示不设该端的边界，limit为0表示不限条数 */
+typedef struct
+{
+    FILE *out;
+    unsigned long limit;
+    unsigned long listed;
+} range_print_t;
+
+static bool range_cb(void *arg, const void *key_data, size_t key_len, void *value_data, size_t value_len)
+{
+    (void)value_data;
+    (void)value_len;
+    range_print_t *rp = arg;
+    FILE *saved = keys_out;
+    keys_out = rp->out;
+    keys_cb(key_data, key_len);
+    keys_out = saved;
+    return !rp->limit || ++rp->listed < rp->limit;
+}
+
+static int print_range(FILE *out, void *pool, const char *start, const char *end, unsigned long limit)
+{
+    range_print_t rp = {out, limit, 0};
+    if (start && strcmp(start, "-") == 0)
+        start = NULL;
+    if (end && strcmp(end, "-") == 0)
+        end = NULL;
+    int r = miaobyte_range(pool, start, start ? strlen(start) : 0, end, end ? strlen(end) : 0, range_cb, &rp);
+    return r < 0 ? r : MEMKV_SUCCESS;
+}
+
+/* count: 每个worker只累加自己的计数，结束后汇总，避免共享计数器上的缓存行争用 */
+#define COUNT_MAX_THREADS 256
+typedef struct
+{
+    uint64_t keys;
+    uint64_t value_bytes;
+    uint8_t pad[48];
+} count_slot_t;
+
+static void count_cb(void *arg, int worker, const void *key_data, size_t key_len, void *value_data, size_t value_len)
+{
+    (void)key_data;
+    (void)key_len;
+    (void)value_data;
+    count_slot_t *slots = arg;
+    slots[worker].keys++;
+    slots[worker].value_bytes += value_len;
+}
+
+static void print_stats(FILE *out, void *pool)
+{
+    memkv_stats_t st;
+    int r = memkv_stats(pool, &st);
+    if (r != MEMKV_SUCCESS)
+    {
+        fprintf(stderr, "stats failed: %s\n", memkv_strerror(r));
+        return;
+    }
+    fprintf(out, " %-22s : %llu\n", "keys", (unsigned long long)st.keys);
+    fprintf(out, " %-22s : %.2f\n", "avg_depth", st.avg_depth);
+    fprintf(out, " %-22s : %llu\n", "nodes", (unsigned long long)st.nodes);
+    fprintf(out, " %-22s : %llu\n", "node_size", (unsigned long long)st.node_size);
+    fprintf(out, " %-22s : %llu\n", "nodes_free", (unsigned long long)st.nodes_free);
+    fprintf(out, " %-22s : %llu\n", "node_capacity", (unsigned long long)st.node_capacity);
+    fprintf(out, " %-22s : %llu\n", "value_region_size", (unsigned long long)st.value_region_size);
+    fprintf(out, " %-22s : %llu\n", "value_boxes", (unsigned long long)st.value_boxes);
+    fprintf(out, " %-22s : %llu\n", "value_alloc_bytes", (unsigned long long)st.value_alloc_bytes);
+    fprintf(out, " %-22s : %llu\n", "value_used_bytes", (unsigned long long)st.value_used_bytes);
+    fprintf(out, " %-22s : %llu\n", "value_largest_free", (unsigned long long)st.value_largest_free);
+    fprintf(out, " %-22s : %.3f\n", "value_internal_frag", st.value_internal_frag);
+    fprintf(out, " %-22s : %.3f\n", "value_external_frag", st.value_external_frag);
+    fprintf(out, " %-22s : %llu\n", "evictions", (unsigned long long)st.evictions);
+    fprintf(out, " %-22s : %llu\n", "filter_bytes", (unsigned long long)st.filter_bytes);
+    fprintf(out, " %-22s : %llu\n", "dedup_boxes", (unsigned long long)st.dedup_boxes);
+    fprintf(out, " %-22s : %llu\n", "dedup_saved_bytes", (unsigned long long)st.dedup_saved_bytes);
+    fprintf(out, " %-22s : %llu\n", "compressed_values", (unsigned long long)st.compressed_values);
+    fprintf(out, " %-22s : %.2f\n", "compress_ratio", st.compress_ratio);
+    fprintf(out, " %-22s : %llu\n", "cold_values", (unsigned long long)st.cold_values);
+    fprintf(out, " %-22s : %llu\n", "cold_bytes", (unsigned long long)st.cold_bytes);
+}
+
+/* 估算每个tick的纳秒数，rdtsc单位时用于换算 */
+static double ns_per_tick(const memkv_probe_t *probe)
+{
+    if (!probe->unit_is_tsc)
+        return 1.0;
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t t0 = __builtin_ia32_rdtsc();
+    struct timespec req = {0, 20 * 1000 * 1000};
+    nanosleep(&req, NULL);
+    uint64_t t1 = __builtin_ia32_rdtsc();
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    return t1 > t0 ? ns / (double)(t1 - t0) : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+static uint64_t probe_percentile(const memkv_probe_op_t *op, double q)
+{
+    uint64_t target = (uint64_t)(op->count * q);
+    uint64_t seen = 0;
+    for (int b = 0; b < MEMKV_PROBE_BUCKETS; b++)
+    {
+        seen += op->hist[b];
+        if (seen > target)
+            return memkv_probe_bucket_floor(b);
+    }
+    return memkv_probe_bucket_floor(MEMKV_PROBE_BUCKETS - 1);
+}
+
+static void print_probe(void *pool)
+{
+    static const char *names[MEMKV_OP_MAX] = {"get", "malloc", "del", "keys"};
+    const memkv_probe_t *probe = memkv_probe(pool);
+    if (!probe || !probe->enabled)
+    {
+        printf("no probe data (build memkv with -DMEMKV_PROBE=ON)\n");
         return;
     }
-    printf("%s\n", buf);
+    double k = ns_per_tick(probe);
+    printf(" %-8s %12s %10s %9s %9s %9s %9s %9s\n", "op", "count", "errors", "depth", "mean_ns", "p50_ns", "p99_ns", "p999_ns");
+    for (int i = 0; i < MEMKV_OP_MAX; i++)
+    {
+        const memkv_probe_op_t *op = &probe->ops[i];
+        if (!op->count)
+            continue;
+        printf(" %-8s %12llu %10llu %9.2f %9.0f %9.0f %9.0f %9.0f\n", names[i],
+               (unsigned long long)op->count, (unsigned long long)op->errors,
+               (double)op->depth_sum / op->count, (double)op->ticks_sum / op->count * k,
+               probe_percentile(op, 0.50) * k, probe_percentile(op, 0.99) * k, probe_percentile(op, 0.999) * k);
+    }
+}
+
+/* 热点key按miaobyte解码，超过MEMKV_HOT_KEY_MAX的key只保留了开头，后面加"..." */
+static void print_hot_entry(const char *label, const memkv_hot_entry_t *e, uint32_t rate)
+{
+    char buf[MEMKV_HOT_KEY_MAX + 1];
+    size_t n = e->len < MEMKV_HOT_KEY_MAX ? e->len : MEMKV_HOT_KEY_MAX;
+    const char *key = miaobyte_decode(e->key, buf, n) == 0 ? buf : "<invalid-key>";
+    printf(" %-6s %12llu  %s%s\n", label, (unsigned long long)e->count * (rate ? rate : 1), key, e->len > n ? "..." : "");
+}
+
+static int print_hot(void *pool)
+{
+    memkv_hot_t hot;
+    int r = memkv_hot_snapshot(pool, &hot);
+    if (r != MEMKV_SUCCESS)
+        return r;
+    printf("sample_rate %u  samples %llu (reads %llu, writes %llu)\n", hot.sample_rate,
+           (unsigned long long)hot.samples, (unsigned long long)hot.reads, (unsigned long long)hot.writes);
+    if (!hot.sample_rate)
+        printf("sampling is off, enable it with: top on <N>\n");
+    printf(" %-6s %12s  %s\n", "rank", "est_ops", "key");
+    for (uint32_t i = 0; i < hot.nkeys; i++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%u", i + 1);
+        print_hot_entry(label, &hot.keys[i], hot.sample_rate);
+    }
+    printf(" %-6s %12s  %s\n", "depth", "est_ops", "prefix");
+    for (int d = 0; d < MEMKV_HOT_DEPTHS; d++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%d", d + 1);
+        for (uint32_t i = 0; i < hot.nprefixes[d]; i++)
+            print_hot_entry(label, &hot.prefixes[d][i], hot.sample_rate);
+    }
+    return MEMKV_SUCCESS;
+}
+
+/* ---------- serve模式：常驻进程，池只映射一次，按行执行文本命令 ----------
+ * 请求：每行一条命令，参数以空白分隔，含空白的参数用双引号包裹
+ *   set <key> <value> [type] | get <key> [type] | del <key> | incr <key> [delta]
+ *   cas <key> <expected> <new> | mset <key> <value> [<key> <value> ...] | keys [prefix] | stats | ping | quit
+ * 响应：+OK | -ERR <msg> | :<int> | $<value> | *<n> 后跟n行
+ * 客户端可以不等响应连续发送多条（pipelining）；每次读到的一批命令执行完后，响应一次性写回 */
+#define SERVE_MAX_ARGS 64
+#define SERVE_BUF_SIZE (64 * 1024)
+#define SERVE_MAX_CLIENTS 64
+
+typedef struct
+{
+    int fd;
+    size_t len;
+    char buf[SERVE_BUF_SIZE];
+} serve_conn_t;
+
+static volatile sig_atomic_t serve_stop;
+
+static void serve_on_signal(int sig)
+{
+    (void)sig;
+    serve_stop = 1;
+}
+
+static int serve_split(char *line, char **args, int max)
+{
+    int n = 0;
+    char *p = line;
+    while (*p)
+    {
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (!*p)
+            break;
+        if (n == max)
+            return -1;
+        if (*p == '"')
+        {
+            args[n++] = ++p;
+            while (*p && *p != '"')
+                p++;
+            if (*p != '"')
+                return -1;
+        }
+        else
+        {
+            args[n++] = p;
+            while (*p && *p != ' ' && *p != '\t')
+                p++;
+        }
+        if (*p)
+            *p++ = '\0';
+    }
+    return n;
+}
+
+/* 多行文本以 *<n> 头加逐行的形式写出 */
+static void serve_block(FILE *out, const char *text, size_t len)
+{
+    size_t lines = 0;
+    for (size_t i = 0; i < len; i++)
+        if (text[i] == '\n')
+            lines++;
+    fprintf(out, "*%zu\n", lines);
+    fwrite(text, 1, len, out);
+}
+
+/* 把若干key/value对作为一个写批次提交，全部生效或全部不生效 */
+static int exec_mset(void *pool, char **pairs, int npairs)
+{
+    memkv_batch_t batch;
+    memkv_batch_init(&batch, pool);
+    int r = MEMKV_SUCCESS;
+    for (int i = 0; i < npairs && r == MEMKV_SUCCESS; i++)
+    {
+        value_scratch_t scratch;
+        size_t len = 0;
+        const void *buf = encode_value(pairs[2 * i + 1], VT_AUTO, &scratch, &len);
+        r = miaobyte_batch_set(&batch, pairs[2 * i], strlen(pairs[2 * i]), buf, len);
+    }
+    if (r == MEMKV_SUCCESS)
+        r = memkv_batch_commit(&batch);
+    memkv_batch_free(&batch);
+    return r;
+}
+
+/* 执行一行命令，响应写入out；返回false表示客户端请求quit */
+static bool serve_exec(void *pool, char *line, FILE *out)
+{
+    char *args[SERVE_MAX_ARGS];
+    int n = serve_split(line, args, SERVE_MAX_ARGS);
+    if (n < 0)
+    {
+        fprintf(out, "-ERR syntax error\n");
+        return true;
+    }
+    if (n == 0)
+        return true;
+
+    const char *cmd = args[0];
+    int r;
+    if (strcmp(cmd, "set") == 0 && n >= 3)
+    {
+        val_type_t t = n >= 4 ? parse_type_flag(args[3]) : VT_AUTO;
+        value_scratch_t scratch;
+        size_t len = 0;
+        const void *buf = encode_value(args[2], t, &scratch, &len);
+        r = miaobyte_set(pool, args[1], strlen(args[1]), buf, len);
+    }
+    else if (strcmp(cmd, "get") == 0 && n >= 2)
+    {
+        val_type_t t = n >= 3 ? parse_type_flag(args[2]) : VT_AUTO;
+        void *owned;
+        void *v = fetch_value(pool, args[1], &owned);
+        if (!v)
+        {
+            fprintf(out, "-ERR not found\n");
+            return true;
+        }
+        fputc('$', out);
+        print_value(out, v, t);
+        free(owned);
+        return true;
+    }
+    else if (strcmp(cmd, "del") == 0 && n >= 2)
+    {
+        r = miaobyte_del(pool, args[1], strlen(args[1]));
+    }
+    else if (strcmp(cmd, "mset") == 0 && n >= 3 && n % 2 == 1)
+    {
+        r = exec_mset(pool, args + 1, (n - 1) / 2);
+    }
+    else if (strcmp(cmd, "incr") == 0 && n >= 2)
+    {
+        int64_t delta = n >= 3 ? strtoll(args[2], NULL, 0) : 1;
+        int64_t v;
+        r = miaobyte_incr(pool, args[1], strlen(args[1]), delta, &v);
+        if (r == MEMKV_SUCCESS)
+        {
+            fprintf(out, ":%lld\n", (long long)v);
+            return true;
+        }
+    }
+    else if (strcmp(cmd, "cas") == 0 && n >= 4)
+    {
+        int64_t actual;
+        r = miaobyte_cas(pool, args[1], strlen(args[1]), strtoll(args[2], NULL, 0),
+                         strtoll(args[3], NULL, 0), &actual);
+        if (r == MEMKV_ERROR_CAS_MISMATCH)
+        {
+            fprintf(out, "-ERR cas mismatch, current value is %lld\n", (long long)actual);
+            return true;
+        }
+    }
+    else if (strcmp(cmd, "keys") == 0 || strcmp(cmd, "stats") == 0 || strcmp(cmd, "range") == 0)
+    {
+        char *text = NULL;
+        size_t len = 0;
+        FILE *tmp = open_memstream(&text, &len);
+        if (!tmp)
+        {
+            fprintf(out, "-ERR out of memory\n");
+            return true;
+        }
+        if (cmd[0] == 'k')
+        {
+            const char *prefix = n >= 2 ? args[1] : "";
+            keys_out = tmp;
+            miaobyte_keys(pool, prefix, strlen(prefix), keys_cb);
+            keys_out = NULL;
+        }
+        else if (cmd[0] == 'r')
+        {
+            r = print_range(tmp, pool, n >= 2 ? args[1] : NULL, n >= 3 ? args[2] : NULL,
+                            n >= 4 ? strtoul(args[3], NULL, 0) : 0);
+            if (r != MEMKV_SUCCESS)
+            {
+                fclose(tmp);
+                free(text);
+                fprintf(out, "-ERR %s\n", memkv_strerror(r));
+                return true;
+            }
+        }
+        else
+        {
+            print_stats(tmp, pool);
+        }
+        fclose(tmp);
+        serve_block(out, text, len);
+        free(text);
+        return true;
+    }
+    else if (strcmp(cmd, "ping") == 0)
+    {
+        fprintf(out, "+PONG\n");
+        return true;
+    }
+    else if (strcmp(cmd, "quit") == 0)
+    {
+        fprintf(out, "+OK\n");
+        return false;
+    }
+    else
+    {
+        fprintf(out, "-ERR unknown command or wrong number of arguments\n");
+        return true;
+    }
+
+    if (r != MEMKV_SUCCESS)
+        fprintf(out, "-ERR %s\n", memkv_strerror(r));
+    else
+        fprintf(out, "+OK\n");
+    return true;
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+    while (len)
+    {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/* 读一次输入，执行其中所有完整的行并把响应批量写到wfd；返回false表示连接应关闭 */
+static bool serve_conn_step(void *pool, serve_conn_t *c, int wfd)
+{
+    ssize_t got = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+    if (got < 0)
+        return errno == EINTR || errno == EAGAIN;
+    bool eof = got == 0;
+    c->len += (size_t)got;
+    if (eof && c->len)
+        c->buf[c->len++] = '\n'; /* 末行没有换行符时也执行 */
+
+    char *resp = NULL;
+    size_t rlen = 0;
+    FILE *out = open_memstream(&resp, &rlen);
+    if (!out)
+        return false;
+    bool quit = false;
+    size_t used = 0;
+    while (!quit)
+    {
+        char *nl = memchr(c->buf + used, '\n', c->len - used);
+        if (!nl)
+            break;
+        *nl = '\0';
+        if (nl > c->buf + used && nl[-1] == '\r')
+            nl[-1] = '\0';
+        quit = !serve_exec(pool, c->buf + used, out);
+        used = (size_t)(nl - c->buf) + 1;
+    }
+    memmove(c->buf, c->buf + used, c->len - used);
+    c->len -= used;
+    if (c->len == sizeof(c->buf) - 1)
+    {
+        fprintf(out, "-ERR line too long\n");
+        quit = true;
+    }
+    fclose(out);
+    int w = write_all(wfd, resp, rlen);
+    free(resp);
+    return w == 0 && !quit && !eof;
+}
+
+static int serve_stdin(void *pool)
+{
+    serve_conn_t *c = calloc(1, sizeof(*c));
+    if (!c)
+        return 1;
+    c->fd = STDIN_FILENO;
+    while (serve_conn_step(pool, c, STDOUT_FILENO))
+        ;
+    free(c);
+    return 0;
+}
+
+static int serve_socket(void *pool, const char *path)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+    unlink(path);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, SERVE_MAX_CLIENTS) != 0)
+    {
+        perror("bind");
+        close(lfd);
+        return 1;
+    }
+
+    struct sigaction sa = {.sa_handler = serve_on_signal};
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "serving on %s\n", path);
+
+    serve_conn_t *conns[SERVE_MAX_CLIENTS] = {0};
+    struct pollfd pfds[SERVE_MAX_CLIENTS + 1];
+    int slot[SERVE_MAX_CLIENTS + 1];
+    while (!serve_stop)
+    {
+        int nfds = 0;
+        pfds[nfds].fd = lfd;
+        pfds[nfds].events = POLLIN;
+        slot[nfds++] = -1;
+        for (int i = 0; i < SERVE_MAX_CLIENTS; i++)
+        {
+            if (!conns[i])
+                continue;
+            pfds[nfds].fd = conns[i]->fd;
+            pfds[nfds].events = POLLIN;
+            slot[nfds++] = i;
+        }
+        if (poll(pfds, (nfds_t)nfds, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        for (int k = 1; k < nfds; k++)
+        {
+            if (!pfds[k].revents)
+                continue;
+            serve_conn_t *c = conns[slot[k]];
+            if (!serve_conn_step(pool, c, c->fd))
+            {
+                close(c->fd);
+                free(c);
+                conns[slot[k]] = NULL;
+            }
+        }
+        if (pfds[0].revents & POLLIN)
+        {
+            int cfd = accept(lfd, NULL, NULL);
+            if (cfd < 0)
+                continue;
+            int i = 0;
+            while (i < SERVE_MAX_CLIENTS && conns[i])
+                i++;
+            serve_conn_t *c = i < SERVE_MAX_CLIENTS ? malloc(sizeof(*c)) : NULL;
+            if (!c)
+            {
+                static const char busy[] = "-ERR too many clients\n";
+                write_all(cfd, busy, sizeof(busy) - 1);
+                close(cfd);
+                continue;
+            }
+            c->fd = cfd;
+            c->len = 0;
+            conns[i] = c;
+        }
+    }
+
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++)
+    {
+        if (conns[i])
+        {
+            close(conns[i]->fd);
+            free(conns[i]);
+        }
+    }
+    close(lfd);
+    unlink(path);
+    return 0;
+}
+
+/* 冻结到新文件：先算出大小，再映射目标文件写入 */
+static int freeze_to(void *pool, const char *out_path)
+{
+    size_t len = 0;
+    int r = memkv_freeze(pool, NULL, 0, &len);
+    if (r != MEMKV_SUCCESS)
+    {
+        fprintf(stderr, "freeze failed: %s\n", memkv_strerror(r));
+        return 1;
+    }
+    int fd = open(out_path, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror("open");
+        return 1;
+    }
+    if (ftruncate(fd, (off_t)len) != 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        unlink(out_path);
+        return 1;
+    }
+    void *dst = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (dst == MAP_FAILED)
+    {
+        perror("mmap");
+        unlink(out_path);
+        return 1;
+    }
+    r = memkv_freeze(pool, dst, len, &len);
+    msync(dst, len, MS_SYNC);
+    munmap(dst, len);
+    if (r != MEMKV_SUCCESS)
+    {
+        fprintf(stderr, "freeze failed: %s\n", memkv_strerror(r));
+        unlink(out_path);
+        return 1;
+    }
+    printf("frozen %lu bytes into %s (%.1f%% of the source pool)\n", (unsigned long)len, out_path,
+           100.0 * (double)len / (double)((memkv_meta_t *)pool)->pool_size);
+    return 0;
 }
 
 static void check_meta(void *pool, size_t filesize)
@@ -181,9 +893,20 @@ static void check_meta(void *pool, size_t filesize)
         printf(" [WARNING] pool_size in meta (%lu) does not match actual file size (%lu)\n",
                (unsigned long)meta->pool_size, (unsigned long)filesize);
     }
-    printf(" %-22s : %lu\n", "key_offset", (unsigned long)meta->key_offset);
-    printf(" %-22s : %lu\n", "valueptr_offset", (unsigned long)meta->valueptr_offset);
-    printf(" %-22s : %lu\n", "value_offset", (unsigned long)meta->value_offset);
+    if (pool_is_frozen(pool))
+    {
+        const memkv_frozen_t *fz = pool;
+        printf(" %-22s : %lu\n", "frozen_nodes", (unsigned long)fz->nodes);
+        printf(" %-22s : %lu\n", "frozen_keys", (unsigned long)fz->keys);
+        printf(" %-22s : %lu\n", "values_offset", (unsigned long)fz->values_offset);
+    }
+    else
+    {
+        printf(" %-22s : %lu\n", "filter_blocks", (unsigned long)meta->filter_blocks);
+        printf(" %-22s : %lu\n", "key_offset", (unsigned long)meta->key_offset);
+        printf(" %-22s : %lu\n", "valueptr_offset", (unsigned long)meta->valueptr_offset);
+        printf(" %-22s : %lu\n", "value_offset", (unsigned long)meta->value_offset);
+    }
 
     for (int i = 0; i < width; ++i)
         putchar('-');
@@ -233,6 +956,16 @@ int main(int argc, char **argv)
             }
         }
 
+        uint64_t filter_keys = 0;
+        if (argc >= 6)
+            filter_keys = strtoull(argv[5], NULL, 0);
+        uint64_t dedup_values = 0;
+        if (argc >= 7)
+            dedup_values = strtoull(argv[6], NULL, 0);
+        uint32_t compress_min = 0;
+        if (argc >= 8)
+            compress_min = (uint32_t)strtoul(argv[7], NULL, 0);
+
         int fd = open(pool_path, O_CREAT | O_EXCL | O_RDWR, 0644);
         if (fd < 0)
         {
@@ -256,7 +989,15 @@ int main(int argc, char **argv)
             return 1;
         }
 
-        int r = miaobyte_init(pool, sz, keymem, valueptrmem, valuemem);
+        memkv_options_t opts = {
+            .keymem = keymem,
+            .valueptrmem = valueptrmem,
+            .valuemem = valuemem,
+            .filter_keys = filter_keys,
+            .dedup_values = dedup_values,
+            .compress_min = compress_min,
+        };
+        int r = miaobyte_init_ex(pool, sz, &opts);
         if (r != MEMKV_SUCCESS)
         {
             fprintf(stderr, "init failed: %s\n", memkv_strerror(r));
@@ -265,47 +1006,35 @@ int main(int argc, char **argv)
             unlink(pool_path);
             return 1;
         }
-        printf("initialized pool '%s' size=%zu ratios=%u:%u:%u char_type=48\n",
-               pool_path, sz, keymem, valueptrmem, valuemem);
+        printf("initialized pool '%s' size=%zu ratios=%u:%u:%u char_type=48 filter_keys=%llu dedup_values=%llu compress_min=%u\n",
+               pool_path, sz, keymem, valueptrmem, valuemem, (unsigned long long)filter_keys, (unsigned long long)dedup_values, compress_min);
         munmap(pool, sz);
         close(fd);
         return 0;
     }
     /* open existing pool file */
-    int fd = open(pool_path, O_RDWR);
-    if (fd < 0)
+    memkv_t kv;
+    int r = memkv_open(&kv, pool_path, 0);
+    if (r != MEMKV_SUCCESS)
     {
-        perror("open");
-        return 1;
-    }
-    struct stat st;
-    if (fstat(fd, &st) != 0)
-    {
-        perror("fstat");
-        close(fd);
-        return 1;
-    }
-    size_t pool_size = (size_t)st.st_size;
-    if (pool_size == 0)
-    {
-        fprintf(stderr, "pool file size is 0\n");
-        close(fd);
+        fprintf(stderr, "open %s failed: %s\n", pool_path, memkv_strerror(r));
         return 1;
     }
+    void *pool = kv.pool;
+    size_t pool_size = kv.pool_len;
 
-    void *pool = mmap(NULL, pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (pool == MAP_FAILED)
+    int retcode = 0;
+
+    /* serve模式下stdout是响应通道，不打印meta */
+    if (strcmp(cmd, "serve") == 0)
     {
-        perror("mmap");
-        close(fd);
-        return 1;
+        retcode = argc >= 4 ? serve_socket(pool, argv[3]) : serve_stdin(pool);
+        goto done;
     }
 
     // perform meta check before executing any command
     check_meta(pool, pool_size);
 
-    int retcode = 0;
-
     if (strcmp(cmd, "set") == 0)
     {
         if (argc < 5)
@@ -319,52 +1048,9 @@ int main(int argc, char **argv)
         val_type_t t = VT_AUTO;
         if (argc >= 6)
             t = parse_type_flag(argv[5]);
-        const void *buf = NULL;
+        value_scratch_t scratch;
         size_t len = 0;
-        int64_t i64;
-        int32_t i32;
-        uint64_t u64;
-        uint32_t u32;
-        uint8_t u8;
-        switch (t)
-        {
-        case VT_I64:
-            i64 = strtoll(valstr, NULL, 0);
-            buf = &i64;
-            len = sizeof(i64);
-            break;
-        case VT_I32:
-            i32 = (int32_t)strtol(valstr, NULL, 0);
-            buf = &i32;
-            len = sizeof(i32);
-            break;
-        case VT_U64:
-            u64 = strtoull(valstr, NULL, 0);
-            buf = &u64;
-            len = sizeof(u64);
-            break;
-        case VT_U32:
-            u32 = (uint32_t)strtoul(valstr, NULL, 0);
-            buf = &u32;
-            len = sizeof(u32);
-            break;
-        case VT_U8:
-            u8 = (uint8_t)strtoul(valstr, NULL, 0);
-            buf = &u8;
-            len = sizeof(u8);
-            break;
-        case VT_BOOL:
-            u8 = (strcmp(valstr, "true") == 0 || strcmp(valstr, "1") == 0) ? 1 : 0;
-            buf = &u8;
-            len = 1;
-            break;
-        case VT_STRING:
-        case VT_AUTO:
-        default:
-            buf = valstr;
-            len = strlen(valstr) + 1;
-            break;
-        }
+        const void *buf = encode_value(valstr, t, &scratch, &len);
         int r = miaobyte_set(pool, key, strlen(key), buf, len);
         if (r != MEMKV_SUCCESS)
         {
@@ -372,6 +1058,21 @@ int main(int argc, char **argv)
             retcode = 1;
         }
     }
+    else if (strcmp(cmd, "mset") == 0)
+    {
+        if (argc < 5 || (argc - 3) % 2)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        int r = exec_mset(pool, argv + 3, (argc - 3) / 2);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "mset failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+    }
     else if (strcmp(cmd, "get") == 0)
     {
         if (argc < 4)
@@ -384,7 +1085,8 @@ int main(int argc, char **argv)
         val_type_t t = VT_AUTO;
         if (argc >= 5)
             t = parse_type_flag(argv[4]);
-        void *v = miaobyte_get(pool, key, strlen(key));
+        void *owned;
+        void *v = fetch_value(pool, key, &owned);
         if (!v)
         {
             fprintf(stderr, "not found\n");
@@ -392,8 +1094,9 @@ int main(int argc, char **argv)
         }
         else
         {
-            print_value(v, t);
+            print_value(stdout, v, t);
         }
+        free(owned);
     }
     else if (strcmp(cmd, "del") == 0)
     {
@@ -411,6 +1114,54 @@ int main(int argc, char **argv)
             retcode = 1;
         }
     }
+    else if (strcmp(cmd, "incr") == 0)
+    {
+        if (argc < 4)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        const char *key = argv[3];
+        int64_t delta = 1;
+        if (argc >= 5)
+            delta = strtoll(argv[4], NULL, 0);
+        int64_t v;
+        int r = miaobyte_incr(pool, key, strlen(key), delta, &v);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "incr failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+        else
+        {
+            printf("%lld\n", (long long)v);
+        }
+    }
+    else if (strcmp(cmd, "cas") == 0)
+    {
+        if (argc < 6)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        const char *key = argv[3];
+        int64_t expected = strtoll(argv[4], NULL, 0);
+        int64_t desired = strtoll(argv[5], NULL, 0);
+        int64_t actual;
+        int r = miaobyte_cas(pool, key, strlen(key), expected, desired, &actual);
+        if (r == MEMKV_ERROR_CAS_MISMATCH)
+        {
+            fprintf(stderr, "cas failed: current value is %lld\n", (long long)actual);
+            retcode = 1;
+        }
+        else if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "cas failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+    }
     else if (strcmp(cmd, "keys") == 0)
     {
         const char *prefix = NULL;
@@ -427,6 +1178,275 @@ int main(int argc, char **argv)
         }
         miaobyte_keys(pool, prefix, plen, keys_cb);
     }
+    else if (strcmp(cmd, "freeze") == 0)
+    {
+        if (argc < 4)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        retcode = freeze_to(pool, argv[3]);
+    }
+    else if (strcmp(cmd, "range") == 0)
+    {
+        int r = print_range(stdout, pool, argc >= 4 ? argv[3] : NULL, argc >= 5 ? argv[4] : NULL,
+                            argc >= 6 ? strtoul(argv[5], NULL, 0) : 0);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "range failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+    }
+    else if (strcmp(cmd, "seek") == 0)
+    {
+        if (argc < 5)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        int (*seek)(void *, const void *, size_t, void *, size_t, size_t *, void **);
+        if (strcmp(argv[3], "ge") == 0)
+            seek = miaobyte_lower_bound;
+        else if (strcmp(argv[3], "gt") == 0)
+            seek = miaobyte_successor;
+        else if (strcmp(argv[3], "lt") == 0)
+            seek = miaobyte_predecessor;
+        else
+        {
+            fprintf(stderr, "unknown seek mode: %s\n", argv[3]);
+            retcode = 1;
+            goto done;
+        }
+        uint8_t key[1024];
+        size_t key_len;
+        int r = seek(pool, argv[4], strlen(argv[4]), key, sizeof(key), &key_len, NULL);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "seek failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+            goto done;
+        }
+        keys_cb(key, key_len);
+    }
+    else if (strcmp(cmd, "count") == 0)
+    {
+        const char *prefix = argc >= 4 ? argv[3] : "";
+        memkv_scan_options_t opts = {0};
+        if (argc >= 5)
+            opts.threads = atoi(argv[4]);
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        if (opts.threads <= 0)
+            opts.threads = ncpu > 0 ? (int)ncpu : 1;
+        if (opts.threads > COUNT_MAX_THREADS)
+            opts.threads = COUNT_MAX_THREADS;
+        static count_slot_t slots[COUNT_MAX_THREADS];
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int r = miaobyte_scan(pool, prefix, strlen(prefix), &opts, count_cb, slots);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "count failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+            goto done;
+        }
+        uint64_t keys = 0, bytes = 0;
+        for (int i = 0; i < opts.threads; i++)
+        {
+            keys += slots[i].keys;
+            bytes += slots[i].value_bytes;
+        }
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        printf("keys %llu\nvalue_bytes %llu\nthreads %d\nelapsed_ms %.3f\n",
+               (unsigned long long)keys, (unsigned long long)bytes, opts.threads, ms);
+    }
+    else if (strcmp(cmd, "stats") == 0)
+    {
+        print_stats(stdout, pool);
+    }
+    else if (strcmp(cmd, "slabs") == 0)
+    {
+        memkv_slab_stats_t classes[MEMKV_SLAB_CLASSES];
+        int n = memkv_slab_stats(pool, classes, MEMKV_SLAB_CLASSES);
+        if (n < 0)
+        {
+            fprintf(stderr, "slabs failed: %s\n", memkv_strerror(n));
+            retcode = 1;
+            goto done;
+        }
+        printf(" %6s %6s %8s %10s %10s %12s %7s\n", "size", "per", "slabs", "chunks", "values", "value_bytes", "waste");
+        for (int i = 0; i < n; i++)
+        {
+            const memkv_slab_stats_t *c = &classes[i];
+            if (!c->slabs && !c->values)
+                continue;
+            // 内部碎片：被占用的块里头部之外没有用上的字节
+            uint64_t held = c->values * c->size;
+            printf(" %6u %6u %8llu %10llu %10llu %12llu %6.1f%%\n", c->size, c->chunks_per_slab, (unsigned long long)c->slabs,
+                   (unsigned long long)c->chunks, (unsigned long long)c->values, (unsigned long long)c->value_bytes,
+                   held ? 100.0 * (held - c->values * 8 - c->value_bytes) / held : 0.0);
+        }
+    }
+    else if (strcmp(cmd, "probe") == 0)
+    {
+        print_probe(pool);
+    }
+    else if (strcmp(cmd, "top") == 0)
+    {
+        int r = MEMKV_SUCCESS;
+        if (argc >= 4 && strcmp(argv[3], "on") == 0)
+            r = memkv_hot_enable(pool, argc >= 5 ? (uint32_t)strtoul(argv[4], NULL, 0) : 100);
+        else if (argc >= 4 && strcmp(argv[3], "off") == 0)
+            r = memkv_hot_enable(pool, 0);
+        else if (argc >= 4 && strcmp(argv[3], "reset") == 0)
+            r = memkv_hot_reset(pool);
+        else
+        {
+            // 不给间隔时只打印一次；rounds为0表示一直刷新到被中断
+            long interval_ms = argc >= 4 ? atol(argv[3]) : 0;
+            long rounds = argc >= 5 ? atol(argv[4]) : 0;
+            bool tty = isatty(STDOUT_FILENO);
+            for (long i = 0;; i++)
+            {
+                if (interval_ms > 0 && tty)
+                    printf("\033[H\033[J");
+                r = print_hot(pool);
+                fflush(stdout);
+                if (r != MEMKV_SUCCESS || interval_ms <= 0 || (rounds > 0 && i + 1 >= rounds))
+                    break;
+                struct timespec ts = {interval_ms / 1000, (interval_ms % 1000) * 1000000};
+                nanosleep(&ts, NULL);
+            }
+        }
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "top failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+    }
+    else if (strcmp(cmd, "evict") == 0)
+    {
+        if (argc < 4)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        memkv_evict_policy_t policy;
+        if (strcmp(argv[3], "none") == 0)
+            policy = MEMKV_EVICT_NONE;
+        else if (strcmp(argv[3], "lfu") == 0)
+            policy = MEMKV_EVICT_LFU;
+        else if (strcmp(argv[3], "tier") == 0)
+            policy = MEMKV_EVICT_TIER;
+        else
+        {
+            fprintf(stderr, "unknown evict policy: %s\n", argv[3]);
+            retcode = 1;
+            goto done;
+        }
+        uint8_t samples = 0;
+        if (argc >= 5)
+            samples = (uint8_t)strtoul(argv[4], NULL, 0);
+        int r = memkv_set_evict(pool, policy, samples);
+        if (r != MEMKV_SUCCESS)
+        {
+            fprintf(stderr, "evict failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+    }
+    else if (strcmp(cmd, "watch") == 0)
+    {
+        if (argc < 4)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        const char *key = argv[3];
+        bool prefix = argc >= 5 && strcmp(argv[4], "prefix") == 0;
+        int timeout_ms = argc >= (prefix ? 6 : 5) ? atoi(argv[prefix ? 5 : 4]) : -1;
+        uint32_t version = 0;
+        miaobyte_watch(pool, key, strlen(key), prefix, &version, 0);
+        for (;;)
+        {
+            int r = miaobyte_watch(pool, key, strlen(key), prefix, &version, timeout_ms);
+            if (r == MEMKV_ERROR_TIMEOUT)
+                break;
+            if (r != MEMKV_SUCCESS)
+            {
+                fprintf(stderr, "watch failed: %s\n", memkv_strerror(r));
+                retcode = 1;
+                break;
+            }
+            void *owned;
+            void *v = prefix ? NULL : fetch_value(pool, key, &owned);
+            printf("[%u] %s", version, key);
+            if (v)
+            {
+                printf(" = ");
+                print_value(stdout, v, VT_AUTO);
+                free(owned);
+            }
+            else
+            {
+                printf(prefix ? " changed\n" : " deleted\n");
+            }
+            fflush(stdout);
+        }
+    }
+    else if (strcmp(cmd, "fsck") == 0)
+    {
+        memkv_check_options_t copts = {0};
+        for (int i = 3; i < argc; i++)
+        {
+            if (strcmp(argv[i], "repair") == 0)
+                copts.repair = true;
+            else
+                copts.threads = atoi(argv[i]);
+        }
+        memkv_check_report_t rep;
+        int r = memkv_check(pool, &copts, &rep);
+        if (r != MEMKV_SUCCESS && r != MEMKV_ERROR_CORRUPT)
+        {
+            fprintf(stderr, "fsck failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+            goto done;
+        }
+        printf("nodes %lu, keys %lu, value boxes %lu, dedup boxes %lu\n", (unsigned long)rep.nodes, (unsigned long)rep.keys,
+               (unsigned long)rep.value_boxes, (unsigned long)rep.dedup_boxes);
+        printf("bad links %lu, shared links %lu, bad values %lu, overlapping boxes %lu, dedup mismatches %lu, counter mismatches %lu\n",
+               (unsigned long)rep.bad_links, (unsigned long)rep.shared_links, (unsigned long)rep.bad_values, (unsigned long)rep.overlapping_boxes,
+               (unsigned long)rep.dedup_mismatches, (unsigned long)rep.counter_mismatches);
+        if (copts.repair)
+            printf("repaired: dropped %lu subtrees, %lu keys\n", (unsigned long)rep.dropped_subtrees, (unsigned long)rep.dropped_keys);
+        printf("%s\n", rep.errors == 0 ? "clean" : copts.repair ? "repaired" : "CORRUPT");
+        retcode = r == MEMKV_SUCCESS ? 0 : 2;
+    }
+    else if (strcmp(cmd, "tier") == 0)
+    {
+        if (argc < 5)
+        {
+            usage(argv[0]);
+            retcode = 1;
+            goto done;
+        }
+        uint8_t max_freq = argc >= 6 ? (uint8_t)strtoul(argv[5], NULL, 0) : UINT8_MAX;
+        int r = memkv_tier_attach(pool, argv[3], parse_size_arg(argv[4]));
+        if (r == MEMKV_SUCCESS)
+            r = memkv_tier_demote(pool, max_freq, 0);
+        if (r < 0)
+        {
+            fprintf(stderr, "tier failed: %s\n", memkv_strerror(r));
+            retcode = 1;
+        }
+        else
+        {
+            printf("moved %d values to %s\n", r, argv[3]);
+        }
+    }
     else
     {
         fprintf(stderr, "unknown cmd: %s\n", cmd);
@@ -435,7 +1455,7 @@ int main(int argc, char **argv)
     }
 
 done:
-    munmap(pool, pool_size);
-    close(fd);
+    memkv_probe_flush();
+    memkv_close(&kv);
     return retcode;
 }
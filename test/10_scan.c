@@ -0,0 +1,108 @@
+#define POOL_SIZE (8 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NKEYS 1000
+#define NTHREADS 4
+
+static char keys[NKEYS + 1][8];
+static int nkeys;
+static int listed;
+static int mismatched;
+static int64_t sum;
+static int workers_seen[NTHREADS];
+
+static void collect_key(const void *key_data, size_t key_len) {
+    memcpy(keys[nkeys], key_data, key_len);
+    keys[nkeys++][key_len] = 0;
+}
+
+// 有序扫描的输出应与memkv_keys逐个一致，且回调都在worker 0
+static void check_ordered(void *arg, int worker, const void *key_data, size_t key_len, void *value_data, size_t value_len) {
+    (void)arg;
+    (void)value_data;
+    (void)value_len;
+    if (worker != 0 || listed >= nkeys || strlen(keys[listed]) != key_len || memcmp(keys[listed], key_data, key_len) != 0)
+        mismatched++;
+    listed++;
+}
+
+static void count_value(void *arg, int worker, const void *key_data, size_t key_len, void *value_data, size_t value_len) {
+    (void)arg;
+    (void)key_data;
+    (void)key_len;
+    int v;
+    if (value_len != sizeof(v)) {
+        __atomic_add_fetch(&mismatched, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    memcpy(&v, value_data, sizeof(v));
+    __atomic_add_fetch(&sum, v, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&listed, 1, __ATOMIC_RELAXED);
+    if (worker >= 0 && worker < NTHREADS)
+        __atomic_store_n(&workers_seen[worker], 1, __ATOMIC_RELAXED);
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    memkv_options_t opts = {.chartype = 256, .keymem = 4, .valueptrmem = 1, .valuemem = 2};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    char key[16];
+    int64_t expect = 0;
+    for (int i = 0; i < NKEYS; i++) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        if (memkv_set(pool, key, strlen(key), &i, sizeof(i)) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+        expect += i;
+    }
+    // 前缀自身也是key
+    int k = NKEYS;
+    memkv_set(pool, "k1", 2, &k, sizeof(k));
+    expect += k;
+
+    // 无序并行扫描：数量与value之和正确
+    memkv_scan_options_t scan = {.threads = NTHREADS};
+    if (memkv_scan(pool, NULL, 0, &scan, count_value, NULL) != MEMKV_SUCCESS || listed != NKEYS + 1 || sum != expect || mismatched) {
+        LOG("[ERROR] unordered scan got %d keys sum %lld, expected %d sum %lld", listed, (long long)sum, NKEYS + 1, (long long)expect);
+        return -1;
+    }
+    int used = 0;
+    for (int i = 0; i < NTHREADS; i++)
+        used += workers_seen[i];
+    LOG("[INFO] unordered scan used %d workers", used);
+
+    // 有序扫描与memkv_keys顺序一致，带前缀和不带前缀
+    const char *prefixes[] = {"", "k1", "k99"};
+    for (int p = 0; p < 3; p++) {
+        size_t plen = strlen(prefixes[p]);
+        nkeys = listed = mismatched = 0;
+        memkv_keys(pool, prefixes[p], plen, collect_key);
+        scan = (memkv_scan_options_t){.threads = NTHREADS, .ordered = true};
+        if (memkv_scan(pool, prefixes[p], plen, &scan, check_ordered, NULL) != MEMKV_SUCCESS || listed != nkeys || mismatched) {
+            LOG("[ERROR] ordered scan of \"%s\" listed %d keys, %d mismatched, expected %d", prefixes[p], listed, mismatched, nkeys);
+            return -1;
+        }
+    }
+    if (nkeys != 10) {
+        LOG("[ERROR] prefix k99 expected 10 keys, got %d", nkeys);
+        return -1;
+    }
+
+    // 不存在的前缀不回调
+    listed = 0;
+    if (memkv_scan(pool, "x", 1, NULL, count_value, NULL) != MEMKV_SUCCESS || listed != 0) {
+        LOG("[ERROR] scan of missing prefix listed %d keys", listed);
+        return -1;
+    }
+    LOG("[INFO] scan test passed");
+    return 0;
+}
@@ -0,0 +1,152 @@
+#define POOL_SIZE (4 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define CHARTYPE 16
+#define NKEYS 400
+#define NPROBES 2000
+#define MAXLEN 5
+
+typedef struct {
+    uint8_t key[MAXLEN];
+    size_t len;
+} key_t_;
+
+// memkv_keys按字典序给出全部key，作为对照
+static key_t_ sorted[NKEYS];
+static int nsorted;
+
+static void collect_key(const void *key_data, size_t key_len) {
+    memcpy(sorted[nsorted].key, key_data, key_len);
+    sorted[nsorted++].len = key_len;
+}
+
+static int key_cmp(const uint8_t *a, size_t alen, const uint8_t *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : (alen < blen ? -1 : alen > blen);
+}
+
+static void random_key(uint8_t *key, size_t *len, int maxc) {
+    *len = 1 + rand() % MAXLEN;
+    for (size_t i = 0; i < *len; i++)
+        key[i] = (uint8_t)(rand() % maxc);
+}
+
+// 暴力求解：mode 0为>=，1为>，2为<
+static int expected_index(const uint8_t *key, size_t len, int mode) {
+    if (mode == 2) {
+        for (int i = nsorted - 1; i >= 0; i--)
+            if (key_cmp(sorted[i].key, sorted[i].len, key, len) < 0)
+                return i;
+        return -1;
+    }
+    for (int i = 0; i < nsorted; i++) {
+        int c = key_cmp(sorted[i].key, sorted[i].len, key, len);
+        if (c > 0 || (c == 0 && mode == 0))
+            return i;
+    }
+    return -1;
+}
+
+static int range_pos;
+static int range_seen;
+static int range_limit;
+static int range_bad;
+
+static bool check_range(void *arg, const void *key_data, size_t key_len, void *value_data, size_t value_len) {
+    (void)arg;
+    (void)value_data;
+    (void)value_len;
+    int i = range_pos++;
+    if (i >= nsorted || sorted[i].len != key_len || memcmp(sorted[i].key, key_data, key_len) != 0)
+        range_bad++;
+    return ++range_seen < range_limit;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    if (memkv_init(pool, sizeof(pool), CHARTYPE, 3, 1, 2) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    srand(12345);
+    for (int i = 0; i < NKEYS; i++) {
+        uint8_t key[MAXLEN];
+        size_t len;
+        random_key(key, &len, 6);
+        memkv_set(pool, key, len, &i, sizeof(i));
+    }
+    memkv_keys(pool, NULL, 0, collect_key);
+
+    // 探测key含不存在的字符和超出char_type的字符
+    static int (*const seeks[3])(void *, const void *, size_t, void *, size_t, size_t *, void **) = {
+        memkv_lower_bound, memkv_successor, memkv_predecessor};
+    for (int p = 0; p < NPROBES; p++) {
+        uint8_t probe[MAXLEN];
+        size_t plen;
+        random_key(probe, &plen, 7);
+        if (p % 50 == 0)
+            probe[plen - 1] = CHARTYPE + 3;
+        for (int mode = 0; mode < 3; mode++) {
+            uint8_t found[16];
+            size_t flen = 0;
+            void *value = NULL;
+            int r = seeks[mode](pool, probe, plen, found, sizeof(found), &flen, &value);
+            int e = expected_index(probe, plen, mode);
+            if (e < 0 ? r != MEMKV_ERROR_KEY_NOT_FOUND
+                      : r != MEMKV_SUCCESS || flen != sorted[e].len || memcmp(found, sorted[e].key, flen) != 0 ||
+                        value != memkv_get(pool, sorted[e].key, sorted[e].len)) {
+                LOG("[ERROR] seek mode %d probe %d mismatched (r=%d, expected index %d)", mode, p, r, e);
+                return -1;
+            }
+        }
+    }
+
+    // 空key：lower_bound是最小的key，predecessor不存在
+    size_t flen;
+    uint8_t found[16];
+    if (memkv_lower_bound(pool, NULL, 0, found, sizeof(found), &flen, NULL) != MEMKV_SUCCESS ||
+        flen != sorted[0].len || memcmp(found, sorted[0].key, flen) != 0 ||
+        memkv_predecessor(pool, NULL, 0, found, sizeof(found), &flen, NULL) != MEMKV_ERROR_KEY_NOT_FOUND) {
+        LOG("[ERROR] empty key lookups mismatched");
+        return -1;
+    }
+
+    // 范围[A, B)与提前结束
+    for (int p = 0; p < 200; p++) {
+        uint8_t a[MAXLEN], b[MAXLEN];
+        size_t alen, blen;
+        random_key(a, &alen, 6);
+        random_key(b, &blen, 6);
+        int lo = expected_index(a, alen, 0);
+        int hi = expected_index(b, blen, 0);
+        if (lo < 0)
+            lo = nsorted;
+        if (hi < 0)
+            hi = nsorted;
+        int expect = hi > lo ? hi - lo : 0;
+        range_limit = p % 3 == 0 ? 3 : NKEYS + 1;
+        if (expect > range_limit)
+            expect = range_limit;
+        range_pos = lo;
+        range_bad = range_seen = 0;
+        int n = memkv_range(pool, a, alen, b, blen, check_range, NULL);
+        if (n != expect || range_bad) {
+            LOG("[ERROR] range %d returned %d keys, expected %d, %d mismatched", p, n, expect, range_bad);
+            return -1;
+        }
+    }
+    range_pos = range_seen = 0;
+    range_limit = NKEYS + 1;
+    if (memkv_range(pool, NULL, 0, NULL, 0, check_range, NULL) != nsorted || range_bad) {
+        LOG("[ERROR] unbounded range mismatched");
+        return -1;
+    }
+    LOG("[INFO] range test passed, %d keys", nsorted);
+    return 0;
+}
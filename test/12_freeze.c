@@ -0,0 +1,105 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NKEYS 3000
+
+// 两次keys的输出逐个比较
+static char listed[NKEYS + 1][24];
+static int nlisted;
+static int compared;
+static int mismatched;
+
+static void collect_key(const void *key_data, size_t key_len) {
+    memcpy(listed[nlisted], key_data, key_len);
+    listed[nlisted++][key_len] = 0;
+}
+
+static void compare_key(const void *key_data, size_t key_len) {
+    if (compared >= nlisted || strlen(listed[compared]) != key_len || memcmp(listed[compared], key_data, key_len) != 0)
+        mismatched++;
+    compared++;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    static uint8_t frozen[POOL_SIZE];
+    if (memkv_init(pool, sizeof(pool), 256, 3, 1, 2) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    char key[24], value[64];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "route:%d:%x", i % 37, i * 2654435761u);
+        int vlen = snprintf(value, sizeof(value), "v%0*d", 1 + i % 40, i);
+        memkv_set(pool, key, n, value, vlen + 1);
+    }
+    // 前缀本身也是key，且有删除后留下的分支
+    memkv_set(pool, "route:1", 7, "prefix", 7);
+    memkv_del(pool, "route:2:0", 9);
+
+    size_t need = 0;
+    if (memkv_freeze(pool, NULL, 0, &need) != MEMKV_SUCCESS || need == 0 || need > sizeof(frozen)) {
+        LOG("[ERROR] memkv_freeze size query failed: %zu", need);
+        return -1;
+    }
+    size_t len = 0;
+    if (memkv_freeze(pool, frozen, need - 1, &len) != MEMKV_ERROR_OUTOFMEMORY ||
+        memkv_freeze(pool, frozen, need, &len) != MEMKV_SUCCESS || len != need) {
+        LOG("[ERROR] memkv_freeze failed");
+        return -1;
+    }
+    memkv_stats_t before, after;
+    memkv_stats(pool, &before);
+    memkv_stats(frozen, &after);
+    uint64_t mutable_bytes = before.nodes * before.node_size + before.value_alloc_bytes;
+    LOG("[INFO] frozen %zu bytes, mutable nodes+values %lu bytes", len, (unsigned long)mutable_bytes);
+    if (after.keys != before.keys || after.value_used_bytes != before.value_used_bytes || len * 3 > mutable_bytes) {
+        LOG("[ERROR] frozen stats mismatch: keys %lu/%lu, bytes %zu", (unsigned long)after.keys, (unsigned long)before.keys, len);
+        return -1;
+    }
+
+    // 每个key的value一致，不存在的key仍然找不到
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "route:%d:%x", i % 37, i * 2654435761u);
+        char *a = memkv_get(pool, key, n);
+        char *b = memkv_get(frozen, key, n);
+        if ((a == NULL) != (b == NULL) || (a && strcmp(a, b) != 0)) {
+            LOG("[ERROR] frozen get mismatch for %s", key);
+            return -1;
+        }
+    }
+    if (memkv_get(frozen, "route:2:0", 9) || memkv_get(frozen, "route:", 6) || memkv_get(frozen, "zzz", 3) ||
+        !memkv_get(frozen, "route:1", 7) || strcmp(memkv_get(frozen, "route:1", 7), "prefix") != 0) {
+        LOG("[ERROR] frozen get of missing or prefix keys is wrong");
+        return -1;
+    }
+
+    // keys的顺序与可变池一致，带前缀和不带前缀
+    const char *prefixes[] = {"", "route:1", "route:36:", "nothing"};
+    for (int p = 0; p < 4; p++) {
+        nlisted = compared = mismatched = 0;
+        memkv_keys(pool, prefixes[p], strlen(prefixes[p]), collect_key);
+        memkv_keys(frozen, prefixes[p], strlen(prefixes[p]), compare_key);
+        if (compared != nlisted || mismatched) {
+            LOG("[ERROR] frozen keys \"%s\" listed %d of %d, %d mismatched", prefixes[p], compared, nlisted, mismatched);
+            return -1;
+        }
+    }
+
+    // 写操作被拒绝，也不能重新初始化
+    int64_t v;
+    if (memkv_set(frozen, "a", 1, "b", 2) != MEMKV_ERROR_FROZEN || memkv_malloc(frozen, "a", 1, 4) ||
+        memkv_del(frozen, "route:1", 7) != MEMKV_ERROR_FROZEN || memkv_incr(frozen, "n", 1, 1, &v) != MEMKV_ERROR_FROZEN ||
+        memkv_init(frozen, sizeof(frozen), 256, 3, 1, 2) != MEMKV_ERROR_ALREADY_INIT) {
+        LOG("[ERROR] frozen pool accepted a write");
+        return -1;
+    }
+    LOG("[INFO] freeze test passed");
+    return 0;
+}
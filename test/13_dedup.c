@@ -0,0 +1,128 @@
+#define POOL_SIZE (8 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NKEYS 1000
+
+static const char shared_value[] = "application/json; charset=utf-8";
+
+// 并发读：key在共享的明文box和共享的压缩box之间来回切换，读者每次都必须读到完整的其中一个
+static uint8_t swap_pool[1 << 20];
+static char packed_value[512];
+static volatile bool swap_done;
+static long swap_bad;
+
+static void *swap_reader(void *arg)
+{
+    (void)arg;
+    static char buf[sizeof(packed_value)];
+    while (!swap_done) {
+        size_t len = 0;
+        int r = memkv_read(swap_pool, "k", 1, buf, sizeof(buf), &len);
+        if (r != MEMKV_SUCCESS ||
+            !((len == sizeof(shared_value) && memcmp(buf, shared_value, len) == 0) ||
+              (len == sizeof(packed_value) && memcmp(buf, packed_value, len) == 0)))
+            swap_bad++;
+    }
+    return NULL;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    memkv_options_t opts = {.chartype = 256, .keymem = 3, .valueptrmem = 1, .valuemem = 2, .dedup_values = 256};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    char key[32];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "content-type:%d", i);
+        if (memkv_set(pool, key, n, shared_value, sizeof(shared_value)) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+    }
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    if (st.dedup_boxes != 1 || st.value_boxes != 1 || st.dedup_saved_bytes == 0) {
+        LOG("[ERROR] identical values not shared: dedup_boxes=%lu value_boxes=%lu", st.dedup_boxes, st.value_boxes);
+        return -1;
+    }
+    if (memkv_get(pool, "content-type:0", 14) != memkv_get(pool, "content-type:999", 16)) {
+        LOG("[ERROR] shared keys point to different boxes");
+        return -1;
+    }
+
+    // 通过realloc修改是写时复制，其他key不受影响
+    char *v = memkv_realloc(pool, "content-type:7", 14, sizeof(shared_value));
+    if (!v || v == memkv_get(pool, "content-type:8", 14)) {
+        LOG("[ERROR] realloc of a shared value did not copy");
+        return -1;
+    }
+    memcpy(v, "text/html", 10);
+    if (strcmp(memkv_get(pool, "content-type:8", 14), shared_value) != 0 || strcmp(memkv_get(pool, "content-type:7", 14), "text/html") != 0) {
+        LOG("[ERROR] copy-on-write changed other keys");
+        return -1;
+    }
+
+    // 共享的int64上做原子加只影响这个key
+    int64_t one = 1, out = 0;
+    opts.dedup_min = 8;
+    static uint8_t small[1 << 20];
+    if (memkv_init_ex(small, sizeof(small), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex with dedup_min failed");
+        return -1;
+    }
+    memkv_set(small, "a", 1, &one, sizeof(one));
+    memkv_set(small, "b", 1, &one, sizeof(one));
+    if (memkv_incr(small, "a", 1, 41, &out) != MEMKV_SUCCESS || out != 42 || *(int64_t *)memkv_get(small, "b", 1) != 1) {
+        LOG("[ERROR] incr on a shared value leaked to other keys: %ld", out);
+        return -1;
+    }
+
+    // 两个box都被别的key引用着，切换时不会释放，读者只可能因为偏移和存储形式不配套读错
+    memset(packed_value, 'x', sizeof(packed_value));
+    if (memkv_init_ex(swap_pool, sizeof(swap_pool), &opts) != MEMKV_SUCCESS ||
+        memkv_set(swap_pool, "plain", 5, shared_value, sizeof(shared_value)) != MEMKV_SUCCESS ||
+        memkv_set_compressed(swap_pool, "packed", 6, packed_value, sizeof(packed_value)) != MEMKV_SUCCESS ||
+        memkv_set(swap_pool, "k", 1, shared_value, sizeof(shared_value)) != MEMKV_SUCCESS) {
+        LOG("[ERROR] failed to prepare the swap pool");
+        return -1;
+    }
+    pthread_t reader;
+    pthread_create(&reader, NULL, swap_reader, NULL);
+    for (int i = 0; i < 100000; i++) {
+        int r = (i & 1) ? memkv_set(swap_pool, "k", 1, shared_value, sizeof(shared_value))
+                        : memkv_set_compressed(swap_pool, "k", 1, packed_value, sizeof(packed_value));
+        if (r != MEMKV_SUCCESS) {
+            LOG("[ERROR] swap set %d failed: %s", i, memkv_strerror(r));
+            return -1;
+        }
+    }
+    swap_done = true;
+    pthread_join(reader, NULL);
+    memkv_stats(swap_pool, &st);
+    if (swap_bad || st.dedup_boxes != 2 || st.value_boxes != 2) {
+        LOG("[ERROR] concurrent reads saw %ld torn values, dedup_boxes=%lu value_boxes=%lu", swap_bad, st.dedup_boxes, st.value_boxes);
+        return -1;
+    }
+
+    // 所有引用都删除后共享box被释放
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "content-type:%d", i);
+        memkv_del(pool, key, n);
+    }
+    memkv_stats(pool, &st);
+    if (st.dedup_boxes != 0 || st.dedup_saved_bytes != 0 || st.value_boxes != 0) {
+        LOG("[ERROR] shared box not freed: dedup_boxes=%lu saved=%lu value_boxes=%lu", st.dedup_boxes, st.dedup_saved_bytes, st.value_boxes);
+        return -1;
+    }
+    LOG("[INFO] dedup test passed");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NDOCS 2000
+#define NSAMPLES 64
+
+static int make_doc(char *buf, size_t cap, int i) {
+    return snprintf(buf, cap,
+                    "{\"id\":%d,\"type\":\"order\",\"status\":\"%s\",\"customer\":{\"name\":\"customer-%d\",\"email\":\"user%d@example.com\","
+                    "\"address\":{\"city\":\"Hangzhou\",\"country\":\"CN\",\"zip\":\"3100%02d\"}},\"items\":[{\"sku\":\"SKU-%05d\",\"qty\":%d,"
+                    "\"price\":%d.%02d,\"currency\":\"CNY\"},{\"sku\":\"SKU-%05d\",\"qty\":1,\"price\":9.90,\"currency\":\"CNY\"}],"
+                    "\"created_at\":\"2024-05-%02dT10:%02d:00Z\",\"tags\":[\"priority\",\"gift\",\"express\"]}",
+                    i, i % 3 ? "shipped" : "pending", i, i, i % 100, i * 7 % 100000, 1 + i % 5, i % 500, i % 100,
+                    i * 13 % 100000, 1 + i % 28, i % 60);
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    static uint8_t frozen[POOL_SIZE];
+    memkv_options_t opts = {.chartype = 256, .keymem = 4, .valueptrmem = 1, .valuemem = 2,
+                            .compress_min = 128, .compress_dict = 4096};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+
+    // 从样本训练字典
+    static char samples[NSAMPLES][1024];
+    const void *sample_ptrs[NSAMPLES];
+    size_t sample_lens[NSAMPLES];
+    for (int i = 0; i < NSAMPLES; i++) {
+        sample_lens[i] = make_doc(samples[i], sizeof(samples[i]), 100000 + i);
+        sample_ptrs[i] = samples[i];
+    }
+    static uint8_t dict[4096];
+    size_t dict_len = memkv_dict_train(sample_ptrs, sample_lens, NSAMPLES, dict, sizeof(dict));
+    if (dict_len == 0 || memkv_set_dict(pool, dict, dict_len) != MEMKV_SUCCESS) {
+        LOG("[ERROR] dictionary training failed: %zu", dict_len);
+        return -1;
+    }
+
+    char key[32], doc[1024], out[1024];
+    size_t raw_total = 0;
+    for (int i = 0; i < NDOCS; i++) {
+        int n = snprintf(key, sizeof(key), "order:%d", i);
+        int len = make_doc(doc, sizeof(doc), i);
+        raw_total += len;
+        if (memkv_set(pool, key, n, doc, len) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+    }
+    memkv_set(pool, "small", 5, "tiny", 5);
+    if (memkv_set_dict(pool, dict, dict_len) != MEMKV_ERROR_INVALID_ARG) {
+        LOG("[ERROR] dictionary replaced while compressed values exist");
+        return -1;
+    }
+
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    LOG("[INFO] compressed %lu values, %lu -> %lu bytes, ratio %.2f", st.compressed_values, st.compressed_raw_bytes, st.compressed_bytes, st.compress_ratio);
+    if (st.compressed_values != NDOCS || st.compressed_raw_bytes != raw_total || st.compress_ratio < 2.0) {
+        LOG("[ERROR] unexpected compression stats");
+        return -1;
+    }
+
+    // 小value仍走零拷贝，压缩的value通过memkv_read读取
+    if (!memkv_get(pool, "small", 5) || strcmp(memkv_get(pool, "small", 5), "tiny") != 0 || memkv_get(pool, "order:1", 7)) {
+        LOG("[ERROR] get did not keep zero-copy only for small values");
+        return -1;
+    }
+    // memkv_find把压缩的value和key不存在区分开
+    void *found;
+    size_t found_len;
+    int doc1_len = make_doc(doc, sizeof(doc), 1);
+    if (memkv_find(pool, "order:1", 7, &found, &found_len) != MEMKV_ERROR_COMPRESSED || found || found_len != (size_t)doc1_len ||
+        memkv_find(pool, "order:x", 7, &found, &found_len) != MEMKV_ERROR_KEY_NOT_FOUND ||
+        memkv_find(pool, "small", 5, &found, &found_len) != MEMKV_SUCCESS || found_len != 5 || strcmp(found, "tiny") != 0) {
+        LOG("[ERROR] memkv_find status for compressed/missing/plain values is wrong");
+        return -1;
+    }
+    for (int i = 0; i < NDOCS; i++) {
+        int n = snprintf(key, sizeof(key), "order:%d", i);
+        int len = make_doc(doc, sizeof(doc), i);
+        size_t got = 0;
+        if (memkv_read(pool, key, n, out, sizeof(out), &got) != MEMKV_SUCCESS || got != (size_t)len || memcmp(out, doc, len) != 0) {
+            LOG("[ERROR] memkv_read mismatch for %s", key);
+            return -1;
+        }
+    }
+    size_t need = 0;
+    if (memkv_read(pool, "order:5", 7, NULL, 0, &need) != MEMKV_SUCCESS || memkv_read(pool, "order:5", 7, out, need - 1, &need) != MEMKV_ERROR_INVALID_ARG) {
+        LOG("[ERROR] memkv_read length query or short buffer check failed");
+        return -1;
+    }
+
+    // realloc把压缩的value解压成可原地修改的私有value
+    int len = make_doc(doc, sizeof(doc), 3);
+    char *v = memkv_realloc(pool, "order:3", 7, len + 1);
+    if (!v || memcmp(v, doc, len) != 0 || memkv_get(pool, "order:3", 7) != v) {
+        LOG("[ERROR] realloc of a compressed value lost data");
+        return -1;
+    }
+
+    // 冻结时解压
+    size_t flen = 0;
+    if (memkv_freeze(pool, frozen, sizeof(frozen), &flen) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_freeze failed");
+        return -1;
+    }
+    len = make_doc(doc, sizeof(doc), 42);
+    v = memkv_get(frozen, "order:42", 8);
+    if (!v || memcmp(v, doc, len) != 0) {
+        LOG("[ERROR] frozen pool holds a compressed value");
+        return -1;
+    }
+
+    for (int i = 0; i < NDOCS; i++) {
+        int n = snprintf(key, sizeof(key), "order:%d", i);
+        memkv_del(pool, key, n);
+    }
+    memkv_stats(pool, &st);
+    if (st.compressed_values != 0 || st.compressed_raw_bytes != 0 || st.compressed_bytes != 0) {
+        LOG("[ERROR] compression stats not released: %lu", st.compressed_values);
+        return -1;
+    }
+    LOG("[INFO] compress test passed");
+    return 0;
+}
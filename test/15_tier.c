@@ -0,0 +1,182 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NKEYS 3000
+#define VALUE_LEN 1000
+
+static void fill_value(char *buf, int i) {
+    for (int j = 0; j < VALUE_LEN; j++)
+        buf[j] = (char)('a' + (i * 31 + j) % 26);
+}
+
+// key为doc:<i>，value应是fill_value(i)的内容
+static bool value_ok(const void *key_data, size_t key_len, const void *value_data, size_t value_len) {
+    char expect[VALUE_LEN], num[16] = {0};
+    memcpy(num, (const char *)key_data + 4, key_len - 4 < sizeof(num) - 1 ? key_len - 4 : sizeof(num) - 1);
+    fill_value(expect, atoi(num));
+    return value_data && value_len == VALUE_LEN && memcmp(value_data, expect, VALUE_LEN) == 0;
+}
+
+static int range_checked;
+static bool check_range(void *arg, const void *key_data, size_t key_len, void *value_data, size_t value_len) {
+    (void)arg;
+    if (value_ok(key_data, key_len, value_data, value_len))
+        range_checked++;
+    return true;
+}
+
+static int scan_checked;
+static void check_scan(void *arg, int worker, const void *key_data, size_t key_len, void *value_data, size_t value_len) {
+    (void)arg;
+    (void)worker;
+    if (value_ok(key_data, key_len, value_data, value_len))
+        __atomic_fetch_add(&scan_checked, 1, __ATOMIC_RELAXED);
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    // value区只放得下一小部分value
+    memkv_options_t opts = {.chartype = 256, .keymem = 14, .valueptrmem = 1, .valuemem = 1};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    char path[] = "/tmp/memkv_tier_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        LOG("[ERROR] mkstemp failed");
+        return -1;
+    }
+    close(fd);
+    if (memkv_tier_attach(pool, path, 16 << 20) != MEMKV_SUCCESS || memkv_set_evict(pool, MEMKV_EVICT_TIER, 0) != MEMKV_SUCCESS) {
+        LOG("[ERROR] tier setup failed");
+        unlink(path);
+        return -1;
+    }
+
+    char key[32], value[VALUE_LEN], *v;
+    int ret = -1;
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "doc:%d", i);
+        fill_value(value, i);
+        if (memkv_set(pool, key, n, value, VALUE_LEN) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed with tiering on", key);
+            goto out;
+        }
+    }
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    LOG("[INFO] cold values %lu, %lu bytes, demotions %lu", st.cold_values, st.cold_bytes, st.tier_demotions);
+    if (st.cold_values == 0 || st.keys != NKEYS || st.cold_values * VALUE_LEN != st.cold_bytes) {
+        LOG("[ERROR] nothing spilled to the tier file");
+        goto out;
+    }
+
+    // 遍历时冷value直接从冷文件读取，不搬回池内
+    range_checked = 0;
+    memkv_range(pool, "doc:", 4, NULL, 0, check_range, NULL);
+    memkv_stats(pool, &st);
+    if (range_checked != NKEYS || st.tier_promotions != 0) {
+        LOG("[ERROR] range over cold values checked %d", range_checked);
+        goto out;
+    }
+    // 有序scan先缓冲偏移再回放，回放时也要认出冷value
+    for (int ordered = 0; ordered < 2; ordered++) {
+        memkv_scan_options_t sopts = {.threads = 2, .ordered = ordered};
+        scan_checked = 0;
+        memkv_scan(pool, "doc:", 4, &sopts, check_scan, NULL);
+        memkv_stats(pool, &st);
+        if (scan_checked != NKEYS || st.tier_promotions != 0) {
+            LOG("[ERROR] %s scan over cold values checked %d", ordered ? "ordered" : "unordered", scan_checked);
+            goto out;
+        }
+    }
+
+    // get透明地把冷value搬回池内
+    for (int i = 0; i < NKEYS; i += 7) {
+        int n = snprintf(key, sizeof(key), "doc:%d", i);
+        fill_value(value, i);
+        v = memkv_get(pool, key, n);
+        if (!v || memcmp(v, value, VALUE_LEN) != 0) {
+            LOG("[ERROR] get of %s returned wrong data", key);
+            goto out;
+        }
+    }
+    memkv_stats(pool, &st);
+    if (st.tier_promotions == 0) {
+        LOG("[ERROR] get did not promote any cold value");
+        goto out;
+    }
+
+    // 批量下沉，然后删除和覆盖冷value
+    if (memkv_tier_demote(pool, UINT8_MAX, 0) <= 0) {
+        LOG("[ERROR] memkv_tier_demote moved nothing");
+        goto out;
+    }
+    memkv_del(pool, "doc:1", 5);
+    fill_value(value, 7);
+    memkv_set(pool, "doc:2", 5, value, VALUE_LEN);
+    v = memkv_get(pool, "doc:2", 5);
+    if (memkv_get(pool, "doc:1", 5) || !v || memcmp(v, value, VALUE_LEN) != 0) {
+        LOG("[ERROR] delete/overwrite of cold values failed");
+        goto out;
+    }
+    memkv_stats(pool, &st);
+    if (st.cold_values != NKEYS - 2) {
+        LOG("[ERROR] cold value count %lu after full demote", st.cold_values);
+        goto out;
+    }
+
+    // 相对路径按绝对路径记下，别的工作目录下重新映射也能找到；读路径不会创建已删除的冷文件
+    static uint8_t pool2[1 << 20];
+    char cwd[4096], rel[64], abs[4096];
+    snprintf(rel, sizeof(rel), "memkv_tier_rel_%d", (int)getpid());
+    snprintf(abs, sizeof(abs), "/tmp/%s", rel);
+    if (!getcwd(cwd, sizeof(cwd)) || memkv_init_ex(pool2, sizeof(pool2), &opts) != MEMKV_SUCCESS || chdir("/tmp") != 0) {
+        LOG("[ERROR] second pool setup failed");
+        goto out;
+    }
+    int r2 = memkv_tier_attach(pool2, rel, 1 << 20);
+    if (chdir("/") != 0 || r2 != MEMKV_SUCCESS) {
+        LOG("[ERROR] attach with a relative path failed");
+        goto out;
+    }
+    fill_value(value, 3);
+    memkv_set(pool2, "doc:3", 5, value, VALUE_LEN);
+    memkv_set(pool2, "doc:4", 5, value, VALUE_LEN);
+    if (memkv_tier_demote(pool2, UINT8_MAX, 0) != 2) {
+        LOG("[ERROR] demote on the second pool failed");
+        goto out2;
+    }
+    memkv_tier_detach(pool2);
+    v = memkv_get(pool2, "doc:3", 5);
+    if (!v || memcmp(v, value, VALUE_LEN) != 0) {
+        LOG("[ERROR] tier file not found again from another working directory");
+        goto out2;
+    }
+    memkv_tier_detach(pool2);
+    unlink(abs);
+    if (memkv_get(pool2, "doc:4", 5) || access(abs, F_OK) == 0) {
+        LOG("[ERROR] read of a cold value recreated the deleted tier file");
+        goto out2;
+    }
+    if (chdir(cwd) != 0)
+        goto out2;
+
+    LOG("[INFO] tier test passed");
+    ret = 0;
+out2:
+    memkv_tier_detach(pool2);
+    unlink(abs);
+out:
+    memkv_tier_detach(pool);
+    unlink(path);
+    return ret;
+}
@@ -0,0 +1,137 @@
+#define POOL_SIZE (1 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main() {
+    // 另一个进程写，本进程在共享mmap上等待
+    void *pool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int64_t *set_at = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED || set_at == MAP_FAILED) {
+        LOG("[ERROR] mmap failed");
+        return -1;
+    }
+    if (memkv_init(pool, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+
+    // 先取得当前计数：key还不存在
+    uint32_t v = 0, pv = 0;
+    if (memkv_watch(pool, "cfg:db", 6, false, &v, 0) != MEMKV_ERROR_TIMEOUT || memkv_watch(pool, "cfg:", 4, true, &pv, 0) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] watch on an unchanged key did not time out");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        usleep(20000);
+        *set_at = now_us();
+        memkv_set(pool, "cfg:db", 6, "v1", 3);
+        usleep(20000);
+        memkv_set(pool, "cfg:cache:size", 14, "64", 3);
+        memkv_del(pool, "cfg:db", 6);
+        _exit(0);
+    }
+
+    if (memkv_watch(pool, "cfg:db", 6, false, &v, 2000) != MEMKV_SUCCESS) {
+        LOG("[ERROR] watcher not woken by set");
+        return -1;
+    }
+    int64_t latency = now_us() - *set_at;
+    char *value = memkv_get(pool, "cfg:db", 6);
+    if (!value || strcmp(value, "v1") != 0) {
+        LOG("[ERROR] woken before the value was published");
+        return -1;
+    }
+    printf("woken %ld us after set\n", (long)latency);
+    if (latency < 0 || latency > 1000000) {
+        LOG("[ERROR] wake latency %ld us out of range", (long)latency);
+        return -1;
+    }
+
+    if (memkv_watch(pool, "cfg:db", 6, false, &v, 2000) != MEMKV_SUCCESS || memkv_get(pool, "cfg:db", 6)) {
+        LOG("[ERROR] watcher not woken by del");
+        return -1;
+    }
+    waitpid(pid, NULL, 0);
+
+    // 前缀watch：子树里的写都会改变计数，等待期间错过的变化下次调用立即返回
+    uint32_t before = pv;
+    if (memkv_watch(pool, "cfg:", 4, true, &pv, 0) != MEMKV_SUCCESS || pv == before) {
+        LOG("[ERROR] prefix watch missed writes under cfg:");
+        return -1;
+    }
+    if (memkv_watch(pool, "cfg:", 4, true, &pv, 10) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] prefix watch did not time out without writes");
+        return -1;
+    }
+    memkv_set(pool, "other", 5, "x", 2);
+    if (memkv_watch(pool, "cfg:", 4, true, &pv, 0) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] write outside the prefix woke the watcher");
+        return -1;
+    }
+
+    // 不存在的key不建节点，等在最近的已有前缀上，key建好后第一次watch立即返回
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    uint64_t nodes = st.nodes;
+    char key[32];
+    uint32_t mv[100];
+    for (int i = 0; i < 100; i++) {
+        int n = snprintf(key, sizeof(key), "missing:%d", i);
+        mv[i] = 0;
+        memkv_watch(pool, key, n, false, &mv[i], 0);
+        if (memkv_watch(pool, key, n, false, &mv[i], 0) != MEMKV_ERROR_TIMEOUT) {
+            LOG("[ERROR] watch on missing %s did not time out", key);
+            return -1;
+        }
+    }
+    memkv_stats(pool, &st);
+    if (st.nodes != nodes) {
+        LOG("[ERROR] watching missing keys grew nodes %lu -> %lu", (unsigned long)nodes, (unsigned long)st.nodes);
+        return -1;
+    }
+    memkv_set(pool, "missing:7", 9, "x", 2);
+    if (memkv_watch(pool, "missing:7", 9, false, &mv[7], 0) != MEMKV_SUCCESS || memkv_watch(pool, "missing:7", 9, false, &mv[7], 0) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] watch did not see missing:7 being created");
+        return -1;
+    }
+    // malloc/realloc不通知，调用方写完value后显式notify
+    uint32_t av = 0;
+    memkv_set(pool, "alloc", 5, "a", 2);
+    memkv_watch(pool, "alloc", 5, false, &av, 0);
+    char *p = memkv_malloc(pool, "alloc", 5, 8);
+    if (!p || memkv_watch(pool, "alloc", 5, false, &av, 0) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] memkv_malloc woke the watcher before the value was written");
+        return -1;
+    }
+    strcpy(p, "filled");
+    if (memkv_notify(pool, "alloc", 5) != MEMKV_SUCCESS || memkv_watch(pool, "alloc", 5, false, &av, 0) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_notify did not wake the watcher");
+        return -1;
+    }
+    if (!memkv_realloc(pool, "alloc", 5, 64) || memkv_watch(pool, "alloc", 5, false, &av, 0) != MEMKV_ERROR_TIMEOUT) {
+        LOG("[ERROR] memkv_realloc woke the watcher");
+        return -1;
+    }
+    if (memkv_notify(pool, "nokey", 5) != MEMKV_ERROR_KEY_NOT_FOUND) {
+        LOG("[ERROR] memkv_notify on a missing key should report it");
+        return -1;
+    }
+    LOG("[INFO] watch test passed");
+    return 0;
+}
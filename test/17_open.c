@@ -0,0 +1,124 @@
+#define POOL_SIZE (4 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define POOL_FILE "/tmp/memkv_test_open.pool"
+#define FROZEN_FILE "/tmp/memkv_test_open.frozen"
+#define NKEYS 500
+#define NOPENS 1000
+
+static int check_lookup(const memkv_t *kv) {
+    char key[32], value[32];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "worker:%d", i);
+        int vlen = snprintf(value, sizeof(value), "cfg-%d", i * 7);
+        size_t len = 0;
+        const char *v = memkv_lookup(kv, key, n, &len);
+        if (!v || len != (size_t)vlen + 1 || strcmp(v, value) != 0)
+            return -1;
+    }
+    return memkv_lookup(kv, "worker:x", 8, NULL) ? -1 : 0;
+}
+
+int main() {
+    unlink(POOL_FILE);
+    unlink(FROZEN_FILE);
+    memkv_map_options_t mopts = {.size = POOL_SIZE};
+    size_t len = 0;
+    void *pool = memkv_map(POOL_FILE, &mopts, &len);
+    if (!pool || memkv_init(pool, len, 256, 4, 1, 1) != MEMKV_SUCCESS) {
+        LOG("[ERROR] creating the pool file failed");
+        return -1;
+    }
+    memkv_unmap(pool, len);
+
+    // 可写打开：handle里的pool可以直接用于写
+    memkv_t kv;
+    if (memkv_open(&kv, POOL_FILE, 0) != MEMKV_SUCCESS || kv.frozen || kv.pool_len != POOL_SIZE) {
+        LOG("[ERROR] memkv_open read-write failed");
+        return -1;
+    }
+    char key[32], value[32];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "worker:%d", i);
+        int vlen = snprintf(value, sizeof(value), "cfg-%d", i * 7);
+        if (memkv_set(kv.pool, key, n, value, vlen + 1) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set through the handle failed");
+            return -1;
+        }
+    }
+    static uint8_t frozen[POOL_SIZE];
+    size_t flen = 0;
+    if (memkv_freeze(kv.pool, frozen, sizeof(frozen), &flen) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_freeze failed");
+        return -1;
+    }
+    memkv_close(&kv);
+    FILE *f = fopen(FROZEN_FILE, "wb");
+    if (!f || fwrite(frozen, 1, flen, f) != flen) {
+        LOG("[ERROR] writing the frozen image failed");
+        return -1;
+    }
+    fclose(f);
+
+    // 只读打开：PROT_READ映射上用memkv_lookup
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < NOPENS; i++) {
+        if (memkv_open(&kv, POOL_FILE, MEMKV_OPEN_RDONLY) != MEMKV_SUCCESS || !memkv_lookup(&kv, "worker:1", 8, NULL)) {
+            LOG("[ERROR] read-only open %d failed", i);
+            return -1;
+        }
+        memkv_close(&kv);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    LOG("[INFO] read-only attach+lookup+close: %.1f us", ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3 / NOPENS);
+    if (memkv_open(&kv, POOL_FILE, MEMKV_OPEN_RDONLY | MEMKV_OPEN_PREFAULT) != MEMKV_SUCCESS || check_lookup(&kv) != 0) {
+        LOG("[ERROR] memkv_lookup on a read-only mapping returned wrong data");
+        return -1;
+    }
+    // 统计和热点快照只读池，PROT_READ映射上不会触发缺页错误
+    memkv_stats_t st;
+    memkv_hot_t hot;
+    if (memkv_stats(kv.pool, &st) != MEMKV_SUCCESS || st.keys != NKEYS || st.value_largest_free == 0 ||
+        memkv_hot_snapshot(kv.pool, &hot) != MEMKV_SUCCESS) {
+        LOG("[ERROR] stats on a read-only mapping: %lu keys", st.keys);
+        return -1;
+    }
+    memkv_close(&kv);
+
+    // 冻结镜像走同一个入口
+    if (memkv_open(&kv, FROZEN_FILE, MEMKV_OPEN_RDONLY) != MEMKV_SUCCESS || !kv.frozen || check_lookup(&kv) != 0) {
+        LOG("[ERROR] memkv_lookup on a frozen image failed");
+        return -1;
+    }
+    memkv_close(&kv);
+
+    // 版本不符和不是池的文件都被拒绝
+    pool = memkv_map(POOL_FILE, NULL, &len);
+    ((memkv_meta_t *)pool)->version = MEMKV_FORMAT_VERSION + 1;
+    memkv_unmap(pool, len);
+    if (memkv_open(&kv, POOL_FILE, MEMKV_OPEN_RDONLY) != MEMKV_ERROR_VERSION) {
+        LOG("[ERROR] pool with a newer format version accepted");
+        return -1;
+    }
+    truncate(FROZEN_FILE, 4096);
+    f = fopen(FROZEN_FILE, "r+b");
+    fwrite("garbage", 1, 7, f);
+    fclose(f);
+    if (memkv_open(&kv, FROZEN_FILE, 0) != MEMKV_ERROR_INVALID_ARG || memkv_open(&kv, "/tmp/memkv_no_such_pool", 0) != MEMKV_ERROR_INVALID_ARG) {
+        LOG("[ERROR] non-pool file accepted");
+        return -1;
+    }
+    unlink(POOL_FILE);
+    unlink(FROZEN_FILE);
+    LOG("[INFO] open test passed");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#define POOL_SIZE (16 << 20)
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define NKEYS 2000
+
+static key_node_t *find_node(memkv_meta_t *meta, const char *key) {
+    void *key_start = (uint8_t *)meta + meta->key_offset;
+    key_node_t *node = keynode_at(meta, key_start, 0);
+    for (size_t i = 0; key[i]; i++)
+        node = keynode_at(meta, key_start, node->child_key_blocks[(uint8_t)key[i]]);
+    return node;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1, .dedup_values = 256};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    char key[32], value[64];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "item:%d", i);
+        int vlen = i % 3 ? snprintf(value, sizeof(value), "value-%d", i) : snprintf(value, sizeof(value), "shared-value-for-every-third-key");
+        if (memkv_set(pool, key, n, value, vlen + 1) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+    }
+
+    memkv_check_options_t copts = {.threads = 4};
+    memkv_check_report_t rep;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS || rep.errors || rep.keys != NKEYS || rep.dedup_boxes != 1) {
+        LOG("[ERROR] clean pool reported %lu problems, %lu keys", rep.errors, rep.keys);
+        return -1;
+    }
+
+    // 注入错误：坏的子节点指针、两个私有key共用一个box、错误的计数
+    memkv_meta_t *meta = (memkv_meta_t *)pool;
+    // 子节点数组实际有char_type项，越过声明的[2]要按节点内的偏移写
+    int32_t bad_link = 0x7ffffff0;
+    memcpy((uint8_t *)find_node(meta, "item:1") + offsetof(key_node_t, child_key_blocks) + '7' * sizeof(int32_t), &bad_link, sizeof(bad_link));
+    find_node(meta, "item:5")->box = find_node(meta, "item:4")->box;
+    meta->stats.keys += 5;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_ERROR_CORRUPT || rep.bad_links != 1 || rep.overlapping_boxes != 1 || rep.counter_mismatches == 0) {
+        LOG("[ERROR] injected corruption not found: links %lu, overlaps %lu, counters %lu", rep.bad_links, rep.overlapping_boxes, rep.counter_mismatches);
+        return -1;
+    }
+
+    // 修复：丢弃item:17开头的子树和重复引用box的key，之后再检查是干净的
+    copts.repair = true;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS || rep.dropped_subtrees != 1 || rep.dropped_keys != 1) {
+        LOG("[ERROR] repair failed: dropped %lu subtrees, %lu keys", rep.dropped_subtrees, rep.dropped_keys);
+        return -1;
+    }
+    copts.repair = false;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS || rep.errors) {
+        LOG("[ERROR] pool still inconsistent after repair: %lu", rep.errors);
+        return -1;
+    }
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    if (st.keys != rep.keys || memkv_get(pool, "item:17", 7) || !memkv_get(pool, "item:4", 6) || strcmp(memkv_get(pool, "item:2", 6), "value-2") != 0) {
+        LOG("[ERROR] unexpected pool contents after repair");
+        return -1;
+    }
+    if (memkv_set(pool, "item:17", 7, "back", 5) != MEMKV_SUCCESS || strcmp(memkv_get(pool, "item:17", 7), "back") != 0) {
+        LOG("[ERROR] pool not writable after repair");
+        return -1;
+    }
+    LOG("[INFO] check test passed, %lu keys kept", rep.keys);
+    return 0;
+}
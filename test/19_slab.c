@@ -0,0 +1,105 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define NKEYS 2000
+
+static memkv_slab_stats_t *slab_of(memkv_slab_stats_t *classes, int n, uint32_t size) {
+    for (int i = 0; i < n; i++)
+        if (classes[i].size == size)
+            return &classes[i];
+    return NULL;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    memkv_meta_t *meta = (memkv_meta_t *)pool;
+    char key[32], value[256];
+    memset(value, 'v', sizeof(value));
+
+    // 70字节的value加头部落在80字节的级别，而不是2的幂的128字节
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "item:%d", i);
+        if (memkv_set(pool, key, n, value, 70) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+    }
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    memkv_slab_stats_t classes[MEMKV_SLAB_CLASSES];
+    int n = memkv_slab_stats(pool, classes, MEMKV_SLAB_CLASSES);
+    memkv_slab_stats_t *c80 = slab_of(classes, n, 80);
+    if (n != MEMKV_SLAB_CLASSES || !c80 || c80->values != NKEYS || c80->value_bytes != NKEYS * 70 || st.value_alloc_bytes != NKEYS * 80) {
+        LOG("[ERROR] class 80: values %lu, bytes %lu, alloc %lu", c80 ? c80->values : 0, c80 ? c80->value_bytes : 0, st.value_alloc_bytes);
+        return -1;
+    }
+    LOG("[INFO] %d values in %lu slabs, internal frag %.3f", NKEYS, c80->slabs, st.value_internal_frag);
+
+    // 偶数key换成200字节的value，进入224字节的级别
+    for (int i = 0; i < NKEYS; i += 2) {
+        int n = snprintf(key, sizeof(key), "item:%d", i);
+        memkv_del(pool, key, n);
+        if (memkv_set(pool, key, n, value, 200) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+    }
+    n = memkv_slab_stats(pool, classes, MEMKV_SLAB_CLASSES);
+    c80 = slab_of(classes, n, 80);
+    memkv_slab_stats_t *c224 = slab_of(classes, n, 224);
+    if (c80->values != NKEYS / 2 || c224->values != NKEYS / 2 || c224->value_bytes != NKEYS / 2 * 200) {
+        LOG("[ERROR] after resize: class 80 %lu values, class 224 %lu values", c80->values, c224->values);
+        return -1;
+    }
+    memkv_check_options_t copts = {.threads = 2};
+    memkv_check_report_t rep;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS) {
+        LOG("[ERROR] check reported %lu problems", rep.errors);
+        return -1;
+    }
+
+    // 全部删除并清空writer缓存后，slab还回去，每个级别至多留一个空slab
+    for (int i = 0; i < NKEYS; i++) {
+        int n = snprintf(key, sizeof(key), "item:%d", i);
+        memkv_del(pool, key, n);
+    }
+    memkv_writer_detach(pool);
+    n = memkv_slab_stats(pool, classes, MEMKV_SLAB_CLASSES);
+    for (int i = 0; i < n; i++) {
+        if (classes[i].values || classes[i].value_bytes || classes[i].chunks || classes[i].slabs > 1) {
+            LOG("[ERROR] class %u not drained: %lu values, %lu chunks, %lu slabs", classes[i].size, classes[i].values, classes[i].chunks, classes[i].slabs);
+            return -1;
+        }
+    }
+
+    // 小value填满池，boxmalloc取整丢掉的尾部也切成了slab
+    int stored = 0;
+    for (int i = 0;; i++) {
+        int n = snprintf(key, sizeof(key), "%d", i);
+        if (memkv_set(pool, key, n, value, 8) != MEMKV_SUCCESS)
+            break;
+        stored++;
+    }
+    if (meta->slab_tail_end - meta->slab_tail >= SLAB_SIZE && meta->slab_tail_next == meta->slab_tail) {
+        LOG("[ERROR] tail of %lu bytes was not used", (unsigned long)(meta->slab_tail_end - meta->slab_tail));
+        return -1;
+    }
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS || rep.keys != (uint64_t)stored) {
+        LOG("[ERROR] check after fill: %lu problems, %lu keys of %d", rep.errors, rep.keys, stored);
+        return -1;
+    }
+    LOG("[INFO] stored %d small values, tail %lu bytes", stored, (unsigned long)(meta->slab_tail_end - meta->slab_tail));
+    LOG("[INFO] slab test passed");
+    return 0;
+}
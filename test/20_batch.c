@@ -0,0 +1,189 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define GROUP 10
+#define ROUNDS 20000
+
+static uint8_t pool[POOL_SIZE];
+static volatile int done;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// 读者：一致读到的GROUP个key必须是同一轮批次写入的值
+static void *reader(void *arg) {
+    long *torn = arg;
+    char key[16];
+    while (!done) {
+        int64_t vals[GROUP];
+        uint64_t seq = memkv_read_begin(pool);
+        for (int i = 0; i < GROUP; i++) {
+            int n = snprintf(key, sizeof(key), "grp:%d", i);
+            int64_t *v = memkv_get(pool, key, n);
+            vals[i] = v ? *v : -1;
+        }
+        if (memkv_read_retry(pool, seq))
+            continue;
+        for (int i = 1; i < GROUP; i++)
+            if (vals[i] != vals[0])
+                (*torn)++;
+    }
+    return NULL;
+}
+
+int main() {
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    memkv_set(pool, "old", 3, "gone", 4);
+
+    // 暂存的操作在commit之前不可见
+    memkv_batch_t b;
+    memkv_batch_init(&b, pool);
+    memkv_batch_set(&b, "a", 1, "1", 1);
+    memkv_batch_set(&b, "b", 1, "2", 1);
+    memkv_batch_set(&b, "a", 1, "3", 1);
+    memkv_batch_del(&b, "old", 3);
+    memkv_batch_del(&b, "missing", 7);
+    if (memkv_get(pool, "a", 1) || !memkv_get(pool, "old", 3)) {
+        LOG("[ERROR] staged ops are visible before commit");
+        return -1;
+    }
+    if (memkv_batch_commit(&b) != MEMKV_SUCCESS || b.ops != 0) {
+        LOG("[ERROR] memkv_batch_commit failed");
+        return -1;
+    }
+    char *a = memkv_get(pool, "a", 1), *bv = memkv_get(pool, "b", 1);
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    if (!a || *a != '3' || !bv || *bv != '2' || memkv_get(pool, "old", 3) || st.keys != 2) {
+        LOG("[ERROR] batch result wrong: a=%c b=%c keys=%lu", a ? *a : '-', bv ? *bv : '-', st.keys);
+        return -1;
+    }
+
+    // 同一key先删后写：以最后的set为准
+    memkv_batch_del(&b, "a", 1);
+    memkv_batch_set(&b, "a", 1, "4", 1);
+    // 池中没有的key先写后删：commit后不存在
+    memkv_batch_set(&b, "zz", 2, "zz", 2);
+    memkv_batch_del(&b, "zz", 2);
+    if (memkv_batch_commit(&b) != MEMKV_SUCCESS) {
+        LOG("[ERROR] del/set batch failed");
+        return -1;
+    }
+    a = memkv_get(pool, "a", 1);
+    memkv_stats(pool, &st);
+    if (!a || *a != '4' || memkv_get(pool, "zz", 2) || st.keys != 2) {
+        LOG("[ERROR] same-key ops out of order: a=%c zz=%s keys=%lu", a ? *a : '-', memkv_get(pool, "zz", 2) ? "present" : "absent", st.keys);
+        return -1;
+    }
+    memkv_check_options_t copts = {.threads = 2};
+    memkv_check_report_t rep;
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS) {
+        LOG("[ERROR] check after del/set batch: %lu problems", rep.errors);
+        return -1;
+    }
+
+    // 放不下的value让整个批次失败，前面的set也不发布
+    static char huge[8 << 20];
+    memkv_batch_set(&b, "x", 1, "x", 1);
+    memkv_batch_set(&b, "y", 1, huge, sizeof(huge));
+    memkv_batch_del(&b, "a", 1);
+    if (memkv_batch_commit(&b) != MEMKV_ERROR_ALLOC_FAILED || b.ops != 3) {
+        LOG("[ERROR] oversized batch did not fail");
+        return -1;
+    }
+    memkv_stats_t st2;
+    memkv_stats(pool, &st2);
+    if (memkv_get(pool, "x", 1) || !memkv_get(pool, "a", 1) || st2.keys != 2 || st2.value_boxes != st.value_boxes) {
+        LOG("[ERROR] failed batch left partial state: keys %lu, boxes %lu/%lu", st2.keys, st2.value_boxes, st.value_boxes);
+        return -1;
+    }
+    memkv_batch_free(&b);
+
+    // 发布批次的进程中途退出：读者确认它已退出后返回，下一个批次接管batch_lock并恢复序列号
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(0);
+    waitpid(pid, NULL, 0);
+    memkv_meta_t *meta = (memkv_meta_t *)pool;
+    uint32_t seq = meta->batch_seq;
+    meta->batch_lock = (uint32_t)pid;
+    meta->batch_seq = seq + 1;
+    uint64_t rseq = memkv_read_begin(pool);
+    if (rseq != seq + 1 || memkv_read_retry(pool, rseq)) {
+        LOG("[ERROR] read_begin after a dead batch writer returned %lu, batch_seq %u", (unsigned long)rseq, seq + 1);
+        return -1;
+    }
+    memkv_batch_set(&b, "after", 5, "1", 1);
+    if (memkv_batch_commit(&b) != MEMKV_SUCCESS || !memkv_read_retry(pool, rseq) || (meta->batch_seq & 1) || meta->batch_lock ||
+        !memkv_get(pool, "after", 5)) {
+        LOG("[ERROR] batch after a dead writer: batch_seq %u, batch_lock %u", meta->batch_seq, meta->batch_lock);
+        return -1;
+    }
+    memkv_del(pool, "after", 5);
+    memkv_batch_free(&b);
+
+    // 并发读者只会看到完整的批次
+    long torn = 0;
+    pthread_t tid;
+    pthread_create(&tid, NULL, reader, &torn);
+    char key[16];
+    double t0 = now_ms();
+    for (int64_t r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < GROUP; i++) {
+            int n = snprintf(key, sizeof(key), "grp:%d", i);
+            memkv_batch_set(&b, key, n, &r, sizeof(r));
+        }
+        if (memkv_batch_commit(&b) != MEMKV_SUCCESS) {
+            LOG("[ERROR] batch round %ld failed", (long)r);
+            return -1;
+        }
+    }
+    double t1 = now_ms();
+    done = 1;
+    pthread_join(tid, NULL);
+    memkv_batch_free(&b);
+    if (torn) {
+        LOG("[ERROR] reader saw %ld torn batches", torn);
+        return -1;
+    }
+
+    // 同样的写入逐个set，对比批次的吞吐
+    double t2 = now_ms();
+    for (int64_t r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < GROUP; i++) {
+            int n = snprintf(key, sizeof(key), "grp:%d", i);
+            memkv_set(pool, key, n, &r, sizeof(r));
+        }
+    }
+    double t3 = now_ms();
+    printf("%d batches of %d sets: %.1f ms with concurrent reader, %.1f ms as single sets\n", ROUNDS, GROUP, t1 - t0, t3 - t2);
+    // 批次多一次写序列号和暂存，读者还在并发读，但不应比逐个set慢上一个量级
+    if (t1 - t0 > 10 * (t3 - t2)) {
+        LOG("[ERROR] batches %.1f ms vs single sets %.1f ms", t1 - t0, t3 - t2);
+        return -1;
+    }
+
+    if (memkv_check(pool, &copts, &rep) != MEMKV_SUCCESS || rep.keys != GROUP + 2) {
+        LOG("[ERROR] check after batches: %lu problems, %lu keys", rep.errors, rep.keys);
+        return -1;
+    }
+    LOG("[INFO] batch test passed");
+    return 0;
+}
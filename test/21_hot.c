@@ -0,0 +1,120 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NKEYS 1000
+#define OPS 400000
+
+static uint8_t pool[POOL_SIZE];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int make_key(char *key, int i) {
+    return snprintf(key, 32, i % 4 ? "user:%d" : "order:%d", i);
+}
+
+// 一半的get落在user:42上，其余均匀分布在所有key上
+static double skewed_gets(int ops) {
+    char key[32];
+    uint32_t rng = 12345;
+    double t0 = now_ns();
+    for (int i = 0; i < ops; i++) {
+        rng = rng * 1103515245 + 12345;
+        int k = (rng >> 8) % (2 * NKEYS);
+        int n = make_key(key, k < NKEYS ? k : 42);
+        memkv_get(pool, key, n);
+    }
+    return (now_ns() - t0) / ops;
+}
+
+static int entry_is(const memkv_hot_entry_t *e, const char *s) {
+    return e->len == strlen(s) && memcmp(e->key, s, e->len) == 0;
+}
+
+int main() {
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    char key[32];
+    for (int i = 0; i < NKEYS; i++) {
+        int n = make_key(key, i);
+        memkv_set(pool, key, n, &i, sizeof(i));
+    }
+
+    // 默认关闭，不采样
+    memkv_hot_t hot;
+    double off_ns = skewed_gets(OPS);
+    if (memkv_hot_snapshot(pool, &hot) != MEMKV_SUCCESS || hot.sample_rate || hot.samples || hot.nkeys) {
+        LOG("[ERROR] sampler active while disabled: %lu samples", hot.samples);
+        return -1;
+    }
+
+    // 每次都采样：热点key和它的前缀排在最前
+    memkv_hot_enable(pool, 1);
+    double all_ns = skewed_gets(OPS);
+    memkv_hot_snapshot(pool, &hot);
+    if (hot.samples != OPS || hot.reads != OPS || !hot.nkeys || !entry_is(&hot.keys[0], "user:42")) {
+        LOG("[ERROR] rate 1: %lu samples, top key %.*s", hot.samples, hot.nkeys ? (int)hot.keys[0].len : 0, hot.keys[0].key);
+        return -1;
+    }
+    if (!hot.nprefixes[4] || !entry_is(&hot.prefixes[4][0], "user:") || !entry_is(&hot.prefixes[6][0], "user:42")) {
+        LOG("[ERROR] hot prefixes wrong: depth 5 %.*s, depth 7 %.*s", (int)hot.prefixes[4][0].len, hot.prefixes[4][0].key,
+            (int)hot.prefixes[6][0].len, hot.prefixes[6][0].key);
+        return -1;
+    }
+    // "user:"的访问约为"order:"的7倍
+    uint64_t user = hot.prefixes[4][0].count, order = 0;
+    for (uint32_t i = 0; i < hot.nprefixes[5]; i++)
+        if (entry_is(&hot.prefixes[5][i], "order:"))
+            order = hot.prefixes[5][i].count;
+    if (!order || user < 4 * order) {
+        LOG("[ERROR] prefix counts user: %lu, order: %lu", user, order);
+        return -1;
+    }
+    for (uint32_t i = 1; i < hot.nkeys; i++) {
+        if (hot.keys[i].count > hot.keys[i - 1].count) {
+            LOG("[ERROR] hot keys not sorted at %u", i);
+            return -1;
+        }
+    }
+
+    // 写也计入
+    memkv_set(pool, "user:42", 7, "x", 1);
+    memkv_hot_snapshot(pool, &hot);
+    if (hot.writes != 1) {
+        LOG("[ERROR] write not sampled: %lu", hot.writes);
+        return -1;
+    }
+
+    // 1/64采样仍能找出热点key
+    memkv_hot_reset(pool);
+    memkv_hot_snapshot(pool, &hot);
+    if (hot.samples || hot.nkeys || hot.sample_rate != 1) {
+        LOG("[ERROR] reset left %lu samples, %u keys", hot.samples, hot.nkeys);
+        return -1;
+    }
+    memkv_hot_enable(pool, 64);
+    double sampled_ns = skewed_gets(OPS);
+    memkv_hot_snapshot(pool, &hot);
+    if (hot.samples < OPS / 64 / 2 || hot.samples > OPS / 64 * 2 || !entry_is(&hot.keys[0], "user:42")) {
+        LOG("[ERROR] rate 64: %lu samples, top key %.*s", hot.samples, (int)hot.keys[0].len, hot.keys[0].key);
+        return -1;
+    }
+    // 耗时只打印供参考，机器负载会让计时抖动，不作为断言
+    printf("get: %.1f ns/op sampling off, %.1f ns/op 1 in 64, %.1f ns/op every op\n", off_ns, sampled_ns, all_ns);
+
+    memkv_hot_enable(pool, 0);
+    LOG("[INFO] hot test passed");
+    return 0;
+}
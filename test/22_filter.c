@@ -0,0 +1,179 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "memkv_hash.h"
+#include "logutil.h"
+
+#define NKEYS 2000
+
+static int key_of(char *buf, size_t cap, const char *prefix, int i) {
+    return snprintf(buf, cap, "%s:%d", prefix, i);
+}
+
+// 过滤器区全为0：加进去的key都已经减回去了
+static bool filter_empty(memkv_meta_t *meta) {
+    const uint8_t *p = (const uint8_t *)meta + meta->filter_offset;
+    for (uint64_t i = 0; i < meta->filter_blocks * MEMKV_FILTER_BLOCK_SIZE; i++)
+        if (p[i])
+            return false;
+    return true;
+}
+
+// 前缀下[0,n)的key全部存在（不被过滤器挡掉）
+static int count_found(void *pool, const char *prefix, int n) {
+    char key[32];
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int len = key_of(key, sizeof(key), prefix, i);
+        if (memkv_get(pool, key, len))
+            found++;
+    }
+    return found;
+}
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    memkv_meta_t *meta = (memkv_meta_t *)pool;
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1, .filter_keys = NKEYS * 4};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS || !meta->filter_blocks) {
+        LOG("[ERROR] memkv_init_ex with a filter failed");
+        return -1;
+    }
+    char key[32];
+
+    // set之后没有漏判，删掉之后过滤器报告不存在，计数器全部减回0
+    for (int i = 0; i < NKEYS; i++) {
+        int n = key_of(key, sizeof(key), "k", i);
+        if (memkv_set(pool, key, n, "v", 2) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkv_set %s failed", key);
+            return -1;
+        }
+        if (!filter_maybe(meta, memkv_hash(key, n))) {
+            LOG("[ERROR] filter lost %s right after set", key);
+            return -1;
+        }
+    }
+    if (count_found(pool, "k", NKEYS) != NKEYS) {
+        LOG("[ERROR] filter hid existing keys");
+        return -1;
+    }
+    int misses = 0;
+    for (int i = 0; i < NKEYS; i++) {
+        int n = key_of(key, sizeof(key), "k", i);
+        memkv_del(pool, key, n);
+        if (filter_maybe(meta, memkv_hash(key, n)))
+            misses++;
+    }
+    // 删除过程中别的key还在，少量误判可以接受；全部删完后不能有残留
+    if (misses > NKEYS / 10 || !filter_empty(meta)) {
+        LOG("[ERROR] deleted keys still pass the filter: %d, filter empty %d", misses, filter_empty(meta));
+        return -1;
+    }
+    for (int i = 0; i < NKEYS; i++) {
+        int n = key_of(key, sizeof(key), "k", i);
+        if (filter_maybe(meta, memkv_hash(key, n))) {
+            LOG("[ERROR] %s passes an empty filter", key);
+            return -1;
+        }
+    }
+
+    // 只有一个块的过滤器：大量key把计数器压到饱和，删掉一半后剩下的仍然都能找到
+    static uint8_t tiny[POOL_SIZE];
+    opts.filter_keys = 1;
+    if (memkv_init_ex(tiny, sizeof(tiny), &opts) != MEMKV_SUCCESS || ((memkv_meta_t *)tiny)->filter_blocks != 1) {
+        LOG("[ERROR] memkv_init_ex with a one-block filter failed");
+        return -1;
+    }
+    for (int i = 0; i < NKEYS; i++) {
+        int n = key_of(key, sizeof(key), "t", i);
+        memkv_set(tiny, key, n, "v", 2);
+    }
+    for (int i = 0; i < NKEYS; i += 2) {
+        int n = key_of(key, sizeof(key), "t", i);
+        memkv_del(tiny, key, n);
+    }
+    for (int i = 1; i < NKEYS; i += 2) {
+        int n = key_of(key, sizeof(key), "t", i);
+        if (!memkv_get(tiny, key, n)) {
+            LOG("[ERROR] saturated filter hid %s", key);
+            return -1;
+        }
+    }
+
+    // 批次：新key发布时进过滤器，批内删除的key发布后减掉
+    memkv_batch_t b;
+    memkv_batch_init(&b, pool);
+    for (int i = 0; i < 100; i++) {
+        int n = key_of(key, sizeof(key), "b", i);
+        memkv_batch_set(&b, key, n, "v", 2);
+    }
+    if (memkv_batch_commit(&b) != MEMKV_SUCCESS || count_found(pool, "b", 100) != 100) {
+        LOG("[ERROR] batch keys hidden by the filter");
+        return -1;
+    }
+    for (int i = 0; i < 100; i++) {
+        int n = key_of(key, sizeof(key), "b", i);
+        memkv_batch_del(&b, key, n);
+    }
+    memkv_batch_set(&b, "b:0", 3, "again", 6);
+    if (memkv_batch_commit(&b) != MEMKV_SUCCESS || count_found(pool, "b", 100) != 1) {
+        LOG("[ERROR] batch del/set left %d keys", count_found(pool, "b", 100));
+        return -1;
+    }
+    memkv_batch_free(&b);
+    memkv_del(pool, "b:0", 3);
+    if (!filter_empty(meta)) {
+        LOG("[ERROR] batch left counters in the filter");
+        return -1;
+    }
+
+    // 淘汰：被淘汰的key也从过滤器里减掉，留下的key都能找到，全部删完后过滤器为空
+    memkv_set_evict(pool, MEMKV_EVICT_LFU, 0);
+    static char value[2048];
+    int total = 0;
+    for (; total < NKEYS * 2; total++) {
+        int n = key_of(key, sizeof(key), "e", total);
+        if (memkv_set(pool, key, n, value, sizeof(value)) != MEMKV_SUCCESS) {
+            LOG("[ERROR] set %s failed in cache mode", key);
+            return -1;
+        }
+    }
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    int alive = count_found(pool, "e", total);
+    if (st.evictions == 0 || (uint64_t)alive != st.keys) {
+        LOG("[ERROR] eviction: %lu evictions, %d keys found, %lu keys stored", st.evictions, alive, st.keys);
+        return -1;
+    }
+    for (int i = 0; i < total; i++) {
+        int n = key_of(key, sizeof(key), "e", i);
+        memkv_del(pool, key, n);
+    }
+    if (!filter_empty(meta)) {
+        LOG("[ERROR] evicted keys left counters in the filter");
+        return -1;
+    }
+
+    // 计数器加到15饱和后不再增减：多删几次也不会漏判（饱和的计数器留在过滤器里，放在最后）
+    memkv_set(pool, "sat", 3, "v", 2);
+    uint64_t h = memkv_hash("sat", 3);
+    for (int i = 0; i < 20; i++)
+        filter_add(meta, h);
+    for (int i = 0; i < 40; i++)
+        filter_del(meta, h);
+    if (!filter_maybe(meta, h) || !memkv_get(pool, "sat", 3)) {
+        LOG("[ERROR] saturated counters dropped an existing key");
+        return -1;
+    }
+    memkv_del(pool, "sat", 3);
+    if (memkv_get(pool, "sat", 3)) {
+        LOG("[ERROR] deleted key behind saturated counters still found");
+        return -1;
+    }
+    LOG("[INFO] filter test passed, %d of %d keys survived eviction", alive, total);
+    return 0;
+}
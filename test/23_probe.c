@@ -0,0 +1,68 @@
+#define POOL_SIZE (16 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+// 本测试和带 MEMKV_ENABLE_PROBE 编译的库源文件一起构建
+static uint8_t pool[POOL_SIZE];
+
+// 不到PROBE_FLUSH_OPS次操作就退出，剩余计数靠线程退出时合并
+static void *worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < 10; i++)
+        memkv_get(pool, "abc", 3);   // 下降3层，命中
+    for (int i = 0; i < 5; i++)
+        memkv_get(pool, "abx", 3);   // 下降2层后找不到
+    for (int i = 0; i < 3; i++)
+        memkv_get(pool, "zz", 2);    // 根节点下就找不到
+    memkv_del(pool, "abd", 3);
+    return NULL;
+}
+
+int main() {
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1};
+    if (memkv_init_ex(pool, sizeof(pool), &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+    memkv_set(pool, "abc", 3, "v", 2);
+    memkv_set(pool, "abd", 3, "v", 2);
+    memkv_probe_flush();
+
+    const memkv_probe_t *probe = memkv_probe(pool);
+    const memkv_probe_op_t *malloc_op = &probe->ops[MEMKV_OP_MALLOC];
+    if (!probe->enabled || malloc_op->count != 2 || malloc_op->errors || malloc_op->depth_sum != 6) {
+        LOG("[ERROR] malloc probe: enabled %u, count %lu, errors %lu, depth %lu", probe->enabled,
+            malloc_op->count, malloc_op->errors, malloc_op->depth_sum);
+        return -1;
+    }
+
+    pthread_t th;
+    pthread_create(&th, NULL, worker, NULL);
+    pthread_join(th, NULL);
+
+    // depth_sum是实际下降的层数：10*3 + 5*2 + 3*0
+    const memkv_probe_op_t *get = &probe->ops[MEMKV_OP_GET];
+    if (get->count != 18 || get->errors != 8 || get->depth_sum != 40) {
+        LOG("[ERROR] get probe after thread exit: count %lu, errors %lu, depth %lu", get->count, get->errors, get->depth_sum);
+        return -1;
+    }
+    const memkv_probe_op_t *del = &probe->ops[MEMKV_OP_DEL];
+    if (del->count != 1 || del->errors || del->depth_sum != 3) {
+        LOG("[ERROR] del probe after thread exit: count %lu, errors %lu, depth %lu", del->count, del->errors, del->depth_sum);
+        return -1;
+    }
+    uint64_t hist = 0;
+    for (int b = 0; b < MEMKV_PROBE_BUCKETS; b++)
+        hist += get->hist[b];
+    if (hist != get->count) {
+        LOG("[ERROR] get histogram holds %lu samples, expected %lu", hist, get->count);
+        return -1;
+    }
+    LOG("[INFO] probe test passed");
+    return 0;
+}
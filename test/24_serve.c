@@ -0,0 +1,143 @@
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "logutil.h"
+
+// MIAOBYTE_BIN 由构建系统给出 miaobyte 可执行文件的路径
+#ifndef MIAOBYTE_BIN
+#define MIAOBYTE_BIN "./miaobyte"
+#endif
+
+// 一次写入全部命令（pipelining），quit之后的命令不再执行
+static const char *requests =
+    "ping\n"
+    "set foo bar\n"
+    "get foo\n"
+    "set \"a b\" \"hello world\"\r\n"
+    "get \"a b\"\n"
+    "incr n 5\n"
+    "incr n -2\n"
+    "cas n 3 10\n"
+    "cas n 3 11\n"
+    "get n -i64\n"
+    "mset x 1 y 2\n"
+    "mset x 1 y\n"
+    "keys\n"
+    "keys a\n"
+    "del foo\n"
+    "get foo\n"
+    "del foo\n"
+    "bogus\n"
+    "set \"unterminated\n"
+    "\n"
+    "quit\n"
+    "ping\n";
+
+static const char *expected =
+    "+PONG\n"
+    "+OK\n"
+    "$bar\n"
+    "+OK\n"
+    "$hello world\n"
+    ":5\n"
+    ":3\n"
+    "+OK\n"
+    "-ERR cas mismatch, current value is 10\n"
+    "$10\n"
+    "+OK\n"
+    "-ERR unknown command or wrong number of arguments\n"
+    "*5\n"
+    "a b\n"
+    "foo\n"
+    "n\n"
+    "x\n"
+    "y\n"
+    "*1\n"
+    "a b\n"
+    "+OK\n"
+    "-ERR not found\n"
+    "-ERR Key not found\n"
+    "-ERR unknown command or wrong number of arguments\n"
+    "-ERR syntax error\n"
+    "+OK\n";
+
+// 把命令写入文件，从stdin喂给 miaobyte <pool> serve，读回全部响应
+static char *run_serve(const char *pool_path, const char *input, size_t *out_len) {
+    char in_path[64], cmd[256];
+    snprintf(in_path, sizeof(in_path), "/tmp/memkv_serve_in_%d", (int)getpid());
+    FILE *f = fopen(in_path, "w");
+    if (!f)
+        return NULL;
+    fputs(input, f);
+    fclose(f);
+    snprintf(cmd, sizeof(cmd), "%s %s serve < %s", MIAOBYTE_BIN, pool_path, in_path);
+    FILE *p = popen(cmd, "r");
+    if (!p) {
+        unlink(in_path);
+        return NULL;
+    }
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+    size_t got;
+    while (buf && (got = fread(buf + len, 1, cap - len - 1, p)) > 0) {
+        len += got;
+        if (cap - len == 1)
+            buf = realloc(buf, cap *= 2);
+    }
+    int status = pclose(p);
+    unlink(in_path);
+    if (!buf || status != 0) {
+        LOG("[ERROR] serve exited with status %d", status);
+        free(buf);
+        return NULL;
+    }
+    buf[len] = '\0';
+    *out_len = len;
+    return buf;
+}
+
+int main() {
+    char pool_path[64], cmd[256];
+    snprintf(pool_path, sizeof(pool_path), "/tmp/memkv_serve_%d.pool", (int)getpid());
+    unlink(pool_path);
+    snprintf(cmd, sizeof(cmd), "%s %s init 8M > /dev/null", MIAOBYTE_BIN, pool_path);
+    if (system(cmd) != 0) {
+        LOG("[ERROR] %s failed", cmd);
+        return -1;
+    }
+
+    size_t len;
+    char *out = run_serve(pool_path, requests, &len);
+    if (!out || strcmp(out, expected) != 0) {
+        LOG("[ERROR] serve replies differ, got:\n%s", out ? out : "(none)");
+        free(out);
+        unlink(pool_path);
+        return -1;
+    }
+    free(out);
+
+    // 第二个进程看到同一个池；多行响应的 *<n> 与实际行数一致，末行没有换行符也执行
+    out = run_serve(pool_path, "get x\nstats", &len);
+    if (!out || strncmp(out, "$1\n*", 4) != 0) {
+        LOG("[ERROR] second serve session: %s", out ? out : "(none)");
+        free(out);
+        unlink(pool_path);
+        return -1;
+    }
+    char *body = strchr(out + 4, '\n') + 1;
+    long lines = strtol(out + 4, NULL, 10), counted = 0;
+    for (char *p = body; *p; p++)
+        if (*p == '\n')
+            counted++;
+    free(out);
+    unlink(pool_path);
+    if (lines <= 0 || counted != lines) {
+        LOG("[ERROR] stats block announced %ld lines, sent %ld", lines, counted);
+        return -1;
+    }
+    LOG("[INFO] serve test passed");
+    return 0;
+}
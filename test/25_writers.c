@@ -0,0 +1,115 @@
+#define POOL_SIZE (128 << 20)
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define WRITERS 4
+#define KEYS_PER_WRITER 5000
+#define SHARED_KEYS 200
+#define INCRS 1000
+
+// 各writer的key交错编号，前缀大量重合，同一个父节点下经常同时挂新的子节点
+static int own_key(char *buf, size_t cap, int writer, int i) {
+    return snprintf(buf, cap, "k%06d", i * WRITERS + writer);
+}
+
+static void writer(void *pool, int w) {
+    char key[32], value[32];
+    for (int i = 0; i < KEYS_PER_WRITER; i++) {
+        int n = own_key(key, sizeof(key), w, i);
+        int m = snprintf(value, sizeof(value), "v%d", i * WRITERS + w);
+        if (memkv_set(pool, key, n, value, m + 1) != MEMKV_SUCCESS)
+            _exit(1);
+        // 所有writer都写同一批key，最后留下谁的value都行
+        if (i < SHARED_KEYS) {
+            n = snprintf(key, sizeof(key), "s%d", i);
+            m = snprintf(value, sizeof(value), "w%d", w);
+            if (memkv_set(pool, key, n, value, m + 1) != MEMKV_SUCCESS)
+                _exit(2);
+        }
+        if (i < INCRS && memkv_incr(pool, "counter", 7, 1, NULL) != MEMKV_SUCCESS)
+            _exit(3);
+        // 删掉一部分自己的key，和别人的插入交错
+        if (i % 10 == 9) {
+            n = own_key(key, sizeof(key), w, i - 1);
+            if (memkv_del(pool, key, n) != MEMKV_SUCCESS)
+                _exit(4);
+        }
+    }
+    memkv_writer_detach(pool);
+    _exit(0);
+}
+
+int main() {
+    void *pool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memkv_options_t opts = {.chartype = 256, .keymem = 6, .valueptrmem = 1, .valuemem = 1, .filter_keys = WRITERS * KEYS_PER_WRITER};
+    if (pool == MAP_FAILED || memkv_init_ex(pool, POOL_SIZE, &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex failed");
+        return -1;
+    }
+
+    pid_t pids[WRITERS];
+    for (int w = 0; w < WRITERS; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0)
+            writer(pool, w);
+    }
+    for (int w = 0; w < WRITERS; w++) {
+        int status;
+        waitpid(pids[w], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            LOG("[ERROR] writer %d failed with status %d", w, status);
+            return -1;
+        }
+    }
+
+    // 每个writer的key都在，value是自己写的；删掉的不在
+    char key[32], expect[32];
+    uint64_t alive = 0;
+    for (int w = 0; w < WRITERS; w++) {
+        for (int i = 0; i < KEYS_PER_WRITER; i++) {
+            int n = own_key(key, sizeof(key), w, i);
+            const char *v = memkv_get(pool, key, n);
+            bool deleted = i % 10 == 8;
+            snprintf(expect, sizeof(expect), "v%d", i * WRITERS + w);
+            if (deleted ? v != NULL : !v || strcmp(v, expect) != 0) {
+                LOG("[ERROR] key %s: got %s, deleted %d", key, v ? v : "(none)", deleted);
+                return -1;
+            }
+            alive += !deleted;
+        }
+    }
+    for (int i = 0; i < SHARED_KEYS; i++) {
+        int n = snprintf(key, sizeof(key), "s%d", i);
+        const char *v = memkv_get(pool, key, n);
+        if (!v || v[0] != 'w' || v[1] < '0' || v[1] >= '0' + WRITERS || v[2]) {
+            LOG("[ERROR] shared key %s holds %s", key, v ? v : "(none)");
+            return -1;
+        }
+    }
+    alive += SHARED_KEYS + 1;
+
+    // 计数器只创建一次，所有的加都在
+    int64_t total = 0;
+    if (memkv_fetch_add(pool, "counter", 7, 0, &total) != MEMKV_SUCCESS || total != WRITERS * INCRS) {
+        LOG("[ERROR] counter is %ld, expected %d", (long)total, WRITERS * INCRS);
+        return -1;
+    }
+
+    // 统计计数和节点结构与实际一致：没有重复挂上或丢掉的节点
+    memkv_stats_t st;
+    memkv_stats(pool, &st);
+    memkv_check_report_t report;
+    if (st.keys != alive || memkv_check(pool, NULL, &report) != MEMKV_SUCCESS || report.errors) {
+        LOG("[ERROR] after concurrent writers: %lu keys stored, %lu expected, %lu check errors", st.keys, alive, report.errors);
+        return -1;
+    }
+    LOG("[INFO] writers test passed, %d writers, %lu keys, %lu nodes", WRITERS, st.keys, st.nodes);
+    return 0;
+}
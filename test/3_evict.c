@@ -0,0 +1,46 @@
+#define POOL_SIZE (1 << 20) // 1MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    if (memkv_init(pool, POOL_SIZE, 256, 2, 1, 1) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    memkv_set_evict(pool, MEMKV_EVICT_LFU, 0);
+
+    // cache模式下插入远超容量的key，set不应失败
+    const char *value = "value";
+    char key[32];
+    size_t failed = 0;
+    memkv_set(pool, "hot", 3, value, strlen(value) + 1);
+    for (size_t i = 0; i < 20000; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        if (memkv_set(pool, key, strlen(key), value, strlen(value) + 1) != MEMKV_SUCCESS) {
+            failed++;
+        }
+        // 热点key持续被访问，应该一直留在池中
+        memkv_get(pool, "hot", 3);
+    }
+    if (failed) {
+        LOG("[ERROR] %zu sets failed in cache mode", failed);
+        return -1;
+    }
+    if (!memkv_get(pool, "hot", 3)) {
+        LOG("[ERROR] hot key was evicted");
+        return -1;
+    }
+    snprintf(key, sizeof(key), "key%d", 19999);
+    char *v = memkv_get(pool, key, strlen(key));
+    if (!v || strcmp(v, value) != 0) {
+        LOG("[ERROR] latest key missing after eviction");
+        return -1;
+    }
+    LOG("[INFO] eviction test passed");
+    return 0;
+}
@@ -0,0 +1,162 @@
+#define POOL_SIZE (1 << 20) // 1MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+#define NPROC 4
+#define NINCR 10000
+#define NFRESH 64
+#define NROUNDS 50
+
+int main() {
+    // 多个进程共享同一个mmap，并发incr同一个计数器
+    void *pool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED) {
+        LOG("[ERROR] mmap failed");
+        return -1;
+    }
+    if (memkv_init(pool, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    int64_t v;
+    memkv_incr(pool, "counter", 7, 0, &v);
+
+    for (int p = 0; p < NPROC; p++) {
+        if (fork() == 0) {
+            for (int i = 0; i < NINCR; i++)
+                memkv_incr(pool, "counter", 7, 1, NULL);
+            _exit(0);
+        }
+    }
+    for (int p = 0; p < NPROC; p++)
+        wait(NULL);
+
+    int64_t *counter = memkv_get(pool, "counter", 7);
+    if (!counter || *counter != NPROC * NINCR) {
+        LOG("[ERROR] counter mismatch: %lld", counter ? (long long)*counter : -1LL);
+        return -1;
+    }
+
+    int64_t actual;
+    if (memkv_cas(pool, "counter", 7, 0, 1, &actual) != MEMKV_ERROR_CAS_MISMATCH || actual != NPROC * NINCR) {
+        LOG("[ERROR] cas should fail on stale expected value");
+        return -1;
+    }
+    if (memkv_cas(pool, "counter", 7, actual, 1, NULL) != MEMKV_SUCCESS) {
+        LOG("[ERROR] cas failed");
+        return -1;
+    }
+    int64_t old;
+    memkv_fetch_add(pool, "counter", 7, -1, &old);
+    if (old != 1 || *counter != 0) {
+        LOG("[ERROR] fetch_add mismatch");
+        return -1;
+    }
+    if (memkv_fetch_add(pool, "missing", 7, 1, NULL) != MEMKV_ERROR_KEY_NOT_FOUND) {
+        LOG("[ERROR] fetch_add on missing key should fail");
+        return -1;
+    }
+
+    // 多个进程同时首次incr同一批不存在的计数器：每个只创建一次，不丢增量
+    volatile int *go = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    for (int round = 0; round < NROUNDS; round++) {
+        *go = 0;
+        for (int p = 0; p < NPROC; p++) {
+            if (fork() == 0) {
+                char key[16];
+                while (!*go)
+                    ;
+                for (int i = 0; i < NFRESH; i++) {
+                    int n = snprintf(key, sizeof(key), "fresh:%d", i);
+                    if (memkv_incr(pool, key, n, 1, NULL) != MEMKV_SUCCESS)
+                        _exit(1);
+                }
+                _exit(0);
+            }
+        }
+        __atomic_store_n(go, 1, __ATOMIC_RELEASE);
+        for (int p = 0; p < NPROC; p++) {
+            int status;
+            wait(&status);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                LOG("[ERROR] memkv_incr failed in a child");
+                return -1;
+            }
+        }
+        for (int i = 0; i < NFRESH; i++) {
+            char key[16];
+            int n = snprintf(key, sizeof(key), "fresh:%d", i);
+            int64_t *c = memkv_get(pool, key, n);
+            if (!c || *c != NPROC) {
+                LOG("[ERROR] round %d: concurrently created counter %s is %lld", round, key, c ? (long long)*c : -1LL);
+                return -1;
+            }
+            memkv_del(pool, key, n);
+        }
+    }
+    // 共享（去重）的计数器：多个进程同时incr各自触发写时复制，只复制一次，增量不丢，共享box不被重复释放
+    void *dpool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memkv_options_t opts = {.chartype = 256, .keymem = 1, .valueptrmem = 1, .valuemem = 2, .dedup_values = 64, .dedup_min = 8};
+    if (dpool == MAP_FAILED || memkv_init_ex(dpool, POOL_SIZE, &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] failed to init the dedup pool");
+        return -1;
+    }
+    int64_t zero = 0;
+    memkv_set(dpool, "pin", 3, &zero, sizeof(zero));
+    for (int round = 0; round < NROUNDS; round++) {
+        for (int i = 0; i < NFRESH; i++) {
+            char key[16];
+            int n = snprintf(key, sizeof(key), "shared:%d", i);
+            memkv_set(dpool, key, n, &zero, sizeof(zero));
+        }
+        *go = 0;
+        for (int p = 0; p < NPROC; p++) {
+            if (fork() == 0) {
+                char key[16];
+                while (!*go)
+                    ;
+                for (int i = 0; i < NFRESH; i++) {
+                    int n = snprintf(key, sizeof(key), "shared:%d", i);
+                    if (memkv_incr(dpool, key, n, 1, NULL) != MEMKV_SUCCESS)
+                        _exit(1);
+                }
+                _exit(0);
+            }
+        }
+        __atomic_store_n(go, 1, __ATOMIC_RELEASE);
+        for (int p = 0; p < NPROC; p++) {
+            int status;
+            wait(&status);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                LOG("[ERROR] memkv_incr on a shared counter failed in a child");
+                return -1;
+            }
+        }
+        for (int i = 0; i < NFRESH; i++) {
+            char key[16];
+            int n = snprintf(key, sizeof(key), "shared:%d", i);
+            int64_t *c = memkv_get(dpool, key, n);
+            if (!c || *c != NPROC) {
+                LOG("[ERROR] round %d: shared counter %s is %lld", round, key, c ? (long long)*c : -1LL);
+                return -1;
+            }
+        }
+    }
+    memkv_check_report_t rep;
+    if (*(int64_t *)memkv_get(dpool, "pin", 3) != 0 || memkv_check(dpool, NULL, &rep) != MEMKV_SUCCESS) {
+        LOG("[ERROR] shared counters corrupted the pool: %lu problems", rep.errors);
+        return -1;
+    }
+    munmap(dpool, POOL_SIZE);
+
+    LOG("[INFO] atomic test passed");
+    munmap(pool, POOL_SIZE);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#define POOL_SIZE (1 << 20) // 1MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    if (memkv_init(pool, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+
+    // 同样大小的覆盖应复用原来的box
+    memkv_set(pool, "k", 1, "aaaaaaaa", 8);
+    void *p1 = memkv_get(pool, "k", 1);
+    memkv_set(pool, "k", 1, "bbbbbbbb", 8);
+    void *p2 = memkv_get(pool, "k", 1);
+    if (p1 != p2 || memcmp(p2, "bbbbbbbb", 8) != 0) {
+        LOG("[ERROR] same-size overwrite moved the value");
+        return -1;
+    }
+
+    // realloc增长保留原有数据，缩小原地完成
+    char *v = memkv_realloc(pool, "k", 1, 4096);
+    if (!v || memcmp(v, "bbbbbbbb", 8) != 0) {
+        LOG("[ERROR] realloc grow lost data");
+        return -1;
+    }
+    memset(v + 8, 'c', 4096 - 8);
+    char *s = memkv_realloc(pool, "k", 1, 16);
+    if (s != v || memcmp(s, "bbbbbbbbcccccccc", 16) != 0) {
+        LOG("[ERROR] realloc shrink was not in place");
+        return -1;
+    }
+    char *g = memkv_realloc(pool, "k", 1, 2048);
+    if (g != v) {
+        LOG("[ERROR] realloc within capacity was not in place");
+        return -1;
+    }
+
+    // key不存在时realloc等同于malloc
+    if (!memkv_realloc(pool, "new", 3, 8) || !memkv_get(pool, "new", 3)) {
+        LOG("[ERROR] realloc on missing key failed");
+        return -1;
+    }
+    LOG("[INFO] realloc test passed");
+    return 0;
+}
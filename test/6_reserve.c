@@ -0,0 +1,50 @@
+#define POOL_SIZE (1 << 20) // 1MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memkv/memkv.h>
+#include "logutil.h"
+
+int main() {
+    static uint8_t pool[POOL_SIZE];
+    if (memkv_init(pool, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    memkv_set(pool, "doc", 3, "old", 4);
+
+    // reserve之后、commit之前，读者只能看到旧value
+    memkv_reservation_t res;
+    char *buf = memkv_reserve(pool, 64, &res);
+    if (!buf) {
+        LOG("[ERROR] reserve failed");
+        return -1;
+    }
+    strcpy(buf, "new value");
+    char *v = memkv_get(pool, "doc", 3);
+    if (!v || strcmp(v, "old") != 0) {
+        LOG("[ERROR] reserved value visible before commit");
+        return -1;
+    }
+    if (memkv_commit(pool, "doc", 3, &res, strlen("new value") + 1) != MEMKV_SUCCESS) {
+        LOG("[ERROR] commit failed");
+        return -1;
+    }
+    v = memkv_get(pool, "doc", 3);
+    if (v != buf || strcmp(v, "new value") != 0) {
+        LOG("[ERROR] committed value mismatch");
+        return -1;
+    }
+
+    // abort之后key不存在
+    buf = memkv_reserve(pool, 128, &res);
+    memset(buf, 'x', 128);
+    memkv_abort(pool, &res);
+    if (memkv_get(pool, "tmp", 3) != NULL || memkv_commit(pool, "tmp", 3, &res, 1) != MEMKV_ERROR_INVALID_ARG) {
+        LOG("[ERROR] aborted reservation is still usable");
+        return -1;
+    }
+    LOG("[INFO] reserve test passed");
+    return 0;
+}
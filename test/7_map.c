@@ -0,0 +1,67 @@
+#define POOL_SIZE (16 << 20) // 16MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+#define POOL_FILE "/tmp/memkv_test_map.pool"
+
+int main() {
+    // 匿名映射：基址与各区偏移都应按大页对齐，并行预取不改变内容
+    memkv_map_options_t mopts = {.size = POOL_SIZE, .hugepage = true, .prefault_threads = 4};
+    size_t len = 0;
+    void *pool = memkv_map(NULL, &mopts, &len);
+    if (!pool || len != POOL_SIZE || (uintptr_t)pool % MEMKV_HUGEPAGE_SIZE) {
+        LOG("[ERROR] anonymous hugepage mapping failed or misaligned");
+        return -1;
+    }
+    memkv_options_t opts = {.chartype = 256, .keymem = 1, .valueptrmem = 1, .valuemem = 2,
+                            .region_align = MEMKV_HUGEPAGE_SIZE};
+    if (memkv_init_ex(pool, len, &opts) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkv_init_ex with region_align failed");
+        return -1;
+    }
+    memkv_meta_t *meta = pool;
+    if (meta->key_offset % MEMKV_HUGEPAGE_SIZE || meta->valueptr_offset % MEMKV_HUGEPAGE_SIZE ||
+        meta->value_offset % MEMKV_HUGEPAGE_SIZE) {
+        LOG("[ERROR] region offsets are not hugepage aligned");
+        return -1;
+    }
+    if (memkv_set(pool, "k", 1, "v", 2) != MEMKV_SUCCESS || strcmp(memkv_get(pool, "k", 1), "v") != 0) {
+        LOG("[ERROR] set/get on aligned pool failed");
+        return -1;
+    }
+    memkv_unmap(pool, len);
+
+    opts.region_align = 3;
+    static uint8_t small[1 << 20];
+    if (memkv_init_ex(small, sizeof(small), &opts) != MEMKV_ERROR_INVALID_ARG) {
+        LOG("[ERROR] non power-of-two region_align accepted");
+        return -1;
+    }
+
+    // 文件映射：创建并扩展文件，重新映射（size=0使用文件大小）后数据仍在
+    unlink(POOL_FILE);
+    mopts = (memkv_map_options_t){.size = 4 << 20, .prefault_threads = 1};
+    pool = memkv_map(POOL_FILE, &mopts, &len);
+    if (!pool || memkv_init(pool, len, 256, 1, 1, 2) != MEMKV_SUCCESS) {
+        LOG("[ERROR] file mapping failed");
+        return -1;
+    }
+    memkv_set(pool, "file", 4, "kept", 5);
+    memkv_unmap(pool, len);
+    mopts = (memkv_map_options_t){.prefault_threads = 2};
+    pool = memkv_map(POOL_FILE, &mopts, &len);
+    if (!pool || len != 4 << 20 || strcmp(memkv_get(pool, "file", 4), "kept") != 0) {
+        LOG("[ERROR] remapped file lost data");
+        return -1;
+    }
+    memkv_unmap(pool, len);
+    unlink(POOL_FILE);
+    LOG("[INFO] map test passed");
+    return 0;
+}
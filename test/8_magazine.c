@@ -0,0 +1,105 @@
+#define POOL_SIZE (1 << 20) // 1MB内存池
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include "memkv_common.h"
+#include "logutil.h"
+
+static int owned_slots(memkv_meta_t *meta) {
+    writer_slot_t *slots = (void *)meta + meta->writers_offset;
+    int n = 0;
+    for (int i = 0; i < MEMKV_WRITER_SLOTS; i++)
+        n += slots[i].owner != 0;
+    return n;
+}
+
+// 子进程写入后退出：detach为false时不归还缓存，模拟崩溃的writer
+static void child_writes(void *pool, bool detach) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        char key[32];
+        for (int i = 0; i < 20; i++) {
+            snprintf(key, sizeof(key), "child%d", i);
+            memkv_set(pool, key, strlen(key), "value", 6);
+        }
+        for (int i = 0; i < 20; i += 2) {
+            snprintf(key, sizeof(key), "child%d", i);
+            memkv_del(pool, key, strlen(key));
+        }
+        if (detach)
+            memkv_writer_detach(pool);
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+static size_t fill(void *pool) {
+    char key[32];
+    size_t n = 0;
+    for (;; n++) {
+        snprintf(key, sizeof(key), "fill%zu", n);
+        if (memkv_set(pool, key, strlen(key), "value", 6) != MEMKV_SUCCESS)
+            return n;
+    }
+}
+
+int main() {
+    void *pool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED || memkv_init(pool, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init failed");
+        return -1;
+    }
+    memkv_meta_t *meta = pool;
+
+    // detach后槽位释放，缓存还给全局分配器
+    memkv_set(pool, "a", 1, "1", 2);
+    if (owned_slots(meta) != 1) {
+        LOG("[ERROR] writer did not take a slot");
+        return -1;
+    }
+    memkv_writer_detach(pool);
+    if (owned_slots(meta) != 0) {
+        LOG("[ERROR] detach did not release the slot");
+        return -1;
+    }
+
+    // 子进程写入后直接退出，不归还缓存
+    child_writes(pool, false);
+    if (owned_slots(meta) != 1) {
+        LOG("[ERROR] exited writer's slot should still be owned");
+        return -1;
+    }
+    if (magazine_reclaim(meta) != 1 || owned_slots(meta) != 0) {
+        LOG("[ERROR] exited writer's cache was not reclaimed");
+        return -1;
+    }
+    if (!memkv_get(pool, "child1", 6) || memkv_get(pool, "child0", 6)) {
+        LOG("[ERROR] data written by the exited writer is wrong");
+        return -1;
+    }
+
+    // 回收后分配失败前能装下的数量，不应少于没有崩溃writer时：
+    // 对照池里做同样的写入，只是子进程正常detach
+    void *base = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED || memkv_init(base, POOL_SIZE, 256, 1, 1, 2) != 0) {
+        LOG("[ERROR] memkv_init of the baseline pool failed");
+        return -1;
+    }
+    memkv_set(base, "a", 1, "1", 2);
+    memkv_writer_detach(base);
+    child_writes(base, true);
+    size_t expected = fill(base);
+    memkv_writer_detach(base);
+    size_t n = fill(pool);
+    if (n == 0 || n < expected) {
+        LOG("[ERROR] pool holds %zu keys after reclaim, %zu without a crashed writer", n, expected);
+        return -1;
+    }
+    LOG("[INFO] magazine test passed, filled %zu keys (baseline %zu)", n, expected);
+    return 0;
+}
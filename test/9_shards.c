@@ -0,0 +1,106 @@
+#define SHARD_SIZE (1 << 20) // 每个分片1MB
+#define NSHARDS 4
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <memkv/memkv.h>
+#include <memkv/memkvs.h>
+#include "logutil.h"
+
+#define NKEYS 300
+#define SHARD_FILE "/tmp/memkv_test_shard.%u"
+
+static char last[64];
+static size_t last_len;
+static int listed;
+static int unordered;
+
+static void check_key(const void *key_data, size_t key_len) {
+    int c = memcmp(last, key_data, last_len < key_len ? last_len : key_len);
+    if (listed && (c > 0 || (c == 0 && last_len >= key_len)))
+        unordered++;
+    memcpy(last, key_data, key_len);
+    last_len = key_len;
+    listed++;
+}
+
+int main() {
+    static uint8_t mem[NSHARDS][SHARD_SIZE];
+    void *pools[NSHARDS];
+    size_t lens[NSHARDS];
+    for (int i = 0; i < NSHARDS; i++) {
+        pools[i] = mem[i];
+        lens[i] = SHARD_SIZE;
+    }
+    memkv_options_t init = {.chartype = 256, .keymem = 1, .valueptrmem = 1, .valuemem = 2};
+    memkvs_t kvs;
+    if (memkvs_attach(&kvs, pools, lens, NSHARDS, &init) != MEMKV_SUCCESS) {
+        LOG("[ERROR] memkvs_attach failed");
+        return -1;
+    }
+
+    // 点操作按哈希路由，每个分片都应分到key
+    int per_shard[NSHARDS] = {0};
+    char key[32];
+    for (int i = 0; i < NKEYS; i++) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        if (memkvs_set(&kvs, key, strlen(key), &i, sizeof(i)) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkvs_set %s failed", key);
+            return -1;
+        }
+        per_shard[memkvs_shard(&kvs, key, strlen(key))]++;
+    }
+    for (int i = 0; i < NSHARDS; i++) {
+        if (per_shard[i] == 0) {
+            LOG("[ERROR] shard %d got no keys", i);
+            return -1;
+        }
+    }
+    for (int i = 0; i < NKEYS; i++) {
+        snprintf(key, sizeof(key), "k%03d", i);
+        int *v = memkvs_get(&kvs, key, strlen(key));
+        if (!v || *v != i || memkv_get(pools[memkvs_shard(&kvs, key, strlen(key))], key, strlen(key)) != v) {
+            LOG("[ERROR] memkvs_get %s returned wrong value", key);
+            return -1;
+        }
+    }
+
+    // keys对各分片做k路归并，结果有序且不重不漏
+    memkvs_del(&kvs, "k000", 4);
+    memkvs_keys(&kvs, "k", 1, check_key);
+    if (listed != NKEYS - 1 || unordered) {
+        LOG("[ERROR] merged keys: %d listed, %d out of order", listed, unordered);
+        return -1;
+    }
+    listed = 0;
+    memkvs_keys(&kvs, "k1", 2, check_key);
+    if (listed != 100 || unordered) {
+        LOG("[ERROR] merged prefix keys: %d listed, %d out of order", listed, unordered);
+        return -1;
+    }
+    memkvs_close(&kvs);
+
+    // 分片文件：关闭后重新打开，路由不变，数据仍在
+    memkvs_options_t opts = {.init = init, .map = {.size = SHARD_SIZE}};
+    for (int i = 0; i < 2; i++) {
+        if (memkvs_open(&kvs, SHARD_FILE, 3, &opts) != MEMKV_SUCCESS) {
+            LOG("[ERROR] memkvs_open failed");
+            return -1;
+        }
+        int64_t v;
+        if (memkvs_incr(&kvs, "counter", 7, 1, &v) != MEMKV_SUCCESS || v != i + 1) {
+            LOG("[ERROR] counter is %lld after reopen %d", (long long)v, i);
+            return -1;
+        }
+        memkvs_close(&kvs);
+    }
+    for (unsigned i = 0; i < 3; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), SHARD_FILE, i);
+        unlink(path);
+    }
+    LOG("[INFO] shards test passed");
+    return 0;
+}
@@ -94,6 +94,7 @@ void test_get(void *mem_pool_data, size_t mem_pool_len) {
 int main() {
     LOG("Starting triekv test");
     uint8_t pool[POOL_SIZE];
+    test_meta(pool, POOL_SIZE);
     test_set(pool, POOL_SIZE);
 
     uint8_t mapped_prefix[256];